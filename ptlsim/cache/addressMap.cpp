@@ -0,0 +1,95 @@
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * This code is released under GPL.
+ *
+ */
+
+#include <addressMap.h>
+
+using namespace Memory;
+
+int Memory::parse_interleave(const char* name)
+{
+    if (strequal(name, "line"))
+        return INTERLEAVE_LINE;
+    if (strequal(name, "page"))
+        return INTERLEAVE_PAGE;
+    if (strequal(name, "xor"))
+        return INTERLEAVE_XOR;
+    return -1;
+}
+
+AddressMap::AddressMap()
+    : controllers_(1)
+    , interleave_(INTERLEAVE_LINE)
+    , nodes_(1)
+    , perNode_(1)
+    , nodeSize_(0)
+    , coresPerNode_(1)
+{}
+
+/**
+ * @brief Set up the mapping
+ *
+ * @param controllers Number of memory controllers
+ * @param interleave Interleaving function inside a node
+ * @param nodes Number of NUMA nodes, must divide controllers
+ * @param node_size Bytes of physical memory in each node
+ * @param cores_per_node Number of cores in each node
+ *
+ * @return false if parameters are invalid, mapping is then left unchanged
+ */
+bool AddressMap::setup(int controllers, int interleave, int nodes,
+        W64 node_size, int cores_per_node)
+{
+    if (controllers <= 0 || nodes <= 0 || controllers % nodes != 0 ||
+            cores_per_node <= 0 || interleave < INTERLEAVE_LINE ||
+            interleave > INTERLEAVE_XOR)
+        return false;
+
+    if (nodes > 1 && node_size == 0)
+        return false;
+
+    controllers_ = controllers;
+    interleave_ = interleave;
+    nodes_ = nodes;
+    perNode_ = controllers / nodes;
+    nodeSize_ = node_size;
+    coresPerNode_ = cores_per_node;
+    return true;
+}
+
+int AddressMap::get_node(W64 addr) const
+{
+    if (nodes_ == 1)
+        return 0;
+
+    return min(addr / nodeSize_, W64(nodes_ - 1));
+}
+
+int AddressMap::get_controller(W64 addr) const
+{
+    W64 index;
+
+    switch (interleave_) {
+        case INTERLEAVE_PAGE:
+            index = addr >> 12;
+            break;
+        case INTERLEAVE_XOR:
+            /* Spread strided accesses by folding row and page bits */
+            index = (addr >> 6) ^ (addr >> 12) ^ (addr >> 20);
+            break;
+        default:
+            index = addr >> 6;
+            break;
+    }
+
+    return get_node(addr) * perNode_ + (index % perNode_);
+}
+
+int AddressMap::hops(int node1, int node2) const
+{
+    int dist = abs(node1 - node2);
+    return min(dist, nodes_ - dist);
+}
@@ -0,0 +1,75 @@
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * This code is released under GPL.
+ *
+ */
+
+#ifndef ADDRESS_MAP_H
+#define ADDRESS_MAP_H
+
+#include <globals.h>
+#include <superstl.h>
+
+namespace Memory {
+
+/* Functions to interleave addresses across memory controllers */
+enum {
+    INTERLEAVE_LINE = 0,    // Consecutive cache lines
+    INTERLEAVE_PAGE,        // Consecutive 4KB pages
+    INTERLEAVE_XOR,         // Cache line address XORed with higher bits
+};
+
+/**
+ * @brief Map physical addresses to memory controllers and NUMA nodes
+ *
+ * Physical memory is split into contiguous ranges of node_size bytes, one
+ * for each NUMA node, and the last node also gets everything above. Each
+ * node owns an equal share of the memory controllers, in order, and its
+ * addresses are interleaved across them. Cores are assigned to nodes in
+ * order, cores_per_node each. Nodes are connected in a ring, so the
+ * distance between two nodes is the number of ring hops.
+ */
+class AddressMap {
+    public:
+        AddressMap();
+
+        bool setup(int controllers, int interleave, int nodes = 1,
+                W64 node_size = 0, int cores_per_node = 1);
+
+        int get_controller(W64 addr) const;
+        int get_node(W64 addr) const;
+
+        int get_controller_node(int controller) const {
+            return controller / perNode_;
+        }
+
+        int get_core_node(int coreid) const {
+            return min(coreid / coresPerNode_, nodes_ - 1);
+        }
+
+        int hops(int node1, int node2) const;
+
+        int get_nodes() const { return nodes_; }
+        int get_interleave() const { return interleave_; }
+        W64 get_node_size() const { return nodeSize_; }
+
+    private:
+        int controllers_;
+        int interleave_;
+        int nodes_;
+        int perNode_;
+        W64 nodeSize_;
+        int coresPerNode_;
+};
+
+/**
+ * @brief Parse name of an interleaving function
+ *
+ * @return INTERLEAVE_* value or -1 if name is unknown
+ */
+int parse_interleave(const char* name);
+
+};
+
+#endif // ADDRESS_MAP_H
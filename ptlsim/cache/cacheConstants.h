@@ -43,6 +43,7 @@ namespace Memory{
 
 	const int REQUEST_POOL_SIZE = 1024;
 	const double REQUEST_POOL_LOW_RATIO = 0.1;
+	const int REQUEST_POOL_CHUNK_SIZE = 256;
 
 	/* CPU Controller */
 	const int CPU_CONT_PENDING_REQ_SIZE = 128;
@@ -61,6 +62,13 @@ namespace Memory{
 	 */
 	const int MEM_BANKS = 64;
 
+	/* Maximum number of global directory slices */
+	const int DIR_MAX_SLICES = 64;
+
+	/* Maximum number of routers of a network on chip, each has 4 links */
+	const int NOC_MAX_NODES = 64;
+	const int NOC_MAX_LINKS = NOC_MAX_NODES * 4;
+
 	/* Average wait dealy for retrying (general) */
 	const int AVG_WAIT_DELAY = 5;
 }
@@ -58,11 +58,16 @@ CacheController::CacheController(W8 coreid, const char *name,
     , wt_disabled_(true)
 	, prefetchEnabled_(false)
 	, prefetchDelay_(1)
+	, prefetchThrottle_(70)
+	, prefetcher_(NULL)
+	, prefetchStats_(NULL)
     , new_stats(name, &memoryHierarchy->get_machine())
+    , mshrStats_("mshr", &new_stats)
 {
     memoryHierarchy_->add_cache_mem_controller(this);
 
-    cacheLines_ = get_cachelines(type);
+    cacheLines_ = create_cachelines(memoryHierarchy_->get_machine(),
+            name, type);
 
     if(!memoryHierarchy_->get_machine().get_option(name, "last_private", isLowestPrivate_)) {
         isLowestPrivate_ = false;
@@ -73,6 +78,8 @@ CacheController::CacheController(W8 coreid, const char *name,
 
 	cacheLines_->init();
 
+    setup_prefetcher();
+
     SET_SIGNAL_CB(name, "_Cache_Hit", cacheHit_, &CacheController::cache_hit_cb);
 
     SET_SIGNAL_CB(name, "_Cache_Miss", cacheMiss_, &CacheController::cache_miss_cb);
@@ -108,41 +115,82 @@ CacheController::CacheController(W8 coreid, const char *name,
 
 CacheController::~CacheController()
 {
+    delete prefetcher_;
+    delete prefetchStats_;
+}
+
+/**
+ * @brief Attach a prefetcher selected with 'prefetcher' option
+ *
+ * Options are prefetcher (next_line, stride, stream or region),
+ * prefetch_degree, prefetch_distance, prefetch_table_size,
+ * prefetch_region_lines, prefetch_delay in cycles and prefetch_throttle, the
+ * pending queue occupancy in percent above which prefetches are dropped.
+ */
+void CacheController::setup_prefetcher()
+{
+    const char *name = get_name();
+    BaseMachine &machine = memoryHierarchy_->get_machine();
+
+    stringbuf type;
+    if (!machine.get_option(name, "prefetcher", type) ||
+            strequal(type.buf, "none"))
+        return;
+
+    PrefetcherConfig pconf;
+    machine.get_option(name, "prefetch_degree", pconf.degree);
+    machine.get_option(name, "prefetch_distance", pconf.distance);
+    machine.get_option(name, "prefetch_table_size", pconf.table_size);
+    machine.get_option(name, "prefetch_region_lines", pconf.region_lines);
+    machine.get_option(name, "prefetch_delay", prefetchDelay_);
+    machine.get_option(name, "prefetch_throttle", prefetchThrottle_);
+
+    prefetcher_ = PrefetcherBuilder::create(type.buf, pconf);
+
+    if (!prefetcher_) {
+        stringbuf err;
+        err << "Warning: unknown prefetcher " << type << " for " <<
+            name << ", prefetching is disabled" << endl;
+        ptl_logfile << err;
+        cerr << err;
+        return;
+    }
+
+    prefetchEnabled_ = true;
+    prefetchStats_ = new PrefetchStats("prefetch", &new_stats);
 }
 
 CacheQueueEntry* CacheController::find_dependency(MemoryRequest *request)
 {
 	W64 requestLineAddress = get_line_address(request);
 
-	CacheQueueEntry* queueEntry;
-	foreach_list_mutable(pendingRequests_.list(), queueEntry, entry,
-			prevEntry) {
+	for(CacheQueueEntry* queueEntry = pendingRequests_.first(
+				requestLineAddress); queueEntry;
+			queueEntry = pendingRequests_.next(queueEntry)) {
 
 		if(request == queueEntry->request || queueEntry->annuled)
 			continue;
 
-		if(get_line_address(queueEntry->request) == requestLineAddress) {
-			// Found an entry with same line address, check if other
-			// entry also depends on this entry or not and to
-			// maintain a chain of dependent entries, return the
-			// last entry in the chain
-			while(queueEntry->depends >= 0) {
-                if(pendingRequests_[queueEntry->depends].annuled)
-                    break;
-				queueEntry = &pendingRequests_[queueEntry->depends];
-            }
-
-			return queueEntry;
+		// Found an entry with same line address, check if other
+		// entry also depends on this entry or not and to
+		// maintain a chain of dependent entries, return the
+		// last entry in the chain
+		while(queueEntry->depends >= 0) {
+			if(pendingRequests_[queueEntry->depends].annuled)
+				break;
+			queueEntry = &pendingRequests_[queueEntry->depends];
 		}
+
+		return queueEntry;
 	}
 	return NULL;
 }
 
 CacheQueueEntry* CacheController::find_match(MemoryRequest *request)
 {
-	CacheQueueEntry* queueEntry;
-	foreach_list_mutable(pendingRequests_.list(), queueEntry, entry,
-			prevEntry) {
+	for(CacheQueueEntry* queueEntry = pendingRequests_.first(
+				get_line_address(request)); queueEntry;
+			queueEntry = pendingRequests_.next(queueEntry)) {
 		if(request == queueEntry->request)
 			return queueEntry;
 	}
@@ -150,6 +198,20 @@ CacheQueueEntry* CacheController::find_match(MemoryRequest *request)
 	return NULL;
 }
 
+void CacheController::track_entry(CacheQueueEntry *queueEntry)
+{
+	MemoryRequest *request = queueEntry->request;
+	bool kernel_req = request->is_kernel();
+
+	if(pendingRequests_.track(queueEntry, get_line_address(request))) {
+		N_STAT_UPDATE(mshrStats_.merged, ++, kernel_req);
+	}
+
+	N_STAT_UPDATE(mshrStats_.requests, ++, kernel_req);
+	N_STAT_UPDATE(mshrStats_.occupancy, += pendingRequests_.mshr_count(),
+			kernel_req);
+}
+
 void CacheController::print(ostream& os) const
 {
 	os << "---Cache-Controller: " << get_name() << endl;
@@ -200,6 +262,7 @@ bool CacheController::handle_interconnect_cb(void *arg)
 		queueEntry->source = (Controller*)msg->origin;
 		queueEntry->dest = (Controller*)msg->dest;
 		queueEntry->request->incRefCounter();
+		track_entry(queueEntry);
 		ADD_HISTORY_ADD(queueEntry->request);
 
         /*
@@ -231,6 +294,9 @@ bool CacheController::handle_interconnect_cb(void *arg)
 			dependsOn->dependsAddr = queueEntry->request->get_physical_address();
 			OP_TYPE type = queueEntry->request->get_type();
             bool kernel_req = queueEntry->request->is_kernel();
+			if(dependsOn->prefetch && !dependsOn->prefetchCompleted) {
+				N_STAT_UPDATE(prefetchStats_->late, ++, kernel_req);
+			}
 			if(type == MEMORY_OP_READ) {
 				N_STAT_UPDATE(new_stats.cpurequest.stall.read.dependency, ++, kernel_req);
 			} else if(type == MEMORY_OP_WRITE) {
@@ -315,6 +381,7 @@ bool CacheController::handle_interconnect_cb(void *arg)
 					newEntry->source = (Controller*)msg->origin;
 					newEntry->dest = (Controller*)msg->dest;
 					newEntry->request->incRefCounter();
+					track_entry(newEntry);
 					ADD_HISTORY_ADD(newEntry->request);
 
 					newEntry->eventFlags[CACHE_ACCESS_EVENT]++;
@@ -496,9 +563,14 @@ bool CacheController::cache_insert_cb(void *arg)
             if(wt_disabled_ && line->state == LINE_MODIFIED) {
                 send_update_message(queueEntry, oldTag);
 			}
+			if(line->prefetched && prefetchStats_) {
+				N_STAT_UPDATE(prefetchStats_->useless, ++,
+						queueEntry->request->is_kernel());
+			}
 		}
 
         line->state = LINE_VALID;
+        line->prefetched = queueEntry->prefetch;
         line->init(cacheLines_->tagOf(queueEntry->request->
                     get_physical_address()));
 
@@ -557,7 +629,9 @@ bool CacheController::cache_access_cb(void *arg)
 				delay = cacheAccessLatency_;
 				queueEntry->eventFlags[CACHE_HIT_EVENT]++;
 
-				if(type == MEMORY_OP_READ) {
+				if(queueEntry->prefetch) {
+					/* Don't count prefetches as demand hits */
+				} else if(type == MEMORY_OP_READ) {
 					N_STAT_UPDATE(new_stats.cpurequest.count.hit.read.hit, ++,
 							kernel_req);
 				} else if(type == MEMORY_OP_WRITE) {
@@ -613,16 +687,15 @@ bool CacheController::cache_access_cb(void *arg)
 				delay = cacheAccessLatency_;
 				queueEntry->eventFlags[CACHE_MISS_EVENT]++;
 
-				if(type == MEMORY_OP_READ) {
+				if(queueEntry->prefetch) {
+					/* Don't count prefetches as demand misses */
+				} else if(type == MEMORY_OP_READ) {
 					N_STAT_UPDATE(new_stats.cpurequest.count.miss.read, ++,
 							kernel_req);
 				} else if(type == MEMORY_OP_WRITE) {
 					N_STAT_UPDATE(new_stats.cpurequest.count.miss.write, ++,
 							kernel_req);
 				}
-
-				if(!queueEntry->prefetch && type == MEMORY_OP_READ)
-					do_prefetch(queueEntry->request);
 			}
             /* else its update and its a cache miss, so ignore that */
 			else {
@@ -638,6 +711,12 @@ bool CacheController::cache_access_cb(void *arg)
                 }
 			}
 		}
+
+		if(prefetchEnabled_ && !queueEntry->prefetch &&
+				(type == MEMORY_OP_READ || type == MEMORY_OP_WRITE)) {
+			train_prefetcher(queueEntry, hit, line);
+		}
+
 		marss_add_event(signal, delay,
 				(void*)queueEntry);
 		return true;
@@ -771,14 +850,16 @@ bool CacheController::clear_entry_cb(void *arg)
 			}
 
 			// make sure that no pending entry will wake up the removed entry (in the case of annuled)
+			// only entries of the same line depend on each other
 			int removed_idx = queueEntry->idx;
-			CacheQueueEntry *tmpEntry;
-			foreach_list_mutable(pendingRequests_.list(), tmpEntry, entry, nextentry) {
+			for(CacheQueueEntry *tmpEntry = pendingRequests_.first_of(
+						queueEntry); tmpEntry;
+					tmpEntry = pendingRequests_.next(tmpEntry)) {
 				if(tmpEntry->depends == removed_idx) {
 					tmpEntry->depends = -1;
 					tmpEntry->dependsAddr = -1;
 				}
-            }
+			}
 			pendingRequests_.free(queueEntry);
 		}
 
@@ -796,9 +877,12 @@ bool CacheController::clear_entry_cb(void *arg)
 
 void CacheController::annul_request(MemoryRequest *request)
 {
-	CacheQueueEntry *queueEntry;
-	foreach_list_mutable(pendingRequests_.list(), queueEntry,
-			entry, nextentry) {
+	// Same requests have the same address, free() keeps next entry valid
+	CacheQueueEntry *nextEntry;
+	for(CacheQueueEntry *queueEntry = pendingRequests_.first(
+				get_line_address(request)); queueEntry;
+			queueEntry = nextEntry) {
+		nextEntry = pendingRequests_.next(queueEntry);
 		if(queueEntry->request->is_same(request)) {
             queueEntry->eventFlags.reset();
             clear_entry_cb(queueEntry);
@@ -807,6 +891,44 @@ void CacheController::annul_request(MemoryRequest *request)
 	}
 }
 
+/**
+ * @brief Functional warming access, updates tags and line state only
+ *
+ * @param request Read or write request of a core
+ * @param shared Unused, this cache has no coherence states
+ *
+ * @return true if lower levels don't need to see this access
+ */
+bool CacheController::warm_access(MemoryRequest *request, bool shared)
+{
+	bool is_write = (request->get_type() == MEMORY_OP_WRITE);
+	CacheLine *line = cacheLines_->probe(request);
+
+	if(line && line->state != LINE_NOT_VALID) {
+		if(is_write && wt_disabled_)
+			line->state = LINE_MODIFIED;
+		return !(is_write && !wt_disabled_);
+	}
+
+	W64 oldTag = InvalidTag<W64>::INVALID;
+	line = cacheLines_->insert(request, oldTag);
+	line->init(cacheLines_->tagOf(request->get_physical_address()));
+	line->state = (is_write && wt_disabled_) ? LINE_MODIFIED : LINE_VALID;
+	line->prefetched = 0;
+
+	return false;
+}
+
+void CacheController::save_warm_state(ostream& os)
+{
+	cacheLines_->save_state(os);
+}
+
+bool CacheController::restore_warm_state(istream& is)
+{
+	return cacheLines_->restore_state(is);
+}
+
 bool CacheController::send_update_message(CacheQueueEntry *queueEntry,
 		W64 tag)
 {
@@ -835,6 +957,7 @@ bool CacheController::send_update_message(CacheQueueEntry *queueEntry,
 	new_entry->sender = NULL;
 	new_entry->sendTo = lowerInterconnect_;
 	request->incRefCounter();
+	track_entry(new_entry);
 	ADD_HISTORY_ADD(request);
 
 	new_entry->eventFlags[
@@ -845,28 +968,93 @@ bool CacheController::send_update_message(CacheQueueEntry *queueEntry,
 	return true;
 }
 
-void CacheController::do_prefetch(MemoryRequest *request, int additional_delay)
+/**
+ * @brief Train prefetcher with a demand access and issue its prefetches
+ *
+ * @param queueEntry Entry of the demand request
+ * @param hit True if the request hit in the cache
+ * @param line Cache line of the request if it hit
+ */
+void CacheController::train_prefetcher(CacheQueueEntry *queueEntry, bool hit,
+		CacheLine *line)
+{
+	MemoryRequest *request = queueEntry->request;
+	bool kernel_req = request->is_kernel();
+
+	PrefetchAccess access;
+	access.line = get_line_address(request);
+	access.pc = request->get_owner_rip();
+	access.miss = !hit;
+	access.prefetchHit = (hit && line->prefetched);
+	access.isWrite = (request->get_type() == MEMORY_OP_WRITE);
+
+	if(access.prefetchHit) {
+		line->prefetched = 0;
+		N_STAT_UPDATE(prefetchStats_->useful, ++, kernel_req);
+	}
+
+	if(access.miss || access.prefetchHit) {
+		N_STAT_UPDATE(prefetchStats_->demand, ++, kernel_req);
+	}
+
+	prefetchLines_.clear();
+	prefetcher_->access(access, prefetchLines_);
+
+	foreach(i, prefetchLines_.count()) {
+		if(!do_prefetch(request, prefetchLines_[i] << cacheLineBits_, i)) {
+			N_STAT_UPDATE(prefetchStats_->throttled,
+					+= prefetchLines_.count() - i, kernel_req);
+			break;
+		}
+	}
+}
+
+/**
+ * @brief Issue a prefetch of one cache line
+ *
+ * @param request Demand request that triggered the prefetch
+ * @param address Address of the line to prefetch
+ * @param additional_delay Cycles to wait in addition to prefetch delay
+ *
+ * @return false if the pending queue is too full to prefetch
+ */
+bool CacheController::do_prefetch(MemoryRequest *request, W64 address,
+		int additional_delay)
 {
 	if(!prefetchEnabled_)
-		return;
+		return false;
 
     /*
 	 * Don't prefetch if our pending request queue is almost full
 	 * This makes sure that we have some space in queue for new requests
      */
-	if(pendingRequests_.count() > pendingRequests_.size() * 0.7)
-		return;
+	if(pendingRequests_.count() * 100 >=
+			pendingRequests_.size() * prefetchThrottle_)
+		return false;
+
+	/* Skip lines that are already requested */
+	W64 line_address = address >> cacheLineBits_;
+	for(CacheQueueEntry *queueEntry = pendingRequests_.first(line_address);
+			queueEntry; queueEntry = pendingRequests_.next(queueEntry)) {
+		if(!queueEntry->annuled)
+			return true;
+	}
 
 	MemoryRequest *new_request = memoryHierarchy_->get_free_request(
             request->get_coreid());
 	assert(new_request);
 
 	new_request->init(request);
-
-	/* Now generate a new address for the prefetch */
-	W64 next_line_address = get_line_address(request);
-	next_line_address = (next_line_address + 1) << cacheLineBits_;
-	new_request->set_physical_address(next_line_address);
+	new_request->set_physical_address(address);
+	new_request->set_op_type(MEMORY_OP_READ);
+
+	/*
+	 * Skip lines that are already cached, the request is freed unused.
+	 * Use peek so a prefetch check does not count as a use of the line.
+	 */
+	CacheLine *line = cacheLines_->peek(new_request);
+	if(line && line->state != LINE_NOT_VALID)
+		return true;
 
 	CacheQueueEntry *new_entry = pendingRequests_.alloc();
 	assert(new_entry);
@@ -877,10 +1065,16 @@ void CacheController::do_prefetch(MemoryRequest *request, int additional_delay)
 	new_entry->prefetch = true;
 	new_entry->annuled = false;
 	new_request->incRefCounter();
+	track_entry(new_entry);
 	ADD_HISTORY_ADD(new_request);
 
+	N_STAT_UPDATE(prefetchStats_->issued, ++, request->is_kernel());
+
+	new_entry->eventFlags[CACHE_ACCESS_EVENT]++;
 	marss_add_event(&cacheAccess_, prefetchDelay_+additional_delay,
 		   new_entry);
+
+	return true;
 }
 
 /**
@@ -897,10 +1091,19 @@ void CacheController::dump_configuration(YAML::Emitter &out) const
 	YAML_KEY_VAL(out, "sets", cacheLines_->get_set_count());
 	YAML_KEY_VAL(out, "ways", cacheLines_->get_way_count());
 	YAML_KEY_VAL(out, "line_size", cacheLines_->get_line_size());
+	YAML_KEY_VAL(out, "replacement", cacheLines_->get_replacement());
 	YAML_KEY_VAL(out, "latency", cacheLines_->get_access_latency());
 	YAML_KEY_VAL(out, "pending_queue_size", pendingRequests_.size());
 	YAML_KEY_VAL(out, "config", (wt_disabled_ ? "writeback" : "writethrough"));
 
+	if(prefetcher_) {
+		const PrefetcherConfig& pconf = prefetcher_->get_config();
+		YAML_KEY_VAL(out, "prefetcher", prefetcher_->get_name());
+		YAML_KEY_VAL(out, "prefetch_degree", pconf.degree);
+		YAML_KEY_VAL(out, "prefetch_distance", pconf.distance);
+		YAML_KEY_VAL(out, "prefetch_throttle", prefetchThrottle_);
+	}
+
 	out << YAML::EndMap;
 }
 
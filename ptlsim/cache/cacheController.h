@@ -35,6 +35,8 @@
 #include <cacheConstants.h>
 #include <memoryStats.h>
 #include <cacheLines.h>
+#include <mshr.h>
+#include <prefetcher.h>
 
 #include <statsBuilder.h>
 
@@ -145,8 +147,9 @@ class CacheController : public Controller
 		// Cache Access Latency
 		int cacheAccessLatency_;
 
-		// A Queue conatining pending requests for this cache
-		FixStateList<CacheQueueEntry, 128> pendingRequests_;
+		// A Queue conatining pending requests for this cache, indexed
+		// by line address
+		MSHRQueue<CacheQueueEntry, 128> pendingRequests_;
 
 		// Flag to indicate if this cache is lowest private
 		// level cache
@@ -158,6 +161,11 @@ class CacheController : public Controller
 		// Prefetch related variables
 		bool prefetchEnabled_;
 		int prefetchDelay_;
+		// Percentage of pending queue above which no prefetch is issued
+		int prefetchThrottle_;
+		Prefetcher *prefetcher_;
+		PrefetchStats *prefetchStats_;
+		dynarray<W64> prefetchLines_;
 
 		// This caches are connected to only two interconnects
 		// upper and lower interconnect.
@@ -180,6 +188,7 @@ class CacheController : public Controller
 
         // Stats Objects
         BaseCacheStats new_stats;
+        MSHRStats mshrStats_;
 
 		CacheQueueEntry* find_dependency(MemoryRequest *request);
 
@@ -187,6 +196,9 @@ class CacheController : public Controller
 		// same MemoryRequest or memory request with same address
 		CacheQueueEntry* find_match(MemoryRequest *request);
 
+		// Add a new entry to the MSHR of its line
+		void track_entry(CacheQueueEntry *queueEntry);
+
 		W64 get_line_address(MemoryRequest *request) {
 			return request->get_physical_address() >> cacheLineBits_;
 		}
@@ -194,7 +206,11 @@ class CacheController : public Controller
 		bool send_update_message(CacheQueueEntry *queueEntry,
 				W64 tag=-1);
 
-		void do_prefetch(MemoryRequest *request, int additional_delay=0);
+		void setup_prefetcher();
+		void train_prefetcher(CacheQueueEntry *queueEntry, bool hit,
+				CacheLine *line);
+		bool do_prefetch(MemoryRequest *request, W64 address,
+				int additional_delay=0);
 
 	public:
 		CacheController(W8 coreid, const char *name,
@@ -213,6 +229,10 @@ class CacheController : public Controller
 		void annul_request(MemoryRequest *request);
 		void dump_configuration(YAML::Emitter &out) const;
 
+		bool warm_access(MemoryRequest *request, bool shared);
+		void save_warm_state(ostream& os);
+		bool restore_warm_state(istream& is);
+
 		// Callback functions for signals of cache
 		bool cache_hit_cb(void *arg);
 		bool cache_miss_cb(void *arg);
@@ -0,0 +1,311 @@
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * This code is released under GPL.
+ *
+ */
+
+#include <globals.h>
+#include <ptlsim.h>
+#include <machine.h>
+#include <memoryHierarchy.h>
+#include <memoryRequest.h>
+#include <cacheLines.h>
+
+using namespace Memory;
+
+DynamicCacheLines::DynamicCacheLines(int setCount, int wayCount,
+        int lineSize, int latency, int readPorts, int writePorts)
+    : setCount_(setCount)
+    , wayCount_(wayCount)
+    , lineSize_(lineSize)
+    , latency_(latency)
+    , readPorts_(readPorts)
+    , writePorts_(writePorts)
+{
+    assert(valid_geometry(setCount, wayCount, lineSize));
+
+    /* Tags are matched in pairs, odd way counts get an invalid pad way */
+    wayStride_ = (wayCount_ + 1) & ~1;
+    lineBits_ = lsbindex(lineSize_);
+    setMask_ = setCount_ - 1;
+    fullMap_ = (wayCount_ == 64) ? W64(-1) : ((W64(1) << wayCount_) - 1);
+
+    /*
+     * Evictmap and a pad word come before the tags. Tags are loaded
+     * unaligned, the pad only keeps loads from splitting a host cache line.
+     */
+    setWords_ = 2 + wayStride_ +
+        (wayStride_ * sizeof(CacheLine) + sizeof(W64) - 1) / sizeof(W64);
+    sets_ = new W64[setCount_ * setWords_];
+
+    foreach (i, setCount_) {
+        evictmap(i) = 0;
+        foreach (j, wayStride_) {
+            tags(i)[j] = INVALID;
+            lines(i)[j].reset();
+        }
+    }
+
+    lastAccessCycle_ = 0;
+    readPortUsed_ = 0;
+    writePortUsed_ = 0;
+}
+
+DynamicCacheLines::~DynamicCacheLines()
+{
+    delete[] sets_;
+}
+
+bool DynamicCacheLines::valid_geometry(int setCount, int wayCount,
+        int lineSize)
+{
+    return (setCount > 0) && ((setCount & (setCount - 1)) == 0) &&
+        (lineSize > 0) && ((lineSize & (lineSize - 1)) == 0) &&
+        inrange(wayCount, 1, 64);
+}
+
+void DynamicCacheLines::init()
+{
+    foreach (i, setCount_) {
+        foreach (j, wayStride_) {
+            lines(i)[j].init(-1);
+        }
+    }
+}
+
+/*
+ * Compare two 64 bit tags per SSE2 instruction, a tag matches when both of
+ * its 32 bit halves are equal. There is at most one matching way.
+ */
+int DynamicCacheLines::match(const W64 *tags, W64 tag) const
+{
+    union {
+        vec4i vec;
+        W64 tag[2];
+    } target;
+
+    target.tag[0] = tag;
+    target.tag[1] = tag;
+
+    W64 hits = 0;
+    for (int i = 0; i < wayStride_; i += 2) {
+        vec4i eq = x86_sse_pcmpeqd(x86_sse_ldvdu((const vec4i*)(tags + i)),
+                target.vec);
+        eq = x86_sse_pandd(eq, x86_sse_pshufd<0xb1>(eq));
+        hits |= W64(x86_sse_movmskpd(eq)) << i;
+    }
+
+    return (hits) ? lsbindex64(hits) : -1;
+}
+
+CacheLine* DynamicCacheLines::probe(W64 address)
+{
+    W64 set = setOf(address);
+    int way = match(tags(set), tagOf(address));
+
+    if (way < 0)
+        return NULL;
+
+    evictmap(set) |= (W64(1) << way);
+    return &lines(set)[way];
+}
+
+CacheLine* DynamicCacheLines::peek(W64 address)
+{
+    W64 set = setOf(address);
+    int way = match(tags(set), tagOf(address));
+
+    return (way < 0) ? NULL : &lines(set)[way];
+}
+
+/* Same pseudo-LRU as FullyAssociativeTags::select */
+CacheLine* DynamicCacheLines::select(W64 address, W64& oldTag)
+{
+    W64 set = setOf(address);
+    W64 tag = tagOf(address);
+    W64 *settags = tags(set);
+    W64& map = evictmap(set);
+    int way = match(settags, tag);
+
+    if (way < 0) {
+        if (map == fullMap_) {
+            way = 0;
+            map = 0;
+        } else {
+            way = lsbindex64(~map & fullMap_);
+        }
+        oldTag = settags[way];
+        settags[way] = tag;
+    }
+
+    map |= (W64(1) << way);
+    if (map == fullMap_) {
+        map = (W64(1) << way);
+    }
+
+    return &lines(set)[way];
+}
+
+int DynamicCacheLines::invalidate(W64 address)
+{
+    W64 set = setOf(address);
+    int way = match(tags(set), tagOf(address));
+
+    if (way < 0)
+        return -1;
+
+    tags(set)[way] = INVALID;
+    evictmap(set) &= ~(W64(1) << way);
+    lines(set)[way].reset();
+    return way;
+}
+
+CacheLine* DynamicCacheLines::probe(MemoryRequest *request)
+{
+    return probe(request->get_physical_address());
+}
+
+CacheLine* DynamicCacheLines::peek(MemoryRequest *request)
+{
+    return peek(request->get_physical_address());
+}
+
+CacheLine* DynamicCacheLines::insert(MemoryRequest *request, W64& oldTag)
+{
+    return select(request->get_physical_address(), oldTag);
+}
+
+int DynamicCacheLines::invalidate(MemoryRequest *request)
+{
+    return invalidate(request->get_physical_address());
+}
+
+bool DynamicCacheLines::get_port(MemoryRequest *request)
+{
+    bool rc = false;
+
+    if(lastAccessCycle_ < sim_cycle) {
+        lastAccessCycle_ = sim_cycle;
+        writePortUsed_ = 0;
+        readPortUsed_ = 0;
+    }
+
+    switch(request->get_type()) {
+        case MEMORY_OP_READ:
+            rc = (readPortUsed_ < readPorts_) ? ++readPortUsed_ : 0;
+            break;
+        case MEMORY_OP_WRITE:
+        case MEMORY_OP_UPDATE:
+        case MEMORY_OP_EVICT:
+            rc = (writePortUsed_ < writePorts_) ? ++writePortUsed_ : 0;
+            break;
+        default:
+            memdebug("Unknown type of memory request: " <<
+                    request->get_type() << endl);
+            assert(0);
+    };
+    return rc;
+}
+
+void DynamicCacheLines::print(ostream& os) const
+{
+    foreach (i, setCount_) {
+        foreach (j, wayCount_) {
+            os << lines(i)[j];
+        }
+    }
+}
+
+/* Geometry is saved first so state of a different geometry is rejected */
+struct DynamicCacheGeometry {
+    W32 sets;
+    W32 ways;
+    W32 lineSize;
+};
+
+void DynamicCacheLines::save_state(ostream& os) const
+{
+    DynamicCacheGeometry geom;
+    geom.sets = setCount_;
+    geom.ways = wayCount_;
+    geom.lineSize = lineSize_;
+    save_warm_block(os, geom);
+
+    os.write((const char*)sets_, setCount_ * setWords_ * sizeof(W64));
+}
+
+bool DynamicCacheLines::restore_state(istream& is)
+{
+    DynamicCacheGeometry geom;
+    if (!restore_warm_block(is, geom))
+        return false;
+
+    if (geom.sets != W32(setCount_) || geom.ways != W32(wayCount_) ||
+            geom.lineSize != W32(lineSize_))
+        return false;
+
+    is.read((char*)sets_, setCount_ * setWords_ * sizeof(W64));
+    return !is.fail();
+}
+
+/**
+ * @brief Create cache lines of a cache controller
+ *
+ * @param machine Machine that has the controller's options
+ * @param name Name of the cache controller
+ * @param type Cache type from cache configuration
+ *
+ * @return Cache lines of the configured type, or DynamicCacheLines if any of
+ * the size, assoc, line_size, latency, read_ports or write_ports options of
+ * the controller is set. Options that are not set keep the configured value,
+ * so 'L2_*.size=4M' given with -machine-options resizes the L2 caches
+ * without building a new CacheLines type.
+ */
+CacheLinesBase* Memory::create_cachelines(BaseMachine& machine,
+        const char *name, int type)
+{
+    CacheLinesBase *lines = get_cachelines(type);
+
+    int size = lines->get_size();
+    int ways = lines->get_way_count();
+    int lineSize = lines->get_line_size();
+    int latency = lines->get_access_latency();
+    int readPorts = lines->get_read_ports();
+    int writePorts = lines->get_write_ports();
+
+    bool runtime = false;
+    runtime |= machine.get_option(name, "size", size);
+    runtime |= machine.get_option(name, "assoc", ways);
+    runtime |= machine.get_option(name, "line_size", lineSize);
+    runtime |= machine.get_option(name, "latency", latency);
+    runtime |= machine.get_option(name, "read_ports", readPorts);
+    runtime |= machine.get_option(name, "write_ports", writePorts);
+
+    if (!runtime)
+        return lines;
+
+    int sets = (ways > 0 && lineSize > 0) ? size / (ways * lineSize) : 0;
+
+    if (!DynamicCacheLines::valid_geometry(sets, ways, lineSize) ||
+            sets * ways * lineSize != size) {
+        stringbuf err;
+        err << "::ERROR::Cache " << name << " can't have size " << size <<
+            " with " << ways << " ways of " << lineSize << " bytes, " <<
+            "sets and line size must be powers of two and ways at most 64" <<
+            endl;
+        ptl_logfile << err << flush;
+        cerr << err << flush;
+        assert(0);
+    }
+
+    if (!strequal(lines->get_replacement(), "plru")) {
+        ptl_logfile << "[WARNING] Cache " << name << " uses pseudo-LRU " <<
+            "replacement instead of " << lines->get_replacement() <<
+            " with runtime geometry\n" << flush;
+    }
+
+    delete lines;
+    return new DynamicCacheLines(sets, ways, lineSize, latency, readPorts,
+            writePorts);
+}
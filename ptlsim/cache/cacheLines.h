@@ -29,6 +29,9 @@
 #define CACHE_LINES_H
 
 #include <logic.h>
+#include <replacement.h>
+
+struct BaseMachine;
 
 namespace Memory {
 
@@ -38,15 +41,21 @@ namespace Memory {
         /* This is a generic variable used by all caches to represent its
          * coherence state */
         W8 state;
+        /* Set when a prefetch brought the line in, until its first use */
+        W8 prefetched;
 
         void init(W64 tag_t) {
             tag = tag_t;
-            if (tag == (W64)-1) state = 0;
+            if (tag == (W64)-1) {
+                state = 0;
+                prefetched = 0;
+            }
         }
 
         void reset() {
             tag = -1;
             state = 0;
+            prefetched = 0;
         }
 
         void invalidate() { reset(); }
@@ -74,10 +83,13 @@ namespace Memory {
     struct CacheLinesBase
     {
         public:
+            virtual ~CacheLinesBase() {}
             virtual void init()=0;
             virtual W64 tagOf(W64 address)=0;
             virtual int latency() const =0;
             virtual CacheLine* probe(MemoryRequest *request)=0;
+            /* Lookup without updating replacement state */
+            virtual CacheLine* peek(MemoryRequest *request)=0;
             virtual CacheLine* insert(MemoryRequest *request,
                     W64& oldTag)=0;
             virtual int invalidate(MemoryRequest *request)=0;
@@ -89,12 +101,19 @@ namespace Memory {
 			virtual int get_set_count() const=0;
 			virtual int get_way_count() const=0;
 			virtual int get_line_size() const=0;
+            virtual const char* get_replacement() const=0;
+            virtual int get_read_ports() const=0;
+            virtual int get_write_ports() const=0;
+            virtual void save_state(ostream& os) const=0;
+            virtual bool restore_state(istream& is)=0;
     };
 
-    template <int SET_COUNT, int WAY_COUNT, int LINE_SIZE, int LATENCY>
+    template <int SET_COUNT, int WAY_COUNT, int LINE_SIZE, int LATENCY,
+             typename REPL = PseudoLRUReplacement>
         class CacheLines : public CacheLinesBase,
         public AssociativeArray<W64, CacheLine, SET_COUNT,
-        WAY_COUNT, LINE_SIZE>
+        WAY_COUNT, LINE_SIZE, NullAssociativeArrayStatisticsCollector<W64,
+        CacheLine>, REPL>
     {
         private:
             int readPortUsed_;
@@ -105,16 +124,16 @@ namespace Memory {
 
         public:
             typedef AssociativeArray<W64, CacheLine, SET_COUNT,
-                    WAY_COUNT, LINE_SIZE> base_t;
-            typedef FullyAssociativeArray<W64, CacheLine, WAY_COUNT,
-                    NullAssociativeArrayStatisticsCollector<W64,
-                    CacheLine> > Set;
+                    WAY_COUNT, LINE_SIZE, NullAssociativeArrayStatisticsCollector<W64,
+                    CacheLine>, REPL> base_t;
+            typedef typename base_t::Set Set;
 
             CacheLines(int readPorts, int writePorts);
             void init();
             W64 tagOf(W64 address);
             int latency() const { return LATENCY; };
             CacheLine* probe(MemoryRequest *request);
+            CacheLine* peek(MemoryRequest *request);
             CacheLine* insert(MemoryRequest *request, W64& oldTag);
             int invalidate(MemoryRequest *request);
             bool get_port(MemoryRequest *request);
@@ -163,28 +182,52 @@ namespace Memory {
             int get_access_latency() const {
                 return LATENCY;
             }
+
+            const char* get_replacement() const {
+                return REPL::name();
+            }
+
+            int get_read_ports() const {
+                return readPorts_;
+            }
+
+            int get_write_ports() const {
+                return writePorts_;
+            }
+
+            /* Tags, replacement and coherence state of all lines */
+            void save_state(ostream& os) const {
+                save_warm_block(os, base_t::sets);
+            }
+
+            bool restore_state(istream& is) {
+                return restore_warm_block(is, base_t::sets);
+            }
     };
 
-    template <int SET_COUNT, int WAY_COUNT, int LINE_SIZE, int LATENCY>
+    template <int SET_COUNT, int WAY_COUNT, int LINE_SIZE, int LATENCY,
+             typename REPL>
         static inline ostream& operator <<(ostream& os, const
-                CacheLines<SET_COUNT, WAY_COUNT, LINE_SIZE, LATENCY>&
+                CacheLines<SET_COUNT, WAY_COUNT, LINE_SIZE, LATENCY, REPL>&
                 cacheLines)
         {
             cacheLines.print(os);
             return os;
         }
 
-    template <int SET_COUNT, int WAY_COUNT, int LINE_SIZE, int LATENCY>
+    template <int SET_COUNT, int WAY_COUNT, int LINE_SIZE, int LATENCY,
+             typename REPL>
         static inline ostream& operator ,(ostream& os, const
-                CacheLines<SET_COUNT, WAY_COUNT, LINE_SIZE, LATENCY>&
+                CacheLines<SET_COUNT, WAY_COUNT, LINE_SIZE, LATENCY, REPL>&
                 cacheLines)
         {
             cacheLines.print(os);
             return os;
         }
 
-    template <int SET_COUNT, int WAY_COUNT, int LINE_SIZE, int LATENCY>
-        CacheLines<SET_COUNT, WAY_COUNT, LINE_SIZE, LATENCY>::CacheLines(int readPorts, int writePorts) :
+    template <int SET_COUNT, int WAY_COUNT, int LINE_SIZE, int LATENCY,
+             typename REPL>
+        CacheLines<SET_COUNT, WAY_COUNT, LINE_SIZE, LATENCY, REPL>::CacheLines(int readPorts, int writePorts) :
             readPorts_(readPorts)
             , writePorts_(writePorts)
     {
@@ -193,8 +236,9 @@ namespace Memory {
         writePortUsed_ = 0;
     }
 
-    template <int SET_COUNT, int WAY_COUNT, int LINE_SIZE, int LATENCY>
-        void CacheLines<SET_COUNT, WAY_COUNT, LINE_SIZE, LATENCY>::init()
+    template <int SET_COUNT, int WAY_COUNT, int LINE_SIZE, int LATENCY,
+             typename REPL>
+        void CacheLines<SET_COUNT, WAY_COUNT, LINE_SIZE, LATENCY, REPL>::init()
         {
             foreach(i, SET_COUNT) {
                 Set &set = base_t::sets[i];
@@ -204,16 +248,18 @@ namespace Memory {
             }
         }
 
-    template <int SET_COUNT, int WAY_COUNT, int LINE_SIZE, int LATENCY>
-        W64 CacheLines<SET_COUNT, WAY_COUNT, LINE_SIZE, LATENCY>::tagOf(W64 address)
+    template <int SET_COUNT, int WAY_COUNT, int LINE_SIZE, int LATENCY,
+             typename REPL>
+        W64 CacheLines<SET_COUNT, WAY_COUNT, LINE_SIZE, LATENCY, REPL>::tagOf(W64 address)
         {
             return floor(address, LINE_SIZE);
         }
 
 
     // Return true if valid line is found, else return false
-    template <int SET_COUNT, int WAY_COUNT, int LINE_SIZE, int LATENCY>
-        CacheLine* CacheLines<SET_COUNT, WAY_COUNT, LINE_SIZE, LATENCY>::probe(MemoryRequest *request)
+    template <int SET_COUNT, int WAY_COUNT, int LINE_SIZE, int LATENCY,
+             typename REPL>
+        CacheLine* CacheLines<SET_COUNT, WAY_COUNT, LINE_SIZE, LATENCY, REPL>::probe(MemoryRequest *request)
         {
             W64 physAddress = request->get_physical_address();
             CacheLine *line = base_t::probe(physAddress);
@@ -221,8 +267,16 @@ namespace Memory {
             return line;
         }
 
-    template <int SET_COUNT, int WAY_COUNT, int LINE_SIZE, int LATENCY>
-        CacheLine* CacheLines<SET_COUNT, WAY_COUNT, LINE_SIZE, LATENCY>::insert(MemoryRequest *request, W64& oldTag)
+    template <int SET_COUNT, int WAY_COUNT, int LINE_SIZE, int LATENCY,
+             typename REPL>
+        CacheLine* CacheLines<SET_COUNT, WAY_COUNT, LINE_SIZE, LATENCY, REPL>::peek(MemoryRequest *request)
+        {
+            return base_t::match(request->get_physical_address());
+        }
+
+    template <int SET_COUNT, int WAY_COUNT, int LINE_SIZE, int LATENCY,
+             typename REPL>
+        CacheLine* CacheLines<SET_COUNT, WAY_COUNT, LINE_SIZE, LATENCY, REPL>::insert(MemoryRequest *request, W64& oldTag)
         {
             W64 physAddress = request->get_physical_address();
             CacheLine *line = base_t::select(physAddress, oldTag);
@@ -230,15 +284,17 @@ namespace Memory {
             return line;
         }
 
-    template <int SET_COUNT, int WAY_COUNT, int LINE_SIZE, int LATENCY>
-        int CacheLines<SET_COUNT, WAY_COUNT, LINE_SIZE, LATENCY>::invalidate(MemoryRequest *request)
+    template <int SET_COUNT, int WAY_COUNT, int LINE_SIZE, int LATENCY,
+             typename REPL>
+        int CacheLines<SET_COUNT, WAY_COUNT, LINE_SIZE, LATENCY, REPL>::invalidate(MemoryRequest *request)
         {
             return base_t::invalidate(request->get_physical_address());
         }
 
 
-    template <int SET_COUNT, int WAY_COUNT, int LINE_SIZE, int LATENCY>
-        bool CacheLines<SET_COUNT, WAY_COUNT, LINE_SIZE, LATENCY>::get_port(MemoryRequest *request)
+    template <int SET_COUNT, int WAY_COUNT, int LINE_SIZE, int LATENCY,
+             typename REPL>
+        bool CacheLines<SET_COUNT, WAY_COUNT, LINE_SIZE, LATENCY, REPL>::get_port(MemoryRequest *request)
         {
             bool rc = false;
 
@@ -265,8 +321,9 @@ namespace Memory {
             return rc;
         }
 
-    template <int SET_COUNT, int WAY_COUNT, int LINE_SIZE, int LATENCY>
-        void CacheLines<SET_COUNT, WAY_COUNT, LINE_SIZE, LATENCY>::print(ostream& os) const
+    template <int SET_COUNT, int WAY_COUNT, int LINE_SIZE, int LATENCY,
+             typename REPL>
+        void CacheLines<SET_COUNT, WAY_COUNT, LINE_SIZE, LATENCY, REPL>::print(ostream& os) const
         {
             foreach(i, SET_COUNT) {
                 const Set &set = base_t::sets[i];
@@ -276,6 +333,94 @@ namespace Memory {
             }
         }
 
+    /*
+     * Cache lines with geometry given at runtime, so a cache size or
+     * associativity can be changed without generating a new CacheLines type.
+     * Set and line size are powers of two and are indexed with shifts and
+     * masks, tags of a set are contiguous and matched two at a time with SSE2.
+     * Replacement is the same pseudo-LRU as the default of CacheLines, with up
+     * to 64 ways.
+     */
+    class DynamicCacheLines : public CacheLinesBase
+    {
+        private:
+            int setCount_;
+            int wayCount_;
+            int wayStride_;
+            int lineSize_;
+            int lineBits_;
+            int latency_;
+            W64 setMask_;
+            W64 fullMap_;
+
+            /* Each set has its evictmap, padded tags and lines in a row */
+            W64 *sets_;
+            int setWords_;
+
+            int readPortUsed_;
+            int writePortUsed_;
+            int readPorts_;
+            int writePorts_;
+            W64 lastAccessCycle_;
+
+            W64& evictmap(W64 set) { return sets_[set * setWords_]; }
+            W64* tags(W64 set) { return &sets_[set * setWords_ + 2]; }
+            CacheLine* lines(W64 set) {
+                return (CacheLine*)(tags(set) + wayStride_);
+            }
+            const CacheLine* lines(W64 set) const {
+                return (const CacheLine*)(&sets_[set * setWords_ + 2] +
+                        wayStride_);
+            }
+            W64 setOf(W64 address) const {
+                return (address >> lineBits_) & setMask_;
+            }
+
+            int match(const W64 *tags, W64 tag) const;
+
+        public:
+            static const W64 INVALID = (W64)-1;
+
+            DynamicCacheLines(int setCount, int wayCount, int lineSize,
+                    int latency, int readPorts, int writePorts);
+            ~DynamicCacheLines();
+
+            static bool valid_geometry(int setCount, int wayCount,
+                    int lineSize);
+
+            void init();
+            W64 tagOf(W64 address) { return address & ~W64(lineSize_ - 1); }
+            int latency() const { return latency_; }
+            CacheLine* probe(MemoryRequest *request);
+            CacheLine* peek(MemoryRequest *request);
+            CacheLine* insert(MemoryRequest *request, W64& oldTag);
+            int invalidate(MemoryRequest *request);
+            bool get_port(MemoryRequest *request);
+            void print(ostream& os) const;
+
+            /* Same as above with physical addresses */
+            CacheLine* probe(W64 address);
+            CacheLine* peek(W64 address);
+            CacheLine* select(W64 address, W64& oldTag);
+            int invalidate(W64 address);
+
+            int get_size() const { return setCount_ * wayCount_ * lineSize_; }
+            int get_set_count() const { return setCount_; }
+            int get_way_count() const { return wayCount_; }
+            int get_line_size() const { return lineSize_; }
+            int get_line_bits() const { return lineBits_; }
+            int get_access_latency() const { return latency_; }
+            const char* get_replacement() const { return "plru"; }
+            int get_read_ports() const { return readPorts_; }
+            int get_write_ports() const { return writePorts_; }
+
+            void save_state(ostream& os) const;
+            bool restore_state(istream& is);
+    };
+
+    CacheLinesBase* create_cachelines(BaseMachine& machine, const char *name,
+            int type);
+
 };
 
 #endif // CACHE_LINES_H
@@ -66,6 +66,14 @@ namespace Memory {
                 virtual void invalidate_line(CacheLine *line)              = 0;
                 virtual void handle_response(CacheQueueEntry *entry,
                         Message &message) = 0;
+
+                /* Functional warming: update line state without any
+                 * message, warm_hit returns true if lower levels must see
+                 * the access and warm_snoop handles other cores' accesses */
+                virtual bool warm_hit(CacheLine *line, bool is_write)    = 0;
+                virtual void warm_insert(CacheLine *line, bool is_write,
+                        bool shared)                                       = 0;
+                virtual void warm_snoop(CacheLine *line, bool is_write)  = 0;
 				virtual void dump_configuration(YAML::Emitter &out) const = 0;
 
                 CacheController* controller;
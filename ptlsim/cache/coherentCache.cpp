@@ -54,8 +54,10 @@ CacheController::CacheController(W8 coreid, const char *name,
 {
     memoryHierarchy_->add_cache_mem_controller(this);
     new_stats = new MESIStats(name, &memoryHierarchy->get_machine());
+    mshrStats_ = new MSHRStats("mshr", new_stats);
 
-    cacheLines_ = get_cachelines(type);
+    cacheLines_ = create_cachelines(memoryHierarchy_->get_machine(),
+            name, type);
 
     if(!memoryHierarchy_->get_machine().get_option(name, "last_private", isLowestPrivate_)) {
         isLowestPrivate_ = false;
@@ -66,6 +68,8 @@ CacheController::CacheController(W8 coreid, const char *name,
 
     cacheLines_->init();
 
+    reject_prefetcher();
+
 
     SET_SIGNAL_CB(name, "_Cache_Hit", cacheHit_, &CacheController::cache_hit_cb);
 
@@ -90,8 +94,31 @@ CacheController::CacheController(W8 coreid, const char *name,
     lowerInterconnect_  = NULL;
 }
 
+/**
+ * @brief Fail on a 'prefetcher' option given to a coherent cache
+ *
+ * Prefetchers are only attached to wb_cache and wt_cache based caches, a
+ * MESI or MOESI cache would silently run without one.
+ */
+void CacheController::reject_prefetcher()
+{
+    stringbuf type;
+    if (!memoryHierarchy_->get_machine().get_option(get_name(), "prefetcher",
+                type) || strequal(type.buf, "none"))
+        return;
+
+    stringbuf err;
+    err << "::ERROR::Cache " << get_name() << " uses a coherence protocol " <<
+        "that doesn't support prefetcher " << type << ", only wb_cache " <<
+        "and wt_cache based caches can prefetch" << endl;
+    ptl_logfile << err;
+    cerr << err;
+    assert(0);
+}
+
 CacheController::~CacheController()
 {
+    delete mshrStats_;
     delete new_stats;
 }
 
@@ -99,25 +126,23 @@ CacheQueueEntry* CacheController::find_dependency(MemoryRequest *request)
 {
     W64 requestLineAddress = get_line_address(request);
 
-    CacheQueueEntry* queueEntry;
-    foreach_list_mutable(pendingRequests_.list(), queueEntry, entry,
-            prevEntry) {
+    for (CacheQueueEntry* queueEntry = pendingRequests_.first(
+                requestLineAddress); queueEntry;
+            queueEntry = pendingRequests_.next(queueEntry)) {
 
         if(request == queueEntry->request || queueEntry->annuled)
             continue;
 
-        if(get_line_address(queueEntry->request) == requestLineAddress) {
-            /*
-             * Found an entry with same line address, check if other
-             * entry also depends on this entry or not and to
-             * maintain a chain of dependent entries, return the
-             * last entry in the chain
-             */
-            while(queueEntry->depends >= 0)
-                queueEntry = &pendingRequests_[queueEntry->depends];
+        /*
+         * Found an entry with same line address, check if other
+         * entry also depends on this entry or not and to
+         * maintain a chain of dependent entries, return the
+         * last entry in the chain
+         */
+        while(queueEntry->depends >= 0)
+            queueEntry = &pendingRequests_[queueEntry->depends];
 
-            return queueEntry;
-        }
+        return queueEntry;
     }
     return NULL;
 }
@@ -129,22 +154,14 @@ bool CacheController::is_line_in_use(W64 tag)
     }
 
     /* Check each local cache request for same line tag */
-    CacheQueueEntry* queueEntry;
-    foreach_list_mutable(pendingRequests_.list(), queueEntry, entry,
-            prevEntry) {
-        if (get_line_address(queueEntry->request) == tag) {
-            return true;
-        }
-    }
-
-    return false;
+    return (pendingRequests_.first(tag) != NULL);
 }
 
 CacheQueueEntry* CacheController::find_match(MemoryRequest *request)
 {
-    CacheQueueEntry* queueEntry;
-    foreach_list_mutable(pendingRequests_.list(), queueEntry, entry,
-            prevEntry) {
+    for (CacheQueueEntry* queueEntry = pendingRequests_.first(
+                get_line_address(request)); queueEntry;
+            queueEntry = pendingRequests_.next(queueEntry)) {
         if(request == queueEntry->request)
             return queueEntry;
     }
@@ -152,6 +169,20 @@ CacheQueueEntry* CacheController::find_match(MemoryRequest *request)
     return NULL;
 }
 
+void CacheController::track_entry(CacheQueueEntry *queueEntry)
+{
+    MemoryRequest *request = queueEntry->request;
+    bool kernel_req = request->is_kernel();
+
+    if (pendingRequests_.track(queueEntry, get_line_address(request))) {
+        N_STAT_UPDATE(mshrStats_->merged, ++, kernel_req);
+    }
+
+    N_STAT_UPDATE(mshrStats_->requests, ++, kernel_req);
+    N_STAT_UPDATE(mshrStats_->occupancy, += pendingRequests_.mshr_count(),
+            kernel_req);
+}
+
 void CacheController::print(ostream& os) const
 {
     os << "---Cache-Controller: " << get_name() << endl;
@@ -184,6 +215,7 @@ bool CacheController::handle_upper_interconnect(Message &message)
     queueEntry->source  = (Controller*)message.origin;
     queueEntry->dest    = (Controller*)message.dest;
     queueEntry->request->incRefCounter();
+    track_entry(queueEntry);
 
     queueEntry->eventFlags[CACHE_ACCESS_EVENT]++;
 
@@ -248,6 +280,7 @@ bool CacheController::handle_lower_interconnect(Message &message)
         newEntry->source  = (Controller*)message.origin;
         newEntry->dest    = (Controller*)message.dest;
         newEntry->request->incRefCounter();
+        track_entry(newEntry);
 
         newEntry->eventFlags[CACHE_ACCESS_EVENT]++;
         marss_add_event(&cacheAccess_, 0,
@@ -264,6 +297,7 @@ bool CacheController::handle_lower_interconnect(Message &message)
 
                 evictEntry->request = message.request;
                 evictEntry->request->incRefCounter();
+                track_entry(evictEntry);
                 evictEntry->isSnoop = true;
                 evictEntry->m_arg   = message.arg;
                 evictEntry->eventFlags[CACHE_ACCESS_EVENT]++;
@@ -310,6 +344,7 @@ void CacheController::send_message(CacheQueueEntry *queueEntry,
     evictEntry->dest    = queueEntry->dest;
     evictEntry->line    = queueEntry->line;
     evictEntry->request->incRefCounter();
+    track_entry(evictEntry);
 
     //memdebug("Created Evict message: ", *evictEntry, endl);
     ADD_HISTORY_ADD(evictEntry->request);
@@ -830,9 +865,12 @@ bool CacheController::clear_entry_cb(void *arg)
 
 void CacheController::annul_request(MemoryRequest *request)
 {
-    CacheQueueEntry *queueEntry;
-    foreach_list_mutable(pendingRequests_.list(), queueEntry,
-            entry, nextentry) {
+    /* Same requests have the same address, free() keeps next entry valid */
+    CacheQueueEntry *nextEntry;
+    for (CacheQueueEntry *queueEntry = pendingRequests_.first(
+                get_line_address(request)); queueEntry;
+            queueEntry = nextEntry) {
+        nextEntry = pendingRequests_.next(queueEntry);
         if (queueEntry->request->is_same(request)) {
             queueEntry->annuled = true;
             /* Fix dependency chain if this entry was waiting for
@@ -868,6 +906,79 @@ CacheQueueEntry* CacheController::get_new_queue_entry()
     return queueEntry;
 }
 
+/**
+ * @brief Functional warming access, updates tags and line state only
+ *
+ * @param request Read or write request of a core
+ * @param shared True if line is present in other core's private caches
+ *
+ * @return true if lower levels don't need to see this access
+ *
+ * Evictions from the lowest private cache are sent to directory, but upper
+ * caches are not invalidated and dirty lines are not written back.
+ */
+bool CacheController::warm_access(MemoryRequest *request, bool shared)
+{
+    bool is_write = (request->get_type() == MEMORY_OP_WRITE);
+    CacheLine *line = cacheLines_->probe(request);
+
+    if (line && coherence_logic_->is_line_valid(line)) {
+        if (!coherence_logic_->warm_hit(line, is_write))
+            return true;
+    } else {
+        W64 oldTag = InvalidTag<W64>::INVALID;
+        W64 physaddr = request->get_physical_address();
+        line = cacheLines_->insert(request, oldTag);
+
+        if (directory_ && is_lowest_private() &&
+                coherence_logic_->is_line_valid(line)) {
+            OP_TYPE type = request->get_type();
+            request->set_physical_address(oldTag);
+            request->set_op_type(MEMORY_OP_EVICT);
+            directory_->warm_access(request, false);
+            request->set_physical_address(physaddr);
+            request->set_op_type(type);
+        }
+
+        line->init(cacheLines_->tagOf(physaddr));
+        coherence_logic_->warm_insert(line, is_write, shared);
+    }
+
+    if (directory_ && is_lowest_private())
+        directory_->warm_access(request, shared);
+
+    return false;
+}
+
+/**
+ * @brief Functional warming access of another core
+ *
+ * @param request Read or write request of other core
+ *
+ * @return true if line is present in this cache
+ */
+bool CacheController::warm_snoop(MemoryRequest *request)
+{
+    CacheLine *line = cacheLines_->probe(request);
+
+    if (!line || !coherence_logic_->is_line_valid(line))
+        return false;
+
+    coherence_logic_->warm_snoop(line, request->get_type() ==
+            MEMORY_OP_WRITE);
+    return true;
+}
+
+void CacheController::save_warm_state(ostream& os)
+{
+    cacheLines_->save_state(os);
+}
+
+bool CacheController::restore_warm_state(istream& is)
+{
+    return cacheLines_->restore_state(is);
+}
+
 /**
  * @brief Dump Coherent Cache Configuration in YAML Format
  *
@@ -882,6 +993,7 @@ void CacheController::dump_configuration(YAML::Emitter &out) const
 	YAML_KEY_VAL(out, "sets", cacheLines_->get_set_count());
 	YAML_KEY_VAL(out, "ways", cacheLines_->get_way_count());
 	YAML_KEY_VAL(out, "line_size", cacheLines_->get_line_size());
+	YAML_KEY_VAL(out, "replacement", cacheLines_->get_replacement());
 	YAML_KEY_VAL(out, "latency", cacheLines_->get_access_latency());
 	YAML_KEY_VAL(out, "pending_queue_size", pendingRequests_.size());
 
@@ -36,6 +36,7 @@
 #include <memoryStats.h>
 #include <statsBuilder.h>
 #include <cacheLines.h>
+#include <mshr.h>
 
 namespace Memory {
 
@@ -172,8 +173,9 @@ namespace Memory {
                 // Cache Access Latency
                 int cacheAccessLatency_;
 
-                // A Queue conatining pending requests for this cache
-                FixStateList<CacheQueueEntry, 256> pendingRequests_;
+                // A Queue conatining pending requests for this cache,
+                // indexed by line address
+                MSHRQueue<CacheQueueEntry, 256> pendingRequests_;
 
                 // Flag to indicate if this cache is lowest private
                 // level cache
@@ -202,6 +204,7 @@ namespace Memory {
 
                 // Stats Objects
                 MESIStats *new_stats;
+                MSHRStats *mshrStats_;
 
                 CoherenceLogic *coherence_logic_;
 
@@ -211,6 +214,9 @@ namespace Memory {
                 // same MemoryRequest or memory request with same address
                 CacheQueueEntry* find_match(MemoryRequest *request);
 
+                // Add a new entry to the MSHR of its line
+                void track_entry(CacheQueueEntry *queueEntry);
+
                 W64 get_line_address(MemoryRequest *request) {
                     return request->get_physical_address() >> cacheLineBits_;
                 }
@@ -229,6 +235,9 @@ namespace Memory {
 
                 void get_directory(Interconnect *interconn);
 
+                // Prefetchers are not supported by coherent caches
+                void reject_prefetcher();
+
             public:
                 CacheController(W8 coreid, const char *name,
                         MemoryHierarchy *memoryHierarchy, CacheType type);
@@ -275,6 +284,11 @@ namespace Memory {
                 void annul_request(MemoryRequest *request);
 				void dump_configuration(YAML::Emitter &out) const;
 
+                bool warm_access(MemoryRequest *request, bool shared);
+                bool warm_snoop(MemoryRequest *request);
+                void save_warm_state(ostream& os);
+                bool restore_warm_state(istream& is);
+
                 // Callback functions for signals of cache
                 virtual bool cache_hit_cb(void *arg);
                 virtual bool cache_miss_cb(void *arg);
@@ -84,6 +84,7 @@ class Controller
         stringbuf name_;
 		Signal handle_interconnect_;
 		bool isPrivate_;
+		int fullIdx_;
 
 	public:
 		MemoryHierarchy *memoryHierarchy_;
@@ -97,6 +98,7 @@ class Controller
 		{
 			name_ << name;
 			isPrivate_ = false;
+			fullIdx_ = -1;
 
 			handle_interconnect_.connect(signal_mem_ptr \
 					(*this, &Controller::handle_interconnect_cb));
@@ -119,6 +121,45 @@ class Controller
 		virtual void annul_request(MemoryRequest* request) = 0;
 		virtual void dump_configuration(YAML::Emitter &out) const = 0;
 
+		/**
+		 * @brief Indicate if this controller is a main memory controller
+		 *
+		 * Used by interconnects that route requests by address.
+		 */
+		virtual bool is_memory_controller() const { return false; }
+
+		/**
+		 * @brief Update state for an access made during functional warming
+		 *
+		 * @param request Access of a core, no message or event is created
+		 * @param shared True if line is cached by another core
+		 *
+		 * @return true if lower levels don't need to see this access
+		 */
+		virtual bool warm_access(MemoryRequest *request, bool shared) {
+			return true;
+		}
+
+		/**
+		 * @brief Update state for an access of another core during
+		 * functional warming
+		 *
+		 * @return true if line is present in this controller
+		 */
+		virtual bool warm_snoop(MemoryRequest *request) { return false; }
+
+		/**
+		 * @brief Save cache lines and coherence state for warm checkpoints
+		 */
+		virtual void save_warm_state(ostream& os) {}
+
+		/**
+		 * @brief Restore state written by save_warm_state
+		 *
+		 * @return false if saved state doesn't match this controller
+		 */
+		virtual bool restore_warm_state(istream& is) { return true; }
+
 		int flush() {
 			return 0;
 		}
@@ -139,6 +180,10 @@ class Controller
 
 		bool is_private() { return isPrivate_; }
 
+		/* Index of this controller's full flag in MemoryHierarchy */
+		void set_full_index(int idx) { fullIdx_ = idx; }
+		int get_full_index() const { return fullIdx_; }
+
 };
 
 static inline ostream& operator <<(ostream& os, const Controller&
@@ -176,6 +176,21 @@ int CPUController::access_fast_path(Interconnect *interconnect,
     if unlikely (fastPathLat == 0)
 		return 0;
 
+	return queue_request(request, fastPathLat);
+}
+
+/**
+ * @brief Add a request to the pending queue
+ *
+ * @param request Request from the core
+ * @param fastPathLat L1 hit latency, or -1 to send the request to L1
+ *
+ * @return -1 as the core is woken up once the request is finalized
+ */
+int CPUController::queue_request(MemoryRequest *request, int fastPathLat)
+{
+    bool kernel_req = request->is_kernel();
+
 	request->incRefCounter();
 	ADD_HISTORY_ADD(request);
 
@@ -232,6 +247,51 @@ int CPUController::access_fast_path(Interconnect *interconnect,
 	return -1;
 }
 
+/**
+ * @brief Look up a read in the private L1 without using shared state
+ *
+ * @param request Request from the core
+ *
+ * @return L1 hit latency, 0 for an icache buffer hit and -1 if the request
+ * has to be sent through the pending queue
+ *
+ * Used while cores run ahead of the shared hierarchy in parallel quantum
+ * mode. Only a point-to-point L1 answers the fast path, shared interconnects
+ * always return -1, so a hit never touches state of another core.
+ */
+int CPUController::access_private(MemoryRequest *request)
+{
+	if (request->get_type() == MEMORY_OP_WRITE || find_dependency(request))
+		return -1;
+
+	int fastPathLat;
+    bool kernel_req = request->is_kernel();
+
+	if unlikely (request->is_instruction()) {
+		if (is_icache_buffer_hit(request))
+			return 0;
+
+		fastPathLat = int_L1_i_->access_fast_path(this, request);
+		if (fastPathLat > 0)
+			N_STAT_UPDATE(stats.icache_latency, [fastPathLat]++, kernel_req);
+	} else {
+		fastPathLat = int_L1_d_->access_fast_path(this, request);
+		if (fastPathLat > 0)
+			N_STAT_UPDATE(stats.dcache_latency, [fastPathLat]++, kernel_req);
+	}
+
+	return fastPathLat;
+}
+
+/**
+ * @brief Finish a request that was served by access_private()
+ */
+void CPUController::complete_private(MemoryRequest *request)
+{
+	finish_request(request);
+    memoryHierarchy_->core_wakeup(request);
+}
+
 bool CPUController::is_cache_availabe(bool is_icache)
 {
 	assert(0);
@@ -296,23 +356,7 @@ void CPUController::finalize_request(CPUControllerQueueEntry *queueEntry)
 			*queueEntry << endl);
 	MemoryRequest *request = queueEntry->request;
 
-	int req_latency = sim_cycle - request->get_init_cycles();
-	req_latency = (req_latency >= 200) ? 199 : req_latency;
-    bool kernel_req = request->is_kernel();
-
-	if unlikely (request->is_instruction()) {
-		W64 lineAddress = get_line_address(request);
-		if likely (icacheBuffer_.isFull()) {
-			memdebug("Freeing icache buffer head\n");
-			icacheBuffer_.free(icacheBuffer_.head());
-			N_STAT_UPDATE(stats.queueFull, ++, request->is_kernel());
-		}
-		CPUControllerBufferEntry *bufEntry = icacheBuffer_.alloc();
-		bufEntry->lineAddress = lineAddress;
-        N_STAT_UPDATE(stats.icache_latency, [req_latency]++, kernel_req);
-	} else {
-        N_STAT_UPDATE(stats.dcache_latency, [req_latency]++, kernel_req);
-	}
+	finish_request(request);
     memoryHierarchy_->core_wakeup(request);
 
 	memdebug("Entry finalized..\n");
@@ -332,6 +376,30 @@ void CPUController::finalize_request(CPUControllerQueueEntry *queueEntry)
 	}
 }
 
+/**
+ * @brief Update icache buffer and latency stats of a completed request
+ */
+void CPUController::finish_request(MemoryRequest *request)
+{
+	int req_latency = sim_cycle - request->get_init_cycles();
+	req_latency = (req_latency >= 200) ? 199 : req_latency;
+    bool kernel_req = request->is_kernel();
+
+	if unlikely (request->is_instruction()) {
+		W64 lineAddress = get_line_address(request);
+		if likely (icacheBuffer_.isFull()) {
+			memdebug("Freeing icache buffer head\n");
+			icacheBuffer_.free(icacheBuffer_.head());
+			N_STAT_UPDATE(stats.queueFull, ++, request->is_kernel());
+		}
+		CPUControllerBufferEntry *bufEntry = icacheBuffer_.alloc();
+		bufEntry->lineAddress = lineAddress;
+        N_STAT_UPDATE(stats.icache_latency, [req_latency]++, kernel_req);
+	} else {
+        N_STAT_UPDATE(stats.dcache_latency, [req_latency]++, kernel_req);
+	}
+}
+
 bool CPUController::cache_access_cb(void *arg)
 {
 	CPUControllerQueueEntry* queueEntry = (CPUControllerQueueEntry*)arg;
@@ -431,6 +499,42 @@ void CPUController::clock()
 	}
 }
 
+/**
+ * @brief Find the cycle in which clock() will finalize next request
+ *
+ * @return Cycle number or -1 if no request is waiting on a fixed latency
+ *
+ * Requests that wait for a response from the cache have negative cycles and
+ * are only finalized from the cache callback.
+ */
+W64 CPUController::get_next_clock()
+{
+	W64 next = (W64)-1;
+	CPUControllerQueueEntry* queueEntry;
+	foreach_list_mutable(pendingRequests_.list(), queueEntry, entry_t,
+			prev_t) {
+		if(queueEntry->cycles > 0)
+			next = min(next, sim_cycle + queueEntry->cycles - 1);
+	}
+	return next;
+}
+
+/**
+ * @brief Account for cycles that were skipped without calling clock()
+ *
+ * @param cycles Number of skipped cycles, must be less than cycles left of
+ * any pending request
+ */
+void CPUController::skip_cycles(W64 cycles)
+{
+	CPUControllerQueueEntry* queueEntry;
+	foreach_list_mutable(pendingRequests_.list(), queueEntry, entry_t,
+			prev_t) {
+		assert(queueEntry->cycles <= 0 || queueEntry->cycles > (int)cycles);
+		queueEntry->cycles -= cycles;
+	}
+}
+
 void CPUController::print(ostream& os) const
 {
 	os << "---CPU-Controller: "<< get_name()<< endl;
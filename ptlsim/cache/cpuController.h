@@ -126,6 +126,7 @@ class CPUController : public Controller
 		void wakeup_dependents(CPUControllerQueueEntry *queueEntry);
 
 		void finalize_request(CPUControllerQueueEntry *queueEntry);
+		void finish_request(MemoryRequest *request);
 
 		CPUControllerQueueEntry* find_entry(MemoryRequest *request);
 
@@ -145,7 +146,12 @@ class CPUController : public Controller
 
 		int access_fast_path(Interconnect *interconnect,
 				MemoryRequest *request);
+		int queue_request(MemoryRequest *request, int fastPathLat);
+		int access_private(MemoryRequest *request);
+		void complete_private(MemoryRequest *request);
 		void clock();
+		W64 get_next_clock();
+		void skip_cycles(W64 cycles);
         void register_interconnect(Interconnect *interconnect, int type);
 		void register_interconnect_L1_d(Interconnect *interconnect);
 		void register_interconnect_L1_i(Interconnect *interconnect);
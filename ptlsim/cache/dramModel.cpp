@@ -0,0 +1,257 @@
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * This code is released under GPL.
+ *
+ */
+
+#include <dramModel.h>
+
+#include <math.h>
+
+using namespace Memory;
+
+DRAMConfig::DRAMConfig()
+    : channels(1)
+    , ranks(2)
+    , banks(8)
+    , row_lines(128)
+    , policy(DRAM_OPEN_PAGE)
+    , tCAS(11)
+    , tCWL(8)
+    , tRCD(11)
+    , tRP(11)
+    , tRAS(28)
+    , tRRD(5)
+    , tFAW(24)
+    , tWR(12)
+    , tWTR(6)
+    , tRTW(2)
+    , tBURST(4)
+    , tRFC(128)
+    , tREFI(6240)
+{}
+
+static int scale_timing(int t, double factor)
+{
+    return int(ceil(t * factor));
+}
+
+/**
+ * @brief Convert timing parameters from DRAM clocks to simulation cycles
+ *
+ * @param cycles_per_dram_clock Simulation cycles in one DRAM clock
+ */
+void DRAMConfig::scale(double cycles_per_dram_clock)
+{
+    int* params[] = {&tCAS, &tCWL, &tRCD, &tRP, &tRAS, &tRRD, &tFAW, &tWR,
+        &tWTR, &tRTW, &tBURST, &tRFC, &tREFI};
+
+    foreach (i, int(sizeof(params) / sizeof(params[0]))) {
+        *params[i] = scale_timing(*params[i], cycles_per_dram_clock);
+    }
+
+    /* Every transfer must take at least one cycle */
+    tBURST = max(tBURST, 1);
+}
+
+DRAMModel::DRAMModel(const DRAMConfig& config)
+    : config_(config)
+    , refreshes_(0)
+{
+    assert(config_.channels > 0 && config_.ranks > 0 && config_.banks > 0);
+    assert(config_.row_lines > 0);
+
+    banks_.resize(config_.channels * config_.ranks * config_.banks);
+    foreach (i, banks_.count()) {
+        Bank& bank = banks_[i];
+        bank.open = false;
+        bank.openRow = 0;
+        bank.readyCycle = 0;
+        bank.actCycle = 0;
+        bank.writeDone = 0;
+    }
+
+    ranks_.resize(config_.channels * config_.ranks);
+    foreach (i, ranks_.count()) {
+        Rank& rank = ranks_[i];
+        rank.acts = 0;
+        rank.nextRefresh = config_.tREFI;
+    }
+
+    channels_.resize(config_.channels);
+    foreach (i, channels_.count()) {
+        channels_[i].busFree = 0;
+        channels_[i].lastWrite = false;
+    }
+}
+
+/**
+ * @brief Map a physical address to its channel, rank, bank and row
+ *
+ * Consecutive cache lines are interleaved across channels. With open page
+ * policy lines of a row are next to each other to benefit from row hits,
+ * with closed page policy consecutive lines are spread across banks.
+ */
+DRAMLocation DRAMModel::decode(W64 addr) const
+{
+    DRAMLocation loc;
+    W64 line = addr >> 6;
+
+    loc.channel = line % config_.channels;
+    line /= config_.channels;
+
+    if (config_.policy == DRAM_OPEN_PAGE) {
+        line /= config_.row_lines;
+        loc.bank = line % config_.banks;
+        line /= config_.banks;
+        loc.rank = line % config_.ranks;
+        line /= config_.ranks;
+    } else {
+        loc.bank = line % config_.banks;
+        line /= config_.banks;
+        loc.rank = line % config_.ranks;
+        line /= config_.ranks;
+        line /= config_.row_lines;
+    }
+
+    loc.row = line;
+    return loc;
+}
+
+/*
+ * Refresh all banks of a rank for every refresh interval that has passed.
+ * A refresh starts when all banks are idle and closes their rows.
+ */
+void DRAMModel::refresh(const DRAMLocation& loc, W64 now)
+{
+    Rank& rank = get_rank(loc);
+
+    if unlikely (config_.tREFI == 0)
+        return;
+
+    while (now >= rank.nextRefresh) {
+        DRAMLocation bloc = loc;
+        W64 start = rank.nextRefresh;
+
+        foreach (b, config_.banks) {
+            bloc.bank = b;
+            Bank& bank = get_bank(bloc);
+            start = max(start, bank.readyCycle);
+            if (bank.open)
+                start = max(start, max(bank.actCycle + config_.tRAS,
+                            bank.writeDone + config_.tWR) + config_.tRP);
+        }
+
+        foreach (b, config_.banks) {
+            bloc.bank = b;
+            Bank& bank = get_bank(bloc);
+            bank.open = false;
+            bank.readyCycle = start + config_.tRFC;
+        }
+
+        rank.nextRefresh += config_.tREFI;
+        refreshes_++;
+    }
+}
+
+/**
+ * @brief Earliest cycle a new access can be issued to a bank
+ *
+ * @param loc Bank to check
+ * @param now Current cycle, refreshes due by this cycle are applied
+ */
+W64 DRAMModel::ready_cycle(const DRAMLocation& loc, W64 now)
+{
+    refresh(loc, now);
+    return get_bank(loc).readyCycle;
+}
+
+bool DRAMModel::is_row_hit(const DRAMLocation& loc) const
+{
+    const Bank& bank = banks_[bank_index(loc)];
+    return bank.open && bank.openRow == loc.row;
+}
+
+/**
+ * @brief Issue an access and update bank, rank and channel state
+ *
+ * @param loc Location from decode()
+ * @param is_write True for write access
+ * @param now Cycle in which the access is issued
+ * @param state Set to row buffer state of the bank
+ *
+ * @return Cycle in which data transfer of the access ends
+ */
+W64 DRAMModel::access(const DRAMLocation& loc, bool is_write, W64 now,
+        DRAMRowState& state)
+{
+    refresh(loc, now);
+
+    Bank& bank = get_bank(loc);
+    Rank& rank = get_rank(loc);
+    Channel& channel = channels_[loc.channel];
+
+    W64 cmd = max(now, bank.readyCycle);
+    W64 cas;
+
+    if (bank.open && bank.openRow == loc.row) {
+        state = DRAM_ROW_HIT;
+        cas = cmd;
+    } else {
+        W64 act = cmd;
+
+        if (bank.open) {
+            state = DRAM_ROW_CONFLICT;
+            W64 pre = max(cmd, max(bank.actCycle + config_.tRAS,
+                        bank.writeDone + config_.tWR));
+            act = pre + config_.tRP;
+        } else {
+            state = DRAM_ROW_MISS;
+        }
+
+        if (rank.acts > 0) {
+            int last = (rank.acts - 1) % 4;
+            act = max(act, rank.actHistory[last] + config_.tRRD);
+        }
+        if (rank.acts >= 4) {
+            act = max(act, rank.actHistory[rank.acts % 4] + config_.tFAW);
+        }
+
+        rank.actHistory[rank.acts % 4] = act;
+        rank.acts++;
+
+        bank.open = true;
+        bank.openRow = loc.row;
+        bank.actCycle = act;
+        cas = act + config_.tRCD;
+    }
+
+    /* Data bus turnaround when direction changes */
+    W64 bus = channel.busFree;
+    if (channel.lastWrite && !is_write)
+        bus += config_.tWTR;
+    else if (!channel.lastWrite && is_write)
+        bus += config_.tRTW;
+
+    W64 data = max(cas + (is_write ? config_.tCWL : config_.tCAS), bus);
+    W64 done = data + config_.tBURST;
+
+    channel.busFree = done;
+    channel.lastWrite = is_write;
+
+    if (is_write)
+        bank.writeDone = done;
+
+    if (config_.policy == DRAM_OPEN_PAGE) {
+        bank.readyCycle = cas + config_.tBURST;
+    } else {
+        /* Auto-precharge after the access */
+        W64 pre = max(bank.actCycle + config_.tRAS,
+                is_write ? done + config_.tWR : cas + config_.tBURST);
+        bank.open = false;
+        bank.readyCycle = pre + config_.tRP;
+    }
+
+    return done;
+}
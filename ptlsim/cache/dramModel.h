@@ -0,0 +1,135 @@
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * This code is released under GPL.
+ *
+ */
+
+#ifndef DRAM_MODEL_H
+#define DRAM_MODEL_H
+
+#include <globals.h>
+#include <superstl.h>
+
+namespace Memory {
+
+enum DRAMPagePolicy {
+    DRAM_OPEN_PAGE = 0,     // Keep row open until a conflicting access
+    DRAM_CLOSED_PAGE,       // Precharge bank after every access
+};
+
+/* State of the bank's row buffer when an access is issued */
+enum DRAMRowState {
+    DRAM_ROW_HIT = 0,       // Row is already open
+    DRAM_ROW_MISS,          // Bank is precharged, row is activated
+    DRAM_ROW_CONFLICT,      // Other row is open, precharge then activate
+};
+
+/**
+ * @brief Organization and timing of a DRAM subsystem
+ *
+ * Timing parameters are in DRAM clock cycles until scale() converts them to
+ * simulation cycles. Defaults are of a DDR3-1600 11-11-11 part.
+ */
+struct DRAMConfig {
+    int channels;
+    int ranks;
+    int banks;
+    int row_lines;  // Cache lines in one row buffer
+    DRAMPagePolicy policy;
+
+    int tCAS;       // Read command to data
+    int tCWL;       // Write command to data
+    int tRCD;       // Activate to read/write command
+    int tRP;        // Precharge to activate
+    int tRAS;       // Activate to precharge
+    int tRRD;       // Activate to activate in the same rank
+    int tFAW;       // Window of four activates in the same rank
+    int tWR;        // End of write data to precharge
+    int tWTR;       // End of write data to read data on the channel
+    int tRTW;       // End of read data to write data on the channel
+    int tBURST;     // Data transfer of one cache line
+    int tRFC;       // Refresh cycle time
+    int tREFI;      // Refresh interval, 0 disables refresh
+
+    DRAMConfig();
+
+    void scale(double cycles_per_dram_clock);
+};
+
+/* Bank of an address */
+struct DRAMLocation {
+    int channel;
+    int rank;
+    int bank;
+    W64 row;
+};
+
+/**
+ * @brief Timing model of DRAM channels, ranks and banks
+ *
+ * Tracks open row and next free cycle of each bank, activate history of each
+ * rank and data bus of each channel. Commands are not simulated one by one,
+ * access() computes the cycles of precharge, activate and read/write
+ * commands of an access from current state and returns when its data
+ * transfer ends. Refresh is applied lazily to a rank when it is accessed.
+ */
+class DRAMModel {
+    public:
+        DRAMModel(const DRAMConfig& config);
+
+        DRAMLocation decode(W64 addr) const;
+        W64 ready_cycle(const DRAMLocation& loc, W64 now);
+        bool is_row_hit(const DRAMLocation& loc) const;
+        W64 access(const DRAMLocation& loc, bool is_write, W64 now,
+                DRAMRowState& state);
+
+        int bank_index(const DRAMLocation& loc) const {
+            return (loc.channel * config_.ranks + loc.rank) * config_.banks +
+                loc.bank;
+        }
+
+        int bank_count() const { return banks_.count(); }
+        const DRAMConfig& get_config() const { return config_; }
+        W64 get_refreshes() const { return refreshes_; }
+
+    private:
+        struct Bank {
+            bool open;
+            W64 openRow;
+            W64 readyCycle;     // Next read/write or activate
+            W64 actCycle;       // Last activate
+            W64 writeDone;      // End of last write data
+        };
+
+        struct Rank {
+            W64 actHistory[4];  // Last four activates, for tFAW
+            int acts;
+            W64 nextRefresh;
+        };
+
+        struct Channel {
+            W64 busFree;
+            bool lastWrite;
+        };
+
+        DRAMConfig config_;
+        dynarray<Bank> banks_;
+        dynarray<Rank> ranks_;
+        dynarray<Channel> channels_;
+        W64 refreshes_;
+
+        Bank& get_bank(const DRAMLocation& loc) {
+            return banks_[bank_index(loc)];
+        }
+
+        Rank& get_rank(const DRAMLocation& loc) {
+            return ranks_[loc.channel * config_.ranks + loc.rank];
+        }
+
+        void refresh(const DRAMLocation& loc, W64 now);
+};
+
+};
+
+#endif // DRAM_MODEL_H
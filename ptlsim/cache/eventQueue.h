@@ -0,0 +1,386 @@
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef _EVENTQUEUE_H_
+#define _EVENTQUEUE_H_
+
+#include <globals.h>
+#include <superstl.h>
+
+namespace Memory {
+
+  class Event
+  {
+    private:
+      Signal *signal_;
+      W64    clock_;
+      void   *arg_;
+
+      // Link and insertion order used by EventQueue
+      Event  *next_;
+      W64    seq_;
+
+      template <int SIZE, int WHEEL_SIZE> friend class EventQueue;
+
+    public:
+      void init() {
+        signal_ = NULL;
+        clock_ = -1;
+        arg_ = NULL;
+        next_ = NULL;
+        seq_ = 0;
+      }
+
+      void setup(Signal *signal, W64 clock, void *arg) {
+        signal_ = signal;
+        clock_ = clock;
+        arg_ = arg;
+      }
+
+      bool execute() {
+        return signal_->emit(arg_);
+      }
+
+      W64 get_clock() {
+        return clock_;
+      }
+
+      ostream& print(ostream& os) const {
+        os << "Event< ";
+        if(signal_)
+          os << "Signal:" << signal_->get_name() << " ";
+        os << "Clock:" << clock_ << " ";
+        os << "arg:" << arg_ ;
+        os << ">" << endl << flush;
+        return os;
+      }
+
+      bool operator ==(Event &event) {
+        if(clock_ == event.clock_)
+          return true;
+        return false;
+      }
+
+      bool operator >(Event &event) {
+        if(clock_ > event.clock_)
+          return true;
+        return false;
+      }
+
+      bool operator <(Event &event) {
+        if(clock_ < event.clock_)
+          return true;
+        return false;
+      }
+
+      bool operator >=(Event &event) {
+        if (clock_ >= event.clock_)
+          return true;
+        return false;
+      }
+  };
+
+  static inline ostream& operator <<(ostream& os, const Event& event) {
+    return event.print(os);
+  }
+
+  /**
+   * @brief Timing wheel of pending memory events
+   *
+   * Events that fire within WHEEL_SIZE cycles of the current wheel position
+   * are appended to the bucket of their clock, so scheduling and retiring an
+   * event is O(1). Events further in the future are kept in an overflow
+   * min-heap and moved into the wheel when their clock comes into range.
+   *
+   * Events of the same clock are always returned in the order they were
+   * scheduled, which is the same ordering the old sorted event list
+   * provided.
+   */
+  template <int SIZE, int WHEEL_SIZE>
+  class EventQueue
+  {
+    public:
+      EventQueue() {
+        assert((WHEEL_SIZE & (WHEEL_SIZE - 1)) == 0 && WHEEL_SIZE >= 64);
+        reset();
+      }
+
+      Event* alloc() {
+        Event *event = freeList_;
+        if unlikely (!event) return NULL;
+        freeList_ = event->next_;
+        event->init();
+        return event;
+      }
+
+      void free(Event *event) {
+        event->next_ = freeList_;
+        freeList_ = event;
+      }
+
+      /**
+       * @brief Add an allocated and setup Event to the queue
+       *
+       * Events whose clock is already in the past are placed at the current
+       * wheel position so they are returned by the next pop().
+       */
+      void schedule(Event *event) {
+        event->seq_ = seq_++;
+        event->next_ = NULL;
+        count_++;
+
+        if likely (event->clock_ - current_ < (W64)WHEEL_SIZE ||
+            event->clock_ < current_) {
+          add_to_bucket(event);
+        } else {
+          heap_push(event);
+        }
+      }
+
+      /**
+       * @brief Remove the next Event with clock <= cycle
+       *
+       * @return Event in (clock, scheduling order) or NULL if there are no
+       * more events due by given cycle
+       */
+      Event* pop(W64 cycle) {
+        for (;;) {
+          Bucket& bucket = wheel_[current_ & WHEEL_MASK];
+
+          if (bucket.head) {
+            Event *event = bucket.head;
+            bucket.head = event->next_;
+            if (!bucket.head) {
+              bucket.tail = NULL;
+              clear_occupied(current_);
+            }
+            wheelCount_--;
+            count_--;
+            return event;
+          }
+
+          if (current_ >= cycle)
+            return NULL;
+
+          advance(cycle);
+        }
+      }
+
+      /**
+       * @brief Clock of the earliest pending Event
+       *
+       * @return -1 if queue is empty
+       */
+      W64 next_clock() const {
+        if (wheelCount_) {
+          W64 clock = current_;
+          int word = (current_ & WHEEL_MASK) / 64;
+          W64 bits = occupied_[word] & (-1ULL << (current_ & 63));
+
+          foreach (i, WHEEL_WORDS + 1) {
+            if (bits) {
+              return clock - (clock & 63) + lsbindex64(bits);
+            }
+            clock += 64 - (clock & 63);
+            word = (word + 1) % WHEEL_WORDS;
+            bits = occupied_[word];
+          }
+        }
+
+        if (heapCount_)
+          return heap_[0]->clock_;
+
+        return (W64)-1;
+      }
+
+      bool empty() const {
+        return count_ == 0;
+      }
+
+      int count() const {
+        return count_;
+      }
+
+      int size() const {
+        return SIZE;
+      }
+
+      void reset() {
+        freeList_ = NULL;
+        for (int i = SIZE - 1; i >= 0; i--) {
+          events_[i].init();
+          free(&events_[i]);
+        }
+
+        foreach (i, WHEEL_SIZE) {
+          wheel_[i].head = NULL;
+          wheel_[i].tail = NULL;
+        }
+
+        foreach (i, WHEEL_WORDS) {
+          occupied_[i] = 0;
+        }
+
+        current_ = 0;
+        seq_ = 0;
+        count_ = 0;
+        wheelCount_ = 0;
+        heapCount_ = 0;
+      }
+
+      ostream& print(ostream& os) const {
+        os << " (" << count_ << " entries):" << endl;
+
+        foreach (i, WHEEL_SIZE) {
+          Event *event = wheel_[(current_ + i) & WHEEL_MASK].head;
+          for (; event; event = event->next_) {
+            os << *event;
+          }
+        }
+
+        foreach (i, heapCount_) {
+          os << *heap_[i];
+        }
+
+        return os;
+      }
+
+    private:
+      static const int WHEEL_MASK = WHEEL_SIZE - 1;
+      static const int WHEEL_WORDS = (WHEEL_SIZE + 63) / 64;
+
+      struct Bucket {
+        Event *head;
+        Event *tail;
+      };
+
+      Event events_[SIZE];
+      Event *freeList_;
+
+      Bucket wheel_[WHEEL_SIZE];
+      W64 occupied_[WHEEL_WORDS];
+
+      // Min-heap of events beyond the wheel, ordered by (clock, seq)
+      Event *heap_[SIZE];
+      int heapCount_;
+
+      // Clock of the wheel bucket that is currently being retired
+      W64 current_;
+      W64 seq_;
+      int count_;
+      int wheelCount_;
+
+      void set_occupied(W64 clock) {
+        occupied_[(clock & WHEEL_MASK) / 64] |= (1ULL << (clock & 63));
+      }
+
+      void clear_occupied(W64 clock) {
+        occupied_[(clock & WHEEL_MASK) / 64] &= ~(1ULL << (clock & 63));
+      }
+
+      void add_to_bucket(Event *event) {
+        W64 clock = max(event->clock_, current_);
+        Bucket& bucket = wheel_[clock & WHEEL_MASK];
+
+        if (bucket.tail) {
+          bucket.tail->next_ = event;
+        } else {
+          bucket.head = event;
+          set_occupied(clock);
+        }
+        bucket.tail = event;
+        wheelCount_++;
+      }
+
+      /*
+       * Move the wheel one cycle forward, or directly to the next pending
+       * clock if the wheel is empty, and pull in the overflow events that
+       * are now within range. Events are pulled in heap order, before any
+       * event with the same clock can be scheduled directly into the wheel,
+       * so scheduling order is preserved across the two structures.
+       */
+      void advance(W64 cycle) {
+        if (wheelCount_ == 0) {
+          W64 next = cycle;
+          if (heapCount_ && heap_[0]->clock_ < next)
+            next = heap_[0]->clock_;
+          current_ = max(current_ + 1, next);
+        } else {
+          current_++;
+        }
+
+        while (heapCount_ &&
+            heap_[0]->clock_ - current_ < (W64)WHEEL_SIZE) {
+          add_to_bucket(heap_pop());
+        }
+      }
+
+      static bool before(const Event *a, const Event *b) {
+        if (a->clock_ != b->clock_)
+          return a->clock_ < b->clock_;
+        return a->seq_ < b->seq_;
+      }
+
+      void heap_push(Event *event) {
+        int i = heapCount_++;
+        while (i > 0) {
+          int parent = (i - 1) / 2;
+          if (!before(event, heap_[parent]))
+            break;
+          heap_[i] = heap_[parent];
+          i = parent;
+        }
+        heap_[i] = event;
+      }
+
+      Event* heap_pop() {
+        Event *top = heap_[0];
+        Event *last = heap_[--heapCount_];
+        int i = 0;
+
+        for (;;) {
+          int child = 2 * i + 1;
+          if (child >= heapCount_)
+            break;
+          if (child + 1 < heapCount_ && before(heap_[child + 1], heap_[child]))
+            child++;
+          if (!before(heap_[child], last))
+            break;
+          heap_[i] = heap_[child];
+          i = child;
+        }
+        heap_[i] = last;
+
+        return top;
+      }
+  };
+
+  template <int SIZE, int WHEEL_SIZE>
+  static inline ostream& operator <<(ostream& os,
+      const EventQueue<SIZE, WHEEL_SIZE>& queue) {
+    return queue.print(os);
+  }
+
+};
+
+#endif // _EVENTQUEUE_H_
@@ -40,15 +40,213 @@ void DirectoryEntry::init(W64 tag_)
     present.reset();
 }
 
-Directory::Directory()
+DirectorySlice::DirectorySlice(int sets, int ways, int latency, int ports)
+    : sets_(sets)
+    , ways_(ways)
+    , latency_(latency)
+    , ports_(ports)
 {
-    entries = new base_t();
+    assert(valid_geometry(sets, ways));
+
+    setMask_ = sets_ - 1;
+    fullMap_ = (ways_ == 64) ? W64(-1) : ((W64(1) << ways_) - 1);
+
+    tags_     = new W64[sets_ * ways_];
+    evictmap_ = new W64[sets_];
+    entries_  = new DirectoryEntry[sets_ * ways_];
+
+    foreach (i, sets_ * ways_) {
+        tags_[i] = InvalidTag<W64>::INVALID;
+    }
+    foreach (i, sets_) {
+        evictmap_[i] = 0;
+    }
+
+    lastAccessCycle_ = 0;
+    portsUsed_       = 0;
+}
+
+DirectorySlice::~DirectorySlice()
+{
+    delete[] tags_;
+    delete[] evictmap_;
+    delete[] entries_;
+}
+
+bool DirectorySlice::valid_geometry(int sets, int ways)
+{
+    return (sets > 0) && ((sets & (sets - 1)) == 0) &&
+        inrange(ways, 1, 64);
+}
+
+int DirectorySlice::match(W64 set, W64 tag) const
+{
+    const W64 *tags = &tags_[set * ways_];
+
+    foreach (i, ways_) {
+        if (tags[i] == tag)
+            return i;
+    }
+
+    return -1;
+}
+
+DirectoryEntry* DirectorySlice::probe(W64 addr)
+{
+    W64 set = set_of(addr);
+    int way = match(set, floor(addr, DIR_LINE_SIZE));
+
+    if (way < 0)
+        return NULL;
+
+    evictmap_[set] |= (W64(1) << way);
+    return &entries_[set * ways_ + way];
+}
+
+/* Same pseudo-LRU as FullyAssociativeTags::select */
+DirectoryEntry* DirectorySlice::select(W64 addr, W64& old_tag)
+{
+    W64 set = set_of(addr);
+    W64 tag = floor(addr, DIR_LINE_SIZE);
+    W64 *tags = &tags_[set * ways_];
+    W64& map = evictmap_[set];
+    int way = match(set, tag);
+
+    if (way < 0) {
+        if (map == fullMap_) {
+            way = 0;
+            map = 0;
+        } else {
+            way = lsbindex64(~map & fullMap_);
+        }
+        old_tag = tags[way];
+        tags[way] = tag;
+    }
+
+    map |= (W64(1) << way);
+    if (map == fullMap_) {
+        map = (W64(1) << way);
+    }
+
+    return &entries_[set * ways_ + way];
+}
+
+int DirectorySlice::invalidate(W64 addr)
+{
+    W64 set = set_of(addr);
+    int way = match(set, floor(addr, DIR_LINE_SIZE));
+
+    if (way < 0)
+        return -1;
+
+    tags_[set * ways_ + way] = InvalidTag<W64>::INVALID;
+    evictmap_[set] &= ~(W64(1) << way);
+    entries_[set * ways_ + way].reset();
+    return way;
+}
+
+/**
+ * @brief Use one of this cycle's ports of the slice
+ *
+ * @return false if all ports are already used in this cycle
+ */
+bool DirectorySlice::get_port()
+{
+    if (lastAccessCycle_ < sim_cycle) {
+        lastAccessCycle_ = sim_cycle;
+        portsUsed_ = 0;
+    }
+
+    if (portsUsed_ >= ports_)
+        return false;
+
+    portsUsed_++;
+    return true;
+}
+
+/*
+ * Entries locked by requests in flight when state was saved are unlocked,
+ * those requests are not part of the checkpoint.
+ */
+void DirectorySlice::unlock_all()
+{
+    foreach (i, sets_ * ways_) {
+        entries_[i].locked = 0;
+    }
+}
+
+void DirectorySlice::save_state(ostream& os) const
+{
+    os.write((const char*)tags_, sets_ * ways_ * sizeof(W64));
+    os.write((const char*)evictmap_, sets_ * sizeof(W64));
+    os.write((const char*)entries_, sets_ * ways_ * sizeof(DirectoryEntry));
+}
+
+bool DirectorySlice::restore_state(istream& is)
+{
+    is.read((char*)tags_, sets_ * ways_ * sizeof(W64));
+    is.read((char*)evictmap_, sets_ * sizeof(W64));
+    is.read((char*)entries_, sets_ * ways_ * sizeof(DirectoryEntry));
+
+    if (is.fail())
+        return false;
+
+    unlock_all();
+    return true;
+}
+
+/**
+ * @brief Create the directory slices
+ *
+ * @param machine Machine that has the directory controller's options
+ * @param name Name of the directory controller
+ *
+ * Options of the controller are 'size', total number of entries of all
+ * slices, 'assoc', 'slices', one per home node and by default one per core,
+ * and 'latency' and 'ports' of each slice. Sets of a slice are rounded down
+ * to a power of two.
+ */
+Directory::Directory(BaseMachine& machine, const char *name)
+{
+    int size    = DIR_SET * DIR_WAY;
+    int ways    = DIR_WAY;
+    int slices  = machine.get_num_cores();
+    int latency = DIR_ACCESS_DELAY;
+    int ports   = DIR_PORTS;
+
+    machine.get_option(name, "size", size);
+    machine.get_option(name, "assoc", ways);
+    machine.get_option(name, "slices", slices);
+    machine.get_option(name, "latency", latency);
+    machine.get_option(name, "ports", ports);
+
+    int sets = 1;
+    if (slices > 0 && ways > 0) {
+        while (sets * 2 <= size / (slices * ways))
+            sets *= 2;
+    }
+
+    if (!inrange(slices, 1, DIR_MAX_SLICES) ||
+            !DirectorySlice::valid_geometry(sets, ways) || ports < 1) {
+        stringbuf err;
+        err << "::ERROR::Directory " << name << " can't have " << slices <<
+            " slices of " << ways << " ways with " << ports << " ports, " <<
+            "it must have 1 to " << DIR_MAX_SLICES << " slices of at most " <<
+            "64 ways" << endl;
+        ptl_logfile << err << flush;
+        cerr << err << flush;
+        assert(0);
+    }
+
+    foreach (i, slices) {
+        slices_.push(new DirectorySlice(sets, ways, latency, ports));
+    }
 }
 
 DirectoryEntry* Directory::insert(MemoryRequest *req, W64& old_tag)
 {
     W64 phys_addr = req->get_physical_address();
-    DirectoryEntry* entry = entries->select(phys_addr, old_tag);
+    DirectoryEntry* entry = slice_of(phys_addr).select(phys_addr, old_tag);
 
     return entry;
 }
@@ -56,14 +254,57 @@ DirectoryEntry* Directory::insert(MemoryRequest *req, W64& old_tag)
 DirectoryEntry* Directory::probe(MemoryRequest *req)
 {
     W64 phys_addr = req->get_physical_address();
-    DirectoryEntry* entry = entries->probe(phys_addr);
+    DirectoryEntry* entry = slice_of(phys_addr).probe(phys_addr);
 
     return entry;
 }
 
 int Directory::invalidate(MemoryRequest *req)
 {
-    return entries->invalidate(req->get_physical_address());
+    W64 phys_addr = req->get_physical_address();
+    return slice_of(phys_addr).invalidate(phys_addr);
+}
+
+/* Geometry is saved first so state of a different geometry is rejected */
+struct DirectoryGeometry {
+    W32 slices;
+    W32 sets;
+    W32 ways;
+};
+
+void Directory::save_state(ostream& os) const
+{
+    DirectoryGeometry geom;
+    geom.slices = slices_.count();
+    geom.sets   = slices_[0]->get_sets();
+    geom.ways   = slices_[0]->get_ways();
+    save_warm_block(os, geom);
+
+    foreach (i, slices_.count()) {
+        slices_[i]->save_state(os);
+    }
+}
+
+/**
+ * @brief Restore directory entries saved in a warm state checkpoint
+ */
+bool Directory::restore_state(istream& is)
+{
+    DirectoryGeometry geom;
+    if (!restore_warm_block(is, geom))
+        return false;
+
+    if (geom.slices != W32(slices_.count()) ||
+            geom.sets != W32(slices_[0]->get_sets()) ||
+            geom.ways != W32(slices_[0]->get_ways()))
+        return false;
+
+    foreach (i, slices_.count()) {
+        if (!slices_[i]->restore_state(is))
+            return false;
+    }
+
+    return true;
 }
 
 Directory* Directory::dir = NULL;
@@ -73,12 +314,15 @@ DirectoryController::pendingRequests_ = NULL;
 /**
  * @brief Get the global directory
  *
+ * @param machine Machine that has the directory options
+ * @param name Name of the first directory controller, which creates it
+ *
  * @return reference to global Directory
  */
-Directory& Directory::get_directory()
+Directory& Directory::get_directory(BaseMachine& machine, const char *name)
 {
     if (dir == NULL) {
-        dir = new Directory();
+        dir = new Directory(machine, name);
         DirectoryController::pendingRequests_ =
             new FixStateList<DirContBufferEntry, REQ_Q_SIZE>();
     }
@@ -94,7 +338,8 @@ DirectoryController* DirectoryController::dir_controllers[NUM_SIM_CORES] = {0};
 DirectoryController::DirectoryController(W8 idx, const char *name,
         MemoryHierarchy *memoryHierarchy)
     : Controller(idx, name, memoryHierarchy)
-      , dir_(Directory::get_directory())
+      , dir_(Directory::get_directory(memoryHierarchy->get_machine(), name))
+      , new_stats(name, &memoryHierarchy->get_machine())
 {
     memoryHierarchy_->add_cache_mem_controller(this);
 
@@ -295,8 +540,14 @@ bool DirectoryController::read_miss_cb(void *arg)
 {
     DirContBufferEntry *queueEntry = (DirContBufferEntry*)arg;
 
+    if (!get_slice_port(queueEntry->request)) {
+        marss_add_event(&read_miss, 1, queueEntry);
+        return true;
+    }
+
     DirectoryEntry *dir_entry      = get_directory_entry(queueEntry->request);
     DirectoryController *sig_dir   = this;
+    int latency = get_slice_latency(queueEntry->request);
 
     if (!dir_entry) {
         // Retry after 1 cycle
@@ -318,12 +569,10 @@ bool DirectoryController::read_miss_cb(void *arg)
 
         if (sig_dir == this && dir_entry->owner != queueEntry->cont->idx) {
             queueEntry->responder = controllers[dir_entry->owner];
-            marss_add_event(&send_response, DIR_ACCESS_DELAY,
-                    queueEntry);
+            marss_add_event(&send_response, latency, queueEntry);
         } else {
             queueEntry->responder = lower_cont;
-            marss_add_event(&sig_dir->send_update,
-                    DIR_ACCESS_DELAY, queueEntry);
+            marss_add_event(&sig_dir->send_update, latency, queueEntry);
         }
 
         return true;
@@ -342,8 +591,7 @@ bool DirectoryController::read_miss_cb(void *arg)
         queueEntry->responder = lower_cont;
 
     // Send response back
-    marss_add_event(&send_response, DIR_ACCESS_DELAY,
-            queueEntry);
+    marss_add_event(&send_response, latency, queueEntry);
 
     return true;
 }
@@ -353,8 +601,14 @@ bool DirectoryController::write_miss_cb(void *arg)
     DirContBufferEntry *queueEntry = (DirContBufferEntry*)arg;
     int cont_id = queueEntry->cont->idx;
 
+    if (!get_slice_port(queueEntry->request)) {
+        marss_add_event(&write_miss, 1, queueEntry);
+        return true;
+    }
+
     DirectoryEntry *dir_entry = get_directory_entry(queueEntry->request);
     DirectoryController *sig_dir = this;
+    int latency = get_slice_latency(queueEntry->request);
 
     if (!dir_entry || dir_entry->locked) {
         // Retry after 1 cycle
@@ -377,8 +631,7 @@ bool DirectoryController::write_miss_cb(void *arg)
         // Its not present in requested cache
         queueEntry->responder = lower_cont;
         sig_dir               = dir_controllers[dir_entry->owner];
-        marss_add_event(&sig_dir->send_evict,
-                DIR_ACCESS_DELAY, queueEntry);
+        marss_add_event(&sig_dir->send_evict, latency, queueEntry);
         return true;
     } else {
         // Check if it was present in only requested cache
@@ -388,8 +641,7 @@ bool DirectoryController::write_miss_cb(void *arg)
             // Send evict msg to other caches
             queueEntry->responder = lower_cont;
             sig_dir               = dir_controllers[dir_entry->owner];
-            marss_add_event(&sig_dir->send_evict,
-                    DIR_ACCESS_DELAY, queueEntry);
+            marss_add_event(&sig_dir->send_evict, latency, queueEntry);
             return true;
         }
 
@@ -402,8 +654,7 @@ bool DirectoryController::write_miss_cb(void *arg)
         queueEntry->hasData = 1;
     }
 
-    marss_add_event(&send_response,
-            DIR_ACCESS_DELAY, queueEntry);
+    marss_add_event(&send_response, latency, queueEntry);
 
     return true;
 }
@@ -416,8 +667,13 @@ bool DirectoryController::update_cb(void *arg)
 
     /* If this update was not initiated by directory controller
      * then we get the directory entry */
-    if (!dir_entry)
+    if (!dir_entry) {
+        if (!get_slice_port(queueEntry->request)) {
+            marss_add_event(&update, 1, queueEntry);
+            return true;
+        }
         dir_entry = get_directory_entry(queueEntry->request, 1);
+    }
 
     if (!dir_entry) {
         // Retry after 1 cycle
@@ -461,6 +717,10 @@ bool DirectoryController::evict_cb(void *arg)
      * then we get the directory entry , and if entry is not present
      * then we ignore this eviction.*/
     if (!dir_entry) {
+        if (!get_slice_port(queueEntry->request)) {
+            marss_add_event(&evict, 1, queueEntry);
+            return true;
+        }
         dir_entry = get_directory_entry(queueEntry->request, 1);
         if (!dir_entry) {
             // Remove this queue entry
@@ -778,11 +1038,99 @@ DirContBufferEntry* DirectoryController::find_dependent_enry(
     return NULL;
 }
 
+/**
+ * @brief Update directory for a functional warming access
+ *
+ * @param request Read, write or evict request from a lowest private cache
+ * @param shared True if line is present in another core's caches
+ *
+ * @return Always true, directory is not part of any cache's lower path
+ *
+ * Directory entries replaced here don't invalidate lines in caches.
+ */
+bool DirectoryController::warm_access(MemoryRequest *request, bool shared)
+{
+    W8 cont_id = request->get_coreid();
+    DirectoryEntry *entry = dir_.probe(request);
+
+    if (request->get_type() == MEMORY_OP_EVICT) {
+        if (!entry)
+            return true;
+
+        entry->present.reset(cont_id);
+        if (entry->present.iszero()) {
+            entry->owner = -1;
+            entry->dirty = 0;
+        } else if (entry->owner == cont_id) {
+            entry->owner = entry->present.lsb();
+        }
+        return true;
+    }
+
+    if (!entry) {
+        W64 old_tag = InvalidTag<W64>::INVALID;
+        entry = dir_.insert(request, old_tag);
+        entry->init(dir_.tag_of(request->get_physical_address()));
+    }
+
+    if (request->get_type() == MEMORY_OP_WRITE) {
+        entry->present.reset();
+        entry->owner = cont_id;
+        entry->dirty = 1;
+    } else if (entry->present.iszero()) {
+        entry->owner = cont_id;
+        entry->dirty = 0;
+    }
+
+    entry->present.set(cont_id);
+    return true;
+}
+
+/* All controllers share the Directory, first one saves it */
+void DirectoryController::save_warm_state(ostream& os)
+{
+    if (idx == 0)
+        dir_.save_state(os);
+}
+
+bool DirectoryController::restore_warm_state(istream& is)
+{
+    if (idx == 0)
+        return dir_.restore_state(is);
+    return true;
+}
+
+/**
+ * @brief Use a port of the home slice of a request in this cycle
+ *
+ * @param req Request that accesses the directory
+ *
+ * @return false if all ports of the slice are used, the access is retried
+ */
+bool DirectoryController::get_slice_port(MemoryRequest *req)
+{
+    if (dir_.slice_of(req->get_physical_address()).get_port())
+        return true;
+
+    N_STAT_UPDATE(new_stats.port_stalls, ++, req->is_kernel());
+    return false;
+}
+
+int DirectoryController::get_slice_latency(MemoryRequest *req)
+{
+    return dir_.slice_of(req->get_physical_address()).get_latency();
+}
+
 DirectoryEntry* DirectoryController::get_directory_entry(
         MemoryRequest *req, bool must_present)
 {
+    bool kernel = req->is_kernel();
     DirectoryEntry *entry = dir_.probe(req);
 
+    N_STAT_UPDATE(new_stats.accesses, ++, kernel);
+    N_STAT_UPDATE(new_stats.slice_access,
+            [dir_.slice_index(req->get_physical_address())]++, kernel);
+
     if (!entry && must_present) {
         W64 tag_t = dir_.tag_of(req->get_physical_address());
         foreach (i, REQ_Q_SIZE) {
@@ -800,10 +1148,14 @@ DirectoryEntry* DirectoryController::get_directory_entry(
         entry = dir_.insert(req, old_tag);
         assert(entry);
 
+        N_STAT_UPDATE(new_stats.misses, ++, kernel);
+
         /* If we are removing any entry with cached line then we
          * must send evict signal to those caches. */
         if ((old_tag != InvalidTag<W64>::INVALID && old_tag != (W64)-1) &&
                 entry->present.nonzero()) {
+            N_STAT_UPDATE(new_stats.back_invalidations, ++, kernel);
+
             DirContBufferEntry *newEntry = pendingRequests_->alloc();
 
             assert(newEntry);
@@ -964,11 +1316,17 @@ void DirectoryController::dump_configuration(YAML::Emitter &out) const
 {
 	out << YAML::Key << get_name() << YAML::Value << YAML::BeginMap;
 
+	DirectorySlice& slice = dir_.slice_of(0);
+
 	YAML_KEY_VAL(out, "type", "directory");
-	YAML_KEY_VAL(out, "size", DIR_SET * DIR_WAY);
+	YAML_KEY_VAL(out, "size", dir_.slice_count() * slice.get_sets() *
+			slice.get_ways());
 	YAML_KEY_VAL(out, "line_size", DIR_LINE_SIZE);
-	YAML_KEY_VAL(out, "sets", DIR_SET);
-	YAML_KEY_VAL(out, "ways", DIR_WAY);
+	YAML_KEY_VAL(out, "slices", dir_.slice_count());
+	YAML_KEY_VAL(out, "sets", slice.get_sets());
+	YAML_KEY_VAL(out, "ways", slice.get_ways());
+	YAML_KEY_VAL(out, "latency", slice.get_latency());
+	YAML_KEY_VAL(out, "ports", slice.get_ports());
 
 	out << YAML::EndMap;
 }
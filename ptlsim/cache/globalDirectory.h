@@ -25,6 +25,7 @@ using namespace Memory;
 #define DIR_WAY 16
 #define DIR_LINE_SIZE 64
 #define DIR_ACCESS_DELAY 10
+#define DIR_PORTS 2
 #define REQ_Q_SIZE 128
 
 /**
@@ -53,39 +54,97 @@ static inline ostream& operator <<(ostream &os, const DirectoryEntry &e)
     return e.print(os);
 }
 
+/**
+ * @brief One slice of the sparse directory
+ *
+ * Set-associative array of directory entries with runtime geometry and the
+ * same pseudo-LRU replacement as AssociativeArray. Each slice has its own
+ * access ports and latency, so requests to different slices don't contend.
+ */
+class DirectorySlice {
+    private:
+        int sets_;
+        int ways_;
+        int latency_;
+        int ports_;
+        W64 setMask_;
+        W64 fullMap_;
+
+        W64 *tags_;
+        W64 *evictmap_;
+        DirectoryEntry *entries_;
+
+        W64 lastAccessCycle_;
+        int portsUsed_;
+
+        W64 set_of(W64 addr) const {
+            return (addr >> log2(DIR_LINE_SIZE)) & setMask_;
+        }
+
+        int match(W64 set, W64 tag) const;
+
+    public:
+        DirectorySlice(int sets, int ways, int latency, int ports);
+        ~DirectorySlice();
+
+        static bool valid_geometry(int sets, int ways);
+
+        DirectoryEntry *probe(W64 addr);
+        DirectoryEntry *select(W64 addr, W64& old_tag);
+        int             invalidate(W64 addr);
+
+        bool get_port();
+        void unlock_all();
+
+        int get_sets() const { return sets_; }
+        int get_ways() const { return ways_; }
+        int get_latency() const { return latency_; }
+        int get_ports() const { return ports_; }
+
+        void save_state(ostream& os) const;
+        bool restore_state(istream& is);
+};
+
 /**
  * @brief A Directory containing cacheline informations.
  *
  * This is a singleton class so there is only one Global directory.
- * All directory controllers get access to this directory and should
- * simulate appropriate access delay. This directory is a set-assoc
- * structure. The size of the directory is statically set.
- *
- * TODO:
- *	- Allow configuration options to dynamically set directory size.
- *	- Simulate limited port access
+ * All directory controllers get access to this directory. The directory is
+ * split in slices, one per home node, and a line's home slice is selected by
+ * a hash of its address. Size, associativity, number of slices, latency and
+ * ports of each slice are options of the directory controller that creates
+ * the directory, see Directory::Directory.
  */
 class Directory {
     private:
-        Directory();
+        Directory(BaseMachine& machine, const char *name);
         static Directory* dir;
 
-        typedef AssociativeArray<W64, DirectoryEntry, DIR_SET,
-                DIR_WAY, DIR_LINE_SIZE> base_t;
-        typedef FullyAssociativeArray<W64, DirectoryEntry, DIR_WAY,
-                NullAssociativeArrayStatisticsCollector<W64,
-                DirectoryEntry> > Set;
-
-        base_t* entries;
+        dynarray<DirectorySlice*> slices_;
 
     public:
-        static Directory& get_directory();
+        static Directory& get_directory(BaseMachine& machine,
+                const char *name);
+
+        int slice_index(W64 addr) const {
+            W64 line = addr >> log2(DIR_LINE_SIZE);
+            return (line ^ (line >> 7) ^ (line >> 17)) % slices_.count();
+        }
+
+        DirectorySlice& slice_of(W64 addr) {
+            return *slices_[slice_index(addr)];
+        }
+
+        int slice_count() const { return slices_.count(); }
 
         DirectoryEntry *insert(MemoryRequest *req, W64&old_tag);
         DirectoryEntry *probe(MemoryRequest *req);
         int             invalidate(MemoryRequest *req);
 
-        W64 tag_of(W64 addr) { return base_t::tagof(addr); }
+        W64 tag_of(W64 addr) { return floor(addr, DIR_LINE_SIZE); }
+
+        void save_state(ostream& os) const;
+        bool restore_state(istream& is);
 };
 
 struct DirContBufferEntry : public FixStateListObject
@@ -160,6 +219,8 @@ class DirectoryController : public Controller {
 
         DirectoryEntry dummy_entries[REQ_Q_SIZE];
 
+        DirectoryStats new_stats;
+
         /* Simple function dispatcher to handle memory request */
         typedef bool (DirectoryController::*req_handler)(Message *msg);
         req_handler req_handlers[NUM_MEMORY_OP];
@@ -191,6 +252,9 @@ class DirectoryController : public Controller {
         bool is_full(bool flag=false) const;
         void annul_request(MemoryRequest *request);
 		void dump_configuration(YAML::Emitter &out) const;
+        bool warm_access(MemoryRequest *request, bool shared);
+        void save_warm_state(ostream& os);
+        bool restore_warm_state(istream& is);
 
         bool handle_read_miss(Message *message);
         bool handle_write_miss(Message *message);
@@ -212,6 +276,8 @@ class DirectoryController : public Controller {
         DirContBufferEntry* find_dependent_enry(MemoryRequest *req);
         void wakeup_dependent(DirContBufferEntry *queueEntry);
 
+        bool get_slice_port(MemoryRequest *req);
+        int  get_slice_latency(MemoryRequest *req);
         DirectoryEntry* get_directory_entry(MemoryRequest *req,
                 bool must_present=0);
         DirectoryEntry* get_dummy_entry(DirectoryEntry *entry, W64 old_tag);
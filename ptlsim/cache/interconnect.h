@@ -46,6 +46,7 @@ class Interconnect
 	private:
         stringbuf name_;
 		Signal controller_request_;
+		int fullIdx_;
 
 	public:
 		MemoryHierarchy *memoryHierarchy_;
@@ -54,6 +55,7 @@ class Interconnect
 			, memoryHierarchy_(memoryHierarchy)
 		{
 			name_ << name;
+			fullIdx_ = -1;
 			controller_request_.connect(signal_mem_ptr(*this,
 						&Interconnect::controller_request_cb));
 		}
@@ -80,6 +82,10 @@ class Interconnect
 		char* get_name() const {
 			return name_.buf;
 		}
+
+		/* Index of this interconnect's full flag in MemoryHierarchy */
+		void set_full_index(int idx) { fullIdx_ = idx; }
+		int get_full_index() const { return fullIdx_; }
 };
 
 static inline ostream& operator << (ostream& os, const Interconnect&
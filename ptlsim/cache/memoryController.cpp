@@ -41,9 +41,13 @@
 using namespace Memory;
 
 MemoryController::MemoryController(W8 coreid, const char *name,
-		MemoryHierarchy *memoryHierarchy) :
+		MemoryHierarchy *memoryHierarchy, bool dramTiming) :
 	Controller(coreid, name, memoryHierarchy)
     , new_stats(name, &memoryHierarchy->get_machine())
+    , dram_(NULL)
+    , dramStats_(NULL)
+    , nextSchedule_(0)
+    , lastStatCycle_(0)
 {
     memoryHierarchy_->add_cache_mem_controller(this);
 
@@ -65,6 +69,70 @@ MemoryController::MemoryController(W8 coreid, const char *name,
 	foreach(i, MEM_BANKS) {
 		banksUsed_[i] = 0;
 	}
+
+    if (dramTiming)
+        setup_dram();
+}
+
+MemoryController::~MemoryController()
+{
+    delete dram_;
+    delete dramStats_;
+}
+
+/**
+ * @brief Set up DRAM timing model from machine options
+ *
+ * Timing options are in DRAM clock cycles of 'dram_clock' MHz, page_policy
+ * is either 'open' or 'closed'. Unset options keep DDR3-1600 defaults.
+ */
+void MemoryController::setup_dram()
+{
+    const char *name = get_name();
+    BaseMachine &machine = memoryHierarchy_->get_machine();
+    DRAMConfig dconf;
+
+    machine.get_option(name, "channels", dconf.channels);
+    machine.get_option(name, "ranks", dconf.ranks);
+    machine.get_option(name, "banks", dconf.banks);
+    machine.get_option(name, "row_lines", dconf.row_lines);
+
+    stringbuf policy;
+    if (machine.get_option(name, "page_policy", policy)) {
+        if (strequal(policy.buf, "closed")) {
+            dconf.policy = DRAM_CLOSED_PAGE;
+        } else if (!strequal(policy.buf, "open")) {
+            ptl_logfile << "Unknown page_policy " << policy << " for " <<
+                name << ", using open page policy\n";
+        }
+    }
+
+    machine.get_option(name, "tCAS", dconf.tCAS);
+    machine.get_option(name, "tCWL", dconf.tCWL);
+    machine.get_option(name, "tRCD", dconf.tRCD);
+    machine.get_option(name, "tRP", dconf.tRP);
+    machine.get_option(name, "tRAS", dconf.tRAS);
+    machine.get_option(name, "tRRD", dconf.tRRD);
+    machine.get_option(name, "tFAW", dconf.tFAW);
+    machine.get_option(name, "tWR", dconf.tWR);
+    machine.get_option(name, "tWTR", dconf.tWTR);
+    machine.get_option(name, "tRTW", dconf.tRTW);
+    machine.get_option(name, "tBURST", dconf.tBURST);
+    machine.get_option(name, "tRFC", dconf.tRFC);
+    machine.get_option(name, "tREFI", dconf.tREFI);
+
+    int dram_clock;
+    if (!machine.get_option(name, "dram_clock", dram_clock)) {
+        dram_clock = 800; /* MHz */
+    }
+
+    dconf.scale(double(config.core_freq_hz) / (dram_clock * 1e6));
+
+    dram_ = new DRAMModel(dconf);
+    dramStats_ = new DRAMStats("dram", &new_stats);
+
+    SET_SIGNAL_CB(name, "_Schedule_DRAM", scheduleDRAM_,
+            &MemoryController::schedule_dram_cb);
 }
 
 /*
@@ -168,6 +236,12 @@ bool MemoryController::handle_interconnect_cb(void *arg)
 
     assert(queueEntry->inUse == false);
 
+    if (dram_) {
+        queueEntry->arrivalCycle = sim_cycle;
+        schedule_dram();
+        return true;
+    }
+
 	if(banksUsed_[bank_no] == 0) {
 		banksUsed_[bank_no] = 1;
 		queueEntry->inUse = true;
@@ -178,12 +252,115 @@ bool MemoryController::handle_interconnect_cb(void *arg)
 	return true;
 }
 
+/**
+ * @brief Issue an access to DRAM and schedule its completion
+ *
+ * @param entry Queue entry of the access
+ * @param loc DRAM location of the access
+ */
+void MemoryController::issue_dram(MemoryQueueEntry *entry,
+        const DRAMLocation& loc)
+{
+    MemoryRequest *request = entry->request;
+    bool kernel = request->is_kernel();
+    bool is_write = (request->get_type() != MEMORY_OP_READ);
+
+    if (lastStatCycle_ == 0)
+        lastStatCycle_ = sim_cycle;
+
+    DRAMRowState state;
+    W64 done = dram_->access(loc, is_write, sim_cycle, state);
+
+    switch (state) {
+        case DRAM_ROW_HIT:
+            N_STAT_UPDATE(dramStats_->row.hit, ++, kernel);
+            break;
+        case DRAM_ROW_MISS:
+            N_STAT_UPDATE(dramStats_->row.miss, ++, kernel);
+            break;
+        case DRAM_ROW_CONFLICT:
+            N_STAT_UPDATE(dramStats_->row.conflict, ++, kernel);
+            break;
+    }
+
+    if (is_write) {
+        N_STAT_UPDATE(dramStats_->writes, ++, kernel);
+    } else {
+        N_STAT_UPDATE(dramStats_->reads, ++, kernel);
+    }
+    N_STAT_UPDATE(dramStats_->accesses, ++, kernel);
+    N_STAT_UPDATE(dramStats_->bytes, += 64, kernel);
+    N_STAT_UPDATE(dramStats_->data_bus_cycles, += dram_->get_config().tBURST,
+            kernel);
+
+    memdebug("DRAM issue ch:" << loc.channel << " rank:" << loc.rank <<
+            " bank:" << loc.bank << " row:" << loc.row << " state:" <<
+            state << " done:" << done << " Request: " << *request << endl);
+
+    entry->inUse = true;
+    marss_add_event(&accessCompleted_, done - sim_cycle, entry);
+}
+
+/**
+ * @brief FR-FCFS scheduling of pending requests to DRAM banks
+ *
+ * Among requests to a ready bank, first ready row hits are issued in
+ * arrival order, then the oldest request of each remaining ready bank.
+ * If requests wait for busy banks, scheduler runs again when the first of
+ * those banks is ready.
+ */
+void MemoryController::schedule_dram()
+{
+    W64 next = (W64)-1;
+    MemoryQueueEntry *entry;
+
+    foreach (pass, 2) {
+        foreach_list_mutable(pendingRequests_.list(), entry, entry_t,
+                prev_t) {
+            if (entry->inUse || entry->annuled)
+                continue;
+
+            DRAMLocation loc = dram_->decode(
+                    entry->request->get_physical_address());
+            W64 ready = dram_->ready_cycle(loc, sim_cycle);
+
+            if (ready > sim_cycle) {
+                next = min(next, ready);
+                continue;
+            }
+
+            if (pass == 0 && !dram_->is_row_hit(loc))
+                continue;
+
+            issue_dram(entry, loc);
+        }
+    }
+
+    /* One wakeup is enough if another is pending before this one */
+    if (next != (W64)-1 && (nextSchedule_ <= sim_cycle ||
+                next < nextSchedule_)) {
+        nextSchedule_ = next;
+        marss_add_event(&scheduleDRAM_, next - sim_cycle, NULL);
+    }
+}
+
+bool MemoryController::schedule_dram_cb(void *arg)
+{
+    if (nextSchedule_ == sim_cycle)
+        nextSchedule_ = 0;
+
+    schedule_dram();
+    return true;
+}
+
 void MemoryController::print(ostream& os) const
 {
 	os << "---Memory-Controller: " << get_name() << endl;
 	if(pendingRequests_.count() > 0)
 		os << "Queue : " << pendingRequests_ << endl;
     os << "banksUsed_: " << banksUsed_ << endl;
+	if(dram_)
+		os << "nextSchedule_: " << nextSchedule_ << endl;
 	os << "---End Memory-Controller: " << get_name() << endl;
 }
 
@@ -197,6 +374,14 @@ bool MemoryController::access_completed_cb(void *arg)
             get_physical_address());
     banksUsed_[bank_no] = 0;
 
+    if (dram_) {
+        N_STAT_UPDATE(dramStats_->queue_cycles, += (sim_cycle -
+                    queueEntry->arrivalCycle), kernel);
+        N_STAT_UPDATE(dramStats_->cycles, += (sim_cycle - lastStatCycle_),
+                kernel);
+        lastStatCycle_ = sim_cycle;
+    }
+
     N_STAT_UPDATE(new_stats.bank_access, [bank_no]++, kernel);
     switch(queueEntry->request->get_type()) {
         case MEMORY_OP_READ:
@@ -217,19 +402,24 @@ bool MemoryController::access_completed_cb(void *arg)
      * for the same bank
      */
     MemoryQueueEntry* entry;
-    foreach_list_mutable(pendingRequests_.list(), entry, entry_t,
-            prev_t) {
-        int bank_no_2 = get_bank_id(entry->request->
-                get_physical_address());
-        if(bank_no == bank_no_2 && entry->inUse == false) {
-            entry->inUse = true;
-            marss_add_event(&accessCompleted_,
-                    latency_, entry);
-            banksUsed_[bank_no] = 1;
-            break;
+    if (!dram_) {
+        foreach_list_mutable(pendingRequests_.list(), entry, entry_t,
+                prev_t) {
+            int bank_no_2 = get_bank_id(entry->request->
+                    get_physical_address());
+            if(bank_no == bank_no_2 && entry->inUse == false) {
+                entry->inUse = true;
+                marss_add_event(&accessCompleted_,
+                        latency_, entry);
+                banksUsed_[bank_no] = 1;
+                break;
+            }
         }
     }
 
+    if (dram_)
+        schedule_dram();
+
     if(!queueEntry->annuled) {
 
         /* Send response back to cache */
@@ -327,25 +517,56 @@ void MemoryController::dump_configuration(YAML::Emitter &out) const
 
 	YAML_KEY_VAL(out, "type", "dram_cont");
 	YAML_KEY_VAL(out, "RAM_size", ram_size); /* ram_size is from QEMU */
-	YAML_KEY_VAL(out, "number_of_banks", MEM_BANKS);
-	YAML_KEY_VAL(out, "latency", latency_);
-	YAML_KEY_VAL(out, "latency_ns", simcycles_to_ns(latency_));
 	YAML_KEY_VAL(out, "pending_queue_size", pendingRequests_.size());
 
+    if (dram_) {
+        const DRAMConfig& dconf = dram_->get_config();
+        YAML_KEY_VAL(out, "timing", "ddr");
+        YAML_KEY_VAL(out, "channels", dconf.channels);
+        YAML_KEY_VAL(out, "ranks", dconf.ranks);
+        YAML_KEY_VAL(out, "banks", dconf.banks);
+        YAML_KEY_VAL(out, "row_lines", dconf.row_lines);
+        YAML_KEY_VAL(out, "page_policy",
+                (dconf.policy == DRAM_OPEN_PAGE ? "open" : "closed"));
+        /* Timing parameters in simulation cycles */
+        YAML_KEY_VAL(out, "tCAS", dconf.tCAS);
+        YAML_KEY_VAL(out, "tCWL", dconf.tCWL);
+        YAML_KEY_VAL(out, "tRCD", dconf.tRCD);
+        YAML_KEY_VAL(out, "tRP", dconf.tRP);
+        YAML_KEY_VAL(out, "tRAS", dconf.tRAS);
+        YAML_KEY_VAL(out, "tRRD", dconf.tRRD);
+        YAML_KEY_VAL(out, "tFAW", dconf.tFAW);
+        YAML_KEY_VAL(out, "tWR", dconf.tWR);
+        YAML_KEY_VAL(out, "tWTR", dconf.tWTR);
+        YAML_KEY_VAL(out, "tRTW", dconf.tRTW);
+        YAML_KEY_VAL(out, "tBURST", dconf.tBURST);
+        YAML_KEY_VAL(out, "tRFC", dconf.tRFC);
+        YAML_KEY_VAL(out, "tREFI", dconf.tREFI);
+    } else {
+        YAML_KEY_VAL(out, "timing", "fixed");
+        YAML_KEY_VAL(out, "number_of_banks", MEM_BANKS);
+        YAML_KEY_VAL(out, "latency", latency_);
+        YAML_KEY_VAL(out, "latency_ns", simcycles_to_ns(latency_));
+    }
+
 	out << YAML::EndMap;
 }
 
 /* Memory Controller Builder */
 struct MemoryControllerBuilder : public ControllerBuilder
 {
-    MemoryControllerBuilder(const char* name) :
+    bool dramTiming;
+
+    MemoryControllerBuilder(const char* name, bool dramTiming = false) :
         ControllerBuilder(name)
+        , dramTiming(dramTiming)
     {}
 
     Controller* get_new_controller(W8 coreid, W8 type,
             MemoryHierarchy& mem, const char *name) {
-        return new MemoryController(coreid, name, &mem);
+        return new MemoryController(coreid, name, &mem, dramTiming);
     }
 };
 
 MemoryControllerBuilder memControllerBuilder("simple_dram_cont");
+MemoryControllerBuilder ddrControllerBuilder("ddr_dram_cont", true);
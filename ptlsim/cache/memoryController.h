@@ -32,6 +32,7 @@
 #include <interconnect.h>
 #include <superstl.h>
 #include <memoryStats.h>
+#include <dramModel.h>
 
 namespace Memory {
 
@@ -42,12 +43,14 @@ struct MemoryQueueEntry : public FixStateListObject
 	int depends;
 	bool annuled;
 	bool inUse;
+	W64 arrivalCycle;
 
 	void init() {
 		request = NULL;
 		depends = -1;
 		annuled = false;
 		inUse = false;
+		arrivalCycle = 0;
 	}
 
 	ostream& print(ostream &os) const {
@@ -72,6 +75,7 @@ class MemoryController : public Controller
 
 		Signal accessCompleted_;
 		Signal waitInterconnect_;
+		Signal scheduleDRAM_;
 
 		FixStateList<MemoryQueueEntry, MEM_REQ_NUM> pendingRequests_;
 
@@ -81,9 +85,20 @@ class MemoryController : public Controller
 
         RAMStats new_stats;
 
+        /* DRAM timing model, NULL when using fixed latency */
+        DRAMModel *dram_;
+        DRAMStats *dramStats_;
+        W64 nextSchedule_;
+        W64 lastStatCycle_;
+
+        void setup_dram();
+        void schedule_dram();
+        void issue_dram(MemoryQueueEntry *entry, const DRAMLocation& loc);
+
 	public:
 		MemoryController(W8 coreid, const char *name,
-				 MemoryHierarchy *memoryHierarchy);
+				 MemoryHierarchy *memoryHierarchy, bool dramTiming = false);
+		~MemoryController();
 		virtual bool handle_interconnect_cb(void *arg);
 		void print(ostream& os) const;
 
@@ -91,6 +106,7 @@ class MemoryController : public Controller
 
 		virtual bool access_completed_cb(void *arg);
 		virtual bool wait_interconnect_cb(void *arg);
+		bool schedule_dram_cb(void *arg);
 
 		void annul_request(MemoryRequest *request);
 		virtual void dump_configuration(YAML::Emitter &out) const;
@@ -101,6 +117,10 @@ class MemoryController : public Controller
 			return pendingRequests_.isFull();
 		}
 
+		bool is_memory_controller() const {
+			return true;
+		}
+
 		void print_map(ostream& os)
 		{
 			os << "Memory Controller: " << get_name() << endl;
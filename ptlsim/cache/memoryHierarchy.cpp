@@ -51,10 +51,16 @@ using namespace Memory;
 
 MemoryHierarchy::MemoryHierarchy(BaseMachine& machine) :
   machine_(machine)
+  , fullCount_(0)
   , someStructIsFull_(false)
+  , bufferAccesses_(false)
 {
   coreNo_ = machine_.get_num_cores();
 
+  foreach(i, NUM_SIM_CORES) {
+    replayIndex_[i] = 0;
+  }
+
   foreach(i, NUM_SIM_CORES) {
     RequestPool* pool = new RequestPool();
     requestPool_.push(pool);
@@ -76,6 +82,11 @@ bool MemoryHierarchy::access_cache(MemoryRequest *request)
   CPUController *cpuController = (CPUController*)cpuControllers_[coreid];
   assert(cpuController != NULL);
 
+  if unlikely (bufferAccesses_)
+    return buffer_access(cpuController, request);
+
+  ParallelSharedAccess shared_access;
+
   int ret_val;
   ret_val = ((CPUController*)cpuController)->access(request);
 
@@ -88,6 +99,153 @@ bool MemoryHierarchy::access_cache(MemoryRequest *request)
   return false;
 }
 
+/**
+ * @brief Handle a core request while cores run ahead in a parallel quantum
+ *
+ * Reads that hit in the private L1 are served right away and the core is
+ * woken up after the L1 latency by clock_private(). All other requests are
+ * kept until replay_accesses() sends them to the hierarchy in cycle order,
+ * so the core sees their response only in the next quantum.
+ *
+ * @return Same as access_cache() for the request
+ */
+bool MemoryHierarchy::buffer_access(CPUController *cpuController,
+    MemoryRequest *request)
+{
+  W8 coreid = request->get_coreid();
+  int latency = cpuController->access_private(request);
+
+  if(latency == 0)
+    return true;
+
+  request->incRefCounter();
+
+  if(latency > 0) {
+    privateWakeups_[coreid].push(BufferedAccess(request, sim_cycle + latency));
+    return false;
+  }
+
+  accessBuffer_[coreid].push(BufferedAccess(request, sim_cycle));
+
+  return (request->get_type() == MEMORY_OP_WRITE);
+}
+
+/**
+ * @brief Wake up the core for private L1 hits that are due this cycle
+ *
+ * @param coreid Core that is about to run its cycle
+ *
+ * Called from the host thread that runs the core, it only touches state of
+ * given core.
+ */
+void MemoryHierarchy::clock_private(W8 coreid)
+{
+  dynarray<BufferedAccess>& wakeups = privateWakeups_[coreid];
+  int pending = 0;
+
+  foreach(i, wakeups.count()) {
+    BufferedAccess access = wakeups[i];
+
+    if(access.cycle > sim_cycle) {
+      wakeups[pending++] = access;
+      continue;
+    }
+
+    access.request->decRefCounter();
+    ((CPUController*)cpuControllers_[coreid])->complete_private(
+        access.request);
+  }
+
+  wakeups.resize(pending);
+}
+
+/**
+ * @brief Send buffered core requests of given cycle to the hierarchy
+ *
+ * @param cycle Cycle that the hierarchy has been clocked to
+ *
+ * @return Number of requests sent
+ *
+ * Requests of the same cycle are sent in core order, same as when all cores
+ * are simulated serially. Reads that now hit in L1 without latency wake up
+ * the core right away as it was told to wait for them.
+ */
+int MemoryHierarchy::replay_accesses(W64 cycle)
+{
+  int count = 0;
+
+  foreach(coreid, NUM_SIM_CORES) {
+    dynarray<BufferedAccess>& buffer = accessBuffer_[coreid];
+    int& index = replayIndex_[coreid];
+
+    for(; index < buffer.count() && buffer[index].cycle <= cycle; index++) {
+      MemoryRequest *request = buffer[index].request;
+      CPUController *cpuController = (CPUController*)cpuControllers_[coreid];
+
+      cpuController->queue_request(request, -1);
+      request->decRefCounter();
+      count++;
+    }
+  }
+
+  return count;
+}
+
+/**
+ * @brief Clear buffers after all cycles of a quantum are replayed
+ */
+void MemoryHierarchy::finish_replay()
+{
+  foreach(coreid, NUM_SIM_CORES) {
+    assert(replayIndex_[coreid] == accessBuffer_[coreid].count());
+    accessBuffer_[coreid].clear();
+    replayIndex_[coreid] = 0;
+  }
+}
+
+/**
+ * @brief Complete all pending private L1 hits before returning to emulation
+ */
+void MemoryHierarchy::flush_private_wakeups()
+{
+  foreach(coreid, NUM_SIM_CORES) {
+    dynarray<BufferedAccess>& wakeups = privateWakeups_[coreid];
+
+    foreach(i, wakeups.count()) {
+      wakeups[i].request->decRefCounter();
+      ((CPUController*)cpuControllers_[coreid])->complete_private(
+          wakeups[i].request);
+    }
+
+    wakeups.clear();
+  }
+}
+
+/**
+ * @brief Drop buffered requests that match an annulled request
+ */
+void MemoryHierarchy::annul_buffered(MemoryRequest *request)
+{
+  W8 coreid = request->get_coreid();
+  dynarray<BufferedAccess>* buffers[2] = {
+    &accessBuffer_[coreid], &privateWakeups_[coreid]};
+
+  foreach(b, 2) {
+    dynarray<BufferedAccess>& buffer = *buffers[b];
+    int count = 0;
+
+    foreach(i, buffer.count()) {
+      if(buffer[i].request->is_same(request)) {
+        buffer[i].request->decRefCounter();
+        continue;
+      }
+      buffer[count++] = buffer[i];
+    }
+
+    buffer.resize(count);
+  }
+}
+
 void MemoryHierarchy::clock()
 {
   // First clock all the cpu controllers
@@ -98,16 +256,49 @@ void MemoryHierarchy::clock()
   }
 
   Event *event;
-  while(!eventQueue_.empty()) {
-    event = eventQueue_.head();
-    if(event->get_clock() <= sim_cycle) {
-      memdebug("Executing event: " << *event);
-      eventQueue_.free(event);
-      assert(event->execute());
-    } else {
-      break;
+  while((event = eventQueue_.pop(sim_cycle))) {
+    memdebug("Executing event: " << *event);
+    assert(event->execute());
+    eventQueue_.free(event);
+  }
+}
+
+/**
+ * @brief Find next cycle in which memory hierarchy has any work to do
+ *
+ * @return Cycle of earliest pending event or CPU controller request, -1 if
+ * there is nothing pending
+ */
+W64 MemoryHierarchy::get_next_event_cycle()
+{
+  W64 next = eventQueue_.next_clock();
+
+  foreach(i, cpuControllers_.count()) {
+    CPUController *cpuController = (CPUController*)(
+        cpuControllers_[i]);
+    next = min(next, cpuController->get_next_clock());
+
+    foreach(j, privateWakeups_[i].count()) {
+      next = min(next, privateWakeups_[i][j].cycle);
     }
   }
+
+  return next;
+}
+
+/**
+ * @brief Skip cycles in which memory hierarchy has nothing to do
+ *
+ * @param cycles Number of cycles to skip, sim_cycle + cycles must not be
+ * beyond get_next_event_cycle()
+ */
+void MemoryHierarchy::skip_cycles(W64 cycles)
+{
+  foreach(i, cpuControllers_.count()) {
+    CPUController *cpuController = (CPUController*)(
+        cpuControllers_[i]);
+    cpuController->skip_cycles(cycles);
+  }
 }
 
 void MemoryHierarchy::reset()
@@ -131,66 +322,48 @@ int MemoryHierarchy::flush(uint8_t coreid)
   return delay;
 }
 
+void MemoryHierarchy::set_full_flag(int idx, bool flag)
+{
+  /* Unregistered controllers and interconnects are never marked full */
+  if(idx < 0)
+    return;
+
+  assert(idx < fullFlags_.count());
+
+  if(fullFlags_[idx] == flag)
+    return;
+
+  fullFlags_[idx] = flag;
+  fullCount_ += flag ? 1 : -1;
+  assert(fullCount_ >= 0);
+  someStructIsFull_ = (fullCount_ > 0);
+}
+
 void MemoryHierarchy::set_controller_full(Controller* controller,
     bool flag)
 {
-
-  bool anyFull = false;
-  foreach(i, cpuControllers_.count()) {
-    if(cpuControllers_[i] == controller) {
-      cpuFullFlags_[i] = flag;
-    }
-    anyFull |= cpuFullFlags_[i];
-  }
-  foreach(j, allControllers_.count()) {
-    if(allControllers_[j] == controller) {
-      controllersFullFlags_[j] = flag;
-    }
-    anyFull |= controllersFullFlags_[j];
-  }
-  foreach(i, allInterconnects_.count()) {
-    anyFull |= interconnectsFullFlags_[i];
-  }
-  someStructIsFull_ = anyFull;
+  set_full_flag(controller->get_full_index(), flag);
 }
 
 void MemoryHierarchy::set_interconnect_full(Interconnect* interconnect,
     bool flag)
 {
-  bool anyFull = false;
-  foreach(i, allInterconnects_.count()) {
-    if(allInterconnects_[i] == interconnect) {
-      interconnectsFullFlags_[i] = flag;
-    }
-    anyFull |= interconnectsFullFlags_[i];
-  }
-  foreach(i, cpuControllers_.count()) {
-    anyFull |= cpuFullFlags_[i];
-  }
-  foreach(j, allControllers_.count()) {
-    anyFull |= controllersFullFlags_[j];
-  }
-  someStructIsFull_ = anyFull;
+  set_full_flag(interconnect->get_full_index(), flag);
 }
 
 bool MemoryHierarchy::is_controller_full(Controller* controller)
 {
-  foreach(j, allControllers_.count()) {
-    if(allControllers_[j] == controller) {
-      return controllersFullFlags_[j];
-    }
-  }
-  foreach(i, cpuControllers_.count()) {
-    if(cpuControllers_[i] == controller) {
-      return cpuFullFlags_[i];
-    }
-  }
-  return false;
+  int idx = controller->get_full_index();
+  if(idx < 0)
+    return false;
+  return fullFlags_[idx];
 }
 
 bool MemoryHierarchy::is_cache_available(W8 coreid, W8 threadid,
     bool is_icache)
 {
+  ParallelSharedAccess shared_access(!bufferAccesses_);
+
   CPUController *cpuController = (CPUController*)cpuControllers_[coreid];
   assert(cpuController != NULL);
   return !(cpuController->is_full());
@@ -229,7 +402,8 @@ void MemoryHierarchy::dump_info(ostream& os)
     os << *(allInterconnects_[i]);
   }
 
-  os << "::someStructIsFull_: " << someStructIsFull_ << endl;
+  os << "::someStructIsFull_: " << someStructIsFull_ <<
+    " (" << fullCount_ << " full)" << endl;
 }
 
 void MemoryHierarchy::print_map(ostream& os)
@@ -254,55 +428,9 @@ void MemoryHierarchy::print_map(ostream& os)
   os << "--End MemoryHierarchy Map\n";
 }
 
-void MemoryHierarchy::sort_event_queue(Event *event)
-{
-  // First make sure that given event is in tail of queue
-  assert(eventQueue_.tail() == event);
-
-  // No need to sort if only 1 event
-  if(eventQueue_.count() == 1)
-    return;
-
-  Event* entryEvent;
-  foreach_list_mutable(eventQueue_.list(), entryEvent, entry, preventry) {
-    if(*event < *entryEvent) {
-      eventQueue_.unlink(event);
-      eventQueue_.insert_after(event, (Event*)(entryEvent->prev));
-      return;
-    }
-  }
-
-  // Entry is already at the tail of queue, keep it there
-  return;
-}
-
-void MemoryHierarchy::sort_event_queue_tail(Event *event)
-{
-  // First make sure that given event is in tail of queue
-  assert(eventQueue_.tail() == event);
-
-  // No need to sort if only 1 event
-  if (eventQueue_.count() == 1)
-    return;
-
-  Event* entryEvent;
-  foreach_list_mutable_backwards(eventQueue_.list(), entryEvent, entry, preventry) {
-    if (entryEvent == event)
-      continue;
-
-    if (*event >= *entryEvent) {
-      eventQueue_.unlink(event);
-      eventQueue_.insert_after(event, (Event*)(entryEvent));
-      return;
-    }
-  }
-}
-
 void MemoryHierarchy::add_event(Signal *signal, int delay, void *arg)
 {
   Event *event = eventQueue_.alloc();
-  if(eventQueue_.count() == 1)
-    assert(event == eventQueue_.head());
   assert(event);
   event->setup(signal, sim_cycle + delay, arg);
 
@@ -318,7 +446,7 @@ void MemoryHierarchy::add_event(Signal *signal, int delay, void *arg)
 
   memdebug("Adding event:" << *event);
 
-  sort_event_queue(event);
+  eventQueue_.schedule(event);
 
   return;
 }
@@ -339,6 +467,8 @@ void MemoryHierarchy::annul_request(W8 coreid,
     W8 threadid, int robid, W64 physaddr,
     bool is_icache, bool is_write)
 {
+  ParallelSharedAccess shared_access;
+
   /*
    * Flushin of the caches is disabled currently because we need to
    * implement a logic where every cache will check physaddr's cache line
@@ -347,6 +477,8 @@ void MemoryHierarchy::annul_request(W8 coreid,
   MemoryRequest* memRequest = get_free_request(coreid);
   memRequest->init(coreid, threadid, physaddr, robid, sim_cycle, is_icache,
       -1, -1, (is_write ? MEMORY_OP_WRITE : MEMORY_OP_READ));
+  if unlikely (bufferAccesses_)
+    annul_buffered(memRequest);
   cpuControllers_[coreid]->annul_request(memRequest);
   //foreach(i, allControllers_.count()) {
   //	allControllers_[i]->annul_request(memRequest);
@@ -383,10 +515,132 @@ void MemoryHierarchy::annul_request(W8 coreid,
 
 int MemoryHierarchy::get_core_pending_offchip_miss(W8 coreid)
 {
+  // Memory controller is not changed while accesses are buffered
+  ParallelSharedAccess shared_access(!bufferAccesses_);
+
   return ((MemoryController*)memoryController_)->
     get_no_pending_request(coreid);
 }
 
+/**
+ * @brief Find controller below given controller in machine connections
+ *
+ * @param controller Controller to start from
+ * @param conn_type Type of connection to the lower interconnect
+ *
+ * @return Controller connected as upper side of that interconnect
+ */
+Controller* MemoryHierarchy::get_lower_controller(Controller* controller,
+    int conn_type)
+{
+  foreach (i, machine_.connections.count()) {
+    ConnectionDef *conn_def = machine_.connections[i];
+    bool found = false;
+
+    foreach (j, conn_def->connections.count()) {
+      SingleConnection *sg = conn_def->connections[j];
+      if (sg->type == conn_type &&
+          strcmp(sg->controller.buf, controller->get_name()) == 0) {
+        found = true;
+        break;
+      }
+    }
+
+    if (!found)
+      continue;
+
+    foreach (j, conn_def->connections.count()) {
+      SingleConnection *sg = conn_def->connections[j];
+      if (sg->type == INTERCONN_TYPE_UPPER ||
+          sg->type == INTERCONN_TYPE_UPPER2) {
+        Controller **cont = machine_.controller_hash.get(sg->controller);
+        assert(cont);
+        return *cont;
+      }
+    }
+  }
+
+  return NULL;
+}
+
+/**
+ * @brief Find the controllers each core's accesses go through
+ *
+ * Called once before warming starts, warm_access() then only walks these
+ * arrays.
+ */
+void MemoryHierarchy::setup_warming()
+{
+  foreach (i, cpuControllers_.count()) {
+    Controller *cpuController = cpuControllers_[i];
+
+    warmPrivate_[i].clear();
+
+    foreach (d, 2) {
+      dynarray<Controller*>& path = warmPath_[i][d];
+      Controller *cont = get_lower_controller(cpuController,
+          d ? INTERCONN_TYPE_D : INTERCONN_TYPE_I);
+
+      path.clear();
+      while (cont) {
+        path.push(cont);
+
+        if (cont->is_private()) {
+          bool present = false;
+          foreach (p, warmPrivate_[i].count()) {
+            present |= (warmPrivate_[i][p] == cont);
+          }
+          if (!present)
+            warmPrivate_[i].push(cont);
+        }
+
+        cont = get_lower_controller(cont, INTERCONN_TYPE_LOWER);
+      }
+
+      if (path.empty()) {
+        ptl_logfile << "WARNING: No cache found for core " << i <<
+          ", its accesses will not be warmed\n";
+      }
+    }
+  }
+}
+
+/**
+ * @brief Update caches and directory for an access during fast-forward
+ *
+ * @param coreid Core that made the access
+ * @param threadid Hardware thread in the core
+ * @param physaddr Physical address of the access
+ * @param is_icache True for instruction fetch
+ * @param is_write True for store
+ *
+ * No request, message or event is created and no stats are updated. Private
+ * caches of other cores are snooped first, then each level below the core
+ * is updated until one of them hits.
+ */
+void MemoryHierarchy::warm_access(W8 coreid, W8 threadid, W64 physaddr,
+    bool is_icache, bool is_write)
+{
+  warmRequest_.init(coreid, threadid, physaddr, 0, sim_cycle, is_icache,
+      -1, -1, is_write ? MEMORY_OP_WRITE : MEMORY_OP_READ);
+
+  bool shared = false;
+  foreach (i, cpuControllers_.count()) {
+    if (i == coreid)
+      continue;
+
+    foreach (j, warmPrivate_[i].count()) {
+      shared |= warmPrivate_[i][j]->warm_snoop(&warmRequest_);
+    }
+  }
+
+  dynarray<Controller*>& path = warmPath_[coreid][!is_icache];
+  foreach (i, path.count()) {
+    if (path[i]->warm_access(&warmRequest_, shared))
+      break;
+  }
+}
+
 /**
  * @brief Try to grab Cache line lock
  *
@@ -397,6 +651,8 @@ int MemoryHierarchy::get_core_pending_offchip_miss(W8 coreid)
  */
 bool MemoryHierarchy::grab_lock(W64 lockaddr, W8 ctx_id)
 {
+  ParallelSharedAccess shared_access;
+
   bool ret = false;
   MemoryInterlockEntry* lock = interlocks.select_and_lock(lockaddr);
 
@@ -416,6 +672,8 @@ bool MemoryHierarchy::grab_lock(W64 lockaddr, W8 ctx_id)
  */
 void MemoryHierarchy::invalidate_lock(W64 lockaddr, W8 ctx_id)
 {
+  ParallelSharedAccess shared_access;
+
   MemoryInterlockEntry* lock = interlocks.probe(lockaddr);
 
   assert(lock);
@@ -433,6 +691,8 @@ void MemoryHierarchy::invalidate_lock(W64 lockaddr, W8 ctx_id)
  */
 bool MemoryHierarchy::probe_lock(W64 lockaddr, W8 ctx_id)
 {
+  ParallelSharedAccess shared_access;
+
   bool ret = false;
   MemoryInterlockEntry* lock = interlocks.probe(lockaddr);
 
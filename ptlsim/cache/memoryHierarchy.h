@@ -36,6 +36,7 @@
 #include <memoryRequest.h>
 #include <controller.h>
 #include <interconnect.h>
+#include <eventQueue.h>
 
 #include <statsBuilder.h>
 
@@ -86,73 +87,6 @@
 
 namespace Memory {
 
-  class Event : public FixStateListObject
-  {
-    private:
-      Signal *signal_;
-      W64    clock_;
-      void   *arg_;
-
-    public:
-      void init() {
-        signal_ = NULL;
-        clock_ = -1;
-        arg_ = NULL;
-      }
-
-      void setup(Signal *signal, W64 clock, void *arg) {
-        signal_ = signal;
-        clock_ = clock;
-        arg_ = arg;
-      }
-
-      bool execute() {
-        return signal_->emit(arg_);
-      }
-
-      W64 get_clock() {
-        return clock_;
-      }
-
-      ostream& print(ostream& os) const {
-        os << "Event< ";
-        if(signal_)
-          os << "Signal:" << signal_->get_name() << " ";
-        os << "Clock:" << clock_ << " ";
-        os << "arg:" << arg_ ;
-        os << ">" << endl << flush;
-        return os;
-      }
-
-      bool operator ==(Event &event) {
-        if(clock_ == event.clock_)
-          return true;
-        return false;
-      }
-
-      bool operator >(Event &event) {
-        if(clock_ > event.clock_)
-          return true;
-        return false;
-      }
-
-      bool operator <(Event &event) {
-        if(clock_ < event.clock_)
-          return true;
-        return false;
-      }
-
-      bool operator >=(Event &event) {
-        if (clock_ >= event.clock_)
-          return true;
-        return false;
-      }
-  };
-
-  static inline ostream& operator <<(ostream& os, const Event& event) {
-    return event.print(os);
-  }
-
   struct MemoryInterlockEntry {
     W8 ctx_id;
 
@@ -168,6 +102,18 @@ namespace Memory {
 
   extern MemoryInterlockBuffer interlocks;
 
+  class CPUController;
+
+  // Core request waiting in a parallel quantum
+  struct BufferedAccess {
+    MemoryRequest *request;
+    W64 cycle;
+
+    BufferedAccess() {}
+    BufferedAccess(MemoryRequest *request, W64 cycle)
+      : request(request), cycle(cycle) {}
+  };
+
   //
   // MemoryHierarchy provides interface with core
   //
@@ -202,6 +148,12 @@ namespace Memory {
 
       void clock();
 
+      // cycle in which clock() has work to do next, -1 if idle
+      W64 get_next_event_cycle();
+
+      // advance internal counters for cycles that are not clocked
+      void skip_cycles(W64 cycles);
+
       void reset();
 
       // return the number of cycle used to flush the caches
@@ -215,9 +167,23 @@ namespace Memory {
       void add_event(Signal *signal, int delay, void *arg);
 
       MemoryRequest* get_free_request(int id) {
+        // Each core allocates from its own pool while accesses are buffered
+        ParallelSharedAccess shared_access(!bufferAccesses_);
         return requestPool_[id]->get_free_request();
       }
 
+      // Parallel quantum mode support
+      void set_access_buffering(bool flag) { bufferAccesses_ = flag; }
+      void clock_private(W8 coreid);
+      int replay_accesses(W64 cycle);
+      void finish_replay();
+      void flush_private_wakeups();
+
+      // Functional warming support, used while QEMU fast-forwards
+      void setup_warming();
+      void warm_access(W8 coreid, W8 threadid, W64 physaddr,
+          bool is_icache, bool is_write);
+
       void set_controller_full(Controller* controller, bool flag);
       void set_interconnect_full(Interconnect* interconnect, bool flag);
       bool is_controller_full(Controller* controller);
@@ -230,22 +196,31 @@ namespace Memory {
       BaseMachine& get_machine() { return machine_; }
 
       void add_cpu_controller(Controller* cont) {
+        cont->set_full_index(add_full_flag());
         cpuControllers_.push(cont);
       }
 
       void add_cache_mem_controller(Controller* cont) {
+        cont->set_full_index(add_full_flag());
         allControllers_.push(cont);
       }
 
       void add_interconnect(Interconnect* conn) {
+        conn->set_full_index(add_full_flag());
         allInterconnects_.push(conn);
       }
 
       void setup_full_flags() {
-        // Setup the full flags
-        cpuFullFlags_.resize(cpuControllers_.count(), false);
-        controllersFullFlags_.resize(allControllers_.count(), false);
-        interconnectsFullFlags_.resize(allInterconnects_.count(), false);
+        // Clear the full flags, one per registered structure
+        foreach(i, fullFlags_.count()) {
+          fullFlags_[i] = false;
+        }
+        fullCount_ = 0;
+        someStructIsFull_ = false;
+      }
+
+      bool is_any_struct_full() const {
+        return someStructIsFull_;
       }
 
       bool grab_lock(W64 lockaddr, W8 ctx_id);
@@ -264,12 +239,19 @@ namespace Memory {
       Controller* memoryController_;
 
       // array to indicate if controller or interconnect buffers
-      // are full or not
-      dynarray<bool> cpuFullFlags_;
-      dynarray<bool> controllersFullFlags_;
-      dynarray<bool> interconnectsFullFlags_;
+      // are full or not, indexed by their full index, and the number
+      // of set flags
+      dynarray<bool> fullFlags_;
+      int fullCount_;
       bool someStructIsFull_;
 
+      int add_full_flag() {
+        fullFlags_.push(false);
+        return fullFlags_.count() - 1;
+      }
+
+      void set_full_flag(int idx, bool flag);
+
       // number of cores
       int coreNo_;
 
@@ -280,10 +262,28 @@ namespace Memory {
       FixStateList<Message, 128> messageQueue_;
 
       // Event Queue
-      FixStateList<Event, 2048> eventQueue_;
+      EventQueue<2048, 1024> eventQueue_;
+
+      // Core requests of current parallel quantum, in cycle order per core
+      bool bufferAccesses_;
+      dynarray<BufferedAccess> accessBuffer_[NUM_SIM_CORES];
+      int replayIndex_[NUM_SIM_CORES];
+
+      // Private L1 hits served in a quantum that wait for their latency
+      dynarray<BufferedAccess> privateWakeups_[NUM_SIM_CORES];
+
+      bool buffer_access(CPUController *cpuController,
+          MemoryRequest *request);
+      void annul_buffered(MemoryRequest *request);
+
+      // Controllers that see a core's instruction [0] and data [1]
+      // accesses, from L1 down to memory, and private caches of each core
+      dynarray<Controller*> warmPath_[NUM_SIM_CORES][2];
+      dynarray<Controller*> warmPrivate_[NUM_SIM_CORES];
+      MemoryRequest warmRequest_;
 
-      void sort_event_queue(Event *event);
-      void sort_event_queue_tail(Event *event);
+      Controller* get_lower_controller(Controller* controller,
+          int conn_type);
 
       // Temp Stats
       Stats *stats;
@@ -63,8 +63,7 @@ void MemoryRequest::init(W8 coreId,
 	opType_ = opType;
 	isData_ = !isInstruction;
 
-	if(history) delete history;
-	history = new stringbuf();
+	if(history) history->reset();
 
 	memdebug("Init " << *this << endl);
 }
@@ -82,8 +81,7 @@ void MemoryRequest::init(MemoryRequest *request)
 	opType_ = request->opType_;
 	isData_ = request->isData_;
 
-	if(history) delete history;
-	history = new stringbuf();
+	if(history) history->reset();
 
 	memdebug("Init " << *this << endl);
 }
@@ -123,48 +121,62 @@ bool MemoryRequest::is_same(MemoryRequest *request)
 }
 
 
+void MemoryRequest::new_history()
+{
+	history = new stringbuf();
+	if(pool_) pool_->allocations_++;
+}
+
 RequestPool::RequestPool()
+	: size_(0)
+	, allocations_(0)
 {
-	size_ = REQUEST_POOL_SIZE;
-	foreach(i, REQUEST_POOL_SIZE) {
-		freeRequestList_.enqueue((selfqueuelink*)&((*this)[i]));
-	}
+	grow(REQUEST_POOL_SIZE);
 }
 
-MemoryRequest* RequestPool::get_free_request()
+RequestPool::~RequestPool()
 {
-	if (isPoolLow()){
-		garbage_collection();
-        /* if asserted here please increase REQUEST_POOL_SIZE */
-		assert(!isEmpty());
+	foreach(i, chunks_.count()) {
+		delete[] chunks_[i];
 	}
-	MemoryRequest* memoryRequest = (MemoryRequest*)freeRequestList_.peek();
-	freeRequestList_.remove((selfqueuelink*)memoryRequest);
-	usedRequestsList_.enqueue((selfqueuelink*)memoryRequest);
-
-	return memoryRequest;
+	chunks_.clear();
 }
 
-void RequestPool::freeRequest( MemoryRequest* memoryrequest)
+/**
+ * @brief Add a chunk of free requests to the pool
+ *
+ * @param count Number of requests in the chunk
+ *
+ * Requests are never moved once allocated, as queues of the memory hierarchy
+ * keep pointers to them.
+ */
+void RequestPool::grow(int count)
 {
-    /* we should free it only when no one refrence to it  */
-	assert(0 == memoryrequest->get_ref_counter());
-	usedRequestsList_.remove(memoryrequest);
-	freeRequestList_.enqueue(memoryrequest);
-	memoryrequest->set_ref_counter(0);
+	MemoryRequest *chunk = new MemoryRequest[count];
+	chunks_.push(chunk);
+	allocations_++;
+
+	foreach(i, count) {
+		chunk[i].set_pool(this);
+		freeRequestList_.enqueue((selfqueuelink*)&chunk[i]);
+	}
+	size_ += count;
+
+	memdebug("Request pool grown to " << size_ << " requests\n");
 }
 
-void RequestPool::garbage_collection()
+MemoryRequest* RequestPool::get_free_request()
 {
-	int cleaned = 0;
-	MemoryRequest *memoryRequest;
-	foreach_list_mutable(usedRequestsList_, memoryRequest, \
-			entry, nextentry){
-		if (0 == memoryRequest->get_ref_counter()){
-			freeRequest(memoryRequest);
-			cleaned++;
-		}
-	}
-	memdebug("number of Request cleaned by garbageCollector is: " <<
-		   cleaned <<	endl);
+	if unlikely (isPoolLow())
+		grow(REQUEST_POOL_CHUNK_SIZE);
+
+	/*
+	 * Keep the request on the free list until it is referenced, a request
+	 * that is never queued is free again once its owner is done with it.
+	 */
+	MemoryRequest* memoryRequest = (MemoryRequest*)freeRequestList_.peek();
+	freeRequestList_.remove((selfqueuelink*)memoryRequest);
+	freeRequestList_.enqueue((selfqueuelink*)memoryRequest);
+
+	return memoryRequest;
 }
@@ -50,10 +50,17 @@ static const char* memory_op_names[NUM_MEMORY_OP] = {
 	"memory_op_evict"
 };
 
+class RequestPool;
+
 class MemoryRequest: public selfqueuelink
 {
 	public:
-		MemoryRequest() { reset(); }
+		MemoryRequest()
+			: pool_(NULL)
+			, history(NULL)
+		{
+			reset();
+		}
 
 		void reset() {
 			coreId_ = 0;
@@ -65,17 +72,16 @@ class MemoryRequest: public selfqueuelink
 			refCounter_ = 0; // or maybe 1
 			opType_ = MEMORY_OP_READ;
 			isData_ = 0;
-			history = new stringbuf();
             coreSignal_ = NULL;
+			if(history) history->reset();
 		}
 
-		void incRefCounter(){
-			refCounter_++;
+		~MemoryRequest() {
+			if(history) delete history;
 		}
 
-		void decRefCounter(){
-			refCounter_--;
-		}
+		inline void incRefCounter();
+		inline void decRefCounter();
 
 		void init(W8 coreId,
 				W8 threadId,
@@ -101,9 +107,8 @@ class MemoryRequest: public selfqueuelink
 			return refCounter_;
 		}
 
-		void set_ref_counter(int count) {
-			refCounter_ = count;
-		}
+		RequestPool* get_pool() { return pool_; }
+		void set_pool(RequestPool *pool) { pool_ = pool; }
 
 		bool is_instruction() {
 			return !isData_;
@@ -128,7 +133,14 @@ class MemoryRequest: public selfqueuelink
 
 		W64 get_init_cycles() { return cycles_; }
 
-		stringbuf& get_history() { return *history; }
+		/*
+		 * History is only written by ADD_HISTORY, so it is allocated on first
+		 * use and kept for later requests of this slot.
+		 */
+		stringbuf& get_history() {
+			if unlikely (!history) new_history();
+			return *history;
+		}
 
         bool is_kernel() {
             // based on owner RIP value
@@ -160,7 +172,9 @@ class MemoryRequest: public selfqueuelink
 			os << "isData[" << isData_ << "] ";
 			os << "ownerUUID[" << ownerUUID_ << "] ";
 			os << "ownerRIP[" << (void*)ownerRIP_ << "] ";
-			os << "History[ " << *history << "] ";
+			if(history) {
+				os << "History[ " << *history << "] ";
+			}
             if(coreSignal_) {
                 os << "Signal[ " << coreSignal_->get_name() << "] ";
             }
@@ -178,9 +192,11 @@ class MemoryRequest: public selfqueuelink
 		W64 ownerUUID_;
 		int refCounter_;
 		OP_TYPE opType_;
+		RequestPool *pool_;
 		stringbuf *history;
         Signal *coreSignal_;
 
+		void new_history();
 };
 
 static inline ostream& operator <<(ostream& os, const MemoryRequest& request)
@@ -188,17 +204,34 @@ static inline ostream& operator <<(ostream& os, const MemoryRequest& request)
 	return request.print(os);
 }
 
-class RequestPool: public array<MemoryRequest,REQUEST_POOL_SIZE>
+/*
+ * Pool of memory requests of a core. A request is free while its reference
+ * counter is zero: it goes back to the free list as soon as the last
+ * reference is dropped and leaves it when it is referenced again. A request
+ * handed out by get_free_request() stays at the tail of the free list until
+ * it is referenced, so requests that are never queued anywhere are recycled
+ * too. Free requests are reused oldest first and the pool grows by
+ * REQUEST_POOL_CHUNK_SIZE requests when fewer than REQUEST_POOL_LOW_RATIO of
+ * them are free, so a request is not reused right after it is released.
+ */
+class RequestPool
 {
 	public:
 		RequestPool();
+		~RequestPool();
+
 		MemoryRequest* get_free_request();
-		void garbage_collection();
 
 		StateList& used_list() {
 			return usedRequestsList_;
 		}
 
+		int size() const { return size_; }
+		int free_count() const { return freeRequestList_.count; }
+
+		/* Number of heap allocations made for requests and their history */
+		W64 allocations() const { return allocations_; }
+
 		void print(ostream& os) {
 			os << "Request pool : size[" << size_ << "]\n";
 			os << "used requests : count[" << usedRequestsList_.count <<
@@ -225,23 +258,50 @@ class RequestPool: public array<MemoryRequest,REQUEST_POOL_SIZE>
 
 	private:
 		int size_;
+		W64 allocations_;
+		dynarray<MemoryRequest*> chunks_;
 		StateList freeRequestList_;
 		StateList usedRequestsList_;
 
-		void freeRequest(MemoryRequest* request);
+		friend class MemoryRequest;
 
-		bool isEmpty()
-		{
-			return (freeRequestList_.empty());
+		void grow(int count);
+
+		/* Called when the reference counter becomes non zero */
+		void referenced(MemoryRequest* request) {
+			freeRequestList_.remove(request);
+			usedRequestsList_.enqueue(request);
+		}
+
+		/* Called when the last reference is dropped */
+		void released(MemoryRequest* request) {
+			usedRequestsList_.remove(request);
+			freeRequestList_.enqueue(request);
 		}
 
 		bool isPoolLow()
 		{
 			return (freeRequestList_.count < (
-						REQUEST_POOL_SIZE * REQUEST_POOL_LOW_RATIO));
+						size_ * REQUEST_POOL_LOW_RATIO));
 		}
 };
 
+inline void MemoryRequest::incRefCounter()
+{
+	if(refCounter_++ == 0 && pool_)
+		pool_->referenced(this);
+}
+
+inline void MemoryRequest::decRefCounter()
+{
+	/* Annulled requests can be released twice */
+	if unlikely (refCounter_ <= 0)
+		return;
+
+	if(--refCounter_ == 0 && pool_)
+		pool_->released(this);
+}
+
 static inline ostream& operator <<(ostream& os, RequestPool &pool)
 {
 	pool.print(os);
@@ -0,0 +1,299 @@
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * This code is released under GPL.
+ *
+ */
+
+#include <ptlsim.h>
+#include <memoryRouter.h>
+#include <machine.h>
+
+using namespace Memory;
+
+MemoryRouter::MemoryRouter(const char *name,
+        MemoryHierarchy *memoryHierarchy)
+    : Interconnect(name, memoryHierarchy)
+    , mapReady_(false)
+    , new_stats(name, &memoryHierarchy->get_machine())
+{
+    memoryHierarchy_->add_interconnect(this);
+
+    SET_SIGNAL_CB(name, "_Deliver", deliver_, &MemoryRouter::deliver_cb);
+
+    if (!memoryHierarchy_->get_machine().get_option(name, "hop_latency",
+                hopLatency_)) {
+        hopLatency_ = 20;
+    }
+
+    /* Convert latency from ns to cycles */
+    hopLatency_ = ns_to_simcycles(hopLatency_);
+}
+
+void MemoryRouter::register_controller(Controller *controller)
+{
+    if (controller->is_memory_controller())
+        memControllers_.push(controller);
+    else
+        upperControllers_.push(controller);
+}
+
+/*
+ * Controllers are registered after the router is created, so the address
+ * map is set up when the first request arrives.
+ */
+void MemoryRouter::setup_map()
+{
+    BaseMachine &machine = memoryHierarchy_->get_machine();
+    const char *name = get_name();
+
+    assert(memControllers_.count() > 0);
+
+    int interleave = INTERLEAVE_LINE;
+    stringbuf interleave_name;
+    if (machine.get_option(name, "interleave", interleave_name)) {
+        interleave = parse_interleave(interleave_name.buf);
+        if (interleave < 0) {
+            ptl_logfile << "Unknown interleave " << interleave_name <<
+                " for " << name << ", using line interleaving\n";
+            interleave = INTERLEAVE_LINE;
+        }
+    }
+
+    int nodes;
+    if (!machine.get_option(name, "numa_nodes", nodes))
+        nodes = 1;
+
+    int node_mb;
+    W64 node_size = (nodes > 0) ? ram_size / nodes : 0;
+    if (machine.get_option(name, "numa_node_mb", node_mb))
+        node_size = W64(node_mb) << 20;
+
+    int cores_per_node;
+    if (!machine.get_option(name, "cores_per_node", cores_per_node))
+        cores_per_node = max((NUM_SIM_CORES + nodes - 1) / max(nodes, 1), 1);
+
+    if (!map_.setup(memControllers_.count(), interleave, nodes, node_size,
+                cores_per_node)) {
+        stringbuf err;
+        err << "Warning: invalid NUMA configuration of " << name << ": " <<
+            nodes << " nodes for " << memControllers_.count() <<
+            " memory controllers, using a single node" << endl;
+        ptl_logfile << err;
+        cerr << err;
+        map_.setup(memControllers_.count(), interleave);
+    }
+
+    mapReady_ = true;
+}
+
+/**
+ * @brief Find destination of a message and its NUMA distance
+ *
+ * @param msg Message from a controller
+ * @param hops Set to number of hops between requester's and memory's node
+ *
+ * @return Controller to deliver the message to
+ */
+Controller* MemoryRouter::route(Message *msg, int& hops)
+{
+    Controller *sender = (Controller*)msg->sender;
+    MemoryRequest *request = msg->request;
+    int core_node = map_.get_core_node(request->get_coreid());
+
+    if (sender->is_memory_controller()) {
+        Controller *dest = (Controller*)msg->dest;
+        if (!dest) {
+            assert(upperControllers_.count() == 1);
+            dest = upperControllers_[0];
+        }
+
+        int mem_node = 0;
+        foreach (i, memControllers_.count()) {
+            if (memControllers_[i] == sender)
+                mem_node = map_.get_controller_node(i);
+        }
+
+        hops = map_.hops(core_node, mem_node);
+        return dest;
+    }
+
+    int cont = map_.get_controller(request->get_physical_address());
+    hops = map_.hops(core_node, map_.get_controller_node(cont));
+    return memControllers_[cont];
+}
+
+bool MemoryRouter::controller_request_cb(void *arg)
+{
+    Message *msg = (Message*)arg;
+    Controller *sender = (Controller*)msg->sender;
+    bool kernel = msg->request->is_kernel();
+
+    if unlikely (!mapReady_)
+        setup_map();
+
+    int hops;
+    Controller *receiver = route(msg, hops);
+
+    RouterQueueEntry *entry = queue_.alloc();
+    if (entry == NULL) {
+        memdebug("Memory router queue is full\n");
+        return false;
+    }
+
+    entry->request  = msg->request;
+    entry->source   = sender;
+    entry->dest     = receiver;
+    entry->arg      = msg->arg;
+    entry->hasData  = msg->hasData;
+    entry->isShared = msg->isShared;
+
+    if (sender->is_memory_controller()) {
+        N_STAT_UPDATE(new_stats.responses, ++, kernel);
+    } else {
+        N_STAT_UPDATE(new_stats.requests, ++, kernel);
+        if (hops > 0) {
+            N_STAT_UPDATE(new_stats.remote, ++, kernel);
+        } else {
+            N_STAT_UPDATE(new_stats.local, ++, kernel);
+        }
+    }
+
+    /* Local accesses pass through without delay, like a P2P link */
+    if (hops == 0 || hopLatency_ == 0) {
+        bool success = send(entry);
+        queue_.free(entry);
+        return success;
+    }
+
+    entry->request->incRefCounter();
+    ADD_HISTORY_ADD(entry->request);
+
+    N_STAT_UPDATE(new_stats.hops, += hops, kernel);
+    N_STAT_UPDATE(new_stats.hop_cycles, += hops * hopLatency_, kernel);
+
+    marss_add_event(&deliver_, hops * hopLatency_, entry);
+    return true;
+}
+
+bool MemoryRouter::send(RouterQueueEntry *entry)
+{
+    Message& message = *memoryHierarchy_->get_message();
+    /* Memory controllers respond to origin of the request */
+    message.sender   = this;
+    message.origin   = entry->source;
+    message.dest     = entry->dest->is_memory_controller() ? NULL :
+        entry->dest;
+    message.request  = entry->request;
+    message.arg      = entry->arg;
+    message.hasData  = entry->hasData;
+    message.isShared = entry->isShared;
+
+    memdebug("Memory router sending to " << entry->dest->get_name() <<
+            ": " << message);
+
+    bool success = entry->dest->get_interconnect_signal()->emit(&message);
+    memoryHierarchy_->free_message(&message);
+
+    return success;
+}
+
+bool MemoryRouter::deliver_cb(void *arg)
+{
+    RouterQueueEntry *entry = (RouterQueueEntry*)arg;
+    MemoryRequest *request = entry->request;
+
+    if (entry->annuled) {
+        request->decRefCounter();
+        ADD_HISTORY_REM(request);
+        queue_.free(entry);
+        return true;
+    }
+
+    if (!send(entry)) {
+        /* Destination is busy, retry in next cycle */
+        N_STAT_UPDATE(new_stats.retries, ++, request->is_kernel());
+        marss_add_event(&deliver_, 1, entry);
+        return true;
+    }
+
+    request->decRefCounter();
+    ADD_HISTORY_REM(request);
+    queue_.free(entry);
+    return true;
+}
+
+int MemoryRouter::access_fast_path(Controller *controller,
+        MemoryRequest *request)
+{
+    if (controller->is_memory_controller())
+        return -1;
+
+    if unlikely (!mapReady_)
+        setup_map();
+
+    int cont = map_.get_controller(request->get_physical_address());
+    return memControllers_[cont]->access_fast_path(this, request);
+}
+
+void MemoryRouter::annul_request(MemoryRequest *request)
+{
+    RouterQueueEntry *entry;
+    foreach_list_mutable(queue_.list(), entry, entry_t, nextentry_t) {
+        if (entry->request->is_same(request))
+            entry->annuled = true;
+    }
+}
+
+void MemoryRouter::print_map(ostream& os)
+{
+    os << "Memory Router: " << get_name() << endl;
+    os << "\tconnected to:" << endl;
+
+    foreach (i, upperControllers_.count()) {
+        os << "\t\tupper[" << i << "]: " <<
+            upperControllers_[i]->get_name() << endl;
+    }
+
+    foreach (i, memControllers_.count()) {
+        os << "\t\tmemory[" << i << "]: " <<
+            memControllers_[i]->get_name() << endl;
+    }
+}
+
+/**
+ * @brief Dump Memory Router Configuration in YAML Format
+ *
+ * @param out YAML Object
+ */
+void MemoryRouter::dump_configuration(YAML::Emitter &out) const
+{
+    static const char* interleave_names[] = {"line", "page", "xor"};
+
+    out << YAML::Key << get_name() << YAML::Value << YAML::BeginMap;
+
+    YAML_KEY_VAL(out, "type", "interconnect");
+    YAML_KEY_VAL(out, "memory_controllers", memControllers_.count());
+    YAML_KEY_VAL(out, "interleave", interleave_names[map_.get_interleave()]);
+    YAML_KEY_VAL(out, "numa_nodes", map_.get_nodes());
+    YAML_KEY_VAL(out, "numa_node_mb", int(map_.get_node_size() >> 20));
+    YAML_KEY_VAL(out, "hop_latency", hopLatency_);
+    YAML_KEY_VAL(out, "queue_size", queue_.size());
+
+    out << YAML::EndMap;
+}
+
+struct MemoryRouterBuilder : public InterconnectBuilder
+{
+    MemoryRouterBuilder(const char *name) :
+        InterconnectBuilder(name)
+    { }
+
+    Interconnect* get_new_interconnect(MemoryHierarchy &mem,
+            const char *name)
+    {
+        return new MemoryRouter(name, &mem);
+    }
+};
+
+MemoryRouterBuilder memoryRouterBuilder("mem_router");
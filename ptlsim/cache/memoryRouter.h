@@ -0,0 +1,112 @@
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * This code is released under GPL.
+ *
+ */
+
+#ifndef MEMORY_ROUTER_H
+#define MEMORY_ROUTER_H
+
+#include <interconnect.h>
+#include <memoryHierarchy.h>
+#include <memoryStats.h>
+#include <addressMap.h>
+
+namespace Memory {
+
+struct RouterQueueEntry : public FixStateListObject
+{
+    MemoryRequest *request;
+    Controller    *source;
+    Controller    *dest;
+    void          *arg;
+    bool           hasData;
+    bool           isShared;
+    bool           annuled;
+
+    void init() {
+        request  = NULL;
+        source   = NULL;
+        dest     = NULL;
+        arg      = NULL;
+        hasData  = false;
+        isShared = false;
+        annuled  = false;
+    }
+
+    ostream& print(ostream& os) const {
+        if (!request) {
+            os << "Free entry";
+            return os;
+        }
+
+        os << "request[" << *request << "] ";
+        os << "source[" << source->get_name() << "] ";
+        os << "dest[" << dest->get_name() << "] ";
+        os << "annuled[" << annuled << "]" << endl;
+        return os;
+    }
+};
+
+/**
+ * @brief Route requests of last level caches to multiple memory controllers
+ *
+ * Connects any number of upper controllers (last level caches or a bus
+ * side controller) to memory controllers. Requests are sent to the memory
+ * controller that owns the address, as given by AddressMap, and responses
+ * go back to the controller that sent the request. Requests between
+ * different NUMA nodes, where core's node is the requester's node, are
+ * delayed by 'hop_latency' ns for each ring hop in both directions.
+ *
+ * Options: interleave (line, page or xor), numa_nodes, numa_node_mb,
+ * cores_per_node and hop_latency.
+ */
+class MemoryRouter : public Interconnect
+{
+    private:
+        dynarray<Controller*> memControllers_;
+        dynarray<Controller*> upperControllers_;
+
+        AddressMap map_;
+        bool mapReady_;
+        int hopLatency_;
+
+        FixStateList<RouterQueueEntry, MEM_REQ_NUM> queue_;
+        Signal deliver_;
+
+        RouterStats new_stats;
+
+        void setup_map();
+        bool send(RouterQueueEntry *entry);
+        Controller* route(Message *msg, int& hops);
+
+    public:
+        MemoryRouter(const char *name, MemoryHierarchy *memoryHierarchy);
+
+        bool controller_request_cb(void *arg);
+        void register_controller(Controller *controller);
+        int access_fast_path(Controller *controller,
+                MemoryRequest *request);
+        void annul_request(MemoryRequest *request);
+        void dump_configuration(YAML::Emitter &out) const;
+
+        bool deliver_cb(void *arg);
+
+        int get_delay() {
+            return 1;
+        }
+
+        void print(ostream& os) const {
+            os << "--Memory-Router: " << get_name() << endl;
+            if (queue_.count() > 0)
+                os << "Queue : " << queue_ << endl;
+            os << "--End-Memory-Router" << endl;
+        }
+
+        void print_map(ostream& os);
+};
+
+};
+
+#endif // MEMORY_ROUTER_H
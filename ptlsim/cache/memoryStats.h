@@ -149,6 +149,77 @@ struct BaseCacheStats : public Statable
     {}
 };
 
+/*
+ * Useful prefetches are demand accesses that hit a prefetched line, late ones
+ * are the useful prefetches that were still in flight when demand arrived.
+ * Useless prefetched lines were evicted before any demand access.
+ */
+struct PrefetchStats : public Statable
+{
+    StatObj<W64> issued;
+    StatObj<W64> useful;
+    StatObj<W64> late;
+    StatObj<W64> useless;
+    StatObj<W64> throttled;
+    StatObj<W64> demand;    // Demand misses plus useful prefetches
+
+    StatEquation<W64, double, StatObjFormulaDiv> accuracy;
+    StatEquation<W64, double, StatObjFormulaDiv> coverage;
+    StatEquation<W64, double, StatObjFormulaDiv> late_rate;
+
+    PrefetchStats(const char *name, Statable *parent)
+        : Statable(name, parent)
+          , issued("issued", this)
+          , useful("useful", this)
+          , late("late", this)
+          , useless("useless", this)
+          , throttled("throttled", this)
+          , demand("demand", this)
+          , accuracy("accuracy", this)
+          , coverage("coverage", this)
+          , late_rate("late_rate", this)
+    {
+        accuracy.add_elem(&useful);
+        accuracy.add_elem(&issued);
+
+        coverage.add_elem(&useful);
+        coverage.add_elem(&demand);
+
+        late_rate.add_elem(&late);
+        late_rate.add_elem(&useful);
+    }
+};
+
+/*
+ * Each pending request allocates the MSHR of its cache line or is merged into
+ * the MSHR of an earlier request to the line. Occupancy is the number of
+ * MSHRs in use, summed over requests.
+ */
+struct MSHRStats : public Statable
+{
+    StatObj<W64> requests;
+    StatObj<W64> merged;
+    StatObj<W64> occupancy;
+
+    StatEquation<W64, double, StatObjFormulaDiv> merge_rate;
+    StatEquation<W64, double, StatObjFormulaDiv> avg_occupancy;
+
+    MSHRStats(const char *name, Statable *parent)
+        : Statable(name, parent)
+          , requests("requests", this)
+          , merged("merged", this)
+          , occupancy("occupancy", this)
+          , merge_rate("merge_rate", this)
+          , avg_occupancy("avg_occupancy", this)
+    {
+        merge_rate.add_elem(&merged);
+        merge_rate.add_elem(&requests);
+
+        avg_occupancy.add_elem(&occupancy);
+        avg_occupancy.add_elem(&requests);
+    }
+};
+
 struct CPUControllerStats : public BaseCacheStats
 {
     StatArray<W64, 200> icache_latency;
@@ -254,6 +325,151 @@ struct RAMStats : public Statable {
     {}
 };
 
+/*
+ * Accesses of a directory controller to the directory. Back invalidations
+ * are entries replaced while lines were cached, their caches are sent an
+ * evict. Port stalls are accesses retried as all ports of the home slice
+ * were used in that cycle.
+ */
+struct DirectoryStats : public Statable {
+
+    StatObj<W64> accesses;
+    StatObj<W64> misses;
+    StatObj<W64> back_invalidations;
+    StatObj<W64> port_stalls;
+    StatArray<W64, DIR_MAX_SLICES> slice_access;
+
+    DirectoryStats(const char* name, Statable *parent)
+        : Statable(name, parent)
+          , accesses("accesses", this)
+          , misses("misses", this)
+          , back_invalidations("back_invalidations", this)
+          , port_stalls("port_stalls", this)
+          , slice_access("slice_access", this)
+    {}
+};
+
+/*
+ * Network on chip statistics. Latency is summed from injection to delivery
+ * of each packet. A link's flits are the cycles it was busy, so its
+ * utilisation is link_flits over simulated cycles, and link_wait is the
+ * cycles packets waited at routers for that link.
+ */
+struct NoCStats : public Statable {
+
+    StatObj<W64> packets;
+    StatObj<W64> flits;
+    StatObj<W64> hops;
+    StatObj<W64> latency;
+    StatObj<W64> stalls;
+    StatObj<W64> inject_stalls;
+    StatArray<W64, NOC_MAX_LINKS> link_flits;
+    StatArray<W64, NOC_MAX_LINKS> link_wait;
+
+    StatEquation<W64, double, StatObjFormulaDiv> avg_latency;
+    StatEquation<W64, double, StatObjFormulaDiv> avg_hops;
+
+    NoCStats(const char* name, Statable *parent)
+        : Statable(name, parent)
+          , packets("packets", this)
+          , flits("flits", this)
+          , hops("hops", this)
+          , latency("latency", this)
+          , stalls("stalls", this)
+          , inject_stalls("inject_stalls", this)
+          , link_flits("link_flits", this)
+          , link_wait("link_wait", this)
+          , avg_latency("avg_latency", this)
+          , avg_hops("avg_hops", this)
+    {
+        avg_latency.add_elem(&latency);
+        avg_latency.add_elem(&packets);
+
+        avg_hops.add_elem(&hops);
+        avg_hops.add_elem(&packets);
+    }
+};
+
+struct RouterStats : public Statable {
+
+    StatObj<W64> requests;
+    StatObj<W64> responses;
+    StatObj<W64> local;
+    StatObj<W64> remote;
+    StatObj<W64> hops;
+    StatObj<W64> hop_cycles;
+    StatObj<W64> retries;
+
+    RouterStats(const char* name, Statable *parent)
+        : Statable(name, parent)
+          , requests("requests", this)
+          , responses("responses", this)
+          , local("local", this)
+          , remote("remote", this)
+          , hops("hops", this)
+          , hop_cycles("hop_cycles", this)
+          , retries("retries", this)
+    {}
+};
+
+struct DRAMStats : public Statable {
+
+    StatObj<W64> reads;
+    StatObj<W64> writes;
+    StatObj<W64> accesses;
+
+    struct row : public Statable {
+        StatObj<W64> hit;
+        StatObj<W64> miss;
+        StatObj<W64> conflict;
+
+        row(Statable *parent)
+            : Statable("row", parent)
+              , hit("hit", this)
+              , miss("miss", this)
+              , conflict("conflict", this)
+        {}
+    } row;
+
+    StatObj<W64> bytes;
+    StatObj<W64> cycles;
+    StatObj<W64> data_bus_cycles;
+    StatObj<W64> queue_cycles;
+
+    StatEquation<W64, double, StatObjFormulaDiv> row_hit_rate;
+    StatEquation<W64, double, StatObjFormulaDiv> bytes_per_cycle;
+    StatEquation<W64, double, StatObjFormulaDiv> bus_utilization;
+    StatEquation<W64, double, StatObjFormulaDiv> avg_latency;
+
+    DRAMStats(const char* name, Statable *parent)
+        : Statable(name, parent)
+          , reads("reads", this)
+          , writes("writes", this)
+          , accesses("accesses", this)
+          , row(this)
+          , bytes("bytes", this)
+          , cycles("cycles", this)
+          , data_bus_cycles("data_bus_cycles", this)
+          , queue_cycles("queue_cycles", this)
+          , row_hit_rate("row_hit_rate", this)
+          , bytes_per_cycle("bytes_per_cycle", this)
+          , bus_utilization("bus_utilization", this)
+          , avg_latency("avg_latency", this)
+    {
+        row_hit_rate.add_elem(&row.hit);
+        row_hit_rate.add_elem(&accesses);
+
+        bytes_per_cycle.add_elem(&bytes);
+        bytes_per_cycle.add_elem(&cycles);
+
+        bus_utilization.add_elem(&data_bus_cycles);
+        bus_utilization.add_elem(&cycles);
+
+        avg_latency.add_elem(&queue_cycles);
+        avg_latency.add_elem(&accesses);
+    }
+};
+
 };
 
 #endif // MEMORY_STATS_H
@@ -448,6 +448,41 @@ void MESILogic::handle_response(CacheQueueEntry *entry, Message &msg)
 {
 }
 
+/**
+ * @brief Update line state for a local hit during functional warming
+ *
+ * @param line Valid cache line
+ * @param is_write True for store access
+ *
+ * @return true if write needs ownership from lower level
+ */
+bool MESILogic::warm_hit(CacheLine *line, bool is_write)
+{
+    if (!is_write)
+        return false;
+
+    bool upgrade = (line->state == MESI_SHARED);
+    line->state = MESI_MODIFIED;
+
+    return upgrade;
+}
+
+void MESILogic::warm_insert(CacheLine *line, bool is_write, bool shared)
+{
+    if (is_write)
+        line->state = MESI_MODIFIED;
+    else
+        line->state = shared ? MESI_SHARED : MESI_EXCLUSIVE;
+}
+
+void MESILogic::warm_snoop(CacheLine *line, bool is_write)
+{
+    if (is_write)
+        line->state = MESI_INVALID;
+    else
+        line->state = MESI_SHARED;
+}
+
 /**
  * @brief Dump MESI Coherence Logic Configuration
  *
@@ -394,6 +394,45 @@ bool MOESILogic::is_line_valid(CacheLine *line)
     return true;
 }
 
+/**
+ * @brief Update line state for a local hit during functional warming
+ *
+ * @param line Valid cache line
+ * @param is_write True for store access
+ *
+ * @return true if write needs ownership from lower level
+ */
+bool MOESILogic::warm_hit(CacheLine *line, bool is_write)
+{
+    if (!is_write)
+        return false;
+
+    bool upgrade = (line->state == MOESI_SHARED ||
+            line->state == MOESI_OWNER);
+    line->state = MOESI_MODIFIED;
+
+    return upgrade;
+}
+
+void MOESILogic::warm_insert(CacheLine *line, bool is_write, bool shared)
+{
+    if (is_write)
+        line->state = MOESI_MODIFIED;
+    else
+        line->state = shared ? MOESI_SHARED : MOESI_EXCLUSIVE;
+}
+
+void MOESILogic::warm_snoop(CacheLine *line, bool is_write)
+{
+    if (is_write) {
+        line->state = MOESI_INVALID;
+    } else if (line->state == MOESI_MODIFIED) {
+        line->state = MOESI_OWNER;
+    } else if (line->state == MOESI_EXCLUSIVE) {
+        line->state = MOESI_SHARED;
+    }
+}
+
 void MOESILogic::handle_response(CacheQueueEntry *queueEntry,
         Message &message)
 {
@@ -440,7 +479,7 @@ void MOESILogic::send_to_cont(CacheQueueEntry *queueEntry,
         Interconnect *sendTo, Controller *dest)
 {
     queueEntry->dest = dest;
-    queueEntry->request->get_history() << "{MOESI} ";
+    ADD_HISTORY(queueEntry->request, "{MOESI} ");
 
     send_response(queueEntry, sendTo);
 }
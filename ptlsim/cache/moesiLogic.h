@@ -97,6 +97,9 @@ namespace CoherentCache {
                     Message &message);
             bool is_line_valid(CacheLine *line);
             void invalidate_line(CacheLine *line);
+            bool warm_hit(CacheLine *line, bool is_write);
+            void warm_insert(CacheLine *line, bool is_write, bool shared);
+            void warm_snoop(CacheLine *line, bool is_write);
 			void dump_configuration(YAML::Emitter &out) const;
 
             void send_response(CacheQueueEntry *queueEntry,
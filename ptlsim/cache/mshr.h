@@ -0,0 +1,188 @@
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * This code is released under GPL.
+ *
+ */
+
+#ifndef MSHR_H
+#define MSHR_H
+
+#include <globals.h>
+#include <superstl.h>
+#include <statelist.h>
+
+namespace Memory {
+
+/*
+ * Pending request queue of a cache indexed by cache line address, a file of
+ * Miss Status Holding Registers. The first queued entry of a line allocates
+ * the line's MSHR and later entries of the same line are merged into it, so
+ * entries of one line are found without walking the whole queue. Entries of
+ * a line are kept in allocation order, which is also the order of the queue.
+ *
+ * Entries are added to the index with track() once their request is set, and
+ * free() removes them from it.
+ */
+template <typename T, int SIZE>
+struct MSHRQueue : public FixStateList<T, SIZE>
+{
+    typedef FixStateList<T, SIZE> base_t;
+
+    enum { BUCKETS = 2 * SIZE };
+
+    MSHRQueue() {
+        reset_index();
+    }
+
+    /**
+     * @brief Add an entry to the MSHR of its line
+     *
+     * @param entry Allocated queue entry
+     * @param line Cache line address of the entry's request
+     *
+     * @return true if the entry was merged into the MSHR of an earlier entry
+     */
+    bool track(T* entry, W64 line) {
+        if (entryMSHR_[entry->idx] >= 0) untrack(entry);
+
+        int idx = entry->idx;
+        int m = find_mshr(line);
+        bool merged = (m >= 0);
+
+        if (!merged) {
+            m = freeMSHR_;
+            assert(m >= 0);
+            freeMSHR_ = mshrs_[m].next;
+
+            MSHR& mshr = mshrs_[m];
+            int bucket = hash(line);
+            mshr.line = line;
+            mshr.head = -1;
+            mshr.tail = -1;
+            mshr.count = 0;
+            mshr.next = buckets_[bucket];
+            buckets_[bucket] = m;
+            used_++;
+        }
+
+        MSHR& mshr = mshrs_[m];
+        entryMSHR_[idx] = m;
+        entryNext_[idx] = -1;
+        entryPrev_[idx] = mshr.tail;
+        if (mshr.tail >= 0) entryNext_[mshr.tail] = idx;
+        else mshr.head = idx;
+        mshr.tail = idx;
+        mshr.count++;
+
+        return merged;
+    }
+
+    void untrack(T* entry) {
+        int idx = entry->idx;
+        int m = entryMSHR_[idx];
+        if (m < 0) return;
+
+        MSHR& mshr = mshrs_[m];
+        int prev = entryPrev_[idx];
+        int next = entryNext_[idx];
+        if (prev >= 0) entryNext_[prev] = next;
+        else mshr.head = next;
+        if (next >= 0) entryPrev_[next] = prev;
+        else mshr.tail = prev;
+        entryMSHR_[idx] = -1;
+
+        if (--mshr.count == 0) {
+            /* Unlink from hash bucket and return to free list */
+            int* link = &buckets_[hash(mshr.line)];
+            while (*link != m) link = &mshrs_[*link].next;
+            *link = mshr.next;
+            mshr.next = freeMSHR_;
+            freeMSHR_ = m;
+            used_--;
+        }
+    }
+
+    void free(T* entry) {
+        untrack(entry);
+        base_t::free(entry);
+    }
+
+    /* First entry of a line, or NULL if the line has no MSHR */
+    T* first(W64 line) {
+        int m = find_mshr(line);
+        return (m < 0) ? NULL : &(*this)[mshrs_[m].head];
+    }
+
+    /* First entry of the line of a tracked entry */
+    T* first_of(T* entry) {
+        int m = entryMSHR_[entry->idx];
+        return (m < 0) ? NULL : &(*this)[mshrs_[m].head];
+    }
+
+    /* Next entry of the same line */
+    T* next(T* entry) {
+        int idx = entryNext_[entry->idx];
+        return (idx < 0) ? NULL : &(*this)[idx];
+    }
+
+    /* Number of entries of a line */
+    int line_count(W64 line) {
+        int m = find_mshr(line);
+        return (m < 0) ? 0 : mshrs_[m].count;
+    }
+
+    /* Number of lines with pending entries */
+    int mshr_count() const {
+        return used_;
+    }
+
+    void reset() {
+        base_t::reset();
+        reset_index();
+    }
+
+    private:
+        struct MSHR {
+            W64 line;
+            int head;
+            int tail;
+            int count;
+            int next;   // Next MSHR of the hash bucket or free list
+        };
+
+        MSHR mshrs_[SIZE];
+        int buckets_[BUCKETS];
+        int freeMSHR_;
+        int used_;
+
+        int entryMSHR_[SIZE];
+        int entryNext_[SIZE];
+        int entryPrev_[SIZE];
+
+        static int hash(W64 line) {
+            return (line ^ (line >> 11) ^ (line >> 23)) % BUCKETS;
+        }
+
+        int find_mshr(W64 line) const {
+            int m = buckets_[hash(line)];
+            while (m >= 0 && mshrs_[m].line != line) m = mshrs_[m].next;
+            return m;
+        }
+
+        void reset_index() {
+            foreach (i, BUCKETS) buckets_[i] = -1;
+            foreach (i, SIZE) {
+                mshrs_[i].next = (i + 1 < SIZE) ? i + 1 : -1;
+                entryMSHR_[i] = -1;
+                entryNext_[i] = -1;
+                entryPrev_[i] = -1;
+            }
+            freeMSHR_ = 0;
+            used_ = 0;
+        }
+};
+
+};
+
+#endif // MSHR_H
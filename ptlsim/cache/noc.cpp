@@ -0,0 +1,465 @@
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * This code is released under GPL.
+ *
+ */
+
+#include <ptlsim.h>
+#include <noc.h>
+#include <machine.h>
+
+using namespace Memory;
+using namespace Memory::NetworkOnChip;
+
+NoC::NoC(const char *name, MemoryHierarchy *memoryHierarchy, int type)
+    : Interconnect(name, memoryHierarchy)
+    , type_(type)
+    , ready_(false)
+    , new_stats(name, &memoryHierarchy->get_machine())
+{
+    BaseMachine &machine = memoryHierarchy_->get_machine();
+
+    memoryHierarchy_->add_interconnect(this);
+
+    SET_SIGNAL_CB(name, "_Tick", tick_, &NoC::tick_cb);
+
+    if (!machine.get_option(name, "vcs", vcs_))
+        vcs_ = 4;
+    if (!machine.get_option(name, "buffer_depth", bufferDepth_))
+        bufferDepth_ = 4;
+    if (!machine.get_option(name, "router_latency", routerLatency_))
+        routerLatency_ = 2;
+    if (!machine.get_option(name, "link_latency", linkLatency_))
+        linkLatency_ = 1;
+    if (!machine.get_option(name, "data_flits", dataFlits_))
+        dataFlits_ = 4;
+
+    adaptive_ = false;
+    stringbuf routing;
+    if (machine.get_option(name, "routing", routing)) {
+        if (strequal(routing.buf, "adaptive")) {
+            adaptive_ = true;
+        } else if (!strequal(routing.buf, "xy")) {
+            ptl_logfile << "Unknown routing " << routing << " for " <<
+                name << ", using xy routing\n";
+        }
+    }
+
+    /* Escape channel and dateline need two VC classes */
+    int min_vcs = (adaptive_ || type_ == NOC_RING) ? 2 : 1;
+    if (vcs_ < min_vcs) {
+        ptl_logfile << "[WARNING] " << name << " needs " << min_vcs <<
+            " virtual channels, using " << min_vcs << endl;
+        vcs_ = min_vcs;
+    }
+
+    bufferDepth_ = max(bufferDepth_, 1);
+    routerLatency_ = max(routerLatency_, 1);
+    dataFlits_ = max(dataFlits_, 1);
+
+    /* The wheel must hold the longest delay of a packet, a link crossing */
+    int wheel = 1;
+    while (wheel <= linkLatency_ + dataFlits_ - 1 + routerLatency_)
+        wheel *= 2;
+
+    wheelHead_.resize(wheel);
+    wheelTail_.resize(wheel);
+    foreach (i, wheel) {
+        wheelHead_[i] = NULL;
+        wheelTail_[i] = NULL;
+    }
+    wheelMask_ = wheel - 1;
+    waiting_ = 0;
+    nextTick_ = -1;
+}
+
+void NoC::register_controller(Controller *controller)
+{
+    controllers_.push(controller);
+}
+
+/*
+ * Controllers are registered after the network is created, so routers are
+ * set up when the first message arrives.
+ */
+void NoC::setup_network()
+{
+    BaseMachine &machine = memoryHierarchy_->get_machine();
+    const char *name = get_name();
+    int count = max(controllers_.count(), 2);
+
+    if (type_ == NOC_RING) {
+        int nodes = count;
+        machine.get_option(name, "nodes", nodes);
+        topo_.setup_ring(nodes);
+    } else {
+        int cols = 1;
+        while (cols * cols < count)
+            cols++;
+        int rows = (count + cols - 1) / cols;
+
+        machine.get_option(name, "rows", rows);
+        machine.get_option(name, "cols", cols);
+        topo_.setup_mesh(rows, cols);
+    }
+
+    if (!inrange(topo_.nodes, 1, NOC_MAX_NODES) || topo_.rows < 1 ||
+            topo_.cols < 1) {
+        stringbuf err;
+        err << "::ERROR::Interconnect " << name << " can't have " <<
+            topo_.rows << "x" << topo_.cols << " routers, it must have 1 " <<
+            "to " << NOC_MAX_NODES << endl;
+        ptl_logfile << err << flush;
+        cerr << err << flush;
+        assert(0);
+    }
+
+    credits_.resize(topo_.nodes * NOC_PORTS * vcs_);
+    foreach (i, credits_.count()) {
+        credits_[i] = bufferDepth_;
+    }
+
+    linkFree_.resize(topo_.nodes * 4);
+    foreach (i, linkFree_.count()) {
+        linkFree_[i] = 0;
+    }
+
+    routes_.resize(topo_.nodes * topo_.nodes);
+    neighbors_.resize(topo_.nodes * NOC_PORTS);
+    foreach (node, topo_.nodes) {
+        foreach (dest, topo_.nodes) {
+            routes_[node * topo_.nodes + dest] = topo_.route_port(node, dest);
+        }
+        foreach (port, NOC_PORTS) {
+            neighbors_[node * NOC_PORTS + port] = topo_.neighbor(node, port);
+        }
+    }
+
+    foreach (i, controllers_.count()) {
+        nodes_.add((W64)controllers_[i], i % topo_.nodes);
+    }
+
+    ready_ = true;
+}
+
+int NoC::node_of(Controller *controller)
+{
+    int *node = nodes_.get((W64)controller);
+    assert(node);
+    return *node;
+}
+
+bool NoC::controller_request_cb(void *arg)
+{
+    Message *msg = (Message*)arg;
+    Controller *sender = (Controller*)msg->sender;
+    bool kernel = msg->request->is_kernel();
+
+    if unlikely (!ready_)
+        setup_network();
+
+    assert(msg->dest);
+
+    /* Packet enters the local input buffer of its router */
+    int node = node_of(sender);
+    int vc = best_vc(node, PORT_LOCAL, 0, vcs_);
+    Packet *packet = (vc >= 0) ? packets_.alloc() : NULL;
+
+    if (packet == NULL) {
+        N_STAT_UPDATE(new_stats.inject_stalls, ++, kernel);
+        return false;
+    }
+
+    credit(node, PORT_LOCAL, vc)--;
+
+    packet->request  = msg->request;
+    packet->source   = sender;
+    packet->dest     = (Controller*)msg->dest;
+    packet->arg      = msg->arg;
+    packet->hasData  = msg->hasData;
+    packet->isShared = msg->isShared;
+    packet->destNode = node_of(packet->dest);
+    packet->node     = node;
+    packet->inport   = PORT_LOCAL;
+    packet->vc       = vc;
+    packet->flits    = msg->hasData ? dataFlits_ : 1;
+    packet->injected = sim_cycle;
+    packet->ready    = sim_cycle + routerLatency_;
+
+    packet->request->incRefCounter();
+
+    N_STAT_UPDATE(new_stats.packets, ++, kernel);
+    N_STAT_UPDATE(new_stats.flits, += packet->flits, kernel);
+
+    schedule(packet, routerLatency_);
+    return true;
+}
+
+/**
+ * @brief Select output port and VC of the next router for a packet
+ *
+ * @param packet Packet that is ready to leave its router
+ * @param port Set to the output port
+ * @param vc Set to the VC of the next router's input buffer
+ *
+ * @return false if no productive output link is free or no VC of the next
+ * router has a free buffer
+ */
+bool NoC::allocate(Packet *packet, int& port, int& vc)
+{
+    int node = packet->node;
+
+    if (adaptive_ && topo_.type == NOC_MESH) {
+        int ports[2];
+        int count = topo_.productive_ports(node, packet->destNode, ports);
+        int most = 0;
+
+        vc = -1;
+        foreach (i, count) {
+            if (linkFree_[link_of(node, ports[i])] > sim_cycle)
+                continue;
+
+            int next = neighbor(node, ports[i]);
+            int in = Topology::opposite(ports[i]);
+            int v = best_vc(next, in, 1, vcs_);
+
+            if (v >= 0 && credit(next, in, v) > most) {
+                most = credit(next, in, v);
+                port = ports[i];
+                vc = v;
+            }
+        }
+
+        if (vc >= 0)
+            return true;
+    }
+
+    /* Dimension order route, also the escape channel of adaptive routing */
+    port = route_port(node, packet->destNode);
+    if (linkFree_[link_of(node, port)] > sim_cycle)
+        return false;
+
+    int first = 0;
+    int last = vcs_;
+
+    if (topo_.type == NOC_RING) {
+        bool upper = packet->crossed || topo_.crosses_dateline(node, port);
+        first = upper ? vcs_ / 2 : 0;
+        last = upper ? vcs_ : vcs_ / 2;
+    } else if (adaptive_) {
+        last = 1;
+    }
+
+    vc = best_vc(neighbor(node, port), Topology::opposite(port),
+            first, last);
+    return (vc >= 0);
+}
+
+bool NoC::deliver(Packet *packet)
+{
+    Message& message = *memoryHierarchy_->get_message();
+    message.sender   = this;
+    message.origin   = packet->source;
+    message.dest     = packet->dest;
+    message.request  = packet->request;
+    message.arg      = packet->arg;
+    message.hasData  = packet->hasData;
+    message.isShared = packet->isShared;
+
+    memdebug("NoC delivering to " << packet->dest->get_name() << ": " <<
+            message);
+
+    bool success = packet->dest->get_interconnect_signal()->emit(&message);
+    memoryHierarchy_->free_message(&message);
+
+    return success;
+}
+
+/* Free the packet's buffer and the packet */
+void NoC::release(Packet *packet)
+{
+    credit(packet->node, packet->inport, packet->vc)++;
+
+    packet->request->decRefCounter();
+    packets_.free(packet);
+}
+
+/**
+ * @brief Move all packets that are ready in this cycle
+ *
+ * @param arg Cycle the tick was scheduled for
+ *
+ * Ticks replaced by an earlier one are ignored. Schedules the tick of the
+ * next cycle with a ready packet.
+ */
+bool NoC::tick_cb(void *arg)
+{
+    W64 cycle = (W64)arg;
+    if (cycle != nextTick_)
+        return true;
+
+    int slot = cycle & wheelMask_;
+    Packet *packet = wheelHead_[slot];
+    wheelHead_[slot] = NULL;
+    wheelTail_[slot] = NULL;
+
+    while (packet) {
+        Packet *next = packet->next;
+        waiting_--;
+        route(packet);
+        packet = next;
+    }
+
+    nextTick_ = -1;
+    if (waiting_) {
+        int delay = 1;
+        while (!wheelHead_[(cycle + delay) & wheelMask_])
+            delay++;
+
+        /* A late tick still moves the packets in cycle order */
+        nextTick_ = cycle + delay;
+        delay = (nextTick_ > sim_cycle) ? nextTick_ - sim_cycle : 1;
+        marss_add_event(&tick_, delay, (void*)nextTick_);
+    }
+
+    return true;
+}
+
+/**
+ * @brief Move a packet that is ready to leave its router
+ *
+ * @param packet Packet
+ *
+ * Delivers the packet at its destination router, else sends it to the next
+ * router or retries later.
+ */
+void NoC::route(Packet *packet)
+{
+    bool kernel = packet->request->is_kernel();
+
+    if (packet->annuled) {
+        release(packet);
+        return;
+    }
+
+    if (packet->node == packet->destNode) {
+        if (!deliver(packet)) {
+            schedule(packet, 1);
+            return;
+        }
+
+        N_STAT_UPDATE(new_stats.hops, += packet->hops, kernel);
+        N_STAT_UPDATE(new_stats.latency, += sim_cycle - packet->injected,
+                kernel);
+        release(packet);
+        return;
+    }
+
+    int port, vc;
+    if (!allocate(packet, port, vc)) {
+        /* Without adaptive routing nothing changes until the link is free */
+        int wait = 1;
+        if (!adaptive_) {
+            W64 free = linkFree_[link_of(packet->node,
+                    route_port(packet->node, packet->destNode))];
+            if (free > sim_cycle)
+                wait = free - sim_cycle;
+        }
+
+        N_STAT_UPDATE(new_stats.stalls, += wait, kernel);
+        schedule(packet, wait);
+        return;
+    }
+
+    int link = link_of(packet->node, port);
+    int next = neighbor(packet->node, port);
+    int delay = linkLatency_ + packet->flits - 1 + routerLatency_;
+
+    /* Return the credit of this buffer and take one in the next router */
+    credit(packet->node, packet->inport, packet->vc)++;
+    credit(next, Topology::opposite(port), vc)--;
+    linkFree_[link] = sim_cycle + packet->flits;
+
+    N_STAT_UPDATE(new_stats.link_flits, [link] += packet->flits, kernel);
+    N_STAT_UPDATE(new_stats.link_wait, [link] += sim_cycle - packet->ready,
+            kernel);
+
+    packet->crossed |= topo_.crosses_dateline(packet->node, port);
+    packet->node   = next;
+    packet->inport = Topology::opposite(port);
+    packet->vc     = vc;
+    packet->hops++;
+    packet->ready  = sim_cycle + delay;
+
+    schedule(packet, delay);
+}
+
+int NoC::access_fast_path(Controller *controller,
+        MemoryRequest *request)
+{
+    return -1;
+}
+
+/* Annulled packets are dropped at their next router */
+void NoC::annul_request(MemoryRequest *request)
+{
+    Packet *packet;
+    foreach_list_mutable(packets_.list(), packet, entry_t, nextentry_t) {
+        if (packet->request->is_same(request))
+            packet->annuled = true;
+    }
+}
+
+void NoC::print_map(ostream& os)
+{
+    os << "NoC Interconnect: " << get_name() << endl;
+    os << "\tconnected to:" << endl;
+
+    foreach (i, controllers_.count()) {
+        os << "\t\tcontroller[" << i << "]: " <<
+            controllers_[i]->get_name() << endl;
+    }
+}
+
+/**
+ * @brief Dump NoC Interconnect Configuration in YAML Format
+ *
+ * @param out YAML Object
+ */
+void NoC::dump_configuration(YAML::Emitter &out) const
+{
+    out << YAML::Key << get_name() << YAML::Value << YAML::BeginMap;
+
+    YAML_KEY_VAL(out, "type", "interconnect");
+    YAML_KEY_VAL(out, "topology", ((type_ == NOC_RING) ? "ring" : "mesh"));
+    YAML_KEY_VAL(out, "rows", topo_.rows);
+    YAML_KEY_VAL(out, "cols", topo_.cols);
+    YAML_KEY_VAL(out, "vcs", vcs_);
+    YAML_KEY_VAL(out, "buffer_depth", bufferDepth_);
+    YAML_KEY_VAL(out, "router_latency", routerLatency_);
+    YAML_KEY_VAL(out, "link_latency", linkLatency_);
+    YAML_KEY_VAL(out, "data_flits", dataFlits_);
+    YAML_KEY_VAL(out, "routing", (adaptive_ ? "adaptive" : "xy"));
+
+    out << YAML::EndMap;
+}
+
+struct NoCBuilder : public InterconnectBuilder
+{
+    int type;
+
+    NoCBuilder(const char *name, int type_) :
+        InterconnectBuilder(name)
+        , type(type_)
+    { }
+
+    Interconnect* get_new_interconnect(MemoryHierarchy &mem,
+            const char *name)
+    {
+        return new NoC(name, &mem, type);
+    }
+};
+
+NoCBuilder meshBuilder("mesh", NOC_MESH);
+NoCBuilder ringBuilder("ring", NOC_RING);
@@ -0,0 +1,370 @@
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * This code is released under GPL.
+ *
+ */
+
+#ifndef NOC_H
+#define NOC_H
+
+#include <interconnect.h>
+#include <memoryHierarchy.h>
+#include <memoryStats.h>
+
+namespace Memory {
+
+namespace NetworkOnChip {
+
+enum {
+    NOC_MESH = 0,
+    NOC_RING,
+};
+
+/* Router ports, a ring uses east as clockwise and west as counter-clockwise */
+enum {
+    PORT_LOCAL = 0,
+    PORT_NORTH,
+    PORT_EAST,
+    PORT_SOUTH,
+    PORT_WEST,
+    NOC_PORTS
+};
+
+/**
+ * @brief Shape of a 2D mesh or a bidirectional ring
+ *
+ * Nodes of a mesh are numbered row by row, node n is at column n % cols and
+ * row n / cols. Nodes of a ring are numbered clockwise.
+ */
+struct Topology
+{
+    int type;
+    int rows;
+    int cols;
+    int nodes;
+
+    void setup_mesh(int rows_, int cols_) {
+        type  = NOC_MESH;
+        rows  = rows_;
+        cols  = cols_;
+        nodes = rows * cols;
+    }
+
+    void setup_ring(int nodes_) {
+        type  = NOC_RING;
+        rows  = 1;
+        cols  = nodes_;
+        nodes = nodes_;
+    }
+
+    static int opposite(int port) {
+        switch (port) {
+            case PORT_NORTH: return PORT_SOUTH;
+            case PORT_EAST:  return PORT_WEST;
+            case PORT_SOUTH: return PORT_NORTH;
+            case PORT_WEST:  return PORT_EAST;
+        }
+        return PORT_LOCAL;
+    }
+
+    /* Node connected to given port of a node, or -1 */
+    int neighbor(int node, int port) const {
+        if (type == NOC_RING) {
+            switch (port) {
+                case PORT_EAST: return (node + 1) % nodes;
+                case PORT_WEST: return (node + nodes - 1) % nodes;
+            }
+            return -1;
+        }
+
+        int x = node % cols;
+        int y = node / cols;
+
+        switch (port) {
+            case PORT_NORTH: return (y > 0) ? node - cols : -1;
+            case PORT_EAST:  return (x < cols - 1) ? node + 1 : -1;
+            case PORT_SOUTH: return (y < rows - 1) ? node + cols : -1;
+            case PORT_WEST:  return (x > 0) ? node - 1 : -1;
+        }
+        return -1;
+    }
+
+    int hops(int src, int dest) const {
+        if (type == NOC_RING) {
+            int cw = (dest - src + nodes) % nodes;
+            return min(cw, nodes - cw);
+        }
+
+        return abs(src % cols - dest % cols) + abs(src / cols - dest / cols);
+    }
+
+    /*
+     * Port of dimension order routing, X then Y on a mesh and the shorter
+     * direction on a ring, clockwise on a tie.
+     */
+    int route_port(int cur, int dest) const {
+        if (cur == dest)
+            return PORT_LOCAL;
+
+        if (type == NOC_RING) {
+            int cw = (dest - cur + nodes) % nodes;
+            return (cw <= nodes - cw) ? PORT_EAST : PORT_WEST;
+        }
+
+        int dx = dest % cols - cur % cols;
+        if (dx != 0)
+            return (dx > 0) ? PORT_EAST : PORT_WEST;
+
+        return (dest / cols > cur / cols) ? PORT_SOUTH : PORT_NORTH;
+    }
+
+    /* Ports that bring a packet closer to its destination, 0 to 2 of them */
+    int productive_ports(int cur, int dest, int ports[2]) const {
+        if (type == NOC_RING || cur == dest) {
+            ports[0] = route_port(cur, dest);
+            return (cur == dest) ? 0 : 1;
+        }
+
+        int count = 0;
+        int dx = dest % cols - cur % cols;
+        int dy = dest / cols - cur / cols;
+
+        if (dx != 0) ports[count++] = (dx > 0) ? PORT_EAST : PORT_WEST;
+        if (dy != 0) ports[count++] = (dy > 0) ? PORT_SOUTH : PORT_NORTH;
+        return count;
+    }
+
+    /* Ring link between the last and first node, where VC class changes */
+    bool crosses_dateline(int node, int port) const {
+        return (type == NOC_RING) &&
+            ((port == PORT_EAST && node == nodes - 1) ||
+             (port == PORT_WEST && node == 0));
+    }
+};
+
+struct Packet : public FixStateListObject
+{
+    MemoryRequest *request;
+    Controller    *source;
+    Controller    *dest;
+    void          *arg;
+    bool           hasData;
+    bool           isShared;
+    bool           annuled;
+
+    int  destNode;
+    int  node;      // Router that holds the packet
+    int  inport;    // Input buffer of that router
+    int  vc;
+    int  flits;
+    int  hops;
+    bool crossed;   // Ring dateline crossed, uses upper VC class
+    W64  injected;
+    W64  ready;     // Cycle the packet can leave the router
+    Packet *next;   // Next packet of the same wheel slot
+
+    void init() {
+        request  = NULL;
+        source   = NULL;
+        dest     = NULL;
+        arg      = NULL;
+        hasData  = false;
+        isShared = false;
+        annuled  = false;
+        destNode = -1;
+        node     = -1;
+        inport   = -1;
+        vc       = -1;
+        flits    = 0;
+        hops     = 0;
+        crossed  = false;
+        injected = 0;
+        ready    = 0;
+        next     = NULL;
+    }
+
+    ostream& print(ostream& os) const {
+        if (!request) {
+            os << "Free packet";
+            return os;
+        }
+
+        os << "request[" << *request << "] ";
+        os << "source[" << source->get_name() << "] ";
+        os << "dest[" << dest->get_name() << "] ";
+        os << "node[" << node << "->" << destNode << "] ";
+        os << "vc[" << vc << "] ";
+        os << "annuled[" << annuled << "]" << endl;
+        return os;
+    }
+};
+
+static inline ostream& operator <<(ostream& os, const Packet& packet)
+{
+    return packet.print(os);
+}
+
+/**
+ * @brief Network on chip with a 2D mesh or bidirectional ring of routers
+ *
+ * Each controller is attached to a router, in the order they are connected
+ * to the interconnect and wrapping around if there are more controllers than
+ * routers. Messages travel as packets of one flit, or 'data_flits' flits if
+ * they carry data. At each router a packet is routed after
+ * 'router_latency' cycles, gets a virtual channel with a free buffer in the
+ * next router (credit based flow control) and a free output link, and
+ * crosses the link in 'link_latency' cycles plus one cycle per extra flit.
+ * A packet that can't get them waits in its buffer and retries next cycle,
+ * or once its output link is free if that is what it waits for.
+ *
+ * Routing is XY on a mesh or the shorter direction on a ring. With
+ * 'routing: adaptive' a mesh packet takes any productive direction on
+ * VCs 1 and up, VC 0 is kept as an XY routed escape channel. Ring VCs are
+ * split in two classes at the dateline between the last and first router.
+ *
+ * Options: rows and cols of a mesh or nodes of a ring, default fitting all
+ * controllers, vcs, buffer_depth (packets per VC), router_latency,
+ * link_latency, data_flits and routing (xy or adaptive).
+ *
+ * Packets move only when they are ready, so host time depends on packets
+ * and hops, not on the number of routers. Packets ready in the same cycle
+ * are kept in a small timing wheel and moved by one event per busy cycle.
+ */
+class NoC : public Interconnect
+{
+    private:
+        int type_;
+        Topology topo_;
+        bool ready_;
+
+        int vcs_;
+        int bufferDepth_;
+        int routerLatency_;
+        int linkLatency_;
+        int dataFlits_;
+        bool adaptive_;
+
+        dynarray<Controller*> controllers_;
+        /* Router of each controller, keyed by controller address */
+        Hashtable<W64, int, 256> nodes_;
+
+        /*
+         * Dimension order output port of each router and destination, and
+         * the router behind each port, so a hop needs no coordinates
+         */
+        dynarray<W8> routes_;
+        dynarray<int> neighbors_;
+
+        /* Free buffers of each router input port and VC */
+        dynarray<int> credits_;
+        /* First cycle each router output link is free */
+        dynarray<W64> linkFree_;
+
+        FixStateList<Packet, 1024> packets_;
+
+        /* Packets by the cycle they are ready, modulo the wheel size */
+        dynarray<Packet*> wheelHead_;
+        dynarray<Packet*> wheelTail_;
+        int wheelMask_;
+        int waiting_;
+        /* Cycle of the earliest pending tick event, -1 if none */
+        W64 nextTick_;
+        Signal tick_;
+
+        NoCStats new_stats;
+
+        void setup_network();
+        int node_of(Controller *controller);
+
+        int route_port(int node, int dest) const {
+            return routes_[node * topo_.nodes + dest];
+        }
+
+        int neighbor(int node, int port) const {
+            return neighbors_[node * NOC_PORTS + port];
+        }
+
+        int& credit(int node, int port, int vc) {
+            return credits_[(node * NOC_PORTS + port) * vcs_ + vc];
+        }
+
+        static int link_of(int node, int port) {
+            return node * 4 + port - 1;
+        }
+
+        /* VC in [first, last) with most free buffers at an input port, or -1 */
+        int best_vc(int node, int port, int first, int last) {
+            int *credits = &credit(node, port, 0);
+            int vc = -1;
+            int most = 0;
+
+            for (int i = first; i < last; i++) {
+                if (credits[i] > most) {
+                    most = credits[i];
+                    vc = i;
+                }
+            }
+
+            return vc;
+        }
+
+        bool allocate(Packet *packet, int& port, int& vc);
+        bool deliver(Packet *packet);
+        void release(Packet *packet);
+        inline void schedule(Packet *packet, int delay);
+        void route(Packet *packet);
+
+    public:
+        NoC(const char *name, MemoryHierarchy *memoryHierarchy, int type);
+
+        bool controller_request_cb(void *arg);
+        void register_controller(Controller *controller);
+        int  access_fast_path(Controller *controller,
+                MemoryRequest *request);
+        void annul_request(MemoryRequest *request);
+        void dump_configuration(YAML::Emitter &out) const;
+
+        bool tick_cb(void *arg);
+
+        int get_delay() {
+            return routerLatency_ + linkLatency_;
+        }
+
+        const Topology& get_topology() const { return topo_; }
+
+        void print(ostream& os) const {
+            os << "--NoC-Interconnect: " << get_name() << endl;
+            if (packets_.count() > 0)
+                os << "Packets : " << packets_ << endl;
+            os << "--End-NoC-Interconnect" << endl;
+        }
+
+        void print_map(ostream& os);
+};
+
+/* Move the packet after 'delay' cycles, ticking then if nothing comes first */
+inline void NoC::schedule(Packet *packet, int delay)
+{
+    W64 cycle = sim_cycle + delay;
+    int slot = cycle & wheelMask_;
+
+    packet->next = NULL;
+    if (wheelTail_[slot])
+        wheelTail_[slot]->next = packet;
+    else
+        wheelHead_[slot] = packet;
+    wheelTail_[slot] = packet;
+    waiting_++;
+
+    if (cycle < nextTick_) {
+        nextTick_ = cycle;
+        marss_add_event(&tick_, delay, (void*)cycle);
+    }
+}
+
+};
+
+};
+
+#endif // NOC_H
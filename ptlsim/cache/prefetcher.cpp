@@ -0,0 +1,309 @@
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * This code is released under GPL.
+ *
+ */
+
+#include <prefetcher.h>
+
+using namespace Memory;
+
+/* Next Line Prefetcher */
+
+void NextLinePrefetcher::access(const PrefetchAccess& access,
+        dynarray<W64>& lines)
+{
+    if (!access.miss || access.isWrite)
+        return;
+
+    foreach (i, config_.degree) {
+        lines.push(access.line + config_.distance + i);
+    }
+}
+
+/* Stride Prefetcher */
+
+StridePrefetcher::StridePrefetcher(const PrefetcherConfig& config)
+    : Prefetcher(config)
+{
+    table_.resize(max(config_.table_size, 1));
+    foreach (i, table_.count()) {
+        Entry& entry = table_[i];
+        entry.pc = -1;
+        entry.lastLine = 0;
+        entry.stride = 0;
+        entry.confidence = 0;
+    }
+}
+
+void StridePrefetcher::access(const PrefetchAccess& access,
+        dynarray<W64>& lines)
+{
+    Entry& entry = table_[access.pc % table_.count()];
+
+    if (entry.pc != access.pc) {
+        entry.pc = access.pc;
+        entry.lastLine = access.line;
+        entry.stride = 0;
+        entry.confidence = 0;
+        return;
+    }
+
+    W64s stride = W64s(access.line - entry.lastLine);
+
+    /* Repeated accesses to the same line don't change the pattern */
+    if (stride == 0)
+        return;
+
+    entry.lastLine = access.line;
+
+    if (stride == entry.stride) {
+        entry.confidence = min(entry.confidence + 1, 3);
+    } else {
+        entry.confidence = max(entry.confidence - 1, 0);
+        if (entry.confidence == 0)
+            entry.stride = stride;
+        return;
+    }
+
+    if (entry.confidence < 2)
+        return;
+
+    foreach (i, config_.degree) {
+        lines.push(access.line + entry.stride * (config_.distance + i));
+    }
+}
+
+/* Stream Prefetcher */
+
+StreamPrefetcher::StreamPrefetcher(const PrefetcherConfig& config)
+    : Prefetcher(config)
+    , lastMiss_(0)
+    , lastMissValid_(false)
+    , useCounter_(0)
+{
+    streams_.resize(max(config_.table_size, 1));
+    foreach (i, streams_.count()) {
+        streams_[i].valid = false;
+    }
+}
+
+/*
+ * A stream covers lines from its last demand line up to the last prefetched
+ * line plus one, so a demand access right behind the prefetched lines still
+ * advances the stream.
+ */
+StreamPrefetcher::Stream* StreamPrefetcher::find_stream(W64 line)
+{
+    foreach (i, streams_.count()) {
+        Stream& stream = streams_[i];
+        if (!stream.valid)
+            continue;
+
+        W64s ahead = W64s(line - stream.demandLine) * stream.direction;
+        W64s window = W64s(stream.prefetchLine - stream.demandLine) *
+            stream.direction + 1;
+
+        if (ahead > 0 && ahead <= max(window, W64s(config_.distance)))
+            return &stream;
+    }
+
+    return NULL;
+}
+
+StreamPrefetcher::Stream* StreamPrefetcher::alloc_stream()
+{
+    Stream* victim = &streams_[0];
+
+    foreach (i, streams_.count()) {
+        Stream& stream = streams_[i];
+        if (!stream.valid)
+            return &stream;
+        if (stream.lastUse < victim->lastUse)
+            victim = &stream;
+    }
+
+    return victim;
+}
+
+void StreamPrefetcher::access(const PrefetchAccess& access,
+        dynarray<W64>& lines)
+{
+    if (!access.miss && !access.prefetchHit)
+        return;
+
+    Stream* stream = find_stream(access.line);
+
+    if (!stream) {
+        if (!access.miss)
+            return;
+
+        /* Two adjacent misses start a new stream */
+        if (lastMissValid_ && (access.line == lastMiss_ + 1 ||
+                    access.line == lastMiss_ - 1)) {
+            stream = alloc_stream();
+            stream->valid = true;
+            stream->direction = (access.line > lastMiss_) ? 1 : -1;
+            stream->prefetchLine = access.line;
+            lastMissValid_ = false;
+        } else {
+            lastMiss_ = access.line;
+            lastMissValid_ = true;
+            return;
+        }
+    }
+
+    stream->demandLine = access.line;
+    stream->lastUse = ++useCounter_;
+
+    /* Keep prefetched lines 'distance' lines ahead of demand accesses */
+    W64 target = access.line + W64s(config_.distance) * stream->direction;
+    W64 next = stream->prefetchLine;
+    W64s behind = W64s(access.line - next) * stream->direction;
+
+    if (behind >= 0)
+        next = access.line;
+
+    foreach (i, config_.degree) {
+        if (W64s(target - next) * stream->direction <= 0)
+            break;
+        next += stream->direction;
+        lines.push(next);
+    }
+
+    stream->prefetchLine = next;
+}
+
+/* Region Prefetcher */
+
+RegionPrefetcher::RegionPrefetcher(const PrefetcherConfig& config)
+    : Prefetcher(config)
+    , useCounter_(0)
+{
+    /* Patterns are kept in a 64 bit mask */
+    config_.region_lines = min(max(config_.region_lines, 2), 64);
+
+    regions_.resize(max(config_.table_size, 1));
+    foreach (i, regions_.count()) {
+        regions_[i].valid = false;
+    }
+
+    patterns_.resize(max(config_.table_size, 1) * 16);
+    foreach (i, patterns_.count()) {
+        patterns_[i].valid = false;
+    }
+}
+
+void RegionPrefetcher::access(const PrefetchAccess& access,
+        dynarray<W64>& lines)
+{
+    W64 region = access.line / config_.region_lines;
+    int offset = access.line % config_.region_lines;
+
+    Region* victim = &regions_[0];
+    foreach (i, regions_.count()) {
+        Region& r = regions_[i];
+        if (r.valid && r.region == region) {
+            r.pattern |= (1ULL << offset);
+            r.lastUse = ++useCounter_;
+            return;
+        }
+
+        if (!victim->valid)
+            continue;
+        if (!r.valid || r.lastUse < victim->lastUse)
+            victim = &r;
+    }
+
+    /* Learn the access pattern of the replaced region */
+    if (victim->valid) {
+        Pattern& p = get_pattern(victim->key);
+        p.valid = true;
+        p.key = victim->key;
+        p.pattern = victim->pattern;
+    }
+
+    W64 key = get_key(access.pc, offset);
+
+    victim->valid = true;
+    victim->region = region;
+    victim->key = key;
+    victim->pattern = (1ULL << offset);
+    victim->lastUse = ++useCounter_;
+
+    Pattern& p = get_pattern(key);
+    if (!p.valid || p.key != key)
+        return;
+
+    /* Issue recorded lines nearest to the trigger first */
+    W64 base = region * config_.region_lines;
+    int issued = 0;
+    for (int d = 1; d <= config_.distance; d++) {
+        int offsets[2] = {offset + d, offset - d};
+        foreach (j, 2) {
+            int o = offsets[j];
+            if (o < 0 || o >= config_.region_lines)
+                continue;
+            if (!(p.pattern & (1ULL << o)))
+                continue;
+
+            lines.push(base + o);
+            if (++issued >= config_.degree)
+                return;
+        }
+    }
+}
+
+/* Prefetcher Builders */
+
+PrefetcherBuilder::PrefetcherBuilder(const char* name)
+{
+    if (!prefetcherBuilders) {
+        prefetcherBuilders = new Hashtable<const char*,
+            PrefetcherBuilder*, 1>();
+    }
+    prefetcherBuilders->add(name, this);
+}
+
+Hashtable<const char*, PrefetcherBuilder*, 1>
+    *PrefetcherBuilder::prefetcherBuilders = NULL;
+
+/**
+ * @brief Create a new prefetcher
+ *
+ * @param name Registered name of the prefetcher
+ * @param config Parameters of the new prefetcher
+ *
+ * @return New prefetcher or NULL if name is not registered
+ */
+Prefetcher* PrefetcherBuilder::create(const char* name,
+        const PrefetcherConfig& config)
+{
+    if (!prefetcherBuilders)
+        return NULL;
+
+    PrefetcherBuilder** builder = prefetcherBuilders->get(name);
+    if (!builder)
+        return NULL;
+
+    return (*builder)->get_new_prefetcher(config);
+}
+
+template <typename T>
+struct SimplePrefetcherBuilder : public PrefetcherBuilder
+{
+    SimplePrefetcherBuilder(const char* name)
+        : PrefetcherBuilder(name)
+    {}
+
+    Prefetcher* get_new_prefetcher(const PrefetcherConfig& config) {
+        return new T(config);
+    }
+};
+
+SimplePrefetcherBuilder<NextLinePrefetcher> nextLinePrefetcherBuilder(
+        "next_line");
+SimplePrefetcherBuilder<StridePrefetcher> stridePrefetcherBuilder("stride");
+SimplePrefetcherBuilder<StreamPrefetcher> streamPrefetcherBuilder("stream");
+SimplePrefetcherBuilder<RegionPrefetcher> regionPrefetcherBuilder("region");
@@ -0,0 +1,214 @@
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * This code is released under GPL.
+ *
+ */
+
+#ifndef PREFETCHER_H
+#define PREFETCHER_H
+
+#include <globals.h>
+#include <superstl.h>
+
+namespace Memory {
+
+/* Parameters shared by all prefetchers */
+struct PrefetcherConfig {
+    int degree;         // Prefetches issued by one trigger access
+    int distance;       // How far ahead of the trigger prefetching starts
+    int table_size;     // Entries in stride table, streams or region table
+    int region_lines;   // Cache lines in one spatial region
+
+    PrefetcherConfig()
+        : degree(1)
+        , distance(1)
+        , table_size(16)
+        , region_lines(32)
+    {}
+};
+
+/* Demand access of a cache that trains the prefetcher */
+struct PrefetchAccess {
+    W64 line;           // Cache line address (physical address >> line bits)
+    W64 pc;             // Instruction that issued the access
+    bool miss;          // Line was not in the cache
+    bool prefetchHit;   // Line was brought in by a prefetch
+    bool isWrite;
+};
+
+/**
+ * @brief Interface of a hardware prefetcher
+ *
+ * A cache controller trains its prefetcher with every demand access and
+ * issues the returned cache lines. Prefetchers only see line addresses,
+ * filtering lines that are cached or already in flight and throttling is
+ * left to the controller.
+ */
+class Prefetcher {
+    public:
+        Prefetcher(const PrefetcherConfig& config)
+            : config_(config)
+        {}
+
+        virtual ~Prefetcher() {}
+
+        /**
+         * @brief Train on a demand access
+         *
+         * @param access Access seen by the cache
+         * @param lines Line addresses to prefetch are appended here, most
+         * urgent first, at most 'degree' of them
+         */
+        virtual void access(const PrefetchAccess& access,
+                dynarray<W64>& lines) = 0;
+
+        virtual const char* get_name() const = 0;
+
+        const PrefetcherConfig& get_config() const { return config_; }
+
+    protected:
+        PrefetcherConfig config_;
+};
+
+/**
+ * @brief Prefetch lines following a read miss
+ *
+ * Issues 'degree' consecutive lines starting 'distance' lines after the
+ * missing line. With degree and distance of 1 this is the classic next-line
+ * prefetcher.
+ */
+class NextLinePrefetcher : public Prefetcher {
+    public:
+        NextLinePrefetcher(const PrefetcherConfig& config)
+            : Prefetcher(config)
+        {}
+
+        void access(const PrefetchAccess& access, dynarray<W64>& lines);
+        const char* get_name() const { return "next_line"; }
+};
+
+/**
+ * @brief PC indexed stride prefetcher
+ *
+ * A direct mapped table indexed by the instruction address keeps the last
+ * line and stride of each load/store. Once the same stride is seen twice in
+ * a row the entry is confident and each access prefetches 'degree' lines
+ * along the stride, starting 'distance' strides ahead.
+ */
+class StridePrefetcher : public Prefetcher {
+    public:
+        StridePrefetcher(const PrefetcherConfig& config);
+
+        void access(const PrefetchAccess& access, dynarray<W64>& lines);
+        const char* get_name() const { return "stride"; }
+
+    private:
+        struct Entry {
+            W64 pc;
+            W64 lastLine;
+            W64s stride;
+            int confidence;
+        };
+
+        dynarray<Entry> table_;
+};
+
+/**
+ * @brief Stream buffer prefetcher
+ *
+ * Misses to two adjacent lines allocate a stream in their direction,
+ * replacing the least recently used one. A miss or prefetch hit inside a
+ * stream's window advances it and prefetches up to 'degree' lines so the
+ * stream stays 'distance' lines ahead of the demand accesses.
+ */
+class StreamPrefetcher : public Prefetcher {
+    public:
+        StreamPrefetcher(const PrefetcherConfig& config);
+
+        void access(const PrefetchAccess& access, dynarray<W64>& lines);
+        const char* get_name() const { return "stream"; }
+
+    private:
+        struct Stream {
+            bool valid;
+            W64 demandLine;     // Last line accessed by demand requests
+            W64 prefetchLine;   // Last line prefetched
+            int direction;      // +1 for ascending, -1 for descending
+            W64 lastUse;
+        };
+
+        dynarray<Stream> streams_;
+        W64 lastMiss_;
+        bool lastMissValid_;
+        W64 useCounter_;
+
+        Stream* find_stream(W64 line);
+        Stream* alloc_stream();
+};
+
+/**
+ * @brief Spatial region prefetcher
+ *
+ * Memory is divided into regions of 'region_lines' lines. While a region is
+ * active its accessed lines are recorded in a bitmap. When the region is
+ * replaced the bitmap is stored in a pattern table indexed by the PC and
+ * region offset of the access that activated it. The next time the same
+ * trigger activates a region the recorded lines within 'distance' lines of
+ * the trigger are prefetched, nearest first, up to 'degree' of them.
+ */
+class RegionPrefetcher : public Prefetcher {
+    public:
+        RegionPrefetcher(const PrefetcherConfig& config);
+
+        void access(const PrefetchAccess& access, dynarray<W64>& lines);
+        const char* get_name() const { return "region"; }
+
+    private:
+        struct Region {
+            bool valid;
+            W64 region;
+            W64 key;        // Pattern table key of the trigger access
+            W64 pattern;
+            W64 lastUse;
+        };
+
+        struct Pattern {
+            bool valid;
+            W64 key;
+            W64 pattern;
+        };
+
+        dynarray<Region> regions_;
+        dynarray<Pattern> patterns_;
+        W64 useCounter_;
+
+        W64 get_key(W64 pc, int offset) const {
+            return (pc << 6) ^ offset;
+        }
+
+        Pattern& get_pattern(W64 key) {
+            return patterns_[key % patterns_.count()];
+        }
+};
+
+/**
+ * @brief Create prefetchers by name
+ *
+ * Each prefetcher type has one global builder registered with its name,
+ * like controller and interconnect builders.
+ */
+struct PrefetcherBuilder {
+    PrefetcherBuilder(const char* name);
+    virtual ~PrefetcherBuilder() {}
+    virtual Prefetcher* get_new_prefetcher(
+            const PrefetcherConfig& config) = 0;
+
+    static Hashtable<const char*, PrefetcherBuilder*, 1> *prefetcherBuilders;
+    static Prefetcher* create(const char* name,
+            const PrefetcherConfig& config);
+};
+
+};
+
+#endif // PREFETCHER_H
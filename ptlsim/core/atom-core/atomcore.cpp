@@ -256,7 +256,7 @@ bool AtomOp::fetch()
 
         TransOp& op = uops[i];
 
-        op = thread->current_bb->transops[thread->bb_transop_index];
+        op = thread->current_bb->uops[thread->bb_transop_index];
         synthops[i] = thread->current_bb->synthops[thread->bb_transop_index];
 
         rip = fetchrip;
@@ -1821,7 +1821,8 @@ void AtomThread::reset()
     op_waiting_to_writeback_list.reset();
     op_ready_to_writeback_list.reset();
 
-    branchpred.init(core.get_coreid(), threadid);
+    if (!core.machine.keep_warm_state)
+        branchpred.init(core.get_coreid(), threadid);
     branches_in_flight = 0;
 
     foreach(i, NUM_ATOM_OPS_PER_THREAD) {
@@ -1993,13 +1994,14 @@ bool AtomThread::fetch_check_current_bb()
     // We need to fetch new basic block from the buffer.
     fetchrip.update(ctx);
 
+    // Follow the chain of the old basic block before releasing it
+    BasicBlock *bb = bbcache[ctx.cpu_index].lookup(current_bb, fetchrip);
+
     if(current_bb) {
         current_bb->release();
         current_bb = NULL;
     }
 
-    BasicBlock *bb = bbcache[ctx.cpu_index](fetchrip);
-
     if likely (bb) {
         current_bb = bb;
     } else {
@@ -2678,7 +2680,7 @@ bool AtomThread::commit_queue()
         st_commit.uops += buf.op->num_uops_used;
 
         if(buf.op->eom || commit_result == COMMIT_BARRIER) {
-            total_insns_committed++;
+            xadd(total_insns_committed, W64(1));
             st_commit.insns++;
             break;
         }
@@ -2715,6 +2717,8 @@ void AtomThread::add_to_commitbuf(AtomOp* op)
  */
 bool AtomThread::handle_exception()
 {
+    ParallelSharedAccess shared_access;
+
     ATOMTHLOG1("handle_exception()");
     assert(ctx.exception > 0);
 
@@ -2779,6 +2783,7 @@ handle_page_fault:
  */
 bool AtomThread::handle_interrupt()
 {
+    ParallelSharedAccess shared_access;
     ctx.event_upcall();
     handle_interrupt_at_next_eom = 0;
 
@@ -2795,6 +2800,8 @@ bool AtomThread::handle_interrupt()
  */
 bool AtomThread::handle_barrier()
 {
+    ParallelSharedAccess shared_access;
+
     int assistid = ctx.eip;
     assist_func_t assist = (assist_func_t)(Waddr)assistid_to_func[assistid];
     
@@ -3139,7 +3146,7 @@ bool AtomCore::runcycle(void* none)
     ATOMCORELOG("Cycle: " << sim_cycle);
 
     running_thread->handle_interrupt_at_next_eom =
-        running_thread->ctx.check_events();
+        running_thread->ctx.pending_events();
 
     if(running_thread->ctx.kernel_mode) {
         running_thread->set_default_stats(kernel_stats);
@@ -3151,6 +3158,7 @@ bool AtomCore::runcycle(void* none)
 
     if(exit_requested) {
         ATOMCORELOG("Exit to qemu requested");
+        ParallelSharedAccess shared_access;
         machine.ret_qemu_env = &running_thread->ctx;
         return exit_requested;
     }
@@ -3198,6 +3206,61 @@ bool AtomCore::runcycle(void* none)
     return false;
 }
 
+/**
+ * @brief Find the cycle until which this core has nothing to do
+ *
+ * Running thread is idle when its pipeline is empty and it either waits for
+ * an icache miss or, after a load missed in the cache, waits in thread
+ * switch mode with no other thread to switch to. Both are woken up by the
+ * memory hierarchy, so the only local limit is the cycle in which the
+ * deadlock check in writeback() would fire.
+ *
+ * @return -1 if core waits only for memory, current cycle if it is busy
+ */
+W64 AtomCore::get_idle_until()
+{
+    AtomThread* thread = running_thread;
+
+    if(thread->ctx.check_events() || thread->pause_counter > 0 ||
+            thread->itlb_exception || thread->dtlb_walk_level ||
+            !thread->commitbuf.empty() || !thread->ready_to_switch()) {
+        return sim_cycle;
+    }
+
+    if(in_thread_switch) {
+        if(thread->ready || threadcount > 1) {
+            return sim_cycle;
+        }
+    } else if(!thread->ready || thread->issue_disabled ||
+            !thread->waiting_for_icache_miss ||
+            !thread->dispatchq.empty() || thread->op_fetch_list.count) {
+        return sim_cycle;
+    }
+
+    return thread->last_commit_cycle + 1024*1024 + 1;
+}
+
+/**
+ * @brief Update stats of skipped idle cycles
+ *
+ * Adds the same counters that runcycle() updates in each cycle while the
+ * core is in the state detected by get_idle_until().
+ *
+ * @param cycles Number of cycles skipped
+ */
+void AtomCore::skip_cycles(W64 cycles)
+{
+    AtomThread* thread = running_thread;
+
+    thread->handle_interrupt_at_next_eom = 0;
+    thread->st_cycles += cycles;
+
+    if(!in_thread_switch) {
+        thread->st_issue.width[0] += cycles;
+        thread->st_fetch.stop.icache_miss += cycles;
+    }
+}
+
 /**
  * @brief Try to switch running thread
  */
@@ -3241,8 +3304,11 @@ void AtomCore::reset()
         threads[i]->reset();
     }
 
-    dtlb.reset();
-    itlb.reset();
+    /* Keep TLB entries warmed up during fast-forward */
+    if (!machine.keep_warm_state) {
+        dtlb.reset();
+        itlb.reset();
+    }
     fetchq.reset();
 
     forwardbuf.reset();
@@ -3283,6 +3349,61 @@ void AtomCore::flush_tlb_virt(Context& ctx, Waddr virtaddr)
     }
 }
 
+/**
+ * @brief Find the thread that runs given Context
+ *
+ * @param ctx Context to look for
+ * @param threadid Set to index of the thread
+ *
+ * @return true if Context runs on this core
+ */
+bool AtomCore::get_context_thread(Context& ctx, W8& threadid)
+{
+    foreach(i, threadcount) {
+        if(threads[i]->ctx.cpu_index == ctx.cpu_index) {
+            threadid = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+void AtomCore::warm_tlb(W8 threadid, Waddr virtaddr, bool is_code)
+{
+    if(is_code) {
+        itlb.insert(virtaddr, threadid);
+    } else {
+        dtlb.insert(virtaddr, threadid);
+    }
+}
+
+void AtomCore::warm_branch(W8 threadid, int type, W64 ripafter, W64 target)
+{
+    threads[threadid]->branchpred.warm(type, ripafter, target);
+}
+
+void AtomCore::save_warm_state(ostream& os)
+{
+    save_warm_block(os, dtlb);
+    save_warm_block(os, itlb);
+
+    foreach(i, threadcount) {
+        threads[i]->branchpred.save_state(os);
+    }
+}
+
+bool AtomCore::restore_warm_state(istream& is)
+{
+    if(!restore_warm_block(is, dtlb) || !restore_warm_block(is, itlb))
+        return false;
+
+    foreach(i, threadcount) {
+        if(!threads[i]->branchpred.restore_state(is))
+            return false;
+    }
+    return true;
+}
+
 void AtomCore::dump_state(ostream& os)
 {
     os << *this;
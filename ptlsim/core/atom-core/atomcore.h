@@ -1041,6 +1041,8 @@ namespace ATOM_CORE_MODEL {
         
         void reset();
         bool runcycle(void*);
+        W64  get_idle_until();
+        void skip_cycles(W64 cycles);
         void check_ctx_changes();
         void flush_tlb(Context& ctx);
         void flush_tlb_virt(Context& ctx, Waddr virtaddr);
@@ -1050,6 +1052,13 @@ namespace ATOM_CORE_MODEL {
         //W8   get_coreid();
 		void dump_configuration(YAML::Emitter &out) const;
 
+        // Functional warming
+        bool get_context_thread(Context& ctx, W8& threadid);
+        void warm_tlb(W8 threadid, Waddr virtaddr, bool is_code);
+        void warm_branch(W8 threadid, int type, W64 ripafter, W64 target);
+        void save_warm_state(ostream& os);
+        bool restore_warm_state(istream& is);
+
         // Pipeline related functions
         void fetch();
 
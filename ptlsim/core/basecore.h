@@ -35,6 +35,58 @@ namespace Core {
             virtual void flush_pipeline() = 0;
 		    virtual void dump_configuration(YAML::Emitter &out) const = 0;
 
+            /**
+             * @brief Cycle until which this core has nothing to do
+             *
+             * @return First cycle in which core can change its state on its
+             * own. Cores waiting only for a memory response return -1.
+             * Default is current cycle so cores that don't implement idle
+             * detection are never skipped.
+             */
+            virtual W64 get_idle_until() { return sim_cycle; }
+
+            /**
+             * @brief Update per-cycle state and stats for skipped cycles
+             *
+             * @param cycles Number of cycles skipped while core was idle
+             */
+            virtual void skip_cycles(W64 cycles) {}
+
+            /**
+             * @brief Find hardware thread that runs given Context
+             *
+             * @param ctx Context to look for
+             * @param threadid Set to thread id if found
+             *
+             * @return true if Context runs on this core
+             */
+            virtual bool get_context_thread(Context& ctx, W8& threadid) {
+                return false;
+            }
+
+            /**
+             * @brief Functional warming of TLBs and branch predictors
+             *
+             * Called during fast-forward for each instruction fetch, memory
+             * access and branch of the thread, without any timing.
+             */
+            virtual void warm_tlb(W8 threadid, Waddr virtaddr,
+                    bool is_code) {}
+            virtual void warm_branch(W8 threadid, int type, W64 ripafter,
+                    W64 target) {}
+
+            /**
+             * @brief Save TLBs and branch predictors for warm checkpoints
+             */
+            virtual void save_warm_state(ostream& os) {}
+
+            /**
+             * @brief Restore state written by save_warm_state
+             *
+             * @return false if saved state doesn't match this core
+             */
+            virtual bool restore_warm_state(istream& is) { return true; }
+
             void update_memory_hierarchy_ptr();
 
             BaseMachine& machine;
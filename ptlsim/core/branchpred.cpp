@@ -468,6 +468,36 @@ void BranchPredictorInterface::annulras(const PredictorUpdate& predinfo) {
   impl->annulras(predinfo);
 };
 
+/**
+ * @brief Train predictor with a branch outcome during functional warming
+ *
+ * @param type BRANCH_HINT_* flags of the branch
+ * @param branchaddr Address of instruction after the branch
+ * @param target Address executed after the branch
+ *
+ * Same updates as a branch that is fetched and committed without any other
+ * branch in flight.
+ */
+void BranchPredictorInterface::warm(int type, W64 branchaddr, W64 target) {
+  PredictorUpdate update = PredictorUpdate();
+
+  impl->predict(update, type, branchaddr, target);
+  if (type & (BRANCH_HINT_CALL|BRANCH_HINT_RET))
+    impl->updateras(update, branchaddr);
+  impl->update(update, branchaddr, target);
+}
+
+/**
+ * @brief Save all predictor tables, BTB and RAS for warm checkpoints
+ */
+void BranchPredictorInterface::save_state(ostream& os) const {
+  save_warm_block(os, *impl);
+}
+
+bool BranchPredictorInterface::restore_state(istream& is) {
+  return restore_warm_block(is, *impl);
+}
+
 void BranchPredictorInterface::flush() { }
 
 ostream& operator <<(ostream& os, const BranchPredictorInterface& branchpred) {
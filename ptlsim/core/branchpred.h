@@ -72,6 +72,9 @@ struct BranchPredictorInterface {
   void update(PredictorUpdate& update, W64 branchaddr, W64 target);
   void updateras(PredictorUpdate& predinfo, W64 branchaddr);
   void annulras(const PredictorUpdate& predinfo);
+  void warm(int type, W64 branchaddr, W64 target);
+  void save_state(ostream& os) const;
+  bool restore_state(istream& is);
   void flush();
 };
 
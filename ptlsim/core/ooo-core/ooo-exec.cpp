@@ -163,6 +163,24 @@ void IssueQueue<size, operandcount>::clock() {
     }
 }
 
+/**
+ * @brief Check that no entry can issue in this or the next cycle
+ *
+ * @tparam size
+ * @tparam operandcount
+ *
+ * @return True if no entry is ready now and clock() would not make any
+ * entry ready either.
+ */
+template <int size, int operandcount>
+bool IssueQueue<size, operandcount>::stalled() const {
+    bitvec<size> ready = (valid & (~issued));
+    foreach (operand, operandcount) {
+        ready &= ~tags[operand].valid;
+    }
+    return (!allready) && (!ready);
+}
+
 /**
  * @brief Insert an entry into Issue-Queue
  *
@@ -1059,6 +1077,7 @@ int ReorderBufferEntry::issuestore(LoadStoreQueueEntry& state, Waddr& origaddr,
     thread.thread_stats.dcache.store.size[sizeshift]++;
 
     state.physaddr = (annul) ? INVALID_PHYSADDR : (physaddr >> 3);
+    thread.lsqindex.update(state);
 
 /*
  *     The STQ is then searched for the most recent prior store S to same 64-bit block. If found, U's
@@ -1076,49 +1095,46 @@ int ReorderBufferEntry::issuestore(LoadStoreQueueEntry& state, Waddr& origaddr,
  *     All memory fences are considered stores, since in this way both loads and
  *     stores can depend on them using the rs dependency.
  *
+ *     Prior stores are found with the LSQ index instead of walking the LSQ:
+ *     the nearest one of either kind decides, as in a backward walk.
  *
  */
     LoadStoreQueueEntry* sfra = NULL;
+    LSQIndex& lsqindex = thread.lsqindex;
+    int head = LSQ.head;
 
-    foreach_backward_before(LSQ, lsq, i) {
-        LoadStoreQueueEntry& stbuf = LSQ[i];
-
-        /* Skip over loads (we only care about the store queue subset): */
-        if likely (!stbuf.store) continue;
-
-        if likely (stbuf.addrvalid) {
-
-            /* Only considered a match if it's not a fence (which doesn't match anything) */
-            if unlikely (stbuf.lfence | stbuf.sfence) continue;
+    /*
+     * Nearest prior store to the same block; stores are unaligned and
+     * the load with more than two matching stores in queue will not be
+     * issued, so we can issue stores that overlap without any problem.
+     */
+    int nearest_match = -1;
+    LSQIndex::slotvec_t matches = LSQIndex::window(
+            lsqindex.near(state.physaddr) & lsqindex.stores, head, lsq->index());
+    for (int i = matches.lsb(-1); i >= 0; i = matches.nextlsb(i, -1)) {
+        LoadStoreQueueEntry& stbuf = LSQ[LSQIndex::slot_of(head, i)];
 
-            int x = (stbuf.physaddr - state.physaddr);
-            if(-1 <= x && x <= 1) {
-                 /*
-                  * Stores are unaligned and the load with more than two matching stores
-                  * in qeueu will not be issued, so we can issue stores that overlap
-                  * without any problem.
-                  */
-                sfra = NULL;
-                // sfra = &stbuf;
-                break;
-            }
-        } else {
+        /* Only considered a match if it's not a fence (which doesn't match anything) */
+        if unlikely ((!stbuf.addrvalid) | stbuf.lfence | stbuf.sfence) continue;
 
-            /*
-             *  Address is unknown: stores to a given word must issue in program order
-             *  to composite data correctly, but we can't do that without the address.
-             *
-             *  This also catches any unresolved store fences (but not load fences).
-             */
+        int x = (stbuf.physaddr - state.physaddr);
+        if(-1 <= x && x <= 1) nearest_match = i;
+    }
 
-            if unlikely (stbuf.lfence & !stbuf.sfence) {
-                /* Stores can always pass load fences */
-                continue;
-            }
+    /*
+     *  Address is unknown: stores to a given word must issue in program order
+     *  to composite data correctly, but we can't do that without the address.
+     *
+     *  This also catches any unresolved store fences (but not load fences),
+     *  stores can always pass load fences.
+     */
+    LSQIndex::slotvec_t unknown = LSQIndex::window(
+            lsqindex.unresolved & ~(lsqindex.lfences & ~lsqindex.sfences),
+            head, lsq->index());
+    int nearest_unknown = unknown.msb(-1);
 
-            sfra = &stbuf;
-            break;
-        }
+    if (nearest_unknown > nearest_match) {
+        sfra = &LSQ[LSQIndex::slot_of(head, nearest_unknown)];
     }
 
     bool ready = (!sfra || (sfra && sfra->addrvalid && sfra->datavalid)) && rcready;
@@ -1197,10 +1213,17 @@ int ReorderBufferEntry::issuestore(LoadStoreQueueEntry& state, Waddr& origaddr,
      * depended on the data generated by this store. If so, mark the
      * store as invalid (EXCEPTION_LoadStoreAliasing) so it annuls
      * itself and the load after it in program order at commit time.
+     *
+     * Only later loads near this store's address in the LSQ index can
+     * collide, they are checked in program order.
      */
 
-    foreach_forward_after (LSQ, lsq, i) {
-        LoadStoreQueueEntry& ldbuf = LSQ[i];
+    int after = add_index_modulo(lsq->index(), +1, LSQ_SIZE);
+    LSQIndex::slotvec_t later_loads = LSQIndex::window(
+            lsqindex.near(state.physaddr) & ~lsqindex.stores, after, LSQ.tail);
+
+    for (int j = later_loads.lsb(-1); j >= 0; j = later_loads.nextlsb(j, -1)) {
+        LoadStoreQueueEntry& ldbuf = LSQ[LSQIndex::slot_of(after, j)];
 
          /*
           * (see notes on Load Replay Conditions below)
@@ -1476,6 +1499,7 @@ int ReorderBufferEntry::issueload(LoadStoreQueueEntry& state, Waddr& origaddr, W
     thread.thread_stats.dcache.load.size[sizeshift]++;
 
     state.physaddr = (annul) ? INVALID_PHYSADDR : (physaddr >> 3);
+    thread.lsqindex.update(state);
 
     W64 data;
 
@@ -1502,56 +1526,60 @@ int ReorderBufferEntry::issueload(LoadStoreQueueEntry& state, Waddr& origaddr, W
      *
      */
 
-    int sfra_addr_diff;
     bool all_sfra_datavalid = true;
+    LSQIndex& lsqindex = thread.lsqindex;
+    int head = LSQ.head;
 
-    foreach_backward_before(LSQ, lsq, i) {
-        LoadStoreQueueEntry& stbuf = LSQ[i];
-
-        /* Skip over loads (we only care about the store queue subset): */
-        if likely (!stbuf.store) continue;
-
-        if likely (stbuf.addrvalid) {
-            /* Only considered a match if it's not a fence (which doesn't match anything) */
-            if unlikely (stbuf.lfence | stbuf.sfence) continue;
+    /*
+     * Prior stores to the same block, the nearest one is forwarded from.
+     * Only considered a match if it's not a fence (which doesn't match
+     * anything).
+     */
+    int nearest_match = -1;
+    int match_count = 0;
+    LSQIndex::slotvec_t matches = LSQIndex::window(
+            lsqindex.near(state.physaddr) & lsqindex.stores, head, lsq->index());
+    for (int i = matches.lsb(-1); i >= 0; i = matches.nextlsb(i, -1)) {
+        LoadStoreQueueEntry& stbuf = LSQ[LSQIndex::slot_of(head, i)];
+
+        if unlikely ((!stbuf.addrvalid) | stbuf.lfence | stbuf.sfence) continue;
+
+        int sfra_addr_diff = (stbuf.physaddr - state.physaddr);
+        if(-1 <= sfra_addr_diff && sfra_addr_diff <= 1) {
+            nearest_match = i;
+            match_count++;
+            all_sfra_datavalid &= stbuf.datavalid;
+        }
+    }
 
-            sfra_addr_diff = (stbuf.physaddr - state.physaddr);
-            if(-1 <= sfra_addr_diff && sfra_addr_diff <= 1) {
-                thread.thread_stats.dcache.load.dependency.stq_address_match++;
-                if(sfra == NULL) sfra = &stbuf;
-                all_sfra_datavalid &= stbuf.datavalid;
-                continue;
-            }
+    /*
+     * Nearest prior store with unknown address that the load can't pass:
+     * - any store if load address is mmio
+     * - a memory fence that hasn't committed, loads can always pass store
+     *   fences
+     * - any other store if this load is known to alias with prior stores,
+     *   and therefore cannot be hoisted
+     */
+    LSQIndex::slotvec_t blocking = (state.mmio) ? lsqindex.stores :
+        (load_is_known_to_alias_with_store) ? (lsqindex.lfences | ~lsqindex.sfences) :
+        lsqindex.lfences;
+    LSQIndex::slotvec_t unknown = LSQIndex::window(
+            lsqindex.unresolved & blocking, head, lsq->index());
+    int nearest_unknown = unknown.msb(-1);
+
+    if (nearest_unknown > nearest_match) {
+        sfra = &LSQ[LSQIndex::slot_of(head, nearest_unknown)];
+
+        if unlikely (state.mmio) {
+            thread.thread_stats.dcache.load.dependency.mmio++;
+        } else if unlikely (sfra->lfence) {
+            thread.thread_stats.dcache.load.dependency.fence++;
         } else {
-
-            if (sfra != NULL) continue;
-
-            /* If load address is mmio then dont let it issue before unresolved store */
-            if unlikely (state.mmio) {
-                thread.thread_stats.dcache.load.dependency.mmio++;
-                sfra = &stbuf;
-                break;
-            }
-
-            /* Address is unknown: is it a memory fence that hasn't committed? */
-            if unlikely (stbuf.lfence) {
-                thread.thread_stats.dcache.load.dependency.fence++;
-                sfra = &stbuf;
-                break;
-            }
-
-            if unlikely (stbuf.sfence) {
-                /* Loads can always pass store fences */
-                continue;
-            }
-
-            /* Is this load known to alias with prior stores, and therefore cannot be hoisted? */
-            if unlikely (load_is_known_to_alias_with_store) {
-                thread.thread_stats.dcache.load.dependency.predicted_alias_unresolved++;
-                sfra = &stbuf;
-                break;
-            }
+            thread.thread_stats.dcache.load.dependency.predicted_alias_unresolved++;
         }
+    } else if (nearest_match >= 0) {
+        sfra = &LSQ[LSQIndex::slot_of(head, nearest_match)];
+        thread.thread_stats.dcache.load.dependency.stq_address_match += match_count;
     }
 
     thread.thread_stats.dcache.load.dependency.independent += (sfra == NULL);
@@ -1683,6 +1711,7 @@ int ReorderBufferEntry::issueload(LoadStoreQueueEntry& state, Waddr& origaddr, W
     }
 
     state.addrvalid = 1;
+    thread.lsqindex.update(state);
     generated_addr = addr;
     original_addr = origaddr;
     annul_flag = annul;
@@ -1891,6 +1920,13 @@ bool ReorderBufferEntry::probetlb(LoadStoreQueueEntry& state, Waddr& origaddr, W
 
     addrgen(state, origaddr, virtpage, ra, rb, rc, pteupdate, addr, exception, pfec, annul);
 
+    /*
+     * addrgen sets addrvalid and physaddr, and the entry may wait in the
+     * TLB miss list or commit an exception from here without reaching
+     * issueload/issuestore, so update the index now.
+     */
+    thread.lsqindex.update(state);
+
 #ifndef DISABLE_TLB
     /* First check if its a TLB hit or miss */
     if unlikely (exception != 0 || !thread.dtlb.probe(origaddr, threadid)) {
@@ -2067,6 +2103,7 @@ rob_cont:
     request->set_coreSignal(&core.dcache_signal);
 
     lsq->physaddr = pteaddr >> 3;
+    thread.lsqindex.update(*lsq);
 
     bool L1_hit = core.memoryHierarchy->access_cache(request);
 
@@ -2105,23 +2142,21 @@ LoadStoreQueueEntry* ReorderBufferEntry::find_nearest_memory_fence() {
     bool ld = isload(uop.opcode);
     bool st = (uop.opcode == OP_st);
 
-    foreach_backward_before(thread.LSQ, lsq, i) {
-        LoadStoreQueueEntry& stbuf = thread.LSQ[i];
-
-        /* Skip over everything except fences */
-        if unlikely (!(stbuf.lfence | stbuf.sfence)) continue;
-
-        /* Skip over fences that have already completed */
-        if unlikely (stbuf.addrvalid) continue;
+    /*
+     * Fences that have not completed yet have no valid address.
+     * Do not allow loads to pass lfence or mfence.
+     * Do not allow stores to pass sfence or mfence.
+     */
+    if unlikely (!(ld | st)) return NULL;
 
-        /* Do not allow loads to pass lfence or mfence */
-        /* Do not allow stores to pass sfence or mfence */
-        bool match = (ld) ? stbuf.lfence : (st) ? stbuf.sfence : 0;
-        if unlikely (match) return &stbuf;
+    LSQIndex& lsqindex = thread.lsqindex;
+    int head = thread.LSQ.head;
+    LSQIndex::slotvec_t fences = LSQIndex::window(lsqindex.unresolved &
+            ((ld) ? lsqindex.lfences : lsqindex.sfences), head, lsq->index());
 
-        /* Loads can always pass store fences */
-        /* Stores can always pass load fences */
-    }
+    int nearest = fences.msb(-1);
+    if unlikely (nearest >= 0)
+        return &thread.LSQ[LSQIndex::slot_of(head, nearest)];
 
     return NULL;
 }
@@ -2166,6 +2201,7 @@ int ReorderBufferEntry::issuefence(LoadStoreQueueEntry& state) {
     state.datavalid = 0;
     state.addrvalid = 0;
     state.physaddr = bitmask(48-3);
+    thread.lsqindex.update(state);
 
     changestate(thread.rob_memory_fence_list);
 
@@ -2264,16 +2300,18 @@ bool OooCore::dcache_wakeup(void *arg) {
             if(rob.lsq->sfr_bytemask != 0) {
 
                 /*
-                 * Scan through all the LSQ from head to find Store that may
-                 * have the most recent data and merge all the data for this load
+                 * Go through the stores before this load near its address,
+                 * from LSQ head, to find Store that may have the most recent
+                 * data and merge all the data for this load
                  */
                 Queue<LoadStoreQueueEntry, LSQ_SIZE>& LSQ = thread->LSQ;
-                foreach_forward(LSQ, i) {
-                    LoadStoreQueueEntry& stq = LSQ[i];
-                    if unlikely (&stq == rob.lsq)
-                        break;
+                LSQIndex& lsqindex = thread->lsqindex;
+                LSQIndex::slotvec_t stores = LSQIndex::window(
+                        lsqindex.near(rob.lsq->physaddr) & lsqindex.stores,
+                        LSQ.head, rob.lsq->index());
 
-                    if likely (!stq.store) continue;
+                for (int i = stores.lsb(-1); i >= 0; i = stores.nextlsb(i, -1)) {
+                    LoadStoreQueueEntry& stq = LSQ[LSQIndex::slot_of(LSQ.head, i)];
 
                     if likely (stq.addrvalid) {
                         int addr_diff = stq.physaddr - rob.lsq->physaddr;
@@ -2388,6 +2426,7 @@ void ReorderBufferEntry::fencewakeup() {
     physreg->complete();
     lsq->datavalid = 1;
     lsq->addrvalid = 1;
+    thread.lsqindex.update(*lsq);
 
     cycles_left = 0;
     lfrqslot = -1;
@@ -2803,6 +2842,7 @@ W64 ReorderBufferEntry::annul(bool keep_misspec_uop, bool return_first_annulled_
             loads_in_flight -= (annulrob.lsq->store == 0);
             stores_in_flight -= (annulrob.lsq->store == 1);
             annulrob.lsq->reset();
+            thread.lsqindex.remove(annulrob.lsq->index());
             LSQ.annul(annulrob.lsq);
 
             /* annul any cache requests for this entry */
@@ -2928,6 +2968,7 @@ void ReorderBufferEntry::redispatch(const bitvec<MAX_OPERANDS>& dependent_operan
         lsq->virtaddr = 0;
         lsq->addrvalid = 0;
         lsq->datavalid = 0;
+        thread.lsqindex.update(*lsq);
         lsq->mbtag = -1;
         lsq->data = 0;
         lsq->invalid = 0;
@@ -276,6 +276,7 @@ void ThreadContext::flush_pipeline() {
         ROB[i].changestate(rob_free_list);
     }
     LSQ.reset();
+    lsqindex.reset();
     foreach (i, LSQ_SIZE) {
         LSQ[i].coreid = core.get_coreid();
         LSQ[i].core = &core;
@@ -629,7 +630,7 @@ bool ThreadContext::fetch() {
         assert(current_basic_block->synthops);
 
         if likely (!unaligned_ldst_buf.get(transop, synthop)) {
-            transop = current_basic_block->transops[current_basic_block_transop_index];
+            transop = current_basic_block->uops[current_basic_block_transop_index];
             synthop = current_basic_block->synthops[current_basic_block_transop_index];
         }
 
@@ -761,14 +762,15 @@ bool ThreadContext::fetch() {
  */
 BasicBlock* ThreadContext::fetch_or_translate_basic_block(const RIPVirtPhys& rvp) {
 
+    /* Follow the chain of the old basic block before releasing it */
+    BasicBlock* bb = bbcache[ctx.cpu_index].lookup(current_basic_block, rvp);
+
     if likely (current_basic_block) {
         /* Release our ref to the old basic block being fetched */
         current_basic_block->release();
         current_basic_block = NULL;
     }
 
-    BasicBlock* bb = bbcache[ctx.cpu_index](rvp);
-
     if likely (bb) {
         current_basic_block = bb;
     } else {
@@ -872,6 +874,7 @@ void ThreadContext::rename() {
             lsq.datavalid = 0;
             lsq.addrvalid = 0;
             lsq.invalid = 0;
+            lsqindex.add(lsq);
             loads_in_flight += (st == 0);
             stores_in_flight += (st == 1);
         }
@@ -1632,6 +1635,65 @@ int ThreadContext::commit() {
     return rc;
 }
 
+/**
+ * @brief Find the commit failure counter of a uop that is not ready
+ *
+ * @param rob Uop that keeps the macro-op at the ROB head from committing
+ *
+ * @return Counter of the state list rob is in, NULL for lists that have none
+ */
+StatObj<W64>* ThreadContext::commit_fail_stat(const ReorderBufferEntry& rob) {
+    const StateList* list = rob.current_state_list;
+
+    if (list == &rob_free_list) return &thread_stats.commit.fail.free_list;
+    if (list == &rob_frontend_list) return &thread_stats.commit.fail.frontend_list;
+    if (list == &rob_ready_to_dispatch_list) return &thread_stats.commit.fail.ready_to_dispatch_list;
+    if (list == &rob_cache_miss_list) return &thread_stats.commit.fail.cache_miss_list;
+    if (list == &rob_tlb_miss_list) return &thread_stats.commit.fail.tlb_miss_list;
+    if (list == &rob_memory_fence_list) return &thread_stats.commit.fail.memory_fence_list;
+
+    foreach (j, MAX_CLUSTERS) {
+        if (list == &rob_dispatched_list[j]) return &thread_stats.commit.fail.dispatched_list;
+        if (list == &rob_ready_to_issue_list[j]) return &thread_stats.commit.fail.ready_to_issue_list;
+        if (list == &rob_ready_to_store_list[j]) return &thread_stats.commit.fail.ready_to_store_list;
+        if (list == &rob_ready_to_load_list[j]) return &thread_stats.commit.fail.ready_to_load_list;
+        if (list == &rob_completed_list[j]) return &thread_stats.commit.fail.completed_list;
+        if (list == &rob_ready_to_writeback_list[j]) return &thread_stats.commit.fail.ready_to_writeback_list;
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Find the uop that keeps the ROB head from committing
+ *
+ * Repeats the scan of ReorderBufferEntry::commit() over the macro-op at the
+ * ROB head without changing any state.
+ *
+ * @return Uop that commit() reports as not ready, NULL if the ROB is empty
+ * or commit() would retire or except the head macro-op in this cycle
+ */
+ReorderBufferEntry* ThreadContext::find_commit_stall() {
+    ReorderBufferEntry* stalled = NULL;
+
+    foreach_forward(ROB, i) {
+        ReorderBufferEntry& rob = ROB[i];
+
+        if unlikely ((rob.uop.is_sse|rob.uop.is_x87) && ((ctx.cr[0] & CR0_TS_MASK) | (rob.uop.is_x87 & (ctx.cr[0] & CR0_EM_MASK))))
+            return NULL;
+
+        if (!rob.ready_to_commit()) {
+            stalled = &rob;
+        } else if unlikely ((rob.physreg->flags & FLAG_INV) && (rob.uop.opcode != OP_ast)) {
+            return NULL;
+        }
+
+        if likely (rob.uop.eom) break;
+    }
+
+    return stalled;
+}
+
 void ThreadContext::flush_mem_lock_release_list(int start) {
     for (int i = start; i < queued_mem_lock_release_count; i++) {
         W64 lockaddr = queued_mem_lock_release_list[i];
@@ -1826,37 +1888,10 @@ int ReorderBufferEntry::commit() {
     all_ready_to_commit &= found_eom;
 
     if unlikely (!all_ready_to_commit && cant_commit_subrob != NULL) {
-            thread.thread_stats.commit.result.none++;
-
-            if(cant_commit_subrob->current_state_list == &getthread().rob_free_list) {
-                    thread.thread_stats.commit.fail.free_list++;
-            } else if (cant_commit_subrob->current_state_list == &getthread().rob_frontend_list) {
-                    thread.thread_stats.commit.fail.frontend_list++;
-            } else if (cant_commit_subrob->current_state_list == &getthread().rob_ready_to_dispatch_list) {
-                    thread.thread_stats.commit.fail.ready_to_dispatch_list++;
-            } else if (cant_commit_subrob->current_state_list == &getthread().rob_cache_miss_list) {
-                    thread.thread_stats.commit.fail.cache_miss_list++;
-            } else if (cant_commit_subrob->current_state_list == &getthread().rob_tlb_miss_list) {
-                    thread.thread_stats.commit.fail.tlb_miss_list++;
-            } else if (cant_commit_subrob->current_state_list == &getthread().rob_memory_fence_list) {
-                    thread.thread_stats.commit.fail.memory_fence_list++;
-            } else {
-                    foreach(j, MAX_CLUSTERS) {
-                            if(cant_commit_subrob->current_state_list == &getthread().rob_dispatched_list[j]) {
-                                    thread.thread_stats.commit.fail.dispatched_list++;
-                            } else if (cant_commit_subrob->current_state_list == &getthread().rob_ready_to_issue_list[j]) {
-                                    thread.thread_stats.commit.fail.ready_to_issue_list++;
-                            } else if (cant_commit_subrob->current_state_list == &getthread().rob_ready_to_store_list[j]) {
-                                    thread.thread_stats.commit.fail.ready_to_store_list++;
-                            } else if (cant_commit_subrob->current_state_list == &getthread().rob_ready_to_load_list[j]) {
-                                    thread.thread_stats.commit.fail.ready_to_load_list++;
-                            } else if (cant_commit_subrob->current_state_list == &getthread().rob_completed_list[j]) {
-                                    thread.thread_stats.commit.fail.completed_list++;
-                            } else if (cant_commit_subrob->current_state_list == &getthread().rob_ready_to_writeback_list[j]) {
-                                    thread.thread_stats.commit.fail.ready_to_writeback_list++;
-                            }
-                    }
-            }
+        thread.thread_stats.commit.result.none++;
+
+        StatObj<W64>* fail = thread.commit_fail_stat(*cant_commit_subrob);
+        if (fail) (*fail)++;
 
         if(logable(5)) {
             ptl_logfile << "Can't Commit ROB entry: " << *this << " because subrob: " <<
@@ -2217,6 +2252,7 @@ int ReorderBufferEntry::commit() {
         thread.loads_in_flight -= (lsq->store == 0);
         thread.stores_in_flight -= (lsq->store == 1);
         lsq->reset();
+        thread.lsqindex.remove(lsq->index());
         thread.LSQ.commit(lsq);
         core.set_unaligned_hint(uop.rip, uop.ld_st_truly_unaligned);
     }
@@ -2273,7 +2309,7 @@ int ReorderBufferEntry::commit() {
     }
 
     if likely (uop.eom) {
-        total_insns_committed++;
+        xadd(total_insns_committed, W64(1));
         thread.thread_stats.commit.insns++;
         thread.total_insns_committed++;
 
@@ -2291,7 +2327,7 @@ int ReorderBufferEntry::commit() {
         ptl_logfile << "ROB Commit Done...\n" << flush;
     }
 
-    total_uops_committed++;
+    xadd(total_uops_committed, W64(1));
     thread.thread_stats.commit.uops++;
     thread.total_uops_committed++;
 
@@ -2307,6 +2343,7 @@ int ReorderBufferEntry::commit() {
     }
 
     if unlikely (uop_is_eom & thread.stop_at_next_eom) {
+        ParallelSharedAccess shared_access;
         ptl_logfile << "[vcpu " << thread.ctx.cpu_index << "] Stopping at cycle " << sim_cycle << " (" << total_insns_committed << " commits)" << endl;
         return COMMIT_RESULT_STOP;
     }
@@ -178,7 +178,10 @@ void ThreadContext::reset() {
     issueq_count = 0;
 #endif
     queued_mem_lock_release_count = 0;
-    branchpred.init(coreid, threadid);
+
+    /* Keep predictor state warmed up during fast-forward */
+    if (!core.machine.keep_warm_state)
+        branchpred.init(coreid, threadid);
 
     in_tlb_walk = 0;
 }
@@ -515,6 +518,117 @@ int ThreadContext::get_priority() const {
     return priority;
 }
 
+/**
+ * @brief Check if thread is only waiting for an instruction cache fill
+ *
+ * In this state the backend is empty and every pipeline stage of this thread
+ * only updates its stall counters until the icache wakes it up.
+ *
+ * @return true if thread is idle until next icache wakeup
+ */
+bool ThreadContext::is_waiting_for_icache() const {
+    return waiting_for_icache_fill && !stall_frontend &&
+        pause_counter == 0 && ROB.empty() && LSQ.empty() && fetchq.empty();
+}
+
+/**
+ * @brief Check if thread is only waiting for a load at the ROB head
+ *
+ * The ROB head is a load waiting for the memory hierarchy and no other uop
+ * can move on its own: uops wait for a cache miss, for operands in the issue
+ * queues or to commit, and uops ready to dispatch find all issue queues full.
+ * Rename is stalled by an empty fetch queue or a full ROB and fetch by a
+ * stalled frontend, an icache miss or a full fetch queue. Each cycle in this
+ * state only updates stall counters and the dispatch deadlock countdown.
+ * Issue queues are checked by OooCore::get_idle_until().
+ *
+ * @return true if thread is idle until the load at ROB head is serviced
+ */
+bool ThreadContext::is_waiting_for_dcache() {
+    if (ROB.empty() || pause_counter)
+        return false;
+
+    ReorderBufferEntry& head = ROB[ROB.head];
+    if ((head.current_state_list != &rob_cache_miss_list) ||
+            !isload(head.uop.opcode))
+        return false;
+
+    if (!rob_frontend_list.empty() || !rob_tlb_miss_list.empty() ||
+            !rob_memory_fence_list.empty())
+        return false;
+
+    for_each_cluster(cluster) {
+        if (!rob_ready_to_issue_list[cluster].empty() ||
+                !rob_ready_to_store_list[cluster].empty() ||
+                !rob_ready_to_load_list[cluster].empty() ||
+                !rob_issued_list[cluster].empty() ||
+                !rob_completed_list[cluster].empty() ||
+                !rob_ready_to_writeback_list[cluster].empty())
+            return false;
+    }
+
+    if (!rob_ready_to_dispatch_list.empty()) {
+        int free_slots[MAX_CLUSTERS];
+        core.sched_get_all_issueq_free_slots(free_slots);
+        for_each_cluster(cluster) {
+            if (free_slots[cluster])
+                return false;
+        }
+    }
+
+    if (!fetchq.empty() && ROB.remaining())
+        return false;
+
+    if (!stall_frontend && !waiting_for_icache_fill && fetchq.remaining())
+        return false;
+
+    return (find_commit_stall() != NULL);
+}
+
+/**
+ * @brief Update stats of idle cycles skipped by the core
+ *
+ * Adds what commit, writeback, dispatch, rename and fetch count in each
+ * cycle in which is_waiting_for_icache() or is_waiting_for_dcache() holds,
+ * and counts down the dispatch deadlock timer as dispatch() would.
+ *
+ * @param cycles Number of cycles skipped
+ */
+void ThreadContext::skip_cycles(W64 cycles) {
+    CORE_STATS(commit.width)[0] += cycles;
+
+    ReorderBufferEntry* stalled = find_commit_stall();
+    if (stalled) {
+        thread_stats.commit.result.none += cycles;
+
+        StatObj<W64>* fail = commit_fail_stat(*stalled);
+        if (fail) *fail += cycles;
+    }
+
+    for_each_cluster(cluster) {
+        per_cluster_stats_update(writeback.width, cluster, [0] += cycles);
+    }
+
+    CORE_STATS(dispatch.width)[0] += cycles;
+    if (!rob_ready_to_dispatch_list.empty())
+        dispatch_deadlock_countdown -= cycles;
+
+    if (fetchq.empty())
+        thread_stats.frontend.status.fetchq_empty += cycles;
+    else
+        thread_stats.frontend.status.rob_full += cycles;
+    thread_stats.frontend.width[0] += cycles;
+
+    if (stall_frontend) {
+        thread_stats.fetch.stop.stalled += cycles;
+    } else if (waiting_for_icache_fill) {
+        thread_stats.fetch.stop.icache_miss += cycles;
+    } else {
+        thread_stats.fetch.stop.fetchq_full += cycles;
+        thread_stats.fetch.width[0] += cycles;
+    }
+}
+
 /**
  * @brief Execute one cycle of the entire core state machine
  *
@@ -532,7 +646,7 @@ bool OooCore::runcycle(void* none) {
 
     foreach (i, threadcount) {
         ThreadContext* thread = threads[i];
-        bool current_interrupts_pending = thread->ctx.check_events();
+        bool current_interrupts_pending = thread->ctx.pending_events();
         thread->handle_interrupt_at_next_eom = current_interrupts_pending;
         thread->prev_interrupts_pending = current_interrupts_pending;
 
@@ -636,6 +750,7 @@ bool OooCore::runcycle(void* none) {
             thread->pause_counter--;
             if(thread->handle_interrupt_at_next_eom) {
                 commitrc[tid] = COMMIT_RESULT_INTERRUPT;
+                ParallelSharedAccess shared_access;
                 if(thread->ctx.is_int_pending()) {
                     thread->thread_stats.cycles_in_pause -=
                         thread->pause_counter;
@@ -797,6 +912,8 @@ bool OooCore::runcycle(void* none) {
             thread->ctx.page_fault_addr = thread->ctx.exec_fault_addr;
         }
 
+        ParallelSharedAccess shared_access;
+
         switch (rc) {
             case COMMIT_RESULT_SMC:
                 {
@@ -926,6 +1043,7 @@ bool OooCore::runcycle(void* none) {
         if unlikely (!thread->ctx.running) break;
 
         if unlikely ((sim_cycle - thread->last_commit_at_cycle) > (W64)1024*1024*threadcount) {
+            ParallelSharedAccess shared_access;
             stringbuf sb;
             sb << "[vcpu " << thread->ctx.cpu_index << "] thread " << thread->threadid << ": WARNING: At cycle " <<
                sim_cycle << ", " << total_insns_committed << " user commits: no instructions have committed for " <<
@@ -945,6 +1063,91 @@ bool OooCore::runcycle(void* none) {
     return exiting;
 }
 
+/**
+ * @brief Find the cycle until which this core has nothing to do
+ *
+ * Core is idle only when no interrupt is pending, no issue queue entry can
+ * issue and every running thread waits either for an icache fill with an
+ * empty backend or for a load at its ROB head. Such a core is woken up by
+ * the memory hierarchy, so the only local limits are the cycles in which the
+ * deadlock check in runcycle() or the dispatch deadlock recovery would fire.
+ *
+ * @return -1 if core waits only for memory, current cycle if it is busy
+ */
+W64 OooCore::get_idle_until() {
+    W64 idle_until = (W64)-1;
+    bool check_deadlock = true;
+
+    for_each_cluster(cluster) {
+        bool stalled = true;
+        issueq_operation_on_cluster_with_result((*this), cluster, stalled,
+                stalled());
+        if (!stalled)
+            return sim_cycle;
+    }
+
+    foreach (i, threadcount) {
+        ThreadContext* thread = threads[i];
+
+        if unlikely (thread->ctx.check_events())
+            return sim_cycle;
+
+        if unlikely (!thread->ctx.running) {
+            if (!thread->ROB.empty())
+                return sim_cycle;
+            check_deadlock = false;
+            continue;
+        }
+
+        if (thread->is_waiting_for_dcache()) {
+            if (!thread->rob_ready_to_dispatch_list.empty()) {
+                if (thread->dispatch_deadlock_countdown <= 1)
+                    return sim_cycle;
+                idle_until = min(idle_until, sim_cycle +
+                        thread->dispatch_deadlock_countdown - 1);
+            }
+        } else if likely (!thread->is_waiting_for_icache()) {
+            return sim_cycle;
+        }
+
+        if (check_deadlock) {
+            idle_until = min(idle_until, thread->last_commit_at_cycle +
+                    (W64)1024*1024*threadcount + 1);
+        }
+    }
+
+    return idle_until;
+}
+
+/**
+ * @brief Update stats of skipped idle cycles
+ *
+ * Adds the same counters that runcycle() updates in each cycle while the
+ * core is in the state detected by get_idle_until().
+ *
+ * @param cycles Number of cycles skipped
+ */
+void OooCore::skip_cycles(W64 cycles) {
+    foreach (i, threadcount) {
+        ThreadContext* thread = threads[i];
+        thread->handle_interrupt_at_next_eom = 0;
+        thread->prev_interrupts_pending = 0;
+
+        if unlikely (!thread->ctx.running) continue;
+
+        thread->skip_cycles(cycles);
+    }
+
+    for_each_cluster(cluster) {
+        per_cluster_stats_update(issue.width, cluster, [0] += cycles);
+    }
+
+    round_robin_tid = add_index_modulo(round_robin_tid, cycles % threadcount,
+            threadcount);
+
+    core_stats.cycles += cycles;
+}
+
 /*
  * ReorderBufferEntry
  */
@@ -1594,6 +1797,50 @@ void OooCore::flush_tlb_virt(Context& ctx, Waddr virtaddr) {
     /* FIXME AVADH DEFCORE */
 }
 
+bool OooCore::get_context_thread(Context& ctx, W8& threadid) {
+    foreach(i, threadcount) {
+        if(threads[i]->ctx.cpu_index == ctx.cpu_index) {
+            threadid = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+void OooCore::warm_tlb(W8 threadid, Waddr virtaddr, bool is_code) {
+    ThreadContext* thread = threads[threadid];
+
+    if(is_code) {
+        thread->itlb.insert(virtaddr, threadid);
+    } else {
+        thread->dtlb.insert(virtaddr, threadid);
+    }
+}
+
+void OooCore::warm_branch(W8 threadid, int type, W64 ripafter, W64 target) {
+    threads[threadid]->branchpred.warm(type, ripafter, target);
+}
+
+void OooCore::save_warm_state(ostream& os) {
+    foreach(i, threadcount) {
+        ThreadContext* thread = threads[i];
+        save_warm_block(os, thread->dtlb);
+        save_warm_block(os, thread->itlb);
+        thread->branchpred.save_state(os);
+    }
+}
+
+bool OooCore::restore_warm_state(istream& is) {
+    foreach(i, threadcount) {
+        ThreadContext* thread = threads[i];
+        if(!restore_warm_block(is, thread->dtlb) ||
+                !restore_warm_block(is, thread->itlb) ||
+                !thread->branchpred.restore_state(is))
+            return false;
+    }
+    return true;
+}
+
 void OooCore::check_ctx_changes()
 {
     foreach(i, threadcount) {
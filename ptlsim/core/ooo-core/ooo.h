@@ -412,6 +412,7 @@ namespace OOO_CORE_MODEL {
             void reset(W8 coreid, OooCore* core);
             void reset(W8 coreid, W8 threadid, OooCore* core);
             void clock();
+            bool stalled() const;
             bool insert(tag_t uopid, const tag_t* operands, const tag_t* preready);
             bool broadcast(tag_t uopid);
             int issue(int previd = -1);
@@ -654,6 +655,134 @@ namespace OOO_CORE_MODEL {
         return lsq.print(os);
     }
 
+    /**
+     * @brief Address index of the LSQ used by load forwarding, memory
+     * disambiguation and fence searches
+     *
+     * LSQ entries are hashed by the low 32 bits of their 8-byte block
+     * address, the bits compared by the LSQ searches, so entries within one
+     * block of an address are found without walking the queue. Store, fence
+     * and unresolved store slots are kept in bitmaps. Searches select slots
+     * with window(), which also orders them by age, and then check the LSQ
+     * entries themselves.
+     *
+     * The index must be updated with update() every time physaddr or
+     * addrvalid of an LSQ entry changes; addrgen() leaves it to its callers
+     * (issueload(), issuestore() and probetlb()) as it's also used on
+     * entries outside the LSQ.
+     */
+    struct LSQIndex {
+        typedef bitvec<LSQ_SIZE> slotvec_t;
+
+        enum { BUCKETS = 128 };
+
+        slotvec_t stores;       // Store and fence slots
+        slotvec_t lfences;
+        slotvec_t sfences;
+        slotvec_t unresolved;   // Store slots without valid address
+
+        LSQIndex() { reset(); }
+
+        void reset() {
+            stores.reset();
+            lfences.reset();
+            sfences.reset();
+            unresolved.reset();
+            foreach (i, BUCKETS) bucket[i] = -1;
+            foreach (i, LSQ_SIZE) bucketof[i] = -1;
+        }
+
+        /* Entry is allocated at dispatch */
+        void add(const LoadStoreQueueEntry& lsq) {
+            int slot = lsq.index();
+            stores[slot] = lsq.store;
+            lfences[slot] = lsq.lfence;
+            sfences[slot] = lsq.sfence;
+            update(lsq);
+        }
+
+        /* Entry is committed or annulled */
+        void remove(int slot) {
+            stores[slot] = 0;
+            lfences[slot] = 0;
+            sfences[slot] = 0;
+            unresolved[slot] = 0;
+            unhash(slot);
+        }
+
+        void update(const LoadStoreQueueEntry& lsq) {
+            int slot = lsq.index();
+            unresolved[slot] = (lsq.store & (!lsq.addrvalid));
+
+            W32 k = lsq.physaddr;
+            if (bucketof[slot] >= 0 && key[slot] == k) return;
+
+            unhash(slot);
+            int b = k % BUCKETS;
+            key[slot] = k;
+            bucketof[slot] = b;
+            prev[slot] = -1;
+            next[slot] = bucket[b];
+            if (bucket[b] >= 0) prev[bucket[b]] = slot;
+            bucket[b] = slot;
+        }
+
+        /*
+         * Slots whose physaddr is within one 8-byte block of physaddr, in
+         * the same 32-bit wrapping as the LSQ address compare.
+         */
+        slotvec_t near(W64 physaddr) const {
+            slotvec_t slots;
+            W32 k = physaddr;
+
+            for (int d = -1; d <= 1; d++) {
+                W32 nk = k + d;
+                for (int s = bucket[nk % BUCKETS]; s >= 0; s = next[s]) {
+                    if (key[s] == nk) slots[s] = 1;
+                }
+            }
+
+            return slots;
+        }
+
+        /*
+         * Slots of set from slot 'from' up to but not including slot 'to'
+         * in queue order. Bit i of the result is slot (from + i) % LSQ_SIZE,
+         * so lower bits are older entries.
+         */
+        static slotvec_t window(const slotvec_t& set, int from, int to) {
+            int count = (to - from + LSQ_SIZE) % LSQ_SIZE;
+            slotvec_t rotated = (set >> from) | (set << (LSQ_SIZE - from));
+
+            /* Not rotated % count, mask() keeps a whole extra word when
+             * count is a multiple of the word size */
+            slotvec_t all;
+            all.setall();
+            return rotated & ~(all << count);
+        }
+
+        static int slot_of(int from, int offset) {
+            return (from + offset) % LSQ_SIZE;
+        }
+
+        private:
+            W32 key[LSQ_SIZE];
+            W16s bucketof[LSQ_SIZE];
+            W16s prev[LSQ_SIZE];
+            W16s next[LSQ_SIZE];
+            W16s bucket[BUCKETS];
+
+            void unhash(int slot) {
+                int b = bucketof[slot];
+                if (b < 0) return;
+
+                if (prev[slot] >= 0) next[prev[slot]] = next[slot];
+                else bucket[b] = next[slot];
+                if (next[slot] >= 0) prev[next[slot]] = prev[slot];
+                bucketof[slot] = -1;
+            }
+    };
+
     struct PhysicalRegisterOperandInfo {
         W32 uuid;
         W16 physreg;
@@ -993,6 +1122,7 @@ namespace OOO_CORE_MODEL {
         Queue<ReorderBufferEntry, ROB_SIZE> ROB;
 
         Queue<LoadStoreQueueEntry, LSQ_SIZE> LSQ;
+        LSQIndex lsqindex;
         RegisterRenameTable specrrt;
         RegisterRenameTable commitrrt;
 
@@ -1080,6 +1210,11 @@ namespace OOO_CORE_MODEL {
         void redispatch_deadlock_recovery();
         void flush_mem_lock_release_list(int start = 0);
         int get_priority() const;
+        bool is_waiting_for_icache() const;
+        bool is_waiting_for_dcache();
+        ReorderBufferEntry* find_commit_stall();
+        StatObj<W64>* commit_fail_stat(const ReorderBufferEntry& rob);
+        void skip_cycles(W64 cycles);
 
         void dump_smt_state(ostream& os);
         void print_smt_state(ostream& os);
@@ -1257,6 +1392,8 @@ namespace OOO_CORE_MODEL {
 
 		/* Pipeline Stages */
         bool runcycle(void*);
+        W64 get_idle_until();
+        void skip_cycles(W64 cycles);
         void flush_pipeline();
         bool fetch();
         void rename();
@@ -1271,6 +1408,13 @@ namespace OOO_CORE_MODEL {
         void flush_tlb(Context& ctx);
         void flush_tlb_virt(Context& ctx, Waddr virtaddr);
 
+        /* Functional warming */
+        bool get_context_thread(Context& ctx, W8& threadid);
+        void warm_tlb(W8 threadid, Waddr virtaddr, bool is_code);
+        void warm_branch(W8 threadid, int type, W64 ripafter, W64 target);
+        void save_warm_state(ostream& os);
+        bool restore_warm_state(istream& is);
+
 		/* Cache Signals and Callbacks */
         Signal dcache_signal;
         Signal icache_signal;
@@ -19,6 +19,7 @@ inline vec8w x86_sse_ldvwu(const vec8w* m) {
 	return rd;
 }
 //inline vec8w x86_sse_ldvwu(const vec8w* m) { vec8w rd; asm("movdqu %[rd], %[m]" : [rd] "=x" (rd) : [m] "xm" (*m)); return rd; }
+inline vec4i x86_sse_ldvdu(const vec4i* m) { vec4i rd; asm("movdqu %[m],%[rd]" : [rd] "=x" (rd) : [m] "m" (*m)); return rd; }
 inline void x86_sse_stvwu(vec8w* m, const vec8w ra) { asm("movdqu %[ra],%[m]" : [m] "=m" (*m) : [ra] "x" (ra) : "memory"); }
 
 extern ofstream ptl_logfile;
@@ -436,6 +437,20 @@ struct FullyAssociativeTags {
     return select(target, dummy);
   }
 
+  //
+  // Interface used by AssociativeArray for all replacement policies,
+  // the pseudo-LRU evictmap has no state shared between sets.
+  //
+  template <typename S>
+  int probe(T target, S& shared, int set) {
+    return probe(target);
+  }
+
+  template <typename S>
+  int select(T target, T& oldtag, S& shared, int set) {
+    return select(target, oldtag);
+  }
+
   void invalidate_way(int way) {
     tags[way] = INVALID;
     evictmap[way] = 0;
@@ -490,6 +505,25 @@ stringbuf& operator <<(stringbuf& sb, const FullyAssociativeTags<T, ways>& tags)
   return tags.print(sb);
 }
 
+//
+// Replacement policy of associative arrays. A policy gives the tags type
+// of each set and the state shared by all sets of an array. The default
+// is the evictmap pseudo-LRU of FullyAssociativeTags, other policies are
+// in replacement.h.
+//
+struct PseudoLRUReplacement {
+  struct Shared {
+    void reset() { }
+  };
+
+  template <typename T, int ways>
+  struct Tags {
+    typedef FullyAssociativeTags<T, ways> type;
+  };
+
+  static const char* name() { return "plru"; }
+};
+
 //
 // Associative array implemented using vectorized
 // comparisons spread across multiple byte slices
@@ -543,6 +577,8 @@ struct FullyAssociativeTagsNbitOneHot {
   }
 
   int match(const vec16b* targetslices) const {
+    if likely (x86_host_avx2) return match_avx2(targetslices);
+
     vec16b sum = x86_sse_zerob();
 
     foreach (i, chunkcount) {
@@ -558,6 +594,36 @@ struct FullyAssociativeTagsNbitOneHot {
     return idx-1;
   }
 
+  // Same as match() with two chunks per compare, without the size limit
+  avx2_target int match_avx2(const vec16b* targetslices) const {
+    bitvec<(chunkcount*16)> m = 0;
+    vec32b t[slices];
+
+    foreach (j, slices) t[j] = x86_avx_dupb(targetslices[j]);
+
+    int i = 0;
+    for (; i + 2 <= chunkcount; i += 2) {
+      vec32b eq = x86_avx_onesb();
+      foreach (j, slices) {
+        eq = x86_avx_pandb(x86_avx_pcmpeqb(x86_avx_ldvb(&tags[j][i]), t[j]), eq);
+      }
+      m = m.accum(i*16, 32, x86_avx_pmovmskb(eq));
+    }
+
+    x86_avx_zeroupper();
+
+    if (i < chunkcount) {
+      vec16b eq = x86_sse_onesb();
+      foreach (j, slices) {
+        eq = x86_sse_pandb(x86_sse_pcmpeqb(tags[j][i], targetslices[j]), eq);
+      }
+      m = m.accum(i*16, 16, x86_sse_pmovmskb(eq));
+    }
+
+    int idx = m.lsb(-1);
+    return (idx < size) ? idx : -1;
+  }
+
   static void prep(vec16b* targetslices, base_t tag) {
     foreach (i, slices) {
       targetslices[i] = x86_sse_dupb((byte)tag);
@@ -745,9 +811,9 @@ struct NullAssociativeArrayStatisticsCollector {
   static void invalidated(V& elem, T oldtag, int way) { }
 };
 
-template <typename T, typename V, int ways, typename stats = NullAssociativeArrayStatisticsCollector<T, V> >
+template <typename T, typename V, int ways, typename stats = NullAssociativeArrayStatisticsCollector<T, V>, typename tags_t = FullyAssociativeTags<T, ways> >
 struct FullyAssociativeArray {
-  FullyAssociativeTags<T, ways> tags;
+  tags_t tags;
   V data[ways];
 
   FullyAssociativeArray() {
@@ -772,7 +838,32 @@ struct FullyAssociativeArray {
 
   V* select(T tag, T& oldtag) {
     int way = tags.select(tag, oldtag);
+    return selected(way, tag, oldtag);
+  }
+
+  V* select(T tag) {
+    T dummy;
+    return select(tag, dummy);
+  }
+
+  //
+  // Probe and select with replacement state shared by all sets of an
+  // AssociativeArray, 'set' is the index of this set in the array.
+  //
+  template <typename S>
+  V* probe(T tag, S& shared, int set) {
+    int way = tags.probe(tag, shared, set);
+    stats::probed((way < 0) ? data[0] : data[way], tag, way, (way >= 0));
+    return (way < 0) ? NULL : &data[way];
+  }
 
+  template <typename S>
+  V* select(T tag, T& oldtag, S& shared, int set) {
+    int way = tags.select(tag, oldtag, shared, set);
+    return selected(way, tag, oldtag);
+  }
+
+  V* selected(int way, T tag, T oldtag) {
     V& slot = data[way];
 
     if ((way >= 0) & (tag == oldtag)) {
@@ -786,11 +877,6 @@ struct FullyAssociativeArray {
     return &slot;
   }
 
-  V* select(T tag) {
-    T dummy;
-    return select(tag, dummy);
-  }
-
   int wayof(const V* line) const {
     int way = (line - (const V*)&data);
 #if 0
@@ -837,14 +923,16 @@ struct FullyAssociativeArray {
   }
 };
 
-template <typename T, typename V, int ways>
-ostream& operator <<(ostream& os, const FullyAssociativeArray<T, V, ways>& assoc) {
+template <typename T, typename V, int ways, typename stats, typename tags_t>
+ostream& operator <<(ostream& os, const FullyAssociativeArray<T, V, ways, stats, tags_t>& assoc) {
   return assoc.print(os);
 }
 
-template <typename T, typename V, int setcount, int waycount, int linesize, typename stats = NullAssociativeArrayStatisticsCollector<T, V> >
-struct AssociativeArray {
-  typedef FullyAssociativeArray<T, V, waycount, stats> Set;
+template <typename T, typename V, int setcount, int waycount, int linesize, typename stats = NullAssociativeArrayStatisticsCollector<T, V>, typename repl = PseudoLRUReplacement>
+struct AssociativeArray: public repl::Shared {
+  typedef FullyAssociativeArray<T, V, waycount, stats,
+          typename repl::template Tags<T, waycount>::type> Set;
+  typedef typename repl::Shared Shared;
   Set sets[setcount];
 
   AssociativeArray() {
@@ -855,8 +943,12 @@ struct AssociativeArray {
     foreach (set, setcount) {
       sets[set].reset();
     }
+    Shared::reset();
   }
 
+  // Replacement state shared by all sets, takes no space if it's empty
+  Shared& shared() { return *this; }
+
   static int setof(T addr) {
     return bits(addr, log2(linesize), log2(setcount));
   }
@@ -866,7 +958,8 @@ struct AssociativeArray {
   }
 
   V* probe(T addr) {
-    return sets[setof(addr)].probe(tagof(addr));
+    int set = setof(addr);
+    return sets[set].probe(tagof(addr), shared(), set);
   }
 
   V* match(T addr) {
@@ -874,12 +967,13 @@ struct AssociativeArray {
   }
 
   V* select(T addr, T& oldaddr) {
-    return sets[setof(addr)].select(tagof(addr), oldaddr);
+    int set = setof(addr);
+    return sets[set].select(tagof(addr), oldaddr, shared(), set);
   }
 
   V* select(T addr) {
     T dummy;
-    return sets[setof(addr)].select(tagof(addr), dummy);
+    return select(addr, dummy);
   }
 
   int invalidate(T addr) {
@@ -896,8 +990,8 @@ struct AssociativeArray {
   }
 };
 
-template <typename T, typename V, int size, int ways, int linesize>
-ostream& operator <<(ostream& os, const AssociativeArray<T, V, size, ways, linesize>& aa) {
+template <typename T, typename V, int size, int ways, int linesize, typename stats, typename repl>
+ostream& operator <<(ostream& os, const AssociativeArray<T, V, size, ways, linesize, stats, repl>& aa) {
   return aa.print(os);
 }
 
@@ -1601,6 +1695,8 @@ struct FullyAssociativeTags8bit {
   }
 
   bitvec<size> match(const vec_t target) const {
+    if likely (x86_host_avx2) return match_avx2(target);
+
     bitvec<size> m = 0;
 
     foreach (i, chunkcount) {
@@ -1610,6 +1706,25 @@ struct FullyAssociativeTags8bit {
     return m & valid;
   }
 
+  // Same as match() with two chunks per compare
+  avx2_target bitvec<size> match_avx2(const vec_t target) const {
+    bitvec<size> m = 0;
+    vec32b t = x86_avx_dupb(target);
+
+    int i = 0;
+    for (; i + 2 <= chunkcount; i += 2) {
+      m = m.accum(i*16, 32, x86_avx_pmovmskb(x86_avx_pcmpeqb(t, x86_avx_ldvb(&tags[i]))));
+    }
+
+    x86_avx_zeroupper();
+
+    if (i < chunkcount) {
+      m = m.accum(i*16, 16, x86_sse_pmovmskb(x86_sse_pcmpeqb(target, tags[i])));
+    }
+
+    return m & valid;
+  }
+
   bitvec<size> match(base_t target) const {
     return match(prep(target));
   }
@@ -1763,6 +1878,8 @@ struct FullyAssociativeTags16bit {
   }
 
   bitvec<size> match(const vec_t target) const {
+    if likely (x86_host_avx2) return match_avx2(target);
+
     bitvec<size> m = 0;
 
     foreach (i, chunkcount) {
@@ -1772,6 +1889,27 @@ struct FullyAssociativeTags16bit {
     return m & valid;
   }
 
+  // Same as match() with four chunks per mask
+  avx2_target bitvec<size> match_avx2(const vec_t target) const {
+    bitvec<size> m = 0;
+    vec16w t = x86_avx_dupw(target);
+
+    int i = 0;
+    for (; i + 4 <= chunkcount; i += 4) {
+      vec16w lo = x86_avx_pcmpeqw(t, x86_avx_ldvw(&tags[i]));
+      vec16w hi = x86_avx_pcmpeqw(t, x86_avx_ldvw(&tags[i+2]));
+      m = m.accum(i*8, 32, x86_avx_pmovmskw(lo, hi));
+    }
+
+    x86_avx_zeroupper();
+
+    for (; i < chunkcount; i++) {
+      m = m.accum(i*8, 8, x86_sse_pmovmskw(x86_sse_pcmpeqw(target, tags[i])));
+    }
+
+    return m & valid;
+  }
+
   bitvec<size> match(base_t target) const {
     return match(prep(target));
   }
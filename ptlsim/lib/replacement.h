@@ -0,0 +1,428 @@
+// -*- c++ -*-
+//
+// Replacement Policies for Associative Arrays
+//
+
+#ifndef _REPLACEMENT_H_
+#define _REPLACEMENT_H_
+
+#include <logic.h>
+
+//
+// Tags of one set with a replacement policy other than the default
+// pseudo-LRU evictmap. Invalid ways are always filled first, otherwise
+// the policy's per-set state picks the victim. The policy's State gets
+// the state shared by all sets of the array and the set index, which is
+// used for set dueling.
+//
+// A policy provides:
+//
+//   struct Shared { void reset(); };
+//   template <int ways> struct State {
+//     void reset();
+//     void hit(int way, Shared& shared, int set);
+//     int victim(Shared& shared, int set);
+//     void evict(int way, Shared& shared, int set);
+//     void insert(int way, W64 tag, Shared& shared, int set);
+//     void invalidate(int way);
+//   };
+//
+
+template <typename T, int ways, typename policy>
+struct ReplacementTags {
+  typename policy::template State<ways> state;
+  T tags[ways];
+
+  static const T INVALID = InvalidTag<T>::INVALID;
+
+  ReplacementTags() {
+    reset();
+  }
+
+  void reset() {
+    state.reset();
+    foreach (i, ways) {
+      tags[i] = INVALID;
+    }
+  }
+
+  // Same branch-free matching as FullyAssociativeTags
+  int match(T target) {
+    int way = 0;
+    foreach (i, ways) {
+      way += (tags[i] == target) ? (i + 1) : 0;
+    }
+
+    return way - 1;
+  }
+
+  // Lookup without updating replacement state
+  int probe(T target) {
+    return match(target);
+  }
+
+  template <typename S>
+  int probe(T target, S& shared, int set) {
+    int way = match(target);
+    if (way >= 0) state.hit(way, shared, set);
+    return way;
+  }
+
+  template <typename S>
+  int select(T target, T& oldtag, S& shared, int set) {
+    int way = match(target);
+    if (way >= 0) {
+      state.hit(way, shared, set);
+      return way;
+    }
+
+    foreach (i, ways) {
+      if (tags[i] == INVALID) {
+        way = i;
+        break;
+      }
+    }
+
+    if (way < 0) {
+      way = state.victim(shared, set);
+      state.evict(way, shared, set);
+    }
+
+    oldtag = tags[way];
+    tags[way] = target;
+    state.insert(way, W64(target), shared, set);
+    return way;
+  }
+
+  void invalidate_way(int way) {
+    tags[way] = INVALID;
+    state.invalidate(way);
+  }
+
+  int invalidate(T target) {
+    int way = match(target);
+    if (way < 0) return -1;
+    invalidate_way(way);
+    return way;
+  }
+
+  const T& operator [](int index) const { return tags[index]; }
+
+  T& operator [](int index) { return tags[index]; }
+
+  stringbuf& printway(stringbuf& os, int i) const {
+    os << "  way " << intstring(i, -2) << ": ";
+    if (tags[i] != INVALID) {
+      os << "tag 0x" << hexstring(tags[i], sizeof(T)*8);
+    } else {
+      os << "<invalid>";
+    }
+    return os;
+  }
+
+  stringbuf& print(stringbuf& os) const {
+    foreach (i, ways) {
+      printway(os, i);
+      os << endl;
+    }
+    return os;
+  }
+
+  ostream& print(ostream& os) const {
+    stringbuf sb;
+    print(sb);
+    os << sb;
+    return os;
+  }
+};
+
+//
+// Base of policies that use ReplacementTags
+//
+template <typename policy>
+struct ReplacementPolicy {
+  template <typename T, int ways>
+  struct Tags {
+    typedef ReplacementTags<T, ways, policy> type;
+  };
+};
+
+struct EmptyReplacementState {
+  void reset() { }
+};
+
+//
+// True LRU: each way keeps its position in the recency stack,
+// 0 being the most recently used.
+//
+struct LRUReplacement: public ReplacementPolicy<LRUReplacement> {
+  typedef EmptyReplacementState Shared;
+
+  template <int ways>
+  struct State {
+    W8 age[ways];
+
+    void reset() {
+      foreach (i, ways) age[i] = i;
+    }
+
+    void touch(int way) {
+      W8 old = age[way];
+      foreach (i, ways) {
+        age[i] += (age[i] < old);
+      }
+      age[way] = 0;
+    }
+
+    void hit(int way, Shared& shared, int set) { touch(way); }
+
+    int victim(Shared& shared, int set) {
+      foreach (i, ways) {
+        if (age[i] == ways - 1) return i;
+      }
+      return 0;
+    }
+
+    void evict(int way, Shared& shared, int set) { }
+
+    void insert(int way, W64 tag, Shared& shared, int set) { touch(way); }
+
+    void invalidate(int way) {
+      W8 old = age[way];
+      foreach (i, ways) {
+        age[i] -= (age[i] > old);
+      }
+      age[way] = ways - 1;
+    }
+  };
+
+  static const char* name() { return "lru"; }
+};
+
+//
+// Re-Reference Interval Prediction (Jaleel et al., ISCA 2010). Each way has
+// a 2-bit re-reference prediction value (RRPV), hits predict a near
+// re-reference and the victim is a way with distant (maximum) RRPV. Policies
+// differ in the RRPV given to new lines.
+//
+enum { RRPV_MAX = 3 };
+
+template <int ways>
+struct RRIPState {
+  W8 rrpv[ways];
+
+  void reset() {
+    foreach (i, ways) rrpv[i] = RRPV_MAX;
+  }
+
+  void hit(int way) {
+    rrpv[way] = 0;
+  }
+
+  // Aging all ways until one reaches RRPV_MAX is done in one step
+  int victim() {
+    W8 oldest = 0;
+    int way = 0;
+    foreach (i, ways) {
+      if (rrpv[i] > oldest) {
+        oldest = rrpv[i];
+        way = i;
+      }
+    }
+
+    W8 delta = RRPV_MAX - oldest;
+    if (delta) {
+      foreach (i, ways) rrpv[i] += delta;
+    }
+    return way;
+  }
+
+  void invalidate(int way) {
+    rrpv[way] = RRPV_MAX;
+  }
+};
+
+// Static RRIP, new lines get a long re-reference interval
+struct SRRIPReplacement: public ReplacementPolicy<SRRIPReplacement> {
+  typedef EmptyReplacementState Shared;
+
+  template <int ways>
+  struct State: public RRIPState<ways> {
+    typedef RRIPState<ways> base_t;
+
+    void hit(int way, Shared& shared, int set) { base_t::hit(way); }
+    int victim(Shared& shared, int set) { return base_t::victim(); }
+    void evict(int way, Shared& shared, int set) { }
+
+    void insert(int way, W64 tag, Shared& shared, int set) {
+      base_t::rrpv[way] = RRPV_MAX - 1;
+    }
+  };
+
+  static const char* name() { return "srrip"; }
+};
+
+//
+// Bimodal RRIP, new lines get a distant re-reference interval except one
+// in every BRRIP_EPSILON insertions, which protects against thrashing.
+//
+enum { BRRIP_EPSILON = 32 };
+
+struct BRRIPShared {
+  W32 inserts;
+
+  void reset() { inserts = 0; }
+
+  W8 insert_rrpv() {
+    return ((inserts++ % BRRIP_EPSILON) == 0) ? RRPV_MAX - 1 : RRPV_MAX;
+  }
+};
+
+struct BRRIPReplacement: public ReplacementPolicy<BRRIPReplacement> {
+  typedef BRRIPShared Shared;
+
+  template <int ways>
+  struct State: public RRIPState<ways> {
+    typedef RRIPState<ways> base_t;
+
+    void hit(int way, Shared& shared, int set) { base_t::hit(way); }
+    int victim(Shared& shared, int set) { return base_t::victim(); }
+    void evict(int way, Shared& shared, int set) { }
+
+    void insert(int way, W64 tag, Shared& shared, int set) {
+      base_t::rrpv[way] = shared.insert_rrpv();
+    }
+  };
+
+  static const char* name() { return "brrip"; }
+};
+
+//
+// Dynamic RRIP with set dueling. In every group of 32 sets one leader set
+// always uses SRRIP and one always uses BRRIP. Misses in the leader sets
+// move a saturating counter (PSEL) and the follower sets use the policy
+// with fewer misses.
+//
+enum { DRRIP_PSEL_MAX = 1023 };
+
+struct DRRIPShared: public BRRIPShared {
+  W16 psel;
+
+  void reset() {
+    BRRIPShared::reset();
+    psel = (DRRIP_PSEL_MAX + 1) / 2;
+  }
+
+  // 1 for SRRIP leader sets, -1 for BRRIP leader sets, 0 for followers
+  static int leader(int set) {
+    int group = (set >> 5) & 31;
+    int offset = set & 31;
+    if (offset == group) return 1;
+    if (offset == (~group & 31)) return -1;
+    return 0;
+  }
+
+  bool use_brrip(int set) {
+    int lead = leader(set);
+    if (lead) return lead < 0;
+    return psel > DRRIP_PSEL_MAX / 2;
+  }
+};
+
+struct DRRIPReplacement: public ReplacementPolicy<DRRIPReplacement> {
+  typedef DRRIPShared Shared;
+
+  template <int ways>
+  struct State: public RRIPState<ways> {
+    typedef RRIPState<ways> base_t;
+
+    void hit(int way, Shared& shared, int set) { base_t::hit(way); }
+    int victim(Shared& shared, int set) { return base_t::victim(); }
+    void evict(int way, Shared& shared, int set) { }
+
+    // Every insertion follows a miss
+    void insert(int way, W64 tag, Shared& shared, int set) {
+      int lead = Shared::leader(set);
+      if (lead > 0 && shared.psel < DRRIP_PSEL_MAX) shared.psel++;
+      if (lead < 0 && shared.psel > 0) shared.psel--;
+
+      base_t::rrpv[way] = shared.use_brrip(set) ? shared.insert_rrpv() :
+        RRPV_MAX - 1;
+    }
+  };
+
+  static const char* name() { return "drrip"; }
+};
+
+//
+// Signature-based Hit Predictor (Wu et al., MICRO 2011) on top of SRRIP,
+// using the memory region of a line as its signature (SHiP-Mem). A table of
+// 3-bit counters learns if lines of a region are re-referenced, lines of
+// regions without reuse are inserted with a distant re-reference interval.
+//
+enum {
+  SHIP_TABLE_BITS = 14,
+  SHIP_REGION_BITS = 14,  // 16KB regions
+  SHIP_COUNTER_MAX = 7,
+};
+
+struct SHiPShared {
+  W8 shct[1 << SHIP_TABLE_BITS];
+
+  void reset() {
+    foreach (i, (1 << SHIP_TABLE_BITS)) shct[i] = 1;
+  }
+
+  static W16 signature(W64 tag) {
+    W64 region = tag >> SHIP_REGION_BITS;
+    return (region ^ (region >> SHIP_TABLE_BITS) ^
+        (region >> (2 * SHIP_TABLE_BITS))) &
+      ((1 << SHIP_TABLE_BITS) - 1);
+  }
+};
+
+struct SHiPReplacement: public ReplacementPolicy<SHiPReplacement> {
+  typedef SHiPShared Shared;
+
+  template <int ways>
+  struct State: public RRIPState<ways> {
+    typedef RRIPState<ways> base_t;
+    W16 sig[ways];
+    bitvec<ways> reused;
+
+    void reset() {
+      base_t::reset();
+      foreach (i, ways) sig[i] = 0;
+      reused = 0;
+    }
+
+    void hit(int way, Shared& shared, int set) {
+      base_t::hit(way);
+      reused[way] = 1;
+      W8& counter = shared.shct[sig[way]];
+      if (counter < SHIP_COUNTER_MAX) counter++;
+    }
+
+    int victim(Shared& shared, int set) { return base_t::victim(); }
+
+    void evict(int way, Shared& shared, int set) {
+      W8& counter = shared.shct[sig[way]];
+      if (!reused[way] && counter > 0) counter--;
+    }
+
+    void insert(int way, W64 tag, Shared& shared, int set) {
+      sig[way] = Shared::signature(tag);
+      reused[way] = 0;
+      base_t::rrpv[way] = shared.shct[sig[way]] ? RRPV_MAX - 1 : RRPV_MAX;
+    }
+
+    void invalidate(int way) {
+      base_t::invalidate(way);
+      reused[way] = 0;
+    }
+  };
+
+  static const char* name() { return "ship"; }
+};
+
+#endif // _REPLACEMENT_H_
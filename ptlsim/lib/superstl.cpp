@@ -1341,6 +1341,14 @@ const byte index_bytes_plus1_vec16b[16][16] alignto(16) = {
     {0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa, 0xfb, 0xfc, 0xfd, 0xfe, 0xff, 0x00}, // element 255 not valid!
 };
 
+static bool host_supports_avx2() {
+  // Runs before main, so the CPU model must be probed first
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+}
+
+bool x86_host_avx2 = host_supports_avx2();
+
 const W64 expand_8bit_to_64bit_lut[256] alignto(8) = {
   0x0000000000000000ULL,   0x00000000000000ffULL,   0x000000000000ff00ULL,   0x000000000000ffffULL,
   0x0000000000ff0000ULL,   0x0000000000ff00ffULL,   0x0000000000ffff00ULL,   0x0000000000ffffffULL,
@@ -1797,7 +1797,7 @@ namespace superstl {
     }
 
     void accumop(size_t i, size_t n, T v) {
-      w[wordof(i)] |= (v << i);
+      w[wordof(i)] |= (v << bitof(i));
 
       if unlikely ((bitof(i) + n) > BITS_PER_WORD)
         w[wordof(i+1)] |= (v >> (BITS_PER_WORD - bitof(i)));
@@ -0,0 +1,69 @@
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * This code is released under GPL.
+ *
+ */
+
+#include <bbv.h>
+
+BBVProfiler::BBVProfiler(ostream& os, W64 interval)
+    : os_(os)
+    , interval_(interval)
+    , intervalInsns_(0)
+    , intervals_(0)
+    , nextId_(1)
+{
+    assert(interval > 0);
+    counts_.push(0);
+}
+
+/**
+ * @brief Get the id of a basic block, assign a new one if it is not seen
+ *
+ * @param key Unique key of the basic block, like its physical address
+ */
+int BBVProfiler::block_id(W64 key)
+{
+    int* id = ids_.get(key);
+    if likely (id)
+        return *id;
+
+    ids_.add(key, nextId_);
+    counts_.push(0);
+    return nextId_++;
+}
+
+/**
+ * @brief Count instructions executed in a basic block
+ *
+ * @param bbid Block id from block_id()
+ * @param insns Number of instructions in the block
+ */
+void BBVProfiler::count(int bbid, W64 insns)
+{
+    assert(bbid > 0 && bbid < nextId_);
+
+    if (counts_[bbid] == 0)
+        touched_.push(bbid);
+    counts_[bbid] += insns;
+
+    intervalInsns_ += insns;
+    if unlikely (intervalInsns_ >= interval_)
+        write_interval();
+}
+
+void BBVProfiler::write_interval()
+{
+    os_ << "T";
+    foreach (i, touched_.count()) {
+        int bbid = touched_[i];
+        os_ << ":" << bbid << ":" << counts_[bbid] << " ";
+        counts_[bbid] = 0;
+    }
+    os_ << endl;
+
+    touched_.clear();
+    intervalInsns_ = 0;
+    intervals_++;
+}
@@ -0,0 +1,56 @@
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * This code is released under GPL.
+ *
+ */
+
+#ifndef BBV_H
+#define BBV_H
+
+#include <globals.h>
+#include <superstl.h>
+
+/**
+ * @brief Collect basic block vectors for SimPoint analysis
+ *
+ * Every basic block gets an id, starting from 1, the first time it is seen.
+ * Instructions executed in each block are counted and at the end of every
+ * interval the vector of non-zero counts is written in SimPoint's frequency
+ * vector format, one line per interval:
+ *
+ *   T:<id>:<instructions> :<id>:<instructions> ...
+ *
+ * Counting is done per block, so an interval ends at the first block
+ * boundary after the interval length is reached, the same way simpoint
+ * counters expire in emulation.
+ */
+class BBVProfiler {
+    public:
+        BBVProfiler(ostream& os, W64 interval);
+
+        int block_id(W64 key);
+        void count(int bbid, W64 insns);
+
+        W64 get_intervals() const { return intervals_; }
+        int get_blocks() const { return nextId_ - 1; }
+
+    private:
+        ostream& os_;
+        W64 interval_;
+        W64 intervalInsns_;
+        W64 intervals_;
+        int nextId_;
+
+        Hashtable<W64, int, 1 << 14> ids_;
+
+        /* Instructions of each block in current interval, indexed by id */
+        dynarray<W64> counts_;
+
+        /* Blocks with non-zero count in current interval */
+        dynarray<int> touched_;
+
+        void write_interval();
+};
+
+#endif // BBV_H
@@ -0,0 +1,104 @@
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * This code is released under GPL.
+ *
+ */
+
+#include <eventtrace.h>
+
+static const char EVENT_TRACE_MAGIC[8] = {'M', 'A', 'R', 'S', 'S', 'E', 'V', '1'};
+
+EventTraceWriter::EventTraceWriter(ostream& os)
+    : os_(os)
+    , lastCycle_(0)
+    , count_(0)
+{
+    os_.write(EVENT_TRACE_MAGIC, sizeof(EVENT_TRACE_MAGIC));
+}
+
+void EventTraceWriter::write_varint(W64 value)
+{
+    while (value >= 0x80) {
+        os_.put(char((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    os_.put(char(value));
+}
+
+/**
+ * @brief Append an event to the trace
+ *
+ * @param event Event to write, its cycle must not be less than the cycle of
+ * previously written event
+ */
+void EventTraceWriter::write(const TraceEvent& event)
+{
+    assert(event.cycle >= lastCycle_);
+
+    write_varint(event.cycle - lastCycle_);
+    os_.put(char(event.type));
+    os_.put(char(event.cpu));
+    write_varint(event.data);
+
+    lastCycle_ = event.cycle;
+    count_++;
+}
+
+EventTraceReader::EventTraceReader(istream& is)
+    : is_(is)
+    , lastCycle_(0)
+{
+    char magic[sizeof(EVENT_TRACE_MAGIC)];
+    is_.read(magic, sizeof(magic));
+    valid_ = is_.good() && memcmp(magic, EVENT_TRACE_MAGIC,
+            sizeof(magic)) == 0;
+}
+
+bool EventTraceReader::read_varint(W64& value)
+{
+    value = 0;
+
+    for (int shift = 0; shift < 64; shift += 7) {
+        int c = is_.get();
+        if unlikely (c == EOF)
+            return false;
+
+        value |= W64(c & 0x7f) << shift;
+        if (!(c & 0x80))
+            return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Read next event from the trace
+ *
+ * @param event Filled with the event read
+ *
+ * @return false at the end of the trace or if it is truncated
+ */
+bool EventTraceReader::read(TraceEvent& event)
+{
+    if unlikely (!valid_)
+        return false;
+
+    W64 delta, data;
+    if (!read_varint(delta))
+        return false;
+
+    int type = is_.get();
+    int cpu = is_.get();
+    if (cpu == EOF || !read_varint(data) || type >= TRACE_EVENT_COUNT) {
+        valid_ = false;
+        return false;
+    }
+
+    lastCycle_ += delta;
+    event.cycle = lastCycle_;
+    event.type = type;
+    event.cpu = cpu;
+    event.data = data;
+    return true;
+}
@@ -0,0 +1,86 @@
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * This code is released under GPL.
+ *
+ */
+
+#ifndef EVENTTRACE_H
+#define EVENTTRACE_H
+
+#include <globals.h>
+#include <superstl.h>
+
+/* Types of asynchronous events recorded in an event trace */
+enum {
+    TRACE_EVENT_INTERRUPT = 0,  // interrupt_request of a CPU has changed
+    TRACE_EVENT_EXIT,           // QEMU asked a CPU to return to main loop
+    TRACE_EVENT_COUNT,
+};
+
+/**
+ * @brief An event QEMU injected into a simulated CPU
+ *
+ * cycle is the sim_cycle in which the simulator has seen the event.
+ */
+struct TraceEvent {
+    W64 cycle;
+    W8  type;
+    W8  cpu;
+    W32 data;
+
+    bool operator ==(const TraceEvent& e) const {
+        return cycle == e.cycle && type == e.type && cpu == e.cpu &&
+            data == e.data;
+    }
+};
+
+static inline ostream& operator <<(ostream& os, const TraceEvent& e)
+{
+    os << "cycle:" << e.cycle << " type:" << (int)e.type << " cpu:" <<
+        (int)e.cpu << " data:" << e.data;
+    return os;
+}
+
+/**
+ * @brief Write events to a compact binary event trace
+ *
+ * File starts with a magic string, then each event is written as its cycle
+ * relative to previous event, type, CPU and data. Cycle and data are
+ * variable length integers, 7 bits per byte, so most events take 4 bytes.
+ * Events must be written in cycle order.
+ */
+class EventTraceWriter {
+    public:
+        EventTraceWriter(ostream& os);
+
+        void write(const TraceEvent& event);
+        W64 get_count() const { return count_; }
+
+    private:
+        ostream& os_;
+        W64 lastCycle_;
+        W64 count_;
+
+        void write_varint(W64 value);
+};
+
+/**
+ * @brief Read events written by EventTraceWriter
+ */
+class EventTraceReader {
+    public:
+        EventTraceReader(istream& is);
+
+        bool is_valid() const { return valid_; }
+        bool read(TraceEvent& event);
+
+    private:
+        istream& is_;
+        W64 lastCycle_;
+        bool valid_;
+
+        bool read_varint(W64& value);
+};
+
+#endif // EVENTTRACE_H
@@ -29,6 +29,18 @@ extern "C" {
 
 #include <math.h>
 
+//
+// sim_cycle is kept per host thread only in builds with quantum parallel
+// simulation on host threads (scons quantum=1), where each core thread runs
+// its own cycle.
+// Other builds keep a plain global, as thread-local access is slower.
+//
+#ifdef ENABLE_QUANTUM_THREADS
+#define SIM_CYCLE_TLS __thread
+#else
+#define SIM_CYCLE_TLS
+#endif
+
 
 #define fullsys_debug   cerr << "fullsys_debug: cycle " << sim_cycle << " in " << __FILE__ << ":" << __LINE__ << " (" << __PRETTY_FUNCTION__ << ")"
 #define USE_MSDEBUG (logable(5))
@@ -279,6 +291,9 @@ inline W32 x86_sse_pmovmskb(vec16b vec) { W32 mask; asm("pmovmskb %[vec],%[mask]
 inline W32 x86_sse_pmovmskw(vec8w vec) { return x86_sse_pmovmskb(x86_sse_packsswb(vec, vec)) & 0xff; }
 inline vec16b x86_sse_psadbw(vec16b a, vec16b b) { asm("psadbw %[b],%[a]" : [a] "+x" (a) : [b] "xg" (b)); return a; }
 template <int i> inline W16 x86_sse_pextrw(vec16b a) { W32 rd; asm("pextrw %[i],%[a],%[rd]" : [rd] "=r" (rd) : [a] "x" (a), [i] "N" (i)); return rd; }
+template <int i> inline vec4i x86_sse_pshufd(vec4i a) { vec4i rd; asm("pshufd %[i],%[a],%[rd]" : [rd] "=x" (rd) : [a] "xm" (a), [i] "N" (i)); return rd; }
+inline vec4i x86_sse_pandd(vec4i a, vec4i b) { asm("pand %[b],%[a]" : [a] "+x" (a) : [b] "xg" (b)); return a; }
+inline W32 x86_sse_movmskpd(vec4i vec) { W32 mask; asm("movmskpd %[vec],%[mask]" : [mask] "=r" (mask) : [vec] "x" (vec)); return mask; }
 
 inline vec16b x86_sse_zerob() { vec16b rd = {0}; asm("pxor %[rd],%[rd]" : [rd] "+x" (rd)); return rd; }
 inline vec16b x86_sse_onesb() { vec16b rd = {0}; asm("pcmpeqb %[rd],%[rd]" : [rd] "+x" (rd)); return rd; }
@@ -306,6 +321,42 @@ inline vec8w x86_sse_dupw(const W16 b) {
   return val.v;
 }
 
+//
+// 256-bit AVX2 versions of the above, only called after checking
+// x86_host_avx2. Functions using them must be marked avx2_target
+// and end with x86_avx_zeroupper() before any legacy SSE code runs.
+//
+extern bool x86_host_avx2;
+
+#define avx2_target __attribute__ ((target ("avx2")))
+
+typedef byte v32qi __attribute__ ((vector_size(32)));
+typedef v32qi vec32b;
+typedef W16 v16hi __attribute__ ((vector_size(32)));
+typedef v16hi vec16w;
+
+avx2_target inline vec32b x86_avx_ldvb(const void* m) { vec32b rd; asm("vmovdqu %[m],%[rd]" : [rd] "=x" (rd) : [m] "m" (*(const vec32b*)m)); return rd; }
+avx2_target inline vec16w x86_avx_ldvw(const void* m) { vec16w rd; asm("vmovdqu %[m],%[rd]" : [rd] "=x" (rd) : [m] "m" (*(const vec16w*)m)); return rd; }
+avx2_target inline vec32b x86_avx_pcmpeqb(vec32b a, vec32b b) { vec32b rd; asm("vpcmpeqb %[b],%[a],%[rd]" : [rd] "=x" (rd) : [a] "x" (a), [b] "xm" (b)); return rd; }
+avx2_target inline vec16w x86_avx_pcmpeqw(vec16w a, vec16w b) { vec16w rd; asm("vpcmpeqw %[b],%[a],%[rd]" : [rd] "=x" (rd) : [a] "x" (a), [b] "xm" (b)); return rd; }
+avx2_target inline vec32b x86_avx_pandb(vec32b a, vec32b b) { vec32b rd; asm("vpand %[b],%[a],%[rd]" : [rd] "=x" (rd) : [a] "x" (a), [b] "xm" (b)); return rd; }
+avx2_target inline vec32b x86_avx_onesb() { vec32b rd = {0}; asm("vpcmpeqb %[rd],%[rd],%[rd]" : [rd] "+x" (rd)); return rd; }
+avx2_target inline W32 x86_avx_pmovmskb(vec32b vec) { W32 mask; asm("vpmovmskb %[vec],%[mask]" : [mask] "=r" (mask) : [vec] "x" (vec)); return mask; }
+avx2_target inline vec32b x86_avx_dupb(vec16b b) { vec32b rd; asm("vpbroadcastb %[b],%[rd]" : [rd] "=x" (rd) : [b] "x" (b)); return rd; }
+avx2_target inline vec16w x86_avx_dupw(vec8w b) { vec16w rd; asm("vpbroadcastw %[b],%[rd]" : [rd] "=x" (rd) : [b] "x" (b)); return rd; }
+avx2_target inline void x86_avx_zeroupper() {
+  // Clobber the registers so no 256-bit value is kept in them across this
+  asm volatile("vzeroupper" : : : "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7",
+      "xmm8", "xmm9", "xmm10", "xmm11", "xmm12", "xmm13", "xmm14", "xmm15");
+}
+
+// One mask bit per word of a then b: packing works within 128-bit lanes, so put the quadwords back in order
+avx2_target inline W32 x86_avx_pmovmskw(vec16w a, vec16w b) {
+  vec32b rd;
+  asm("vpacksswb %[b],%[a],%[rd]\n\tvpermq $0xd8,%[rd],%[rd]" : [rd] "=&x" (rd) : [a] "x" (a), [b] "x" (b));
+  return x86_avx_pmovmskb(rd);
+}
+
 inline void x86_set_mxcsr(W32 value) { asm volatile("ldmxcsr %[value]" : : [value] "m" (value)); }
 inline W32 x86_get_mxcsr() { W32 value; asm volatile("stmxcsr %[value]" : [value] "=m" (value)); return value; }
 union MXCSR {
@@ -27,6 +27,11 @@ BaseMachine coremodel("base");
 
 
 BaseMachine::BaseMachine(const char *name)
+    : quantumCycleSignal("quantum-cycle")
+    , idle_cycles_skipped("idle_cycles_skipped", this)
+    , idle_skip_episodes("idle_skip_episodes", this)
+    , parallel_quanta("parallel_quanta", this)
+    , parallel_replayed_accesses("parallel_replayed_accesses", this)
 {
     machine_name = name;
     addmachine(machine_name, this);
@@ -37,6 +42,11 @@ BaseMachine::BaseMachine(const char *name)
 
     context_used = 0;
     coreid_counter = 0;
+    parallelRunner = NULL;
+    keep_warm_state = false;
+
+    quantumCycleSignal.connect(signal_mem_ptr(*this,
+                &BaseMachine::clock_private_caches));
 }
 
 BaseMachine::~BaseMachine()
@@ -86,6 +96,11 @@ void BaseMachine::shutdown()
 
 	interconnects.clear();
 
+	if (parallelRunner) {
+		delete parallelRunner;
+		parallelRunner = NULL;
+	}
+
 	if (memoryHierarchyPtr) {
 		delete memoryHierarchyPtr;
 		memoryHierarchyPtr = NULL;
@@ -130,6 +145,8 @@ bool BaseMachine::init(PTLsimConfig& config)
         return 0;
     }
 
+    setup_option_overrides(config.machine_options.buf);
+
     machineBuilder.setup_machine(*this, config.machine_config.buf);
 
     foreach(i, cores.count()) {
@@ -138,6 +155,23 @@ bool BaseMachine::init(PTLsimConfig& config)
 
     init_qemu_io_events();
 
+    if(config.load_warm_state.set()) {
+        ifstream is(config.load_warm_state.buf, std::ios::binary);
+
+        if(is && restore_warm_state(is)) {
+            /* Keep restored TLBs and branch predictors on first reset */
+            keep_warm_state = true;
+            ptl_logfile << "Restored warm state from " <<
+                config.load_warm_state << endl;
+        } else {
+            ptl_logfile << "[WARNING] Unable to restore warm state from " <<
+                config.load_warm_state << ", it is saved by a different " <<
+                "machine configuration or is corrupted\n" << flush;
+            cerr << "[WARNING] Unable to restore warm state from " <<
+                config.load_warm_state << endl << flush;
+        }
+    }
+
     return 1;
 }
 
@@ -225,9 +259,18 @@ int BaseMachine::run(PTLsimConfig& config)
         cores[cur_core]->check_ctx_changes();
     }
     first_run = 0;
+    keep_warm_state = false;
 
     // Run each core
     bool exiting = false;
+    int parallel_mode = setup_parallel_run(config);
+
+    /* Serial cores check events themselves as they run */
+    if (parallel_mode == PARALLEL_OFF) {
+        foreach (i, contextcount) {
+            contextof(i).unsample_events();
+        }
+    }
 
     for (;;) {
         if unlikely ((!logenable) &&
@@ -255,18 +298,33 @@ int BaseMachine::run(PTLsimConfig& config)
                 ((W64)ptl_logfile.tellp() > config.log_file_size))
             backup_and_reopen_logfile();
 
-        memoryHierarchyPtr->clock();
-        clock_qemu_io_events();
-
-		foreach (i, coremodel.per_cycle_signals.size()) {
-			if (logable(4))
-				ptl_logfile << "Per-Cycle-Signal : " <<
-					coremodel.per_cycle_signals[i]->get_name() << endl;
-			exiting |= coremodel.per_cycle_signals[i]->emit(NULL);
-		}
-
-        sim_cycle++;
-        iterations++;
+        if (parallel_mode == PARALLEL_QUANTUM) {
+            exiting |= run_quantum(config);
+        } else {
+            memoryHierarchyPtr->clock();
+            clock_qemu_io_events();
+
+            if unlikely (ptl_event_trace_enabled)
+                event_trace_sample();
+
+            if (parallel_mode == PARALLEL_LOCKSTEP) {
+                foreach (i, contextcount) {
+                    contextof(i).sample_events();
+                }
+
+                exiting |= parallelRunner->run(coremodel.per_cycle_signals);
+            } else {
+                foreach (i, coremodel.per_cycle_signals.size()) {
+                    if (logable(4))
+                        ptl_logfile << "Per-Cycle-Signal : " <<
+                            coremodel.per_cycle_signals[i]->get_name() << endl;
+                    exiting |= coremodel.per_cycle_signals[i]->emit(NULL);
+                }
+            }
+
+            sim_cycle++;
+            iterations++;
+        }
 
         if unlikely (config.stop_at_insns <= total_insns_committed ||
                 config.stop_at_cycle <= sim_cycle) {
@@ -279,6 +337,9 @@ int BaseMachine::run(PTLsimConfig& config)
                 ret_qemu_env = &contextof(0);
             break;
         }
+
+        if (config.skip_idle_cycles)
+            skip_idle_cycles(config);
     }
 
     if(logable(1))
@@ -287,11 +348,390 @@ int BaseMachine::run(PTLsimConfig& config)
            " uops and " << iterations << " iterations (cycles)" << endl;
     }
 
+    if (parallel_mode == PARALLEL_QUANTUM)
+        memoryHierarchyPtr->flush_private_wakeups();
+
+    if (parallel_mode != PARALLEL_OFF)
+        parallelRunner->stop();
+
     config.dump_state_now = 0;
 
     return exiting;
 }
 
+/**
+ * @brief Prepare host threads to run cores in parallel
+ *
+ * @param config Simulation configuration
+ *
+ * @return Mode in which per-cycle signals are run
+ *
+ * Parallel mode requires that each per-cycle signal belongs to one core, as
+ * the runner only keeps the serial order of accesses that cores mark as
+ * shared. Logging and the checker write to global state without marking it
+ * so they force serial mode.
+ *
+ * Quantum mode is also used with a single host thread, so its timing error
+ * against lockstep mode can be measured on any host. Builds without
+ * ENABLE_QUANTUM_THREADS (scons quantum=1) share sim_cycle between host
+ * threads and always run it on one thread. With more than one thread, the
+ * order in which cores take the lock for shared accesses depends on host
+ * timing, so quantum runs are not deterministic.
+ */
+int BaseMachine::setup_parallel_run(PTLsimConfig& config)
+{
+    /* More threads than host CPUs only adds context switches to each cycle */
+    int threads = min((W64)per_cycle_signals.size(), config.parallel_threads);
+    threads = min(threads, (int)sysconf(_SC_NPROCESSORS_ONLN));
+
+    if (config.parallel_quantum) {
+#ifndef ENABLE_QUANTUM_THREADS
+        threads = 1;
+#endif
+        threads = max(threads, 1);
+    } else if (threads <= 1)
+        return PARALLEL_OFF;
+
+    if (per_cycle_signals.size() != cores.count() || config.loglevel > 0 ||
+            config.checker_enabled) {
+        static bool warned = false;
+        if (!warned) {
+            ptl_logfile << "[WARNING] Parallel simulation is disabled with " <<
+                "logging, checker or non-core per-cycle signals" << endl;
+            warned = true;
+        }
+        return PARALLEL_OFF;
+    }
+
+    if (parallelRunner && parallelRunner->get_num_threads() != threads) {
+        delete parallelRunner;
+        parallelRunner = NULL;
+    }
+
+    if (!parallelRunner) {
+        parallelRunner = new ParallelCycleRunner(threads);
+        ptl_logfile << "Simulating " << per_cycle_signals.size() <<
+            " cores on " << threads << " host threads" << endl;
+    }
+
+    parallelRunner->start();
+
+    if (config.parallel_quantum)
+        return PARALLEL_QUANTUM;
+
+    return PARALLEL_LOCKSTEP;
+}
+
+/**
+ * @brief Run all cores for one parallel quantum and replay their accesses
+ *
+ * @param config Simulation configuration
+ *
+ * @return true if any core wants to exit simulation
+ *
+ * Bound phase: each core runs up to config.parallel_quantum cycles on its
+ * host thread with its own sim_cycle. Reads that hit in the private L1 are
+ * served right away, all other memory requests are buffered.
+ *
+ * Weave phase: the memory hierarchy is clocked through the same cycles on
+ * this thread and buffered requests are sent in cycle and core order, as
+ * in serial mode. Cores see the responses to these requests only in the
+ * next quantum, so their timing error is bounded by the quantum length.
+ * Interrupts and QEMU events are also only sampled once per quantum.
+ */
+bool BaseMachine::run_quantum(PTLsimConfig& config)
+{
+    W64 quantum = config.parallel_quantum;
+
+    /* Stats dumps and stop cycle must still fall on a quantum boundary */
+    quantum = min(quantum, next_periodic_cycle(config, sim_cycle + 1) -
+            sim_cycle);
+    if (config.stop_at_cycle != infinity)
+        quantum = min(quantum, config.stop_at_cycle - sim_cycle);
+
+    /* Replayed events are also sampled at quantum boundaries */
+    if unlikely (ptl_event_trace_enabled) {
+        W64 next = get_next_event_trace_cycle();
+        if (next > sim_cycle)
+            quantum = min(quantum, next - sim_cycle);
+    }
+
+    memoryHierarchyPtr->clock();
+    clock_qemu_io_events();
+
+    if unlikely (ptl_event_trace_enabled)
+        event_trace_sample();
+
+    foreach (i, contextcount) {
+        contextof(i).sample_events();
+    }
+
+    memoryHierarchyPtr->set_access_buffering(true);
+    bool exiting = parallelRunner->run_quantum(per_cycle_signals, quantum,
+            &quantumCycleSignal);
+    memoryHierarchyPtr->set_access_buffering(false);
+
+    W64 cycles = parallelRunner->get_quantum_cycles();
+    W64 replayed = 0;
+
+    for (W64 c = 0; c < cycles; c++) {
+        if (c > 0) {
+            memoryHierarchyPtr->clock();
+            clock_qemu_io_events();
+        }
+
+        replayed += memoryHierarchyPtr->replay_accesses(sim_cycle);
+
+        sim_cycle++;
+        iterations++;
+    }
+
+    memoryHierarchyPtr->finish_replay();
+
+    Stats *stats = cores[0]->get_default_stats();
+    parallel_quanta(stats)++;
+    parallel_replayed_accesses(stats) += replayed;
+
+    return exiting;
+}
+
+/**
+ * @brief Deliver private L1 hits of a core before it runs its cycle
+ *
+ * @param arg Index of the core's per-cycle signal
+ */
+bool BaseMachine::clock_private_caches(void *arg)
+{
+    int i = (int)(Waddr)arg;
+    memoryHierarchyPtr->clock_private(cores[i]->get_coreid());
+    return true;
+}
+
+/**
+ * @brief Next cycle at or after given cycle with a progress update or
+ * time-stats dump
+ */
+W64 BaseMachine::next_periodic_cycle(PTLsimConfig& config, W64 cycle)
+{
+    W64 next = (cycle + 999) / 1000 * 1000;
+
+    if (time_stats_file) {
+        next = min(next, (cycle + config.time_stats_period - 1) /
+                config.time_stats_period * config.time_stats_period);
+    }
+
+    return next;
+}
+
+/**
+ * @brief Skip simulation cycles in which no module has any work to do
+ *
+ * @param config Simulation configuration
+ *
+ * When all cores report that they are idle, sim_cycle is moved directly to
+ * the earliest cycle in which a memory event, CPU controller request, QEMU
+ * IO event or QEMU timer is due. Skipped cycles are never more than the
+ * next progress update, time-stats dump or stop cycle so all of them are
+ * still executed at the same cycle as without skipping.
+ */
+void BaseMachine::skip_idle_cycles(PTLsimConfig& config)
+{
+    /* Any per-cycle signal other than the cores must be clocked each cycle */
+    if (per_cycle_signals.size() != cores.count())
+        return;
+
+    W64 target = next_periodic_cycle(config, sim_cycle);
+
+    if (config.stop_at_cycle != infinity)
+        target = min(target, config.stop_at_cycle - 1);
+
+    foreach (i, cores.count()) {
+        if (target <= sim_cycle)
+            return;
+        target = min(target, cores[i]->get_idle_until());
+    }
+
+    target = min(target, memoryHierarchyPtr->get_next_event_cycle());
+    target = min(target, get_next_qemu_io_event_cycle());
+    target = min(target, get_next_event_trace_cycle());
+
+    if (target <= sim_cycle)
+        return;
+
+    W64s timer_ns = qemu_next_sim_timer_deadline();
+    if (timer_ns != INT64_MAX) {
+        target = min(target, sim_cycle + ns_to_simcycles(timer_ns));
+        if (target <= sim_cycle)
+            return;
+    }
+
+    W64 cycles = target - sim_cycle;
+
+    if (logable(4)) {
+        ptl_logfile << "Skipping " << cycles << " idle cycles from " <<
+            sim_cycle << endl;
+    }
+
+    foreach (i, cores.count()) {
+        cores[i]->skip_cycles(cycles);
+    }
+    memoryHierarchyPtr->skip_cycles(cycles);
+
+    Stats *stats = cores[0]->get_default_stats();
+    idle_cycles_skipped(stats) += cycles;
+    idle_skip_episodes(stats)++;
+
+    sim_cycle += cycles;
+    iterations += cycles;
+}
+
+/**
+ * @brief Prepare machine for functional warming during fast-forward
+ */
+void BaseMachine::setup_warming()
+{
+    foreach (i, NUM_SIM_CORES) {
+        WarmTarget& target = warm_targets[i];
+        target.core = NULL;
+
+        foreach (c, cores.count()) {
+            if (cores[c]->get_context_thread(contextof(i), target.threadid)) {
+                target.core = cores[c];
+                break;
+            }
+        }
+    }
+
+    memoryHierarchyPtr->setup_warming();
+}
+
+/**
+ * @brief Fast-forward is done, keep warm state when simulation starts
+ */
+void BaseMachine::finish_warming()
+{
+    keep_warm_state = true;
+}
+
+void BaseMachine::warm_fetch(Context& ctx, Waddr rip)
+{
+    warm_access(ctx, rip, true, false);
+}
+
+void BaseMachine::warm_mem(Context& ctx, Waddr virtaddr, bool is_write)
+{
+    warm_access(ctx, virtaddr, false, is_write);
+}
+
+/**
+ * @brief Warm TLB and caches with an emulated access
+ *
+ * Accesses that miss in QEMU's TLB or go to MMIO are ignored, so warming
+ * never changes emulated state.
+ */
+void BaseMachine::warm_access(Context& ctx, Waddr virtaddr, bool is_code,
+        bool is_write)
+{
+    WarmTarget& target = warm_targets[ctx.cpu_index];
+    int exception, mmio;
+    PageFaultErrorCode pfec;
+
+    if unlikely (!target.core)
+        return;
+
+    Waddr physaddr = ctx.check_and_translate(virtaddr, 0, is_write, false,
+            exception, mmio, pfec, is_code);
+    if (exception || mmio)
+        return;
+
+    target.core->warm_tlb(target.threadid, virtaddr, is_code);
+    memoryHierarchyPtr->warm_access(target.core->get_coreid(),
+            target.threadid, physaddr, is_code, is_write);
+}
+
+void BaseMachine::warm_branch(Context& ctx, int type, W64 ripafter,
+        W64 target)
+{
+    WarmTarget& warm_target = warm_targets[ctx.cpu_index];
+
+    if likely (warm_target.core) {
+        warm_target.core->warm_branch(warm_target.threadid, type, ripafter,
+                target);
+    }
+}
+
+/* Header of warm state files, checks machine shape before restoring */
+struct WarmStateHeader {
+    W64 magic;
+    int contexts;
+    int cores;
+    int controllers;
+};
+
+#define WARM_STATE_MAGIC 0x314d5241574c5450ULL // "PTLWARM1"
+
+/**
+ * @brief Save caches, directory, TLBs and branch predictors
+ *
+ * @param os Binary output stream, written next to a QEMU checkpoint
+ *
+ * @return true if state is written
+ *
+ * Pending memory requests and pipeline contents are not saved, so state
+ * saved while simulating may miss lines that were being filled.
+ */
+bool BaseMachine::save_warm_state(ostream& os)
+{
+    WarmStateHeader header;
+    setzero(header);
+    header.magic = WARM_STATE_MAGIC;
+    header.contexts = NUM_SIM_CORES;
+    header.cores = cores.count();
+    header.controllers = controllers.count();
+    save_warm_block(os, header);
+
+    foreach (i, cores.count()) {
+        cores[i]->save_warm_state(os);
+    }
+
+    foreach (i, controllers.count()) {
+        controllers[i]->save_warm_state(os);
+    }
+
+    return !os.fail();
+}
+
+/**
+ * @brief Restore state written by save_warm_state
+ *
+ * @param is Binary input stream
+ *
+ * @return false if file is saved by a machine with different configuration
+ */
+bool BaseMachine::restore_warm_state(istream& is)
+{
+    WarmStateHeader header;
+
+    if (!restore_warm_block(is, header) ||
+            header.magic != WARM_STATE_MAGIC ||
+            header.contexts != NUM_SIM_CORES ||
+            header.cores != cores.count() ||
+            header.controllers != controllers.count())
+        return false;
+
+    foreach (i, cores.count()) {
+        if (!cores[i]->restore_warm_state(is))
+            return false;
+    }
+
+    foreach (i, controllers.count()) {
+        if (!controllers[i]->restore_warm_state(is))
+            return false;
+    }
+
+    return true;
+}
+
 void BaseMachine::flush_tlb(Context& ctx)
 {
     foreach(i, cores.count()) {
@@ -469,9 +909,107 @@ void BaseMachine::add_option(const char* c_name, int i, const char* opt,
     add_option(core_name.buf, opt, value);
 }
 
+/**
+ * @brief Parse options given on the command line
+ *
+ * @param options Comma separated list of <name>.<option>=<value>
+ *
+ * Overrides are checked before the options of the machine configuration, so
+ * cache geometry or any other module option can be changed without building
+ * a new machine. A name ending with '*' matches all modules whose name starts
+ * with the rest of it, like 'L2_*.size=4M'.
+ */
+void BaseMachine::setup_option_overrides(const char* options)
+{
+    foreach (i, option_overrides.count()) {
+        delete option_overrides[i];
+    }
+    option_overrides.clear();
+
+    stringbuf opts;
+    opts << options;
+
+    dynarray<stringbuf*> entries;
+    opts.split(entries, ",");
+
+    foreach (i, entries.count()) {
+        char* entry = entries[i]->buf;
+        char* dot = strchr(entry, '.');
+        char* eq = strchr(entry, '=');
+
+        if (!dot || !eq || eq < dot) {
+            ptl_logfile << "[WARNING] Ignoring machine option '" << entry <<
+                "', use <name>.<option>=<value>\n" << flush;
+            cerr << "[WARNING] Ignoring machine option '" << entry <<
+                "'" << endl << flush;
+        } else {
+            *dot = '\0';
+            *eq = '\0';
+            OptionOverride* ovr = new OptionOverride();
+            ovr->name << entry;
+            ovr->opt << (dot + 1);
+            ovr->value << (eq + 1);
+            option_overrides.push(ovr);
+        }
+
+        delete entries[i];
+    }
+}
+
+const stringbuf* BaseMachine::get_option_override(const char* name,
+        const char* opt_name)
+{
+    const stringbuf* value = NULL;
+
+    /* Last matching override wins */
+    foreach (i, option_overrides.count()) {
+        OptionOverride* ovr = option_overrides[i];
+        if (!strequal(ovr->opt.buf, opt_name))
+            continue;
+
+        int len = strlen(ovr->name.buf);
+        if (len && ovr->name.buf[len - 1] == '*') {
+            if (strncmp(ovr->name.buf, name, len - 1) == 0)
+                value = &ovr->value;
+        } else if (strequal(ovr->name.buf, name)) {
+            value = &ovr->value;
+        }
+    }
+
+    return value;
+}
+
+/* Integer option values may have a K, M or G suffix */
+static bool parse_int_option(const char* str, int& value)
+{
+    char* end = NULL;
+    W64s val = strtoll(str, &end, 0);
+
+    if (end == str)
+        return false;
+
+    switch (*end) {
+        case 'k': case 'K': val <<= 10; end++; break;
+        case 'm': case 'M': val <<= 20; end++; break;
+        case 'g': case 'G': val <<= 30; end++; break;
+    }
+
+    if (*end != '\0')
+        return false;
+
+    value = val;
+    return true;
+}
+
 bool BaseMachine::get_option(const char* name, const char* opt_name,
         bool& value)
 {
+    const stringbuf* ovr = get_option_override(name, opt_name);
+    if (ovr) {
+        value = strequal(ovr->buf, "true") || strequal(ovr->buf, "1");
+        return true;
+    }
+
     BoolOptions** b = bool_options.get(name);
     if(b) {
         bool* bt = (*b)->get(opt_name);
@@ -487,6 +1025,15 @@ bool BaseMachine::get_option(const char* name, const char* opt_name,
 bool BaseMachine::get_option(const char* name, const char* opt_name,
         int& value)
 {
+    const stringbuf* ovr = get_option_override(name, opt_name);
+    if (ovr) {
+        if (parse_int_option(ovr->buf, value))
+            return true;
+
+        ptl_logfile << "[WARNING] Machine option " << name << "." <<
+            opt_name << "=" << *ovr << " is not a number\n" << flush;
+    }
+
     IntOptions** b = int_options.get(name);
     if(b) {
         int* bt = (*b)->get(opt_name);
@@ -496,12 +1043,27 @@ bool BaseMachine::get_option(const char* name, const char* opt_name,
         }
     }
 
+    /* Sizes like '4M' are given as strings in configuration */
+    StrOptions** s = str_options.get(name);
+    if(s) {
+        stringbuf** bt = (*s)->get(opt_name);
+        if(bt && parse_int_option((*bt)->buf, value)) {
+            return true;
+        }
+    }
+
     return false;
 }
 
 bool BaseMachine::get_option(const char* name, const char* opt_name,
         stringbuf& value)
 {
+    const stringbuf* ovr = get_option_override(name, opt_name);
+    if (ovr) {
+        value << *ovr;
+        return true;
+    }
+
     StrOptions** b = str_options.get(name);
     if(b) {
         stringbuf** bt = (*b)->get(opt_name);
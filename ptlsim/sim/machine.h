@@ -12,6 +12,7 @@
 #define MACHINE_H
 
 #include <ptlsim.h>
+#include <parallel.h>
 
 #define YAML_KEY_VAL(out, key, val) \
 	out << YAML::Key << key << YAML::Value << val;
@@ -32,6 +33,13 @@ typedef Hashtable<const char*, bool, 1> BoolOptions;
 typedef Hashtable<const char*, int, 1> IntOptions;
 typedef Hashtable<const char*, stringbuf*, 1> StrOptions;
 
+// Option given with -machine-options, overrides the configured value
+struct OptionOverride {
+    stringbuf name;
+    stringbuf opt;
+    stringbuf value;
+};
+
 struct SingleConnection {
     stringbuf controller;
     int type;
@@ -54,9 +62,41 @@ struct BaseMachine: public PTLsimMachine {
     Hashtable<const char*, BoolOptions*, 1> bool_options;
     Hashtable<const char*, IntOptions*, 1> int_options;
     Hashtable<const char*, StrOptions*, 1> str_options;
+    dynarray<OptionOverride*> option_overrides;
 
     Memory::MemoryHierarchy* memoryHierarchyPtr;
 
+    // Host threads that run per-cycle signals, NULL in serial mode
+    ParallelCycleRunner* parallelRunner;
+
+    enum {
+        PARALLEL_OFF,
+        PARALLEL_LOCKSTEP,
+        PARALLEL_QUANTUM,
+    };
+
+    // Emitted before each core cycle in parallel quantum mode
+    Signal quantumCycleSignal;
+
+    // Idle cycle skipping stats
+    StatObj<W64> idle_cycles_skipped;
+    StatObj<W64> idle_skip_episodes;
+
+    // Parallel quantum mode stats
+    StatObj<W64> parallel_quanta;
+    StatObj<W64> parallel_replayed_accesses;
+
+    // Core and hardware thread of each Context, used while warming
+    struct WarmTarget {
+        Core::BaseCore* core;
+        W8 threadid;
+    };
+    WarmTarget warm_targets[NUM_SIM_CORES];
+
+    // Set after fast-forward warming so first run keeps caches, TLBs and
+    // branch predictors as they are
+    bool keep_warm_state;
+
     BaseMachine(const char* name);
     virtual bool init(PTLsimConfig& config);
     virtual int run(PTLsimConfig& config);
@@ -66,6 +106,21 @@ struct BaseMachine: public PTLsimMachine {
     virtual void flush_tlb(Context& ctx);
     virtual void flush_tlb_virt(Context& ctx, Waddr virtaddr);
     void flush_all_pipelines();
+    void skip_idle_cycles(PTLsimConfig& config);
+    W64 next_periodic_cycle(PTLsimConfig& config, W64 cycle);
+    int setup_parallel_run(PTLsimConfig& config);
+    bool run_quantum(PTLsimConfig& config);
+    bool clock_private_caches(void *arg);
+    virtual void setup_warming();
+    virtual void finish_warming();
+    virtual void warm_fetch(Context& ctx, Waddr rip);
+    virtual void warm_mem(Context& ctx, Waddr virtaddr, bool is_write);
+    virtual void warm_branch(Context& ctx, int type, W64 ripafter,
+            W64 target);
+    void warm_access(Context& ctx, Waddr virtaddr, bool is_code,
+            bool is_write);
+    virtual bool save_warm_state(ostream& os);
+    virtual bool restore_warm_state(istream& is);
     virtual void reset();
 	virtual void dump_configuration(ostream& os) const;
 	virtual void shutdown();
@@ -101,6 +156,10 @@ struct BaseMachine: public PTLsimMachine {
 
     bool has_option(const char* name, const char* opt_name);
 
+    void setup_option_overrides(const char* options);
+    const stringbuf* get_option_override(const char* name,
+            const char* opt_name);
+
     bool get_option(const char* name, const char* opt_name, bool& value);
     bool get_option(const char* name, const char* opt_name, int& value);
     bool get_option(const char* name, const char* opt_name, stringbuf& value);
@@ -0,0 +1,343 @@
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * This code is released under GPL.
+ *
+ */
+
+#include <parallel.h>
+#include <ptlsim.h>
+
+#include <signal.h>
+
+__thread int parallel_pending_item = -1;
+
+/* Item that holds the quantum mode lock on this thread */
+static __thread int parallel_locked_item = -1;
+
+/* Runner that is currently running signals, only one can be active */
+static ParallelCycleRunner *active_runner = NULL;
+
+/**
+ * @brief Get access to shared state for the pending item
+ *
+ * @return true if a lock was taken that must be released with
+ * parallel_end_access()
+ *
+ * In lockstep mode wait until all signals before the pending one have
+ * finished, the item then keeps access until the end of its cycle. In
+ * quantum mode take the shared lock, nested accesses run under the same
+ * lock.
+ */
+bool parallel_begin_access()
+{
+    int item = parallel_pending_item;
+    ParallelCycleRunner *runner = active_runner;
+
+    assert(runner);
+    parallel_pending_item = -1;
+
+    if (runner->quantum_) {
+        parallel_locked_item = item;
+        runner->sharedLock_.acquire();
+        return true;
+    }
+
+    W32 spins = 0;
+    while (runner->turn_ != item) {
+        cpu_pause();
+        barrier();
+        if unlikely (++spins > SpinBarrier::SPINS_BEFORE_YIELD)
+            sched_yield();
+    }
+
+    barrier();
+    return false;
+}
+
+/**
+ * @brief Release the quantum mode lock taken by parallel_begin_access()
+ */
+void parallel_end_access()
+{
+    parallel_pending_item = parallel_locked_item;
+    parallel_locked_item = -1;
+
+    barrier();
+    active_runner->sharedLock_.release();
+}
+
+ParallelCycleRunner::ParallelCycleRunner(int num_threads)
+    : numThreads_(num_threads)
+    , startBarrier_(num_threads)
+    , endBarrier_(num_threads)
+    , active_(false)
+    , shutdown_(false)
+    , signals_(NULL)
+    , turn_(0)
+    , startCycle_(0)
+    , quantum_(0)
+    , cycleSignal_(NULL)
+    , stopQuantum_(false)
+{
+    assert(num_threads > 0);
+
+    pthread_mutex_init(&lock_, NULL);
+    pthread_cond_init(&wakeup_, NULL);
+
+    threads_ = new pthread_t[numThreads_];
+    args_ = new WorkerArg[numThreads_];
+    cyclesRun_.resize(numThreads_, 0);
+
+    for (int i = 1; i < numThreads_; i++) {
+        args_[i].runner = this;
+        args_[i].tid = i;
+        int rc = pthread_create(&threads_[i], NULL, worker_main, &args_[i]);
+        if (rc) {
+            cerr << "[ERROR] Unable to create simulation thread: " << rc <<
+                endl << flush;
+            assert(0);
+        }
+    }
+}
+
+ParallelCycleRunner::~ParallelCycleRunner()
+{
+    if (active_)
+        stop();
+
+    pthread_mutex_lock(&lock_);
+    shutdown_ = true;
+    pthread_cond_broadcast(&wakeup_);
+    pthread_mutex_unlock(&lock_);
+
+    for (int i = 1; i < numThreads_; i++) {
+        pthread_join(threads_[i], NULL);
+    }
+
+    delete[] threads_;
+    delete[] args_;
+
+    pthread_cond_destroy(&wakeup_);
+    pthread_mutex_destroy(&lock_);
+}
+
+/**
+ * @brief Wake up worker threads before running simulation cycles
+ */
+void ParallelCycleRunner::start()
+{
+    assert(!active_runner);
+    active_runner = this;
+
+    pthread_mutex_lock(&lock_);
+    active_ = true;
+    pthread_cond_broadcast(&wakeup_);
+    pthread_mutex_unlock(&lock_);
+}
+
+/**
+ * @brief Put worker threads to sleep when simulation returns to emulation
+ */
+void ParallelCycleRunner::stop()
+{
+    assert(active_runner == this);
+
+    active_ = false;
+    barrier();
+    startBarrier_.wait();
+
+    /* Wait until all workers have seen the stop so start() can't race */
+    endBarrier_.wait();
+
+    active_runner = NULL;
+}
+
+/**
+ * @brief Emit all signals for one simulation cycle
+ *
+ * @param signals Per-cycle signals in the order serial mode emits them
+ *
+ * @return OR of all signal return values
+ */
+bool ParallelCycleRunner::run(dynarray<Signal*>& signals)
+{
+    assert(active_);
+
+    signals_ = &signals;
+    results_.resize(signals.size());
+    turn_ = 0;
+    startCycle_ = sim_cycle;
+    quantum_ = 0;
+    barrier();
+
+    startBarrier_.wait();
+    run_thread(0);
+    endBarrier_.wait();
+
+    bool ret = false;
+    foreach (i, signals.size()) {
+        ret |= results_[i];
+    }
+
+    return ret;
+}
+
+/**
+ * @brief Emit all signals for a number of cycles without a barrier
+ *
+ * @param signals Per-cycle signals, one per core
+ * @param cycles Number of cycles to run, starting at sim_cycle
+ * @param cycle_signal Optional signal emitted before each signal in every
+ * cycle, with the signal index as argument
+ *
+ * @return OR of all signal return values
+ *
+ * Threads run their signals with sim_cycle set to their own cycle. When a
+ * signal returns true all threads stop at the end of their current cycle,
+ * use get_quantum_cycles() to find how far they got. sim_cycle of the
+ * calling thread is not changed.
+ */
+bool ParallelCycleRunner::run_quantum(dynarray<Signal*>& signals, W64 cycles,
+        Signal *cycle_signal)
+{
+    assert(active_);
+    assert(cycles > 0);
+
+    signals_ = &signals;
+    results_.resize(signals.size());
+    foreach (i, signals.size()) {
+        results_[i] = false;
+    }
+    startCycle_ = sim_cycle;
+    quantum_ = cycles;
+    cycleSignal_ = cycle_signal;
+    stopQuantum_ = false;
+    barrier();
+
+    startBarrier_.wait();
+    run_thread(0);
+    endBarrier_.wait();
+
+    sim_cycle = startCycle_;
+    quantum_ = 0;
+
+    bool ret = false;
+    foreach (i, signals.size()) {
+        ret |= results_[i];
+    }
+
+    return ret;
+}
+
+W64 ParallelCycleRunner::get_quantum_cycles() const
+{
+    W64 cycles = 0;
+    foreach (i, numThreads_) {
+        cycles = max(cycles, cyclesRun_[i]);
+    }
+    return cycles;
+}
+
+void ParallelCycleRunner::run_thread(int tid)
+{
+    /* sim_cycle is shared unless quantum threads give each thread a copy */
+#ifdef ENABLE_QUANTUM_THREADS
+    sim_cycle = startCycle_;
+#else
+    if (tid == 0)
+        sim_cycle = startCycle_;
+#endif
+
+    if (quantum_)
+        run_quantum_signals(tid);
+    else
+        run_signals(tid);
+}
+
+void ParallelCycleRunner::run_signals(int tid)
+{
+    int count = signals_->size();
+
+    for (int i = tid; i < count; i += numThreads_) {
+        parallel_pending_item = i;
+        results_[i] = (*signals_)[i]->emit(NULL);
+
+        /* Finish in order so the next signal can access shared state */
+        if (parallel_pending_item >= 0)
+            parallel_begin_access();
+        barrier();
+        turn_ = i + 1;
+        barrier();
+    }
+}
+
+void ParallelCycleRunner::run_quantum_signals(int tid)
+{
+    int count = signals_->size();
+    W64 cycle;
+
+    for (cycle = 0; cycle < quantum_; cycle++) {
+        sim_cycle = startCycle_ + cycle;
+
+        for (int i = tid; i < count; i += numThreads_) {
+            if (cycleSignal_)
+                cycleSignal_->emit((void*)(Waddr)i);
+
+            parallel_pending_item = i;
+            if ((*signals_)[i]->emit(NULL)) {
+                results_[i] = true;
+                stopQuantum_ = true;
+            }
+            parallel_pending_item = -1;
+        }
+
+        barrier();
+        if (stopQuantum_) {
+            cycle++;
+            break;
+        }
+    }
+
+    cyclesRun_[tid] = cycle;
+}
+
+void* ParallelCycleRunner::worker_main(void *arg)
+{
+    WorkerArg *worker = (WorkerArg*)arg;
+
+    /* Leave all signal handling, like QEMU alarm timers, to main thread */
+    sigset_t set;
+    sigfillset(&set);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+    worker->runner->worker_loop(worker->tid);
+
+    return NULL;
+}
+
+void ParallelCycleRunner::worker_loop(int tid)
+{
+    for (;;) {
+        pthread_mutex_lock(&lock_);
+        while (!active_ && !shutdown_) {
+            pthread_cond_wait(&wakeup_, &lock_);
+        }
+        pthread_mutex_unlock(&lock_);
+
+        if (shutdown_)
+            break;
+
+        for (;;) {
+            startBarrier_.wait();
+            barrier();
+            if (!active_) {
+                endBarrier_.wait();
+                break;
+            }
+
+            run_thread(tid);
+            endBarrier_.wait();
+        }
+    }
+}
@@ -0,0 +1,176 @@
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * This code is released under GPL.
+ *
+ */
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <globals.h>
+#include <superstl.h>
+
+#include <pthread.h>
+#include <sched.h>
+
+/*
+ * Index of the per-cycle work item running on this host thread that has not
+ * yet been given its turn to access shared simulator state, -1 otherwise.
+ */
+extern __thread int parallel_pending_item;
+
+bool parallel_begin_access();
+void parallel_end_access();
+
+/**
+ * @brief Mark an access to simulator state that is shared between cores
+ *
+ * Declare one at the start of any scope in which a core reads or writes
+ * state that another core can also access: memory hierarchy, guest memory,
+ * QEMU CPU state, the basic block cache and global counters.
+ *
+ * In lockstep parallel mode the constructor blocks until all cores with a
+ * lower index have finished their cycle, so shared state is accessed in the
+ * same order as in serial mode, and the core keeps its turn for the rest of
+ * the cycle. In quantum mode the scope holds a global lock instead. In
+ * serial mode it only checks a thread-local variable.
+ */
+struct ParallelSharedAccess {
+    bool locked;
+
+    ParallelSharedAccess(bool shared = true) {
+        locked = false;
+        if unlikely (shared && parallel_pending_item >= 0)
+            locked = parallel_begin_access();
+    }
+
+    ~ParallelSharedAccess() {
+        if unlikely (locked)
+            parallel_end_access();
+    }
+};
+
+/**
+ * @brief Barrier for a fixed number of threads that spins while waiting
+ *
+ * Used to synchronize host threads every simulated cycle, where a futex based
+ * barrier costs more than the work done between two barriers. Threads start
+ * yielding the host CPU if they spin for too long, so an oversubscribed host
+ * still makes progress.
+ */
+struct SpinBarrier {
+    enum { SPINS_BEFORE_YIELD = 1 << 8 };
+
+    W32 count;
+    W32 waiting;
+    W32 generation;
+
+    SpinBarrier(W32 count = 1) { reset(count); }
+
+    void reset(W32 count) {
+        this->count = count;
+        waiting = 0;
+        generation = 0;
+    }
+
+    void wait() {
+        W32 gen = generation;
+        barrier();
+
+        if (xadd(waiting, W32(1)) == count - 1) {
+            waiting = 0;
+            barrier();
+            generation = gen + 1;
+            barrier();
+            return;
+        }
+
+        W32 spins = 0;
+        while (generation == gen) {
+            cpu_pause();
+            barrier();
+            if unlikely (++spins > SPINS_BEFORE_YIELD)
+                sched_yield();
+        }
+    }
+};
+
+/**
+ * @brief Run the per-cycle signals of the machine on multiple host threads
+ *
+ * Signal i is always run by host thread (i % number of threads), where the
+ * calling thread is thread 0. Two modes are supported:
+ *
+ * run() emits all signals for one cycle. A signal runs without any
+ * synchronization until it enters a ParallelSharedAccess scope, from then
+ * on it runs only after all signals with lower index have finished. Results
+ * are same as emitting all signals serially in index order as long as every
+ * access to shared state is marked.
+ *
+ * run_quantum() lets each thread emit its signals for a number of cycles
+ * without waiting for other threads. Shared accesses are only serialized by
+ * a lock, so results depend on host thread timing.
+ *
+ * Worker threads spin between cycles while the runner is started and sleep
+ * while it is stopped, so they don't use host CPU during emulation.
+ */
+class ParallelCycleRunner {
+    public:
+        ParallelCycleRunner(int num_threads);
+        ~ParallelCycleRunner();
+
+        void start();
+        void stop();
+        bool run(dynarray<Signal*>& signals);
+        bool run_quantum(dynarray<Signal*>& signals, W64 cycles,
+                Signal *cycle_signal);
+
+        int get_num_threads() const { return numThreads_; }
+
+        // Most cycles run by any thread in last run_quantum()
+        W64 get_quantum_cycles() const;
+
+    private:
+        struct WorkerArg {
+            ParallelCycleRunner *runner;
+            int tid;
+        };
+
+        int numThreads_;
+        pthread_t *threads_;
+        WorkerArg *args_;
+
+        SpinBarrier startBarrier_;
+        SpinBarrier endBarrier_;
+
+        pthread_mutex_t lock_;
+        pthread_cond_t wakeup_;
+        bool active_;
+        bool shutdown_;
+
+        dynarray<Signal*> *signals_;
+        dynarray<bool> results_;
+
+        /* Number of signals that have finished in current cycle */
+        int turn_;
+
+        /* Quantum mode state, quantum_ is 0 in lockstep mode */
+        W64 startCycle_;
+        W64 quantum_;
+        Signal *cycleSignal_;
+        bool stopQuantum_;
+        dynarray<W64> cyclesRun_;
+        Spinlock sharedLock_;
+
+        static void* worker_main(void *arg);
+        void worker_loop(int tid);
+        void run_thread(int tid);
+        void run_signals(int tid);
+        void run_quantum_signals(int tid);
+
+        friend bool parallel_begin_access();
+        friend void parallel_end_access();
+};
+
+#endif // PARALLEL_H
@@ -38,6 +38,7 @@ extern "C" {
 #include <sysemu.h>
 #include <qemu-objects.h>
 #include <monitor.h>
+#include <qemu-aio.h>
 }
 
 #include <ptl-qemu.h>
@@ -49,6 +50,9 @@ extern "C" {
 #include <ptlcalls.h>
 
 #include <test.h>
+#include <sampling.h>
+#include <bbv.h>
+#include <eventtrace.h>
 
 /*
  * Physical address of the PTLsim PTLCALL hypercall page
@@ -69,6 +73,9 @@ static char *pending_command_str = NULL;
 static int pending_call_type = -1;
 static int pending_call_arg3 = -1;
 
+static void simpoint_marker_reached(CPUX86State* cpu);
+static void simpoint_check_marker();
+
 static void save_core_dump(char* dump, W64 dump_size,
         char* app_name, W64 app_name_size, W64 signum)
 {
@@ -125,6 +132,7 @@ static void ptlcall_mmio_write(CPUX86State* cpu, W64 offset, W64 value,
             {
                 if (!config.quiet) cout << "PTLCALL type PTLCALL_MARKER\n";
                 cpu->regs[REG_rax] = 0;
+                simpoint_marker_reached(cpu);
                 break;
             }
         case PTLCALL_ENQUEUE:
@@ -405,6 +413,35 @@ int ptl_cpuid(uint32_t index, uint32_t count, uint32_t *eax, uint32_t *ebx,
     return 0;
 }
 
+/**
+ * @brief Save warm machine state to '<chk_name>.warm'
+ *
+ * Restored with 'load-warm-state' so runs from the checkpoint don't need
+ * detailed warm-up.
+ */
+static void save_warm_state(const char* chk_name)
+{
+    PTLsimMachine* machine = PTLsimMachine::getmachine(config.core_name);
+
+    if (!machine || !machine->initialized) {
+        ptl_logfile << "WARNING: Machine is not initialized, no warm state " <<
+            "is saved for checkpoint " << chk_name << endl;
+        return;
+    }
+
+    stringbuf filename;
+    filename << chk_name << ".warm";
+
+    ofstream os(filename.buf, std::ios::binary);
+    if (!os || !machine->save_warm_state(os)) {
+        ptl_logfile << "WARNING: Unable to save warm state to " <<
+            filename << endl;
+        return;
+    }
+
+    ptl_logfile << "Saved warm state to " << filename << endl;
+}
+
 void create_checkpoint(const char* chk_name)
 {
     if (!config.quiet)
@@ -416,6 +453,9 @@ void create_checkpoint(const char* chk_name)
                 qstring_from_str(chk_name)));
     do_savevm(cur_mon, checkpoint_dict);
 
+    if (config.save_warm_state)
+        save_warm_state(chk_name);
+
     if (!config.quiet)
         cout << "MARSSx86::Checkpoint " << chk_name <<
              " created\n";
@@ -423,6 +463,8 @@ void create_checkpoint(const char* chk_name)
 
 void ptl_check_ptlcall_queue() {
 
+    simpoint_check_marker();
+
     if(pending_call_type != -1) {
 
         switch(pending_call_type) {
@@ -477,6 +519,8 @@ RIPVirtPhys& RIPVirtPhys::update(Context& ctx, int bytes) {
 
 W64 Context::virt_to_pte_phys_addr(W64 rawvirt, byte& level) {
 
+    ParallelSharedAccess shared_access;
+
     W64 ptep;
     W64 pde_addr, pte_addr;
     W64 ret_addr;
@@ -605,6 +649,8 @@ finish:
 
 int Context::copy_from_vm(void* target, Waddr source, int bytes, PageFaultErrorCode& pfec, Waddr& faultaddr, bool forexec) {
 
+    ParallelSharedAccess shared_access;
+
     if (source == 0) {
         return -1;
     }
@@ -748,6 +794,8 @@ void Context::update_mode(bool is_kernel) {
 
 Waddr Context::check_and_translate(Waddr virtaddr, int sizeshift, bool store, bool internal, int& exception, int& mmio, PageFaultErrorCode& pfec, bool is_code) {
 
+    ParallelSharedAccess shared_access;
+
     exception = 0;
     pfec = 0;
 
@@ -836,6 +884,8 @@ Waddr Context::check_and_translate(Waddr virtaddr, int sizeshift, bool store, bo
 
 bool Context::is_mmio_addr(Waddr virtaddr, bool store) {
 
+    ParallelSharedAccess shared_access;
+
     int mmu_index = cpu_mmu_index((CPUState*)this);
     int index = (virtaddr >> TARGET_PAGE_BITS) & (CPU_TLB_SIZE - 1);
     W64 tlb_addr;
@@ -871,6 +921,8 @@ bool Context::is_mmio_addr(Waddr virtaddr, bool store) {
 }
 
 bool Context::has_page_fault(Waddr virtaddr, int store) {
+    ParallelSharedAccess shared_access;
+
     int mmu_index = cpu_mmu_index((CPUState*)this);
     int index = (virtaddr >> TARGET_PAGE_BITS) & (CPU_TLB_SIZE - 1);
     W64 tlb_addr;
@@ -930,6 +982,8 @@ int copy_from_user_phys_prechecked(void* target, Waddr source, int bytes, Waddr&
 }
 
 void Context::propagate_x86_exception(byte exception, W32 errorcode , Waddr virtaddr ) {
+    ParallelSharedAccess shared_access;
+
     if(logable(2))
         ptl_logfile << "Propagating exception from simulation at eip: " <<
                     this->eip << " cycle: " << sim_cycle << endl;
@@ -946,6 +1000,8 @@ void Context::propagate_x86_exception(byte exception, W32 errorcode , Waddr virt
 }
 
 W64 Context::loadvirt(Waddr virtaddr, int sizeshift) {
+    ParallelSharedAccess shared_access;
+
     Waddr addr = virtaddr;
     assert(virtaddr > 0xffff);
     setup_qemu_switch_all_ctx(*this);
@@ -1010,6 +1066,8 @@ W64 Context::loadvirt(Waddr virtaddr, int sizeshift) {
 }
 
 W64 Context::loadphys(Waddr addr, bool internal, int sizeshift) {
+    ParallelSharedAccess shared_access;
+
     /*
      * Currently we check sizeshift only for internal data
      * for data on RAM or IO we load data at 64 bit boundry
@@ -1061,6 +1119,8 @@ W64 Context::loadphys(Waddr addr, bool internal, int sizeshift) {
 }
 
 W64 Context::storemask_virt(Waddr virtaddr, W64 data, byte bytemask, int sizeshift) {
+    ParallelSharedAccess shared_access;
+
     setup_qemu_switch_all_ctx(*this);
     Waddr paddr = floor(virtaddr, 8);
 
@@ -1149,6 +1209,8 @@ W64 Context::storemask_virt(Waddr virtaddr, W64 data, byte bytemask, int sizeshi
 }
 
 void Context::check_store_virt(Waddr virtaddr, W64 data, byte bytemask, int sizeshift) {
+    ParallelSharedAccess shared_access;
+
     W64 data_r = 0;
     W64 mask = 0;
     switch(sizeshift) {
@@ -1187,6 +1249,8 @@ void Context::check_store_virt(Waddr virtaddr, W64 data, byte bytemask, int size
 }
 
 W64 Context::store_internal(Waddr addr, W64 data, byte bytemask) {
+    ParallelSharedAccess shared_access;
+
     W64 old_data = W64(*(W64*)(addr));
     W64 merged_data = mux64(expand_8bit_to_64bit_lut[bytemask],
             old_data, data);
@@ -1200,6 +1264,8 @@ W64 Context::store_internal(Waddr addr, W64 data, byte bytemask) {
 }
 
 W64 Context::storemask(Waddr paddr, W64 data, byte bytemask) {
+    ParallelSharedAccess shared_access;
+
     W64 old_data = 0;
     setup_qemu_switch_all_ctx(*this);
     if(logable(10))
@@ -1224,6 +1290,8 @@ W64 Context::storemask(Waddr paddr, W64 data, byte bytemask) {
 }
 
 void Context::handle_page_fault(Waddr virtaddr, int is_write) {
+    ParallelSharedAccess shared_access;
+
     setup_qemu_switch_all_ctx(*this);
 
     if(kernel_mode) {
@@ -1256,6 +1324,8 @@ void Context::handle_page_fault(Waddr virtaddr, int is_write) {
 
 bool Context::try_handle_fault(Waddr virtaddr, int store) {
 
+    ParallelSharedAccess shared_access;
+
     setup_qemu_switch_all_ctx(*this);
 
     if(logable(10))
@@ -1306,9 +1376,10 @@ struct Simpoint
 {
     int label;
     int interval;
+    double weight;
 
     Simpoint(int _interval, int _label)
-        : label(_label), interval(_interval)
+        : label(_label), interval(_interval), weight(0)
     { }
 
     bool operator < (const Simpoint& t) const
@@ -1332,6 +1403,21 @@ static W64 total_simpoint_inst_complted = 0;
 static int simpoint_ctr = -1;
 static int simpoint_enabled = 0;
 
+/*
+ * Simpoints are counted in instructions emulated by all CPU Contexts, the
+ * same way basic block vectors are collected. Instructions up to the next
+ * simpoint are split between CPUs using the fast-forward counters, CPUs that
+ * finish early wait for the others and instructions of halted CPUs are given
+ * to running ones by adjust_fwd_insts. total_simpoint_inst_complted is the
+ * global count at which currently allocated instructions are done.
+ */
+static W64 simpoint_insns_alloc = 0;
+static bool simpoint_wait_marker = false;
+static bool simpoint_marker_pending = false;
+static ofstream simpoint_weights_file;
+
+static void start_fast_fwd_warming();
+
 void add_simpoint(int point, int label)
 {
     Simpoint* t = new Simpoint(point, label);
@@ -1358,6 +1444,9 @@ void clear_simpoints(void)
     simpoints.clear();
     simpoint_ctr = -1;
     total_simpoint_inst_complted = 0;
+    simpoint_insns_alloc = 0;
+    simpoint_wait_marker = false;
+    simpoint_marker_pending = false;
 }
 
 void read_simpoint_file()
@@ -1403,7 +1492,172 @@ void read_simpoint_file()
     sort(simpoints.data, simpoints.size(), PointerSortComparator<Simpoint>());
 }
 
-void set_next_simpoint(CPUX86State* ctx)
+/**
+ * @brief Read weight of each simpoint from SimPoint's weights file
+ *
+ * Each line has a weight and the simpoint label it belongs to.
+ */
+static void read_simpoint_weights()
+{
+    ifstream is(config.simpoint_weights);
+
+    if (!is) {
+        cerr << "Error: Unable to read simpoint weights file: " <<
+            config.simpoint_weights << endl;
+        ptl_quit();
+        return;
+    }
+
+    stringbuf line;
+    char split_char[2] = {' ', '\0'};
+
+    while (1) {
+        dynarray<stringbuf*> split;
+        line.reset();
+        is.getline(line.buf, line.length);
+        if (!is) break;
+
+        line.split(split, split_char);
+
+        if (split.size() >= 2) {
+            double weight = atof(split[0]->buf);
+            int label = atoi(split[1]->buf);
+
+            foreach (i, simpoints.size()) {
+                if (simpoints[i]->label == label)
+                    simpoints[i]->weight = weight;
+            }
+        }
+
+        foreach(i, split.size()) {
+            stringbuf* tmp = split.pop();
+            delete tmp;
+        }
+    }
+
+    is.close();
+}
+
+/**
+ * @brief Split instructions between all CPUs' simpoint counters
+ */
+static void set_simpoint_counters(W64 insns)
+{
+    W64 per_cpu = insns / NUM_SIM_CORES;
+
+    simpoint_insns_alloc = insns;
+    total_simpoint_inst_complted += insns;
+    ptl_fast_fwd_enabled = 1;
+
+    /* Warm state is saved with each simpoint checkpoint */
+    if (config.fast_fwd_warm && config.save_warm_state &&
+            !ptl_fast_fwd_warming)
+        start_fast_fwd_warming();
+
+    foreach (i, NUM_SIM_CORES) {
+        Context& ctx = contextof(i);
+        ctx.simpoint_decr = per_cpu;
+        if (i == 0)
+            ctx.simpoint_decr += insns % NUM_SIM_CORES;
+        ctx.stopped = 0;
+        tb_flush(&ctx);
+    }
+}
+
+static void create_simpoint_checkpoint()
+{
+    stringbuf* chk_name = get_simpoint_chk_name();
+
+    ptl_logfile << "Simpoint " << get_simpoint_label(simpoint_ctr) <<
+        " reached after " << total_simpoint_inst_complted <<
+        " instructions\n";
+
+    create_checkpoint(chk_name->buf);
+
+    if (simpoint_weights_file) {
+        simpoint_weights_file << *chk_name << " " <<
+            simpoints[simpoint_ctr]->weight << endl;
+    }
+
+    delete chk_name;
+}
+
+/**
+ * @brief All instructions up to current simpoint are emulated
+ *
+ * With 'simpoint-marker' the checkpoint is created at the next
+ * PTLCALL_MARKER from any CPU, so regions of multi-threaded workloads start
+ * at a synchronization point. Instructions are still counted while waiting.
+ */
+static void simpoint_region_reached()
+{
+    if (config.simpoint_marker) {
+        simpoint_wait_marker = true;
+        set_simpoint_counters(config.simpoint_interval);
+        return;
+    }
+
+    create_simpoint_checkpoint();
+    set_next_simpoint();
+}
+
+/**
+ * @brief All CPUs are done with their simpoint counters
+ *
+ * @param insns_remaining Instructions left in counters of halted CPUs
+ */
+static void simpoint_counters_done(W64 insns_remaining)
+{
+    total_simpoint_inst_complted -= min(insns_remaining,
+            simpoint_insns_alloc);
+
+    if (simpoint_wait_marker) {
+        set_simpoint_counters(config.simpoint_interval);
+        return;
+    }
+
+    simpoint_region_reached();
+}
+
+/**
+ * @brief A CPU executed PTLCALL_MARKER, create pending simpoint checkpoint
+ *
+ * Called while CPU is executing, so all CPUs are stopped here and the
+ * checkpoint is created from main loop in ptl_check_ptlcall_queue.
+ */
+static void simpoint_marker_reached(CPUX86State* cpu)
+{
+    W64 insns_remaining = 0;
+
+    if (!simpoint_wait_marker)
+        return;
+
+    foreach (i, NUM_SIM_CORES) {
+        Context& ctx = contextof(i);
+        insns_remaining += ctx.simpoint_decr;
+        ctx.simpoint_decr = 0;
+        ctx.stopped = 1;
+    }
+
+    total_simpoint_inst_complted -= min(insns_remaining,
+            simpoint_insns_alloc);
+    simpoint_wait_marker = false;
+    simpoint_marker_pending = true;
+
+    cpu_exit(cpu);
+}
+
+static void simpoint_check_marker()
+{
+    if (!simpoint_marker_pending)
+        return;
+
+    simpoint_marker_pending = false;
+    create_simpoint_checkpoint();
+    set_next_simpoint();
+}
+
+void set_next_simpoint()
 {
     W64 point;
 
@@ -1411,18 +1665,28 @@ void set_next_simpoint(CPUX86State* ctx)
 
     if (simpoint_ctr >= simpoints.size()) {
         simpoint_enabled = 0;
-        ctx->simpoint_decr = 0;
+        ptl_fast_fwd_enabled = 0;
+        ptl_fast_fwd_warming = 0;
+
+        foreach (i, NUM_SIM_CORES) {
+            Context& ctx = contextof(i);
+            ctx.simpoint_decr = 0;
+            ctx.stopped = 0;
+            tb_flush(&ctx);
+        }
         return;
     }
 
     point = get_simpoint(simpoint_ctr) * config.simpoint_interval;
-    ctx->simpoint_decr = (point - total_simpoint_inst_complted);
-    total_simpoint_inst_complted = point;
-    tb_flush(ctx);
 
-    if (ctx->simpoint_decr == 0 && get_simpoint(simpoint_ctr) == 0) {
-        ptl_simpoint_reached(ctx->cpu_index);
+    /* Previous region was aligned to a marker past this simpoint */
+    if (point <= total_simpoint_inst_complted) {
+        if (simpoint_enabled)
+            simpoint_region_reached();
+        return;
     }
+
+    set_simpoint_counters(point - total_simpoint_inst_complted);
 }
 
 stringbuf* get_simpoint_chk_name()
@@ -1437,17 +1701,343 @@ stringbuf* get_simpoint_chk_name()
 
 void init_simpoints()
 {
-    /* First check if we are simulating only one core or not */
-    if (NUM_SIM_CORES != 1) {
-        cerr << "ERROR: Marss doesnt support simpoints with more than " <<
-            "one CPU Context.  Please simulate with only one CPU.\n";
-        ptl_quit();
-    }
+    /* Called when each CPU Context is created */
+    if (simpoint_enabled)
+        return;
 
     read_simpoint_file();
+
+    if (config.simpoint_weights.set()) {
+        read_simpoint_weights();
+
+        stringbuf weights_name;
+        weights_name << config.simpoint_chk_name << ".weights";
+        simpoint_weights_file.open(weights_name.buf);
+    }
+
     simpoint_enabled = 1;
 }
 
+/* Basic Block Vector Profiling */
+
+uint8_t ptl_bbv_enabled = 0;
+
+static BBVProfiler* bbv_profiler = NULL;
+static ofstream bbv_file;
+
+void start_bbv_profiling()
+{
+    if (bbv_profiler)
+        return;
+
+    bbv_file.open(config.bbv_file.buf);
+    if (!bbv_file) {
+        cerr << "Error: Unable to open basic block vector file: " <<
+            config.bbv_file << endl;
+        return;
+    }
+
+    bbv_profiler = new BBVProfiler(bbv_file, config.simpoint_interval);
+    ptl_bbv_enabled = 1;
+
+    ptl_logfile << "Writing basic block vectors of every " <<
+        config.simpoint_interval << " instructions to " <<
+        config.bbv_file << endl;
+
+    /* Retranslate all blocks with profiling code */
+    foreach (i, NUM_SIM_CORES) {
+        tb_flush(&contextof(i));
+    }
+}
+
+/*
+ * Blocks are identified by physical address and number of instructions, so
+ * shared code executed by different processes is counted as one block and
+ * ids stay the same when translation cache is flushed.
+ */
+int ptl_bbv_block_id(W64 phys_pc, int icount)
+{
+    return bbv_profiler->block_id((W64(icount) << 48) | phys_pc);
+}
+
+void ptl_bbv_count(int cpuid, int bbid, int icount)
+{
+    bbv_profiler->count(bbid, icount);
+}
+
+/*
+ * Event Trace Record and Replay
+ *
+ * QEMU reaches the simulator asynchronously in two ways: it raises
+ * interrupt_request of a CPU and the host alarm sets exit_request to get
+ * back to its main loop, where timers, device IO and DMA completions run.
+ * Virtual clock follows sim_cycle in simulation, so given the same cycles
+ * of main loop entries, timers and devices behave the same. Recording saves
+ * the cycle of every exit request and interrupt change, replay injects exit
+ * requests at recorded cycles instead of host timed ones and checks that
+ * interrupts arrive in the same cycle. Outstanding disk IO is completed at
+ * each main loop entry so it does not depend on host IO latency.
+ */
+
+uint8_t ptl_event_trace_enabled = 0;
+
+static ofstream event_record_file;
+static EventTraceWriter* event_recorder = NULL;
+
+static ifstream event_replay_file;
+static EventTraceReader* event_replayer = NULL;
+static TraceEvent next_replay_event;
+static W64 replay_divergences = 0;
+
+static W32 last_interrupt_request[NUM_SIM_CORES];
+static bool last_exit_request[NUM_SIM_CORES];
+static bool replay_exit_injected[NUM_SIM_CORES];
+static W32 replay_interrupt_request[NUM_SIM_CORES];
+static bool replay_diverged[NUM_SIM_CORES];
+
+static void reset_event_trace_state()
+{
+    foreach (i, contextcount) {
+        Context& ctx = contextof(i);
+        last_interrupt_request[i] = ctx.interrupt_request;
+        replay_interrupt_request[i] = ctx.interrupt_request;
+        last_exit_request[i] = false;
+        replay_exit_injected[i] = false;
+        replay_diverged[i] = false;
+    }
+}
+
+static void stop_event_record()
+{
+    ptl_logfile << "Recorded " << event_recorder->get_count() <<
+        " events to " << config.event_trace_record_filename << endl;
+
+    delete event_recorder;
+    event_recorder = NULL;
+    event_record_file.close();
+    ptl_event_trace_enabled = (event_replayer != NULL);
+}
+
+static void stop_event_replay(const char* reason)
+{
+    stringbuf sb;
+    sb << "Event replay " << reason << " at cycle " << sim_cycle << " with " <<
+        replay_divergences << " interrupt divergences" << endl;
+    ptl_logfile << sb << flush;
+    cerr << sb << flush;
+
+    delete event_replayer;
+    event_replayer = NULL;
+    event_replay_file.close();
+    ptl_event_trace_enabled = (event_recorder != NULL);
+}
+
+static void start_event_record()
+{
+    event_record_file.open(config.event_trace_record_filename.buf);
+    if (!event_record_file) {
+        cerr << "Error: Unable to open event record file: " <<
+            config.event_trace_record_filename << endl;
+        config.event_trace_record_filename.reset();
+        return;
+    }
+
+    event_recorder = new EventTraceWriter(event_record_file);
+    ptl_logfile << "Recording events to " <<
+        config.event_trace_record_filename << " from cycle " << sim_cycle <<
+        endl;
+}
+
+static void start_event_replay()
+{
+    event_replay_file.open(config.event_trace_replay_filename.buf);
+    if (!event_replay_file) {
+        cerr << "Error: Unable to open event replay file: " <<
+            config.event_trace_replay_filename << endl;
+        config.event_trace_replay_filename.reset();
+        return;
+    }
+
+    event_replayer = new EventTraceReader(event_replay_file);
+    if (!event_replayer->is_valid()) {
+        cerr << "Error: " << config.event_trace_replay_filename <<
+            " is not an event trace" << endl;
+        delete event_replayer;
+        event_replayer = NULL;
+        event_replay_file.close();
+        config.event_trace_replay_filename.reset();
+        return;
+    }
+
+    replay_divergences = 0;
+    ptl_logfile << "Replaying events from " <<
+        config.event_trace_replay_filename << endl;
+
+    if (!event_replayer->read(next_replay_event))
+        stop_event_replay("found no events");
+}
+
+void init_event_trace()
+{
+    if (config.event_trace_record_stop) {
+        config.event_trace_record_stop = 0;
+        if (event_recorder)
+            stop_event_record();
+        config.event_trace_record_filename.reset();
+    }
+
+    if (config.event_trace_record_filename.set() &&
+            config.event_trace_replay_filename.set()) {
+        cerr << "Error: event-record and event-replay can't be used " <<
+            "together, recording is disabled" << endl;
+        config.event_trace_record_filename.reset();
+    }
+
+    if (config.event_trace_record_filename.set() && !event_recorder)
+        start_event_record();
+
+    if (config.event_trace_replay_filename.set() && !event_replayer)
+        start_event_replay();
+
+    if (!ptl_event_trace_enabled && (event_recorder || event_replayer)) {
+        reset_event_trace_state();
+        ptl_event_trace_enabled = 1;
+    }
+}
+
+static void record_events()
+{
+    foreach (i, contextcount) {
+        Context& ctx = contextof(i);
+        TraceEvent event;
+        event.cycle = sim_cycle;
+        event.cpu = i;
+
+        if unlikely (ctx.interrupt_request != last_interrupt_request[i]) {
+            event.type = TRACE_EVENT_INTERRUPT;
+            event.data = ctx.interrupt_request;
+            event_recorder->write(event);
+            last_interrupt_request[i] = ctx.interrupt_request;
+        }
+
+        bool exit = ctx.exit_request;
+        if unlikely (exit && !last_exit_request[i]) {
+            event.type = TRACE_EVENT_EXIT;
+            event.data = 0;
+            event_recorder->write(event);
+        }
+        last_exit_request[i] = exit;
+    }
+}
+
+/*
+ * Exit requests that stop or reconfigure the simulation, unlike the ones
+ * the host alarm timer raises to run QEMU's main loop: a stopped vm,
+ * QEMU system requests like a shutdown from a signal, ptlcalls and
+ * simpoint markers.
+ */
+static bool explicit_exit_pending()
+{
+    return !vm_running || qemu_system_request_pending() ||
+        (pending_call_type != -1) || simpoint_marker_pending;
+}
+
+static void replay_events()
+{
+    /*
+     * Alarm driven exits depend on host time, so only the ones from the
+     * trace run the main loop. Explicit requests are let through.
+     */
+    bool keep_exits = explicit_exit_pending();
+
+    foreach (i, contextcount) {
+        Context& ctx = contextof(i);
+        if (!ctx.exit_request)
+            replay_exit_injected[i] = false;
+        else if (!replay_exit_injected[i] && !keep_exits)
+            ctx.exit_request = 0;
+    }
+
+    while (next_replay_event.cycle <= sim_cycle) {
+        TraceEvent& event = next_replay_event;
+
+        if unlikely (event.cpu >= contextcount) {
+            stop_event_replay("found an invalid CPU");
+            return;
+        }
+
+        if (event.type == TRACE_EVENT_EXIT) {
+            contextof(event.cpu).exit_request = 1;
+            replay_exit_injected[event.cpu] = true;
+        } else {
+            replay_interrupt_request[event.cpu] = event.data;
+        }
+
+        if (!event_replayer->read(next_replay_event)) {
+            stop_event_replay("reached end of trace");
+            return;
+        }
+    }
+
+    /*
+     * Interrupts are raised by devices which are driven by replayed exit
+     * requests, so they are not injected but only checked. A divergence
+     * means some input, like network packets, was not recorded.
+     */
+    foreach (i, contextcount) {
+        bool diverged = (contextof(i).interrupt_request !=
+                replay_interrupt_request[i]);
+
+        if unlikely (diverged && !replay_diverged[i]) {
+            if (replay_divergences++ == 0) {
+                ptl_logfile << "Warning: event replay diverged at cycle " <<
+                    sim_cycle << " cpu " << i << ": interrupt_request " <<
+                    contextof(i).interrupt_request << " expected " <<
+                    replay_interrupt_request[i] << endl;
+            }
+        }
+        replay_diverged[i] = diverged;
+    }
+}
+
+void event_trace_sample()
+{
+    if (event_recorder)
+        record_events();
+    else if (event_replayer)
+        replay_events();
+}
+
+W64 get_next_event_trace_cycle()
+{
+    if (event_replayer)
+        return next_replay_event.cycle;
+
+    return (W64)-1;
+}
+
+void event_trace_sync()
+{
+    bool exiting = false;
+    foreach (i, contextcount) {
+        exiting |= contextof(i).exit_request;
+        last_exit_request[i] = false;
+        replay_exit_injected[i] = false;
+    }
+
+    if (exiting)
+        qemu_aio_flush();
+}
+
+void finish_event_trace()
+{
+    if (event_recorder)
+        stop_event_record();
+
+    if (event_replayer)
+        stop_event_replay("stopped");
+}
+
 /**
  * @brief Flag to indicate if simulation is waiting for fast-fwd to complete
  *
@@ -1456,8 +2046,56 @@ void init_simpoints()
  */
 uint8_t ptl_fast_fwd_enabled = 0;
 
+uint8_t ptl_fast_fwd_warming = 0;
+
+/* Machine being warmed, current machine is reset when simulation stops */
+static PTLsimMachine* warm_machine = NULL;
+
 uint8_t sim_update_clock_offset = 1;
 
+/**
+ * @brief Initialize the simulated machine and start warming its state
+ */
+static void start_fast_fwd_warming()
+{
+    /* Warm state is lost when a checkpoint is created without it */
+    if (config.fast_fwd_checkpoint.size() > 0 && !config.save_warm_state) {
+        ptl_logfile << "WARNING: fast-fwd-warm is ignored when creating " <<
+            "fast-fwd-checkpoint without save-warm-state\n";
+        return;
+    }
+
+    PTLsimMachine* machine = get_sim_machine();
+    if (!machine) {
+        ptl_logfile << "WARNING: Unable to initialize machine, fast-forward " <<
+            "without warming\n";
+        return;
+    }
+
+    machine->setup_warming();
+    warm_machine = machine;
+    ptl_fast_fwd_warming = 1;
+
+    ptl_logfile << "Warming caches, TLBs and branch predictors during " <<
+        "fast-forward\n";
+}
+
+void ptl_warm_fetch(int cpuid, W64 rip)
+{
+    warm_machine->warm_fetch(contextof(cpuid), rip);
+}
+
+void ptl_warm_mem(int cpuid, W64 addr, int is_write)
+{
+    warm_machine->warm_mem(contextof(cpuid), addr, is_write);
+}
+
+void ptl_warm_branch(int cpuid, W64 ripafter, W64 target, int type)
+{
+    warm_machine->warm_branch(contextof(cpuid), type,
+            ripafter, target);
+}
+
 /**
  * @brief Set CPU's simpoint_decr count to fast-forward simulation mode
  */
@@ -1465,16 +2103,36 @@ void set_cpu_fast_fwd()
 {
     W64 fwd_insns;
 
+    /* Simpoints use the fast-forward counters to reach each region */
+    if (simpoint_enabled)
+        return;
+
+    /* Sampling controller does its own fast-forward */
+    if (config.sampling_period > 0) {
+        start_sampling();
+        return;
+    }
+
     if (config.fast_fwd_insns == 0 && config.fast_fwd_user_insns == 0)
         return;
 
     if (config.fast_fwd_insns > 0) {
-        ptl_fast_fwd_enabled = 1;
-        fwd_insns = config.fast_fwd_insns;
+        fast_fwd_cpus(config.fast_fwd_insns, 1);
     } else if (config.fast_fwd_user_insns > 0) {
-        ptl_fast_fwd_enabled = 2;
-        fwd_insns = config.fast_fwd_user_insns;
+        fast_fwd_cpus(config.fast_fwd_user_insns, 2);
     }
+}
+
+/**
+ * @brief Fast-forward all CPUs before switching to simulation mode
+ *
+ * @param fwd_insns Instructions to emulate, split evenly between CPUs
+ * @param mode Value of ptl_fast_fwd_enabled, 2 to count only user level
+ * instructions
+ */
+void fast_fwd_cpus(W64 fwd_insns, uint8_t mode)
+{
+    ptl_fast_fwd_enabled = mode;
 
     /* Set each CPU's counter specified from config.fast_fwd_insns */
     W64 per_cpu_fast_fwd = fwd_insns / NUM_SIM_CORES;
@@ -1482,6 +2140,9 @@ void set_cpu_fast_fwd()
     ptl_logfile << "All CPU context will be fast-forwared to " <<
         per_cpu_fast_fwd << " instructions.\n";
 
+    if (config.fast_fwd_warm && !ptl_fast_fwd_warming)
+        start_fast_fwd_warming();
+
     foreach (i, NUM_SIM_CORES) {
         Context& ctx = contextof(i);
         ctx.simpoint_decr = per_cpu_fast_fwd;
@@ -1533,16 +2194,19 @@ static void adjust_fwd_insts(Context& ctx)
 }
 
 /**
- * @brief CPU has emulated fast-fwd instructions, check if simulation point has
- * reached or not
+ * @brief CPU has emulated its fast-fwd instructions, check if all CPUs are
+ * done
  *
  * @param ctx CPU Context that finished emulating its allocated instructions
+ * @param insns_remaining Set to instructions left in counters of all CPUs
+ *
+ * @return true if all CPUs are either stopped or halted
  */
-static void cpu_fast_fwded(Context& ctx)
+static bool cpus_fast_fwded(Context& ctx, W64& insns_remaining)
 {
     bool all_halted_or_stopped = true;
     bool others_halted = false;
-    W64 insns_remaining = 0;
+    insns_remaining = 0;
 
     /* Stop this CPU and check if all CPU are stopped or not */
     ctx.stopped = 1;
@@ -1574,12 +2238,25 @@ static void cpu_fast_fwded(Context& ctx)
                     ctx.simpoint_decr << " instructions\n";
             }
             ctx.stopped = 0;
-            return;
+            return false;
         }
     }
 
+    return all_halted_or_stopped;
+}
+
+/**
+ * @brief CPU has emulated fast-fwd instructions, check if simulation point has
+ * reached or not
+ *
+ * @param ctx CPU Context that finished emulating its allocated instructions
+ */
+static void cpu_fast_fwded(Context& ctx)
+{
+    W64 insns_remaining;
+
     /* If all CPU's are stopped then issue -run to start simulation */
-    if (all_halted_or_stopped) {
+    if (cpus_fast_fwded(ctx, insns_remaining)) {
 
         /* If we still have any instrucitons remaining then print message
          * to logfile indicating that we are switching to simulation
@@ -1600,6 +2277,11 @@ static void cpu_fast_fwded(Context& ctx)
 
         ptl_fast_fwd_enabled = 0;
 
+        if (ptl_fast_fwd_warming) {
+            warm_machine->finish_warming();
+            ptl_fast_fwd_warming = 0;
+        }
+
         foreach (i, NUM_SIM_CORES) {
             contextof(i).stopped = 0;
             tb_flush(&contextof(i));
@@ -1628,16 +2310,17 @@ void ptl_simpoint_reached(int cpuid)
     Context& ctx = contextof(cpuid);
 
     if (simpoint_enabled) {
+        W64 insns_remaining;
 
-        stringbuf* chk_name = get_simpoint_chk_name();
-        create_checkpoint(chk_name->buf);
-
-        set_next_simpoint(&ctx);
-
-        delete chk_name;
+        if (!simpoint_marker_pending &&
+                cpus_fast_fwded(ctx, insns_remaining)) {
+            simpoint_counters_done(insns_remaining);
+        }
+        return;
     }
 
-    if (config.fast_fwd_insns > 0 || config.fast_fwd_user_insns > 0) {
+    if (config.fast_fwd_insns > 0 || config.fast_fwd_user_insns > 0 ||
+            sampling_active()) {
         cpu_fast_fwded(ctx);
     }
 }
@@ -1651,14 +2334,20 @@ void ptl_qemu_initialized(void)
     qemu_initialized = 1;
 
     // If config.run_tests is enabled, then run testcases
-    if(config.run_tests) {
-        run_tests();
+    if(config.run_tests || config.run_benchmarks) {
+        run_tests(config.run_benchmarks);
     }
 
     if (simpoint_enabled) {
-        set_next_simpoint(&contextof(0));
+        set_next_simpoint();
     }
 
+    if (config.bbv_file.set()) {
+        start_bbv_profiling();
+    }
+
+    init_event_trace();
+
     set_cpu_fast_fwd();
 
     if (config.run) {
@@ -47,7 +47,11 @@ extern "C" {
  *              mode
  */
 typedef unsigned long long W64;
+#ifdef ENABLE_QUANTUM_THREADS
+extern __thread W64 sim_cycle;
+#else
 extern W64 sim_cycle;
+#endif
 
 /*
  * in_simulation
@@ -197,6 +201,14 @@ void ptl_add_phys_memory_mapping(int8_t cpu_index, uint64_t host_vaddr, uint64_t
  */
 void qemu_take_screenshot(char* filename);
 
+/*
+ * qemu_next_sim_timer_deadline
+ * returns int64_t
+ * working      : Nano-seconds of simulated time until the next vm_clock
+ *                timer expires, INT64_MAX if no timer is active
+ */
+int64_t qemu_next_sim_timer_deadline(void);
+
 /**
  * @brief Safe interface to exit the process
  */
@@ -234,11 +246,65 @@ void ptl_simpoint_reached(int cpuid);
 void init_simpoints(void);
 
 /**
- * @brief Set CPU's simpoint counter
+ * @brief Set simpoint counters of all CPUs up to the next simpoint
+ *
+ * Simpoints are counted in instructions emulated by all CPUs together.
+ */
+void set_next_simpoint(void);
+
+/**
+ * @brief Indicate if basic block vectors are collected in emulation mode
+ *
+ * Checked when QEMU translates a block, so blocks are flushed when it changes
+ */
+extern uint8_t ptl_bbv_enabled;
+
+/**
+ * @brief Basic block vector profiling callbacks
+ *
+ * ptl_bbv_block_id() is called once for each translated block and its
+ * result is passed to ptl_bbv_count() every time the block is executed.
+ */
+int ptl_bbv_block_id(W64 phys_pc, int icount);
+void ptl_bbv_count(int cpuid, int bbid, int icount);
+
+/**
+ * @brief Start writing basic block vectors to 'bbv-file'
+ */
+void start_bbv_profiling(void);
+
+/**
+ * @brief Indicate if events are recorded to 'event-record' or replayed from
+ * 'event-replay'
+ */
+extern uint8_t ptl_event_trace_enabled;
+
+/**
+ * @brief Open or close event trace files set in configuration
+ */
+void init_event_trace(void);
+
+/**
+ * @brief Record or replay asynchronous QEMU events of current cycle
  *
- * @param ctx CPU Context
+ * Called every cycle before Contexts sample their pending events.
+ */
+void event_trace_sample(void);
+
+/**
+ * @brief Cycle of next event to replay, -1 if there is none
+ */
+W64 get_next_event_trace_cycle(void);
+
+/**
+ * @brief Simulation is returning to QEMU main loop
+ */
+void event_trace_sync(void);
+
+/**
+ * @brief Close event trace files at the end of simulation
  */
-void set_next_simpoint(CPUX86State* ctx);
+void finish_event_trace(void);
 
 /**
  * @brief Indicate if Emualtion mode is running in fast-fwd mode or not
@@ -248,12 +314,41 @@ void set_next_simpoint(CPUX86State* ctx);
  */
 extern uint8_t ptl_fast_fwd_enabled;
 
+/**
+ * @brief Indicate if emulated memory accesses and branches are used to warm
+ * up simulated caches, TLBs and branch predictors during fast-forward
+ *
+ * Checked when QEMU translates a block, so blocks are flushed when it changes
+ */
+extern uint8_t ptl_fast_fwd_warming;
+
+/* Branch types passed to ptl_warm_branch, same as BRANCH_HINT_* flags */
+#define PTL_WARM_BRANCH_UNCOND      0
+#define PTL_WARM_BRANCH_COND        (1 << 0)
+#define PTL_WARM_BRANCH_INDIRECT    (1 << 1)
+#define PTL_WARM_BRANCH_CALL        (1 << 2)
+#define PTL_WARM_BRANCH_RET         (1 << 3)
+
+/**
+ * @brief Functional warming callbacks from emulated code
+ *
+ * @param cpuid CPU that executed the instruction
+ */
+void ptl_warm_fetch(int cpuid, W64 rip);
+void ptl_warm_mem(int cpuid, W64 addr, int is_write);
+void ptl_warm_branch(int cpuid, W64 ripafter, W64 target, int type);
+
 /**
  * @brief Set each CPU Context to fast forward N instructions before
  * switching to simulation mode
  */
 void set_cpu_fast_fwd(void);
 
+/**
+ * @brief Fast-forward all CPU Contexts by total of N instructions
+ */
+void fast_fwd_cpus(W64 fwd_insns, uint8_t mode);
+
 /**
  * @brief Initialize simulator structures after QEMU's initialization
  *
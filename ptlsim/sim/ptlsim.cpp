@@ -25,12 +25,14 @@
 #include <machine.h>
 #include <statelist.h>
 #include <decode.h>
+#include <bbfile.h>
 
 #include <fstream>
 #include <syscalls.h>
 #include <ptl-qemu.h>
 
 #include <test.h>
+#include <sampling.h>
 /*
  * DEPRECATED CONFIG OPTIONS:
  perfect_cache
@@ -52,7 +54,7 @@ ofstream ptl_rip_trace;
 ofstream trace_mem_logfile;
 ofstream yaml_stats_file;
 bool logenable = 0;
-W64 sim_cycle = 0;
+SIM_CYCLE_TLS W64 sim_cycle = 0;
 W64 unhalted_cycle_count = 0;
 W64 iterations = 0;
 W64 total_uops_executed = 0;
@@ -73,6 +75,7 @@ const char *snapshot_names[] = {"user", "kernel", "global"};
 Stats *user_stats;
 Stats *kernel_stats;
 Stats *global_stats;
+Stats *sampled_stats = NULL;
 
 ofstream *time_stats_file;
 
@@ -185,6 +188,17 @@ void ConfigurationParser<PTLsimConfig>::reset() {
   fast_fwd_insns = 0;
   fast_fwd_user_insns = 0;
   fast_fwd_checkpoint = "";
+  fast_fwd_warm = 0;
+  save_warm_state = 0;
+  load_warm_state = "";
+
+  sampling_period = 0;
+  sampling_warm = 2000;
+  sampling_window = 1000;
+  sampling_confidence = 0.997;
+  sampling_error = 0.03;
+  sampling_min_windows = 30;
+  sampling_max_windows = infinity;
 
   // memory model
   use_memory_model = 0;
@@ -210,8 +224,14 @@ void ConfigurationParser<PTLsimConfig>::reset() {
   dumpcode_filename = "test.dat";
   dump_at_end = 0;
   bbcache_dump_filename.reset();
+  bbcache_filename.reset();
+  bbcache_file_size = 256;
 
   machine_config = "";
+  machine_options = "";
+  skip_idle_cycles = 0;
+  parallel_threads = 0;
+  parallel_quantum = 0;
 
   ///
   /// memory hierarchy implementation
@@ -229,6 +249,7 @@ void ConfigurationParser<PTLsimConfig>::reset() {
 
   // Test Framework
   run_tests = 0;
+  run_benchmarks = 0;
 
   // Utilities/Tools
   execute_after_kill = "";
@@ -240,6 +261,9 @@ void ConfigurationParser<PTLsimConfig>::reset() {
   simpoint_file = "";
   simpoint_interval = 10e6;
   simpoint_chk_name = "simpoint";
+  simpoint_weights = "";
+  simpoint_marker = 0;
+  bbv_file = "";
 }
 
 template <>
@@ -282,6 +306,9 @@ void ConfigurationParser<PTLsimConfig>::setup() {
   add(fast_fwd_insns,               "fast-fwd-insns",       "Fast Fwd each CPU by <N> instructions");
   add(fast_fwd_user_insns,          "fast-fwd-user-insns",  "Fast Fwd each CPU by <N> user level instructions");
   add(fast_fwd_checkpoint,          "fast-fwd-checkpoint",  "Create a checkpoint <chk-name> after fast-forwarding");
+  add(fast_fwd_warm,                "fast-fwd-warm",        "Warm up caches, TLBs and branch predictors while fast-forwarding");
+  add(save_warm_state,              "save-warm-state",      "Save caches, directory, TLBs and branch predictors to '<chk-name>.warm' with each checkpoint");
+  add(load_warm_state,              "load-warm-state",      "Restore caches, directory, TLBs and branch predictors from file when machine is initialized");
   add(stop_at_insns,                "stopinsns",            "Stop after executing <stopinsns> user instructions");
   add(stop_at_cycle,                "stopcycle",            "Stop after <stop> cycles");
   add(stop_at_iteration,            "stopiter",             "Stop after <stop> iterations (does not apply to cycle-accurate cores)");
@@ -292,6 +319,14 @@ void ConfigurationParser<PTLsimConfig>::setup() {
   add(insns_in_last_basic_block,    "bbinsns",              "In final basic block, only translate <bbinsns> user instructions");
   add(flush_interval,               "flushevery",           "Flush the pipeline every N committed instructions");
   add(kill_after_run,               "kill-after-run",       "Kill PTLsim after this run");
+  section("Statistical Sampling");
+  add(sampling_period,              "sampling-period",      "Simulate one detailed window every <N> instructions and fast-forward the rest (0 to disable)");
+  add(sampling_warm,                "sampling-warm",        "Detailed warming instructions before each measured window");
+  add(sampling_window,              "sampling-window",      "Instructions in each measured window");
+  add(sampling_confidence,          "sampling-confidence",  "Confidence level of reported CPI interval");
+  add(sampling_error,               "sampling-error",       "Stop sampling when CPI interval is within this relative error of mean");
+  add(sampling_min_windows,         "sampling-min-windows", "Minimum number of measured windows before stopping early");
+  add(sampling_max_windows,         "sampling-max-windows", "Stop sampling after <N> measured windows");
   section("Event Trace Recording");
   add(event_trace_record_filename,  "event-record",         "Save replayable events (interrupts, DMAs, etc) to this file");
   add(event_trace_record_stop,      "event-record-stop",    "Stop recording events");
@@ -311,11 +346,17 @@ void ConfigurationParser<PTLsimConfig>::setup() {
   add(dumpcode_filename,            "dumpcode",             "Save page of user code at final rip to file <dumpcode>");
   add(dump_at_end,                  "dump-at-end",          "Set breakpoint and dump core before first instruction executed on return to native mode");
   add(bbcache_dump_filename,        "bbdump",               "Basic block cache dump filename");
+  add(bbcache_filename,             "bbcache-file",         "Keep decoded basic blocks across runs in this file");
+  add(bbcache_file_size,            "bbcache-file-size",    "Size in MB of a new basic block file");
 
   add(verify_cache,                 "verify-cache",         "run simulation with storing actual data in cache");
 
   section("Core Configuration");
   add(machine_config, "machine", "Name of machine configuration to simulate");
+  add(machine_options, "machine-options", "Override machine options, as <name>.<option>=<value>,... (e.g. L2_*.size=4M)");
+  add(skip_idle_cycles, "skip-idle-cycles", "Skip cycles in which all cores wait for memory events");
+  add(parallel_threads, "parallel-threads", "Number of host threads used to simulate cores in parallel (0 or 1 runs serially)");
+  add(parallel_quantum, "parallel-quantum", "Cycles each core runs ahead before memory accesses are replayed (0 runs cores in lockstep, more than one host thread needs a quantum=1 build)");
 
   ///
   /// following are for the new memory hierarchy implementation:
@@ -335,6 +376,7 @@ void ConfigurationParser<PTLsimConfig>::setup() {
   // Test Framework
   section("Unit Test Framework");
   add(run_tests,            "run-tests",            "Run Test cases");
+  add(run_benchmarks,       "run-benchmarks",       "Run host time benchmarks instead of test cases");
 
   // Utilities/Tools
   section("options for tools/utilities");
@@ -347,6 +389,9 @@ void ConfigurationParser<PTLsimConfig>::setup() {
   add(simpoint_file, "simpoint", "Create simpoint based checkpoints from given 'simpoint' file");
   add(simpoint_interval, "simpoint-interval", "Number of instructions in each interval");
   add(simpoint_chk_name, "simpoint-chk-name", "Checkpoint name prefix");
+  add(simpoint_weights, "simpoint-weights", "Simpoint weights file, weights are written to '<simpoint-chk-name>.weights' with checkpoint names");
+  add(simpoint_marker, "simpoint-marker", "Delay each simpoint checkpoint to the next PTLCALL_MARKER from any CPU");
+  add(bbv_file, "bbv-file", "Write basic block vectors of each 'simpoint-interval' emulated instructions to file");
 };
 
 #ifndef CONFIG_ONLY
@@ -406,6 +451,7 @@ void print_usage() {
 stringbuf current_stats_filename;
 stringbuf current_log_filename;
 stringbuf current_bbcache_dump_filename;
+stringbuf current_bbcache_filename;
 stringbuf current_trace_memory_updates_logfile;
 stringbuf current_yaml_stats_filename;
 W64 current_start_sim_rip;
@@ -471,6 +517,12 @@ void dump_yaml_stats()
   (StatsBuilder::get()).dump(global_stats, g_out);
   yaml_stats_file << g_out.c_str() << "\n";
 
+  if (sampled_stats) {
+    YAML::Emitter s_out;
+    (StatsBuilder::get()).dump(sampled_stats, s_out);
+    yaml_stats_file << s_out.c_str() << "\n";
+  }
+
   yaml_stats_file.flush();
 }
 
@@ -486,6 +538,9 @@ void dump_text_stats()
   (StatsBuilder::get()).dump(kernel_stats, yaml_stats_file, "kernel.");
   (StatsBuilder::get()).dump(global_stats, yaml_stats_file, "total.");
 
+  if (sampled_stats)
+    (StatsBuilder::get()).dump(sampled_stats, yaml_stats_file, "sampled.");
+
   yaml_stats_file.flush();
 }
 
@@ -607,17 +662,34 @@ bool handle_config_change(PTLsimConfig& config) {
     current_bbcache_dump_filename = config.bbcache_dump_filename;
   }
 
+  if (config.bbcache_filename.set() && (config.bbcache_filename != current_bbcache_filename)) {
+    bbfile.open(config.bbcache_filename, config.bbcache_file_size << 20);
+    current_bbcache_filename = config.bbcache_filename;
+  }
+
 #ifdef __x86_64__
   config.start_log_at_rip = signext64(config.start_log_at_rip, 48);
   config.start_at_rip = signext64(config.start_at_rip, 48);
   config.stop_at_rip = signext64(config.stop_at_rip, 48);
 #endif
 
-  if ((config.fast_fwd_insns || config.fast_fwd_user_insns) && qemu_initialized) {
+  if (config.bbv_file.set() && qemu_initialized) {
+    start_bbv_profiling();
+  }
+
+  if ((config.event_trace_record_filename.set() ||
+        config.event_trace_record_stop ||
+        config.event_trace_replay_filename.set()) && qemu_initialized) {
+    init_event_trace();
+  }
+
+  if ((config.fast_fwd_insns || config.fast_fwd_user_insns ||
+        config.sampling_period) && qemu_initialized) {
     set_cpu_fast_fwd();
   }
 
-  if (config.run && (config.fast_fwd_insns > 0 || config.fast_fwd_user_insns > 0)) {
+  if (config.run && (config.fast_fwd_insns > 0 || config.fast_fwd_user_insns > 0 ||
+        config.sampling_period > 0)) {
     /* Disable run untill cpus are fast-forwarded */
     config.run = 0;
   }
@@ -900,7 +972,7 @@ extern "C" void ptl_machine_configure(const char* config_str_) {
 
   ptl_machine.disable_dump();
 
-  if(config.run_tests) {
+  if(config.run_tests || config.run_benchmarks) {
     in_simulation = 1;
   }
 }
@@ -1211,6 +1283,12 @@ static void setup_sim_stats()
   simstats.tags.set(user_stats, user_tags);
   simstats.tags.set(global_stats, total_tags);
 
+  if (sampled_stats) {
+    stringbuf sampled_tags;
+    sampled_tags << base_tags << "sampled";
+    simstats.tags.set(sampled_stats, sampled_tags);
+  }
+
 #define COLLECT_SYSINFO(stat) \
   simstats.set_default_stats(stat); \
   collect_common_sysinfo();
@@ -1254,7 +1332,15 @@ static void dump_machine_configuration(PTLsimMachine *machine)
   }
 }
 
-extern "C" uint8_t ptl_simulate() {
+/**
+ * @brief Get the simulated machine, initialize it on first use
+ *
+ * @return Selected machine or NULL if it can't be found or initialized
+ *
+ * Normally called when simulation starts, fast-forward with warming calls it
+ * earlier so caches and predictors can be warmed up during emulation.
+ */
+PTLsimMachine* get_sim_machine() {
   PTLsimMachine* machine = NULL;
   char* machinename = config.core_name;
   if likely (curr_ptl_machine != NULL) {
@@ -1266,20 +1352,14 @@ extern "C" uint8_t ptl_simulate() {
   if (!machine) {
     ptl_logfile << "Cannot find core named '" << machinename << "'" << endl;
     cerr << "Cannot find core named '" << machinename << "'" << endl;
-    return 0;
-  }
-
-  // If config.run_tests is enabled, then run testcases
-  if(config.run_tests) {
-    run_tests();
+    return NULL;
   }
 
   if (!machine->initialized) {
     ptl_logfile << "Initializing core '" << machinename << "'" << endl;
     if (!machine->init(config)) {
       ptl_logfile << "Cannot initialize simulation machine; check the configuration!" << endl;
-      config.run = 0;
-      return 0;
+      return NULL;
     }
     machine->initialized = 1;
     machine->first_run = 1;
@@ -1330,6 +1410,24 @@ extern "C" uint8_t ptl_simulate() {
     }
   }
 
+  return machine;
+}
+
+extern "C" uint8_t ptl_simulate() {
+  // If config.run_tests is enabled, then run testcases
+  if(config.run_tests || config.run_benchmarks) {
+    run_tests(config.run_benchmarks);
+  }
+
+  PTLsimMachine* machine = get_sim_machine();
+  if (!machine) {
+    config.run = 0;
+    return 0;
+  }
+
+  if unlikely (sampling_active())
+    sampling_begin_run(*machine);
+
   foreach(ctx_no, contextcount) {
     Context& ctx = contextof(ctx_no);
     ctx.setup_ptlsim_switch();
@@ -1369,11 +1467,32 @@ extern "C" uint8_t ptl_simulate() {
     machine->stopped = 1;
   }
 
+  int sampling_action = SAMPLING_DONE;
+  if unlikely (machine->stopped && sampling_active()) {
+    sampling_action = sampling_stop_reached(*machine);
+    if (sampling_action != SAMPLING_DONE)
+      machine->stopped = 0;
+  }
+
   ptl_stable_state = 1;
 
   if(machine->ret_qemu_env)
     setup_qemu_switch_all_ctx(*machine->ret_qemu_env);
 
+  if unlikely (sampling_action == SAMPLING_FAST_FWD) {
+    /* Emulate up to next sampling window, keep machine and stats */
+    machine->first_run = 1;
+    sim_update_clock_offset = 1;
+
+    foreach(ctx_no, contextcount) {
+      Context& ctx = contextof(ctx_no);
+      tb_flush((CPUX86State*)(&ctx));
+      ctx.old_eip = 0;
+    }
+
+    return 0;
+  }
+
   if (!machine->stopped) {
     if(logable(1)) {
       ptl_logfile << "Switching back to qemu rip: " << (void *)contextof(0).get_cs_eip() << " exception: " << contextof(0).exception_index <<
@@ -1383,6 +1502,9 @@ extern "C" uint8_t ptl_simulate() {
       ptl_logfile << endl << flush;
     }
 
+    if unlikely (ptl_event_trace_enabled)
+      event_trace_sync();
+
     /* Tell QEMU that we will come back to simulate */
     return 1;
   }
@@ -1391,6 +1513,8 @@ extern "C" uint8_t ptl_simulate() {
   W64 tsc_at_end = rdtsc();
   curr_ptl_machine = NULL;
 
+  finish_event_trace();
+
   W64 seconds = W64(ticks_to_native_seconds(tsc_at_end - tsc_at_start));
   stringbuf sb;
   sb << endl << "Stopped after " << sim_cycle << " cycles, " << total_insns_committed << " instructions and " <<
@@ -1541,6 +1665,21 @@ void clock_qemu_io_events()
   }
 }
 
+/**
+ * @brief Find cycle of the earliest pending QEMU IO event
+ *
+ * @return Cycle number or -1 if no IO event is pending
+ */
+W64 get_next_qemu_io_event_cycle()
+{
+  W64 next = (W64)-1;
+  QemuIOSignal *signal;
+  foreach_list_mutable(qemuIOEvents->list(), signal, entry, prev) {
+    next = min(next, signal->cycle);
+  }
+  return next;
+}
+
 extern "C" void add_qemu_io_event(QemuIOCB fn, void *arg, int delay)
 {
   QemuIOSignal* signal = qemuIOEvents->alloc();
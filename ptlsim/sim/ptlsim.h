@@ -36,6 +36,7 @@ struct PTLsimStats;
 extern Stats *user_stats;
 extern Stats *kernel_stats;
 extern Stats *global_stats;
+extern Stats *sampled_stats;
 extern Stats *time_stats;
 extern ofstream *time_stats_file;
 
@@ -45,6 +46,27 @@ struct PTLsimCore{
 
 extern Context* ptl_contexts[MAX_CONTEXTS];
 
+/*
+ * Warm state checkpoints save caches, directory, TLBs and branch predictors
+ * as raw copies of their fixed size arrays. Each block is prefixed with its
+ * size so state saved by a differently configured machine is not restored.
+ */
+template <typename T>
+static inline void save_warm_block(ostream& os, const T& block) {
+  W64 size = sizeof(T);
+  os.write((const char*)&size, sizeof(size));
+  os.write((const char*)&block, sizeof(T));
+}
+
+template <typename T>
+static inline bool restore_warm_block(istream& is, T& block) {
+  W64 size = 0;
+  is.read((char*)&size, sizeof(size));
+  if (!is || size != sizeof(T)) return false;
+  is.read((char*)&block, sizeof(T));
+  return !is.fail();
+}
+
 struct PTLsimMachine : public Statable {
   bool initialized;
   bool stopped;
@@ -64,6 +86,19 @@ struct PTLsimMachine : public Statable {
   virtual void dump_configuration(ostream& os) const;
   virtual void reset(){};
   virtual void shutdown(){};
+
+  // Functional warming of machine state during fast-forward
+  virtual void setup_warming(){};
+  virtual void finish_warming(){};
+  virtual void warm_fetch(Context& ctx, Waddr rip){};
+  virtual void warm_mem(Context& ctx, Waddr virtaddr, bool is_write){};
+  virtual void warm_branch(Context& ctx, int type, W64 ripafter,
+      W64 target){};
+
+  // Warm state checkpoints, saved with each QEMU checkpoint
+  virtual bool save_warm_state(ostream& os) { return false; }
+  virtual bool restore_warm_state(istream& is) { return false; }
+
   static void addmachine(const char* name, PTLsimMachine* machine);
   static void removemachine(const char* name, PTLsimMachine* machine);
   static PTLsimMachine* getmachine(const char* name);
@@ -86,6 +121,8 @@ void setup_qemu_switch_all_ctx(Context& last_ctx);
 void setup_qemu_switch_except_ctx(const Context& const_ctx);
 void setup_ptlsim_switch_all_ctx(Context& const_ctx);
 
+PTLsimMachine* get_sim_machine();
+
 inline Context& contextof(W8 i) {
   return *ptl_contexts[i];
 }
@@ -164,7 +201,7 @@ struct PTLsimStats;
 
 extern ofstream ptl_logfile;
 extern ofstream trace_mem_logfile;
-extern W64 sim_cycle;
+extern SIM_CYCLE_TLS W64 sim_cycle;
 extern W64 user_insn_commits;
 extern W64 iterations;
 extern W64 total_uops_executed;
@@ -196,6 +233,18 @@ struct PTLsimConfig {
   W64 fast_fwd_insns;
   W64 fast_fwd_user_insns;
   stringbuf fast_fwd_checkpoint;
+  bool fast_fwd_warm;
+  bool save_warm_state;
+  stringbuf load_warm_state;
+
+  // Statistical Sampling
+  W64 sampling_period;
+  W64 sampling_warm;
+  W64 sampling_window;
+  double sampling_confidence;
+  double sampling_error;
+  W64 sampling_min_windows;
+  W64 sampling_max_windows;
 
   // Logging
   bool quiet;
@@ -256,9 +305,15 @@ struct PTLsimConfig {
   stringbuf dumpcode_filename;
   bool dump_at_end;
   stringbuf bbcache_dump_filename;
+  stringbuf bbcache_filename;
+  W64 bbcache_file_size;
 
   // Machine configurations
   stringbuf machine_config;
+  stringbuf machine_options;
+  bool skip_idle_cycles;
+  W64 parallel_threads;
+  W64 parallel_quantum;
 
   ///
   /// for memory hierarchy implementaion
@@ -277,6 +332,7 @@ struct PTLsimConfig {
 
   // Test Framework
   bool run_tests;
+  bool run_benchmarks;
 
   //Utilities/Tools
   stringbuf execute_after_kill;
@@ -288,6 +344,9 @@ struct PTLsimConfig {
   stringbuf simpoint_file;
   W64 simpoint_interval;
   stringbuf simpoint_chk_name;
+  stringbuf simpoint_weights;
+  bool simpoint_marker;
+  stringbuf bbv_file;
 
   void reset();
 
@@ -317,6 +376,7 @@ void force_logging_enabled();
 
 void init_qemu_io_events();
 void clock_qemu_io_events();
+W64 get_next_qemu_io_event_cycle();
 
 /**
  * @brief Convert nano-seconds to Simulation Cycles
@@ -336,7 +396,6 @@ W64 ns_to_simcycles(W64 ns);
  */
 float simcycles_to_ns(W64 cycles);
 
-void set_next_simpoint(Context& ctx);
 stringbuf* get_simpoint_chk_name();
 
 #endif // _PTLSIM_H_
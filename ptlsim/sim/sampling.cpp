@@ -0,0 +1,285 @@
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * This code is released under GPL.
+ *
+ */
+
+#include <sampling.h>
+#include <ptlsim.h>
+#include <ptl-qemu.h>
+#include <statsBuilder.h>
+
+#include <math.h>
+
+double SampleEstimator::stddev() const
+{
+    if (count < 2)
+        return 0;
+
+    double var = (sum_sq - (sum * sum) / count) / (count - 1);
+    return (var > 0) ? sqrt(var) : 0;
+}
+
+/**
+ * @brief Half width of the confidence interval of the mean
+ *
+ * @param z Normal quantile of the confidence level
+ */
+double SampleEstimator::half_width(double z) const
+{
+    if (count < 2)
+        return 0;
+
+    return z * stddev() / sqrt(double(count));
+}
+
+/**
+ * @brief Half width of the confidence interval relative to the mean
+ *
+ * Returns HUGE_VAL while there are not enough samples to estimate it.
+ */
+double SampleEstimator::rel_error(double z) const
+{
+    if (count < 2 || mean() == 0)
+        return HUGE_VAL;
+
+    return half_width(z) / fabs(mean());
+}
+
+double confidence_to_z(double confidence)
+{
+    double lo = 0;
+    double hi = 10;
+
+    /* erf is monotonic, so bisect for erf(z / sqrt(2)) = confidence */
+    foreach (i, 64) {
+        double mid = (lo + hi) / 2;
+        if (erf(mid / M_SQRT2) < confidence)
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    return (lo + hi) / 2;
+}
+
+/*
+ * Sampling controller
+ *
+ * Every sampling period consists of fast-forward in emulation, optionally
+ * with functional warming (fast-fwd-warm), followed by detailed warming
+ * and a measured window in simulation. Stats of each measured window are
+ * the difference of global stats at its end and start, they are added into
+ * sampled_stats and CPI of each window is used to estimate the CPI of the
+ * whole run.
+ */
+
+enum SamplingPhase {
+    SAMPLING_OFF,
+    SAMPLING_FWD,
+    SAMPLING_WARM,
+    SAMPLING_MEASURE,
+};
+
+static SamplingPhase phase = SAMPLING_OFF;
+static SampleEstimator cpi_estimate;
+static double sampling_z;
+static W64 saved_stop_at_insns;
+static W64 windows_started;
+
+static Stats *window_start_stats = NULL;
+static Stats *window_stats = NULL;
+static W64 window_start_cycle;
+static W64 window_start_insns;
+
+bool sampling_active()
+{
+    return phase != SAMPLING_OFF;
+}
+
+static void sampling_error(const char* msg)
+{
+    ptl_logfile << "ERROR: " << msg << ", sampling is disabled" << endl;
+    cerr << "ERROR: " << msg << ", sampling is disabled" << endl;
+    config.sampling_period = 0;
+}
+
+/**
+ * @brief Start sampling, begins with fast-forward to the first window
+ *
+ * Instructions set by fast-fwd-insns are skipped before the first period.
+ */
+void start_sampling()
+{
+    if (phase != SAMPLING_OFF)
+        return;
+
+    if (config.sampling_window == 0 ||
+            config.sampling_period <= config.sampling_warm +
+            config.sampling_window) {
+        sampling_error("sampling-period must be larger than sampling-warm "
+                "and sampling-window together");
+        return;
+    }
+
+    if (config.sampling_confidence <= 0 || config.sampling_confidence >= 1) {
+        sampling_error("sampling-confidence must be between 0 and 1");
+        return;
+    }
+
+    if (config.fast_fwd_checkpoint.size() > 0) {
+        sampling_error("fast-fwd-checkpoint can't be used with sampling");
+        return;
+    }
+
+    StatsBuilder& builder = StatsBuilder::get();
+    if (!sampled_stats) {
+        sampled_stats = builder.get_new_stats();
+        window_start_stats = builder.get_new_stats();
+        window_stats = builder.get_new_stats();
+    }
+
+    sampled_stats->reset();
+    cpi_estimate.reset();
+    sampling_z = confidence_to_z(config.sampling_confidence);
+    saved_stop_at_insns = config.stop_at_insns;
+    windows_started = 0;
+
+    ptl_logfile << "Sampling every " << config.sampling_period <<
+        " instructions: " << config.sampling_warm << " warming and " <<
+        config.sampling_window << " measured instructions, target error " <<
+        config.sampling_error * 100 << "% at " <<
+        config.sampling_confidence * 100 << "% confidence\n";
+
+    phase = SAMPLING_FWD;
+    fast_fwd_cpus(config.fast_fwd_insns + config.sampling_period -
+            config.sampling_warm - config.sampling_window, 1);
+}
+
+static void begin_measure(PTLsimMachine& machine)
+{
+    machine.update_stats();
+    *window_start_stats = *global_stats;
+    window_start_cycle = sim_cycle;
+    window_start_insns = total_insns_committed;
+
+    config.stop_at_insns = total_insns_committed + config.sampling_window;
+    phase = SAMPLING_MEASURE;
+}
+
+/**
+ * @brief Fast-forward has reached the next window, set up detailed warming
+ *
+ * @param machine Simulated machine
+ *
+ * Called every time simulation starts, does nothing unless a new window
+ * starts.
+ */
+void sampling_begin_run(PTLsimMachine& machine)
+{
+    if (phase != SAMPLING_FWD)
+        return;
+
+    /* Keep cache and predictor state of previous windows */
+    if (windows_started++ > 0)
+        machine.finish_warming();
+
+    if (config.sampling_warm > 0) {
+        config.stop_at_insns = total_insns_committed + config.sampling_warm;
+        phase = SAMPLING_WARM;
+    } else {
+        begin_measure(machine);
+    }
+}
+
+static void end_measure(PTLsimMachine& machine)
+{
+    machine.update_stats();
+    *window_stats = *global_stats;
+    (StatsBuilder::get()).sub_stats(*window_stats, *window_start_stats);
+    *sampled_stats += *window_stats;
+
+    W64 cycles = sim_cycle - window_start_cycle;
+    W64 insns = total_insns_committed - window_start_insns;
+    double cpi = insns ? double(cycles) / double(insns) : 0;
+
+    cpi_estimate.add(cpi);
+
+    if (logable(1)) {
+        ptl_logfile << "Sampling window " << cpi_estimate.count << ": " <<
+            insns << " instructions, " << cycles << " cycles, CPI " << cpi <<
+            ", mean CPI " << cpi_estimate.mean() << " +/- " <<
+            cpi_estimate.half_width(sampling_z) << endl;
+    }
+}
+
+static void finish_sampling(const char* reason)
+{
+    stringbuf sb;
+    sb << endl << "Sampling " << reason << " after " << cpi_estimate.count <<
+        " windows: mean CPI " << cpi_estimate.mean();
+
+    if (cpi_estimate.count >= 2) {
+        sb << " +/- " << cpi_estimate.half_width(sampling_z) << " (" <<
+            cpi_estimate.rel_error(sampling_z) * 100 << "% at " <<
+            config.sampling_confidence * 100 << "% confidence, stddev " <<
+            cpi_estimate.stddev() << ")";
+    } else {
+        sb << " (too few windows for a confidence interval)";
+    }
+    sb << endl;
+
+    ptl_logfile << sb << flush;
+    cerr << sb << flush;
+
+    config.stop_at_insns = saved_stop_at_insns;
+
+    /* Don't start again on next configuration change */
+    config.sampling_period = 0;
+    phase = SAMPLING_OFF;
+}
+
+/**
+ * @brief Simulation has stopped while sampling
+ *
+ * @param machine Simulated machine
+ *
+ * @return SAMPLING_SIMULATE if simulation continues with the measured
+ * window, SAMPLING_FAST_FWD if emulation should continue up to the next
+ * window and SAMPLING_DONE if sampling has finished and simulation stops.
+ */
+int sampling_stop_reached(PTLsimMachine& machine)
+{
+    /* Stopped by user or by another limit, report what was measured */
+    if (config.kill || config.stop ||
+            total_insns_committed < config.stop_at_insns) {
+        finish_sampling("stopped");
+        return SAMPLING_DONE;
+    }
+
+    if (phase == SAMPLING_WARM) {
+        begin_measure(machine);
+        return SAMPLING_SIMULATE;
+    }
+
+    assert(phase == SAMPLING_MEASURE);
+    end_measure(machine);
+
+    if (cpi_estimate.count >= config.sampling_min_windows &&
+            cpi_estimate.rel_error(sampling_z) <= config.sampling_error) {
+        finish_sampling("reached target error");
+        return SAMPLING_DONE;
+    }
+
+    if (cpi_estimate.count >= config.sampling_max_windows) {
+        finish_sampling("reached maximum windows");
+        return SAMPLING_DONE;
+    }
+
+    phase = SAMPLING_FWD;
+    fast_fwd_cpus(config.sampling_period - config.sampling_warm -
+            config.sampling_window, 1);
+
+    return SAMPLING_FAST_FWD;
+}
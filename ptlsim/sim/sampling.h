@@ -0,0 +1,70 @@
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * This code is released under GPL.
+ *
+ */
+
+#ifndef SAMPLING_H
+#define SAMPLING_H
+
+#include <globals.h>
+
+/**
+ * @brief Running mean and variance of per-window measurements
+ *
+ * Used by the sampling controller to estimate CPI of the whole run from
+ * measured windows, assuming windows are independent samples.
+ */
+struct SampleEstimator {
+    W64 count;
+    double sum;
+    double sum_sq;
+
+    SampleEstimator() { reset(); }
+
+    void reset() {
+        count = 0;
+        sum = 0;
+        sum_sq = 0;
+    }
+
+    void add(double value) {
+        count++;
+        sum += value;
+        sum_sq += value * value;
+    }
+
+    double mean() const {
+        return count ? sum / count : 0;
+    }
+
+    double stddev() const;
+    double half_width(double z) const;
+    double rel_error(double z) const;
+};
+
+/**
+ * @brief Standard normal quantile for a two-sided confidence level
+ *
+ * @param confidence Confidence level between 0 and 1, like 0.95
+ *
+ * @return z such that P(-z < X < z) = confidence for X ~ N(0, 1)
+ */
+double confidence_to_z(double confidence);
+
+struct PTLsimMachine;
+
+/* Actions returned by sampling_stop_reached() */
+enum {
+    SAMPLING_SIMULATE = 0,  // Keep simulating, next phase has started
+    SAMPLING_FAST_FWD,      // Window done, emulate up to the next one
+    SAMPLING_DONE,          // Sampling has finished, stop simulation
+};
+
+bool sampling_active();
+void start_sampling();
+void sampling_begin_run(PTLsimMachine& machine);
+int sampling_stop_reached(PTLsimMachine& machine);
+
+#endif // SAMPLING_H
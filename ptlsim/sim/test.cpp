@@ -8,7 +8,7 @@
 
 using namespace std;
 
-void run_tests()
+void run_tests(bool benchmarks)
 {
     int argc = 1;
     char *argv[1];
@@ -18,6 +18,10 @@ void run_tests()
     argv[0] = name;
 
     ::testing::InitGoogleTest(&argc, argv);
+
+    /* Benchmarks take long and only print timings */
+    ::testing::GTEST_FLAG(filter) = benchmarks ? "*Benchmark.*" : "-*Benchmark.*";
+
     tests_failed = RUN_ALL_TESTS();
     cout << "Testing " << (tests_failed ? "failed\n" : "passed\n");
 
@@ -26,7 +30,7 @@ void run_tests()
 
 #else
 
-void run_tests()
+void run_tests(bool benchmarks)
 {
     return;
 }
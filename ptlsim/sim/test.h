@@ -7,7 +7,10 @@
  *
  * This function setup the GoogleTest framework and run tests.
  * This function will exit after completing all the tests.
+ *
+ * @param benchmarks Run only the tests of test cases named '*Benchmark',
+ * which are skipped otherwise
  */
-void run_tests();
+void run_tests(bool benchmarks = false);
 
 #endif // MARSS_TEST_H
@@ -929,6 +929,68 @@ namespace {
         ASSERT_TRUE(op.all_src_ready());
     }
 
+    /*
+     * Skipping idle cycles of a core gives the same stats as simulating
+     * them, in_thread_switch selects waiting for a load miss or for an
+     * icache miss
+     */
+    void skip_same_as_run(AtomCore& core, bool in_thread_switch)
+    {
+        const int cycles = 1000;
+        StatsBuilder& builder = StatsBuilder::get();
+        AtomThread& thread = *core.threads[0];
+
+        core.in_thread_switch = in_thread_switch;
+        thread.ready = !in_thread_switch;
+        thread.waiting_for_icache_miss = !in_thread_switch;
+        thread.last_commit_cycle = sim_cycle;
+
+        /* One simulated cycle sets the default stats of the core */
+        core.runcycle(NULL);
+        sim_cycle++;
+
+        ASSERT_EQ(core.get_idle_until(), thread.last_commit_cycle +
+                1024*1024 + 1);
+
+        Stats *user_start = builder.get_new_stats();
+        Stats *kernel_start = builder.get_new_stats();
+        *user_start = *user_stats;
+        *kernel_start = *kernel_stats;
+
+        foreach(i, cycles) {
+            core.runcycle(NULL);
+            sim_cycle++;
+        }
+
+        ASSERT_NE(core.get_idle_until(), sim_cycle);
+
+        Stats *user_run = builder.get_new_stats();
+        Stats *kernel_run = builder.get_new_stats();
+        *user_run = *user_stats;
+        *kernel_run = *kernel_stats;
+
+        *user_stats = *user_start;
+        *kernel_stats = *kernel_start;
+
+        core.skip_cycles(cycles);
+
+        ASSERT_EQ(memcmp((void*)user_run->base(), (void*)user_stats->base(),
+                    STATS_SIZE), 0);
+        ASSERT_EQ(memcmp((void*)kernel_run->base(), (void*)kernel_stats->base(),
+                    STATS_SIZE), 0);
+
+        /* A woken up thread is busy again */
+        thread.ready = true;
+        thread.waiting_for_icache_miss = false;
+        ASSERT_EQ(core.get_idle_until(), sim_cycle);
+    }
+
+    TEST_F(AtomCoreTest, SkipCyclesSameAsRun)
+    {
+        skip_same_as_run(*(AtomCore*)base_machine->cores[0], true);
+        skip_same_as_run(*(AtomCore*)base_machine->cores[0], false);
+    }
+
     TEST(AtomCoreModelTest, CheckFUEnums)
     {
         ASSERT_EQ(FU_ALU0, 0x1);
@@ -0,0 +1,38 @@
+#include <gtest/gtest.h>
+
+#define DISABLE_ASSERT
+#include <ptlsim.h>
+#include <bbv.h>
+
+#include <sstream>
+
+namespace {
+
+    TEST(BBV, Intervals)
+    {
+        std::ostringstream os;
+        BBVProfiler bbv(os, 100);
+
+        int a = bbv.block_id(0x1000);
+        int b = bbv.block_id(0x2000);
+        ASSERT_EQ(1, a);
+        ASSERT_EQ(2, b);
+        ASSERT_EQ(a, bbv.block_id(0x1000));
+
+        /* Interval ends at first block after 100 instructions */
+        foreach (i, 9) {
+            bbv.count(a, 10);
+        }
+        bbv.count(b, 30);
+        ASSERT_EQ(1, bbv.get_intervals());
+
+        bbv.count(b, 60);
+        ASSERT_EQ(1, bbv.get_intervals());
+        int c = bbv.block_id(0x3000);
+        bbv.count(c, 40);
+        ASSERT_EQ(2, bbv.get_intervals());
+        ASSERT_EQ(3, bbv.get_blocks());
+
+        ASSERT_EQ("T:1:90 :2:30 \nT:2:60 :3:40 \n", os.str());
+    }
+};
@@ -0,0 +1,156 @@
+#include <gtest/gtest.h>
+
+#define DISABLE_ASSERT
+#include <ptlsim.h>
+#include <memoryHierarchy.h>
+#include <cacheLines.h>
+
+using namespace Memory;
+
+namespace {
+
+    /* Random line addresses of 'sets' sets, with more lines than ways */
+    W64 random_addr(int sets, int ways)
+    {
+        return W64(rand() % (sets * ways * 2)) * 64;
+    }
+
+    /* Runtime cache lines replace lines the same way as templated ones */
+    template <int SETS, int WAYS>
+    void compare_with_templated()
+    {
+        typedef AssociativeArray<W64, CacheLine, SETS, WAYS, 64> Array;
+        Array *array = new Array();
+        DynamicCacheLines *lines = new DynamicCacheLines(SETS, WAYS, 64, 2,
+                1, 1);
+
+        srand(WAYS);
+        foreach (i, 100000) {
+            W64 addr = random_addr(SETS, WAYS);
+
+            switch (rand() % 4) {
+                case 0:
+                    ASSERT_EQ(array->probe(addr) != NULL,
+                            lines->probe(addr) != NULL);
+                    break;
+                case 1:
+                    ASSERT_EQ(array->invalidate(addr),
+                            lines->invalidate(addr));
+                    break;
+                default:
+                    W64 oldTag = -1, dynOldTag = -1;
+                    array->select(addr, oldTag);
+                    lines->select(addr, dynOldTag);
+                    ASSERT_EQ(oldTag, dynOldTag);
+                    break;
+            }
+        }
+
+        delete array;
+        delete lines;
+    }
+
+    TEST(DynamicCacheLines, SameAsTemplated)
+    {
+        compare_with_templated<64, 8>();
+        compare_with_templated<16, 5>();
+        compare_with_templated<4, 64>();
+    }
+
+    /* Peeking at lines does not change which line is replaced next */
+    TEST(DynamicCacheLines, PeekKeepsReplacement)
+    {
+        DynamicCacheLines lines(16, 4, 64, 2, 1, 1);
+        DynamicCacheLines peeked(16, 4, 64, 2, 1, 1);
+
+        srand(1);
+        foreach (i, 10000) {
+            W64 addr = random_addr(16, 4);
+            W64 oldTag = -1, peekedOldTag = -1;
+
+            peeked.peek(random_addr(16, 4));
+            lines.select(addr, oldTag);
+            peeked.select(addr, peekedOldTag);
+            ASSERT_EQ(oldTag, peekedOldTag);
+            ASSERT_TRUE(peeked.peek(addr) != NULL);
+        }
+    }
+
+    TEST(DynamicCacheLines, Geometry)
+    {
+        DynamicCacheLines lines(1024, 12, 64, 10, 2, 1);
+        ASSERT_EQ(1024 * 12 * 64, lines.get_size());
+        ASSERT_EQ(6, lines.get_line_bits());
+        ASSERT_EQ(W64(0x12340), lines.tagOf(0x1237f));
+
+        ASSERT_FALSE(DynamicCacheLines::valid_geometry(1000, 8, 64));
+        ASSERT_FALSE(DynamicCacheLines::valid_geometry(1024, 65, 64));
+        ASSERT_FALSE(DynamicCacheLines::valid_geometry(1024, 8, 48));
+    }
+
+    /* Host cycles to probe each address and insert it on a miss */
+    template <typename lines_t>
+    W64 cachelines_run(lines_t *lines, const W64 *addrs, W64 accesses)
+    {
+        CycleTimer timer("cachelines");
+        W64 sum = 0;
+        W64 oldTag;
+
+        timer.start();
+        foreach (i, accesses) {
+            CacheLine *line = lines->probe(addrs[i]);
+            if (!line) line = lines->select(addrs[i], oldTag);
+            sum += line->state;
+        }
+        timer.stop();
+
+        return (sum) ? 0 : timer.cycles();
+    }
+
+    /*
+     * Microbenchmark: a 16 way cache with runtime geometry must stay within
+     * a few percent of the templated one. Each is timed three times in
+     * turn and the fastest run counts, to ride out host noise.
+     */
+    template <int SETS>
+    void cachelines_benchmark(const char *name)
+    {
+        const W64 accesses = 4000000;
+        W64 *addrs = new W64[accesses];
+
+        srand(1);
+        foreach (i, accesses) {
+            addrs[i] = random_addr(SETS, 16);
+        }
+
+        typedef AssociativeArray<W64, CacheLine, SETS, 16, 64> Array;
+        Array *array = new Array();
+        DynamicCacheLines *lines = new DynamicCacheLines(SETS, 16, 64, 2,
+                1, 1);
+        W64 templated = -1;
+        W64 runtime = -1;
+
+        foreach (run, 3) {
+            templated = min(templated, cachelines_run(array, addrs, accesses));
+            runtime = min(runtime, cachelines_run(lines, addrs, accesses));
+        }
+
+        cout << "Cache lines benchmark (cycles/access, " << name <<
+            " 16 ways): templated " << double(templated) / accesses <<
+            " runtime " << double(runtime) / accesses << endl;
+
+        ASSERT_LE(runtime * 100, templated * 105);
+
+        delete array;
+        delete lines;
+        delete[] addrs;
+    }
+
+    /* Run with -run-benchmarks */
+    TEST(Benchmark, CacheLines)
+    {
+        cachelines_benchmark<32>("32KB");
+        cachelines_benchmark<1024>("1MB");
+    }
+
+};
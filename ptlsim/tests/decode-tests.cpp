@@ -0,0 +1,374 @@
+#include <gtest/gtest.h>
+
+#define DISABLE_ASSERT
+#include <ptlsim.h>
+#include <decode.h>
+#include <bbfile.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+    /* Decoded copy of a one uop block at rip on physical page mfn */
+    BasicBlock* decoded_bb(W64 rip, W64 mfn)
+    {
+        RIPVirtPhys rvp;
+        setzero(rvp);
+        rvp.rip = rip;
+        rvp.mfnlo = mfn;
+        rvp.mfnhi = mfn;
+        rvp.use64 = 1;
+
+        BasicBlock* bb = (BasicBlock*)malloc(sizeof(BasicBlock));
+        bb->reset(rvp);
+        bb->count = 1;
+        bb->bytes = 3;
+        bb->transops[0].init(OP_add, REG_rax, REG_rax, REG_imm, REG_zero, 3, 1);
+
+        BasicBlock* clone = bb->clone();
+        ::free(bb);
+        return clone;
+    }
+
+    SharedBasicBlockKey key_of(const BasicBlock* bb, W64 physpage, W32 mode)
+    {
+        SharedBasicBlockKey key;
+        key.rip = bb->rip;
+        key.physpage = physpage;
+        key.mode = mode;
+        return key;
+    }
+
+    const byte add_rax[16] = {0x48, 0x83, 0xc0, 0x01};
+
+    TEST(SharedBasicBlockCache, Lookup)
+    {
+        SharedBasicBlockCache cache;
+        BasicBlock* bb = decoded_bb(0x400000, 0x1234);
+        SharedBasicBlockKey key = key_of(bb, 0x5678, 1);
+
+        SharedBasicBlock* shared = cache.insert(bb, key, add_rax);
+        ASSERT_EQ(shared, cache.lookup(key));
+        ASSERT_TRUE(bb->synthops);
+
+        /* Same rip in another mode or on another page is decoded again */
+        key.mode = 2;
+        ASSERT_FALSE(cache.lookup(key));
+        key.mode = 1;
+        key.rip.mfnhi = 0x1235;
+        ASSERT_FALSE(cache.lookup(key));
+
+        /* So is the same virtual address in another address space */
+        key.rip.mfnhi = 0x1234;
+        key.physpage = 0x5679;
+        ASSERT_FALSE(cache.lookup(key));
+
+        BasicBlock* handle = cache.handle(shared);
+        cache.release(handle, false);
+        handle->free();
+
+        ASSERT_EQ(0, cache.count);
+        ASSERT_EQ(0, cache.bytes);
+    }
+
+    /* A copy is only reused for the x86 bytes it was decoded from */
+    TEST(SharedBasicBlockCache, Matches)
+    {
+        SharedBasicBlockCache cache;
+        BasicBlock* bb = decoded_bb(0x400000, 0x1234);
+        SharedBasicBlock* shared = cache.insert(bb, key_of(bb, 0x5678, 0), add_rax);
+
+        byte code[16];
+        memcpy(code, add_rax, sizeof(code));
+        ASSERT_TRUE(cache.matches(shared, code, sizeof(code)));
+        ASSERT_FALSE(cache.matches(shared, code, 2));
+        code[2] = 0xc1;
+        ASSERT_FALSE(cache.matches(shared, code, sizeof(code)));
+
+        BasicBlock* handle = cache.handle(shared);
+        cache.release(handle, true);
+        handle->free();
+        ASSERT_EQ(0, cache.count);
+    }
+
+    TEST(SharedBasicBlockCache, Handles)
+    {
+        SharedBasicBlockCache cache;
+        BasicBlock* bb = decoded_bb(0x400000, 0x1234);
+        SharedBasicBlockKey key = key_of(bb, 0x5678, 0);
+        SharedBasicBlock* shared = cache.insert(bb, key, add_rax);
+
+        BasicBlock* a = cache.handle(shared);
+        BasicBlock* b = cache.handle(shared);
+
+        /* Handles share the decoded uops but keep their own state */
+        ASSERT_EQ(bb->transops, a->uops);
+        ASSERT_EQ(a->uops, b->uops);
+        ASSERT_EQ(a->synthops, b->synthops);
+        ASSERT_EQ(OP_add, b->uops[0].opcode);
+        a->acquire();
+        ASSERT_EQ(0, b->refcount);
+        a->release();
+
+        /* A stale copy is not found again but lives on for other handles */
+        cache.release(a, true);
+        a->free();
+        ASSERT_FALSE(cache.lookup(key));
+        ASSERT_EQ(OP_add, b->uops[0].opcode);
+        ASSERT_NE(0, cache.bytes);
+
+        cache.release(b, false);
+        b->free();
+        ASSERT_EQ(0, cache.count);
+        ASSERT_EQ(0, cache.bytes);
+    }
+
+    /* Core 0 bbcache, with decoder stats if no machine has set them up */
+    BasicBlockCache& test_bbcache()
+    {
+        if (!decoder_stats[0]) {
+            static Statable stats("decode_test");
+            set_decoder_stats(&stats, 0);
+        }
+        return bbcache[0];
+    }
+
+    /* Cache bb the way a newly translated block is */
+    BasicBlock* cache_bb(BasicBlockCache& cache, BasicBlock* bb)
+    {
+        cache.add(bb);
+        cache.add_page(bb);
+        return bb;
+    }
+
+    TEST(BasicBlockCache, ChainInvalidate)
+    {
+        BasicBlockCache& cache = test_bbcache();
+        W64 count = cache.count;
+
+        BasicBlock* a = cache_bb(cache, decoded_bb(0x400000, 0x1234));
+        BasicBlock* taken = cache_bb(cache, decoded_bb(0x400040, 0x1234));
+        BasicBlock* not_taken = cache_bb(cache, decoded_bb(0x400003, 0x1234));
+        a->rip_taken = 0x400040;
+        a->rip_not_taken = 0x400003;
+        RIPVirtPhys taken_rip = taken->rip;
+
+        /* The first fetch after a block is hashed, later ones are chained */
+        ASSERT_FALSE(cache.chained(a, taken_rip));
+        ASSERT_EQ(taken, cache.lookup(a, taken_rip));
+        ASSERT_EQ(not_taken, cache.lookup(a, not_taken->rip));
+        ASSERT_EQ(taken, cache.chained(a, taken_rip));
+        ASSERT_EQ(not_taken, cache.chained(a, not_taken->rip));
+
+        /* An indirect branch somewhere else is not chained */
+        ASSERT_FALSE(cache.chained(a, RIPVirtPhys(0x400080)));
+
+        /* Invalidating a block drops every chain */
+        ASSERT_TRUE(cache.invalidate(taken, INVALIDATE_REASON_SPURIOUS));
+        ASSERT_FALSE(cache.chained(a, taken_rip));
+        ASSERT_FALSE(cache.chained(a, not_taken->rip));
+        ASSERT_FALSE(cache.lookup(a, taken_rip));
+        ASSERT_EQ(not_taken, cache.lookup(a, not_taken->rip));
+        ASSERT_EQ(not_taken, cache.chained(a, not_taken->rip));
+
+        /* The block decoded again at that rip is found and chained */
+        BasicBlock* again = cache_bb(cache, decoded_bb(0x400040, 0x1234));
+        ASSERT_EQ(again, cache.lookup(a, taken_rip));
+        ASSERT_EQ(again, cache.chained(a, taken_rip));
+
+        ASSERT_TRUE(cache.invalidate(again, INVALIDATE_REASON_SPURIOUS));
+        ASSERT_TRUE(cache.invalidate(not_taken, INVALIDATE_REASON_SPURIOUS));
+        ASSERT_TRUE(cache.invalidate(a, INVALIDATE_REASON_SPURIOUS));
+        ASSERT_EQ(count, cache.count);
+    }
+
+    TEST(BasicBlockCache, ChainReplace)
+    {
+        BasicBlockCache& cache = test_bbcache();
+        W64 count = cache.count;
+
+        BasicBlock* a = cache_bb(cache, decoded_bb(0x400000, 0x1234));
+        a->rip_taken = 0x400040;
+        a->rip_not_taken = 0x400003;
+
+        /* Only in the hashtable, so it can be freed once replaced */
+        BasicBlock* old = decoded_bb(0x400040, 0x1234);
+        cache.add(old);
+        ASSERT_EQ(old, cache.lookup(a, old->rip));
+        ASSERT_EQ(old, cache.chained(a, old->rip));
+
+        /* A block added at the same rip replaces the chained one */
+        BasicBlock* bb = cache_bb(cache, decoded_bb(0x400040, 0x1234));
+        ASSERT_FALSE(cache.chained(a, bb->rip));
+        ASSERT_EQ(bb, cache.lookup(a, bb->rip));
+        ASSERT_EQ(bb, cache.chained(a, bb->rip));
+        old->free();
+
+        ASSERT_TRUE(cache.invalidate(bb, INVALIDATE_REASON_SPURIOUS));
+        ASSERT_TRUE(cache.invalidate(a, INVALIDATE_REASON_SPURIOUS));
+        ASSERT_EQ(count, cache.count);
+    }
+
+    /*
+     * Benchmark: host cycles per bbcache lookup along a hot path of blocks,
+     * hashed and chained, with the rest of each simulated cycle modeled by
+     * reading a buffer of the given size between two fetches. Run with
+     * -run-benchmarks, OooCoreBenchmark.FetchLoops times the fetch stage.
+     */
+    TEST(Benchmark, BasicBlockChain)
+    {
+        const int blocks = 1024;
+        const int rounds = 16;
+        const int footprints[] = {0, 256 << 10, 2 << 20};
+        BasicBlockCache& cache = test_bbcache();
+        dynarray<BasicBlock*> path;
+
+        foreach (i, blocks) {
+            W64 rip = 0x10000000 + i * 0x40;
+            path.push(cache_bb(cache, decoded_bb(rip, rip >> 12)));
+            path[i]->rip_not_taken = rip + 3;
+        }
+        foreach (i, blocks) {
+            path[i]->rip_taken = path[(i + 1) % blocks]->rip.rip;
+        }
+
+        byte* buf = (byte*)malloc(footprints[2]);
+        memset(buf, 1, footprints[2]);
+        W64 sum = 0;
+
+        foreach (f, 3) {
+            CycleTimer timers[2];
+
+            foreach (chained, 2) {
+                BasicBlock* prev = NULL;
+                foreach (r, rounds) {
+                    foreach (i, blocks) {
+                        for (int b = 0; b < footprints[f]; b += 64) sum += buf[b];
+
+                        timers[chained].start();
+                        BasicBlock* bb = cache.lookup(
+                                (chained) ? prev : NULL, path[i]->rip);
+                        timers[chained].stop();
+
+                        ASSERT_EQ(path[i], bb);
+                        prev = bb;
+                    }
+                }
+            }
+
+            cout << "Chain benchmark: " << (footprints[f] >> 10) <<
+                " KB between fetches: hashed " <<
+                timers[0].cycles() / (blocks * rounds) << ", chained " <<
+                timers[1].cycles() / (blocks * rounds) << " cycles" << endl;
+        }
+
+        ASSERT_NE(0, sum);
+        ::free(buf);
+        foreach (i, blocks) {
+            cache.invalidate(path[i], INVALIDATE_REASON_SPURIOUS);
+        }
+    }
+
+    TEST(BasicBlockFile, StoreAndLoad)
+    {
+        char filename[] = "/tmp/bbfile-XXXXXX";
+        ::close(mkstemp(filename));
+        unlink(filename);
+
+        BasicBlock* bb = decoded_bb(0x400000, 0);
+        byte code[BB_FILE_KEY_BYTES] = {0x48, 0x83, 0xc0, 0x01};
+
+        BasicBlockFile file;
+        ASSERT_TRUE(file.open(filename, 1 << 20));
+        ASSERT_FALSE(file.load(bb->rip, 0, code, sizeof(code)));
+        ASSERT_TRUE(file.store(*bb, 0, code, sizeof(code)));
+        file.close();
+
+        /* Blocks are kept across runs */
+        ASSERT_TRUE(file.open(filename, 1 << 20));
+        BasicBlock* loaded = file.load(bb->rip, 0, code, sizeof(code));
+        ASSERT_TRUE(loaded);
+        ASSERT_EQ(bb->count, loaded->count);
+        ASSERT_EQ(bb->bytes, loaded->bytes);
+        ASSERT_EQ(loaded->transops, loaded->uops);
+        ASSERT_EQ(0, memcmp(bb->transops, loaded->uops, sizeof(TransOp)));
+        ASSERT_FALSE(loaded->synthops);
+        loaded->free();
+
+        /* Another mode, other code or too few valid bytes do not match */
+        ASSERT_FALSE(file.load(bb->rip, 1, code, sizeof(code)));
+        ASSERT_FALSE(file.load(bb->rip, 0, code, bb->bytes));
+        code[8] = 0x90;
+        ASSERT_FALSE(file.load(bb->rip, 0, code, sizeof(code)));
+        code[8] = 0;
+        code[2] = 0xc1;
+        ASSERT_FALSE(file.load(bb->rip, 0, code, sizeof(code)));
+
+        file.close();
+        unlink(filename);
+        bb->free();
+    }
+
+    /* Overwrite the W64 at offset of a basic block file */
+    void write_w64(const char* filename, W64 offset, W64 value)
+    {
+        int fd = ::open(filename, O_RDWR);
+        ASSERT_EQ((ssize_t)sizeof(value), pwrite(fd, &value, sizeof(value), offset));
+        ::close(fd);
+    }
+
+    /* A damaged file loses its blocks but never reads outside the mapping */
+    TEST(BasicBlockFile, Damaged)
+    {
+        char filename[] = "/tmp/bbfile-XXXXXX";
+        ::close(mkstemp(filename));
+        unlink(filename);
+
+        BasicBlock* bb = decoded_bb(0x400000, 0);
+        byte code[BB_FILE_KEY_BYTES] = {0x48, 0x83, 0xc0, 0x01};
+
+        BasicBlockFile file;
+        /* The first record starts where the empty file ends */
+        ASSERT_TRUE(file.open(filename, 1 << 20));
+        W64 rec = file.get_used();
+        W64 size = file.get_size();
+        ASSERT_TRUE(file.store(*bb, 0, code, sizeof(code)));
+        file.close();
+
+        /* Offsets of the next, count and bb.bytes fields of the record */
+        const W64 next = rec;
+        const W64 count = rec + 3 * sizeof(W64) + sizeof(W32) + sizeof(W16);
+        const W64 bytes = rec + 4 * sizeof(W64) + offsetof(BasicBlockBase, bytes);
+        const W64 damage[][2] = {
+            {next, size},               /* past the end of the file */
+            {next, rec},                /* a loop */
+            {count, 0xffff},            /* more uops than the file holds */
+            {bytes, MAX_BB_BYTES + 1},  /* more x86 bytes than a block */
+        };
+
+        foreach (i, lengthof(damage)) {
+            ASSERT_TRUE(file.open(filename, 1 << 20));
+            ASSERT_TRUE(file.load(bb->rip, 0, code, sizeof(code)) != NULL);
+            file.close();
+
+            W64 saved = 0;
+            int fd = ::open(filename, O_RDONLY);
+            ASSERT_EQ((ssize_t)sizeof(saved), pread(fd, &saved, sizeof(saved), damage[i][0]));
+            ::close(fd);
+
+            /* count and bytes are W16, keep the fields after them */
+            W64 mask = (damage[i][0] == next) ? ~0ULL : 0xffffULL;
+            write_w64(filename, damage[i][0], (saved & ~mask) | damage[i][1]);
+
+            ASSERT_TRUE(file.open(filename, 1 << 20));
+            ASSERT_FALSE(file.load(bb->rip, 0, code, sizeof(code)));
+            file.close();
+
+            write_w64(filename, damage[i][0], saved);
+        }
+
+        unlink(filename);
+        bb->free();
+    }
+};
@@ -0,0 +1,60 @@
+#include <gtest/gtest.h>
+
+#define DISABLE_ASSERT
+#include <ptlsim.h>
+#include <globalDirectory.h>
+
+namespace {
+
+    /* A directory slice replaces entries the same way as the templated array */
+    TEST(Directory, SameAsTemplated)
+    {
+        typedef AssociativeArray<W64, DirectoryEntry, 64, 8,
+                DIR_LINE_SIZE> Array;
+        Array *array = new Array();
+        DirectorySlice *slice = new DirectorySlice(64, 8, DIR_ACCESS_DELAY,
+                DIR_PORTS);
+
+        srand(1);
+        foreach (i, 100000) {
+            W64 addr = W64(rand() % (64 * 8 * 2)) * DIR_LINE_SIZE;
+
+            switch (rand() % 4) {
+                case 0:
+                    ASSERT_EQ(array->probe(addr) != NULL,
+                            slice->probe(addr) != NULL);
+                    break;
+                case 1:
+                    ASSERT_EQ(array->invalidate(addr),
+                            slice->invalidate(addr));
+                    break;
+                default:
+                    W64 old_tag = -1, slice_old_tag = -1;
+                    array->select(addr, old_tag);
+                    slice->select(addr, slice_old_tag);
+                    ASSERT_EQ(old_tag, slice_old_tag);
+                    break;
+            }
+        }
+
+        delete array;
+        delete slice;
+    }
+
+    TEST(Directory, Ports)
+    {
+        DirectorySlice slice(16, 4, DIR_ACCESS_DELAY, 2);
+        W64 cycle = sim_cycle;
+
+        sim_cycle = cycle + 1;
+        ASSERT_TRUE(slice.get_port());
+        ASSERT_TRUE(slice.get_port());
+        ASSERT_FALSE(slice.get_port());
+
+        sim_cycle = cycle + 2;
+        ASSERT_TRUE(slice.get_port());
+
+        sim_cycle = cycle;
+    }
+
+};
@@ -0,0 +1,105 @@
+#include <gtest/gtest.h>
+
+#define DISABLE_ASSERT
+#include <ptlsim.h>
+#include <dramModel.h>
+#include <addressMap.h>
+
+using namespace Memory;
+
+namespace {
+
+    TEST(DRAM, RowBufferTiming)
+    {
+        DRAMConfig dconf;
+        dconf.channels = 1;
+        dconf.ranks = 1;
+        dconf.tREFI = 0;
+        DRAMModel dram(dconf);
+
+        DRAMRowState state;
+        DRAMLocation a = dram.decode(0x0);
+        DRAMLocation b = dram.decode(0x40);
+        DRAMLocation c = dram.decode(W64(dconf.row_lines * dconf.banks) << 6);
+
+        /* Lines of a row share the bank, next row of same bank conflicts */
+        ASSERT_EQ(a.bank, b.bank);
+        ASSERT_EQ(a.row, b.row);
+        ASSERT_EQ(a.bank, c.bank);
+        ASSERT_NE(a.row, c.row);
+
+        W64 miss = dram.access(a, false, 100, state);
+        ASSERT_EQ(DRAM_ROW_MISS, state);
+        ASSERT_EQ(100 + dconf.tRCD + dconf.tCAS + dconf.tBURST, miss);
+
+        ASSERT_TRUE(dram.is_row_hit(b));
+        W64 now = dram.ready_cycle(b, 1000);
+        W64 hit = dram.access(b, false, 1000, state);
+        ASSERT_EQ(DRAM_ROW_HIT, state);
+        ASSERT_LE(now, 1000);
+        ASSERT_EQ(1000 + dconf.tCAS + dconf.tBURST, hit);
+
+        W64 conflict = dram.access(c, false, 2000, state);
+        ASSERT_EQ(DRAM_ROW_CONFLICT, state);
+        ASSERT_EQ(2000 + dconf.tRP + dconf.tRCD + dconf.tCAS + dconf.tBURST,
+                conflict);
+    }
+
+    TEST(DRAM, ClosedPageAndRefresh)
+    {
+        DRAMConfig dconf;
+        dconf.policy = DRAM_CLOSED_PAGE;
+        dconf.channels = 1;
+        dconf.ranks = 1;
+        DRAMModel dram(dconf);
+
+        DRAMRowState state;
+        DRAMLocation a = dram.decode(0x0);
+
+        /* Consecutive lines go to different banks */
+        ASSERT_NE(a.bank, dram.decode(0x40).bank);
+
+        dram.access(a, false, 0, state);
+        ASSERT_EQ(DRAM_ROW_MISS, state);
+        ASSERT_FALSE(dram.is_row_hit(a));
+
+        /* Bank is busy for refresh once tREFI has passed */
+        W64 ready = dram.ready_cycle(a, dconf.tREFI);
+        ASSERT_EQ(1, dram.get_refreshes());
+        ASSERT_EQ(W64(dconf.tREFI + dconf.tRFC), ready);
+    }
+
+    TEST(DRAM, AddressMap)
+    {
+        AddressMap map;
+
+        ASSERT_TRUE(map.setup(4, INTERLEAVE_LINE));
+        foreach (i, 8) {
+            ASSERT_EQ(i % 4, map.get_controller(W64(i) << 6));
+        }
+
+        ASSERT_TRUE(map.setup(4, INTERLEAVE_PAGE));
+        ASSERT_EQ(0, map.get_controller(0xfc0));
+        ASSERT_EQ(1, map.get_controller(0x1000));
+
+        /* XOR spreads a page sized stride over all controllers */
+        ASSERT_TRUE(map.setup(4, INTERLEAVE_XOR));
+        bitvec<4> used;
+        foreach (i, 4) {
+            used[map.get_controller(W64(i) << 12)] = 1;
+        }
+        ASSERT_TRUE(used.allset());
+
+        /* Two nodes of 1MB with two controllers and two cores each */
+        ASSERT_FALSE(map.setup(3, INTERLEAVE_LINE, 2, 1 << 20, 2));
+        ASSERT_TRUE(map.setup(4, INTERLEAVE_LINE, 2, 1 << 20, 2));
+        ASSERT_EQ(1, map.get_controller(0x40));
+        ASSERT_EQ(2, map.get_controller(1 << 20));
+        ASSERT_EQ(3, map.get_controller((5 << 20) + 0x40));
+        ASSERT_EQ(1, map.get_core_node(3));
+        ASSERT_EQ(0, map.hops(map.get_core_node(0),
+                    map.get_controller_node(1)));
+        ASSERT_EQ(1, map.hops(map.get_core_node(0),
+                    map.get_controller_node(2)));
+    }
+};
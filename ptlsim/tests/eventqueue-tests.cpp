@@ -0,0 +1,249 @@
+#include <gtest/gtest.h>
+
+#define DISABLE_ASSERT
+#include <ptlsim.h>
+#include <statelist.h>
+#include <eventQueue.h>
+
+using namespace Memory;
+
+namespace {
+
+    dynarray<W64> fired;
+
+    bool record_event(void *arg)
+    {
+        fired.push((W64)arg);
+        return true;
+    }
+
+    /*
+     * Old implementation of the memory event queue, kept here to compare the
+     * timing wheel against: a sorted list that is walked on every insert.
+     */
+    struct ListEvent : public FixStateListObject {
+        W64 clock;
+        void* arg;
+
+        void init() { clock = -1; arg = NULL; }
+    };
+
+    struct ListEventQueue {
+        FixStateList<ListEvent, 2048> queue;
+
+        void add(W64 clock, void* arg) {
+            ListEvent* event = queue.alloc();
+            event->clock = clock;
+            event->arg = arg;
+
+            if (queue.count() == 1)
+                return;
+
+            ListEvent* entryEvent;
+            foreach_list_mutable(queue.list(), entryEvent, entry, preventry) {
+                if (event->clock < entryEvent->clock) {
+                    queue.unlink(event);
+                    queue.insert_after(event, (ListEvent*)(entryEvent->prev));
+                    return;
+                }
+            }
+        }
+
+        ListEvent* pop(W64 cycle) {
+            ListEvent* event = queue.head();
+            if (event && event->clock <= cycle) {
+                queue.free(event);
+                return event;
+            }
+            return NULL;
+        }
+    };
+
+    typedef EventQueue<2048, 64> SmallEventQueue;
+
+    void add_event(SmallEventQueue& queue, Signal& signal, W64 clock,
+            W64 arg)
+    {
+        Event* event = queue.alloc();
+        ASSERT_TRUE(event != NULL);
+        event->setup(&signal, clock, (void*)arg);
+        queue.schedule(event);
+    }
+
+    void run_events(SmallEventQueue& queue, W64 cycle)
+    {
+        Event* event;
+        while ((event = queue.pop(cycle))) {
+            event->execute();
+            queue.free(event);
+        }
+    }
+
+    TEST(EventQueue, SameCycleOrder)
+    {
+        SmallEventQueue* queue = new SmallEventQueue();
+        Signal signal("record");
+        signal.connect(signal_fun_ptr(record_event));
+        fired.clear();
+
+        add_event(*queue, signal, 10, 0);
+        add_event(*queue, signal, 5, 1);
+        add_event(*queue, signal, 10, 2);
+        add_event(*queue, signal, 5, 3);
+        add_event(*queue, signal, 7, 4);
+
+        ASSERT_EQ(5, queue->count());
+        ASSERT_EQ(5, queue->next_clock());
+
+        run_events(*queue, 4);
+        ASSERT_EQ(0, fired.count());
+
+        run_events(*queue, 10);
+        ASSERT_EQ(5, fired.count());
+        ASSERT_EQ(1, fired[0]);
+        ASSERT_EQ(3, fired[1]);
+        ASSERT_EQ(4, fired[2]);
+        ASSERT_EQ(0, fired[3]);
+        ASSERT_EQ(2, fired[4]);
+
+        ASSERT_TRUE(queue->empty());
+        ASSERT_EQ((W64)-1, queue->next_clock());
+
+        delete queue;
+    }
+
+    /* Events beyond the wheel go to overflow heap and must keep order */
+    TEST(EventQueue, OverflowOrder)
+    {
+        SmallEventQueue* queue = new SmallEventQueue();
+        Signal signal("record");
+        signal.connect(signal_fun_ptr(record_event));
+        fired.clear();
+
+        add_event(*queue, signal, 500, 0);
+        add_event(*queue, signal, 300, 1);
+        add_event(*queue, signal, 500, 2);
+        ASSERT_EQ(300, queue->next_clock());
+
+        /* Move the wheel close to the far events, then add more at the
+         * same clocks directly into the wheel */
+        run_events(*queue, 460);
+        ASSERT_EQ(1, fired.count());
+        ASSERT_EQ(1, fired[0]);
+
+        add_event(*queue, signal, 500, 3);
+        add_event(*queue, signal, 470, 4);
+        ASSERT_EQ(470, queue->next_clock());
+
+        run_events(*queue, 10000);
+        ASSERT_EQ(5, fired.count());
+        ASSERT_EQ(4, fired[1]);
+        ASSERT_EQ(0, fired[2]);
+        ASSERT_EQ(2, fired[3]);
+        ASSERT_EQ(3, fired[4]);
+
+        delete queue;
+    }
+
+    /* Compare the event order against the old sorted list */
+    TEST(EventQueue, MatchesSortedList)
+    {
+        SmallEventQueue* queue = new SmallEventQueue();
+        ListEventQueue* list = new ListEventQueue();
+        Signal signal("record");
+        signal.connect(signal_fun_ptr(record_event));
+        fired.clear();
+
+        dynarray<W64> expected;
+        W64 id = 0;
+        srand(1);
+
+        for (W64 cycle = 0; cycle < 50000; cycle++) {
+            run_events(*queue, cycle);
+
+            ListEvent* event;
+            while ((event = list->pop(cycle))) {
+                expected.push((W64)event->arg);
+            }
+
+            int count = rand() % 4;
+            foreach (i, count) {
+                if (queue->count() >= 2000)
+                    break;
+
+                W64 clock = cycle + 1 + ((rand() % 3) ?
+                        rand() % 40 : rand() % 500);
+                add_event(*queue, signal, clock, id);
+                list->add(clock, (void*)id);
+                id++;
+            }
+
+            if (cycle % 5000 == 0)
+                cycle += rand() % 3000;
+        }
+
+        ASSERT_EQ(expected.count(), fired.count());
+        foreach (i, expected.count()) {
+            ASSERT_EQ(expected[i], fired[i]) << "Mismatch at event " << i;
+        }
+
+        delete queue;
+        delete list;
+    }
+
+    /*
+     * Microbenchmark: keep a fixed number of events in flight with a mix of
+     * short cache and long DRAM style delays, and compare host cycles spent
+     * in the timing wheel and the old sorted list. Run with -run-benchmarks.
+     */
+    TEST(Benchmark, EventQueue)
+    {
+        const int in_flight[] = {16, 128, 512, 1024};
+        const W64 cycles = 20000;
+
+        foreach (n, 4) {
+            EventQueue<2048, 1024>* queue = new EventQueue<2048, 1024>();
+            ListEventQueue* list = new ListEventQueue();
+            CycleTimer wheel_timer("wheel");
+            CycleTimer list_timer("list");
+            W64 ops = 0;
+
+            srand(1);
+            wheel_timer.start();
+            for (W64 cycle = 0; cycle < cycles; cycle++) {
+                Event* event;
+                while ((event = queue->pop(cycle))) {
+                    queue->free(event);
+                }
+                while (queue->count() < in_flight[n]) {
+                    event = queue->alloc();
+                    event->setup(NULL, cycle + 1 + (rand() % 8 ?
+                                rand() % 30 : 100 + rand() % 200), NULL);
+                    queue->schedule(event);
+                    ops++;
+                }
+            }
+            wheel_timer.stop();
+
+            srand(1);
+            list_timer.start();
+            for (W64 cycle = 0; cycle < cycles; cycle++) {
+                while (list->pop(cycle)) ;
+                while (list->queue.count() < in_flight[n]) {
+                    list->add(cycle + 1 + (rand() % 8 ?
+                                rand() % 30 : 100 + rand() % 200), NULL);
+                }
+            }
+            list_timer.stop();
+
+            cout << "EventQueue benchmark: " << in_flight[n]
+                << " events in flight, " << ops << " events: wheel "
+                << (double)wheel_timer.cycles() / ops << " cycles/event, list "
+                << (double)list_timer.cycles() / ops << " cycles/event"
+                << endl;
+
+            delete queue;
+            delete list;
+        }
+    }
+};
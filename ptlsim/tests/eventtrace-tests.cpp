@@ -0,0 +1,43 @@
+#include <gtest/gtest.h>
+
+#define DISABLE_ASSERT
+#include <ptlsim.h>
+#include <eventtrace.h>
+
+#include <sstream>
+
+namespace {
+
+    TEST(EventTrace, RecordReplay)
+    {
+        TraceEvent events[4] = {
+            {10, TRACE_EVENT_INTERRUPT, 0, 0x2},
+            {10, TRACE_EVENT_EXIT, 1, 0},
+            {300, TRACE_EVENT_INTERRUPT, 1, 0x80},
+            {W64(1) << 40, TRACE_EVENT_EXIT, 0, 0},
+        };
+
+        std::stringstream ss;
+        EventTraceWriter writer(ss);
+        foreach (i, 4) {
+            writer.write(events[i]);
+        }
+        ASSERT_EQ(4, writer.get_count());
+
+        EventTraceReader reader(ss);
+        ASSERT_TRUE(reader.is_valid());
+
+        TraceEvent event;
+        foreach (i, 4) {
+            ASSERT_TRUE(reader.read(event));
+            ASSERT_EQ(events[i], event);
+        }
+        ASSERT_FALSE(reader.read(event));
+
+        /* Traces without the header are rejected */
+        std::stringstream bad("not a trace");
+        EventTraceReader bad_reader(bad);
+        ASSERT_FALSE(bad_reader.is_valid());
+        ASSERT_FALSE(bad_reader.read(event));
+    }
+};
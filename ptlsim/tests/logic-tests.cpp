@@ -4,6 +4,9 @@
 #define DISABLE_ASSERT
 #include <ptlsim.h>
 #include <logic.h>
+#include <ooo-core/ooo-const.h>
+
+#include <sstream>
 
 namespace {
 
@@ -42,6 +45,122 @@ namespace {
         }
     }
 
+    /* Fill tag arrays with unique tags from 1, leaving every 5th slot invalid */
+    template <typename T>
+    void fill_tags(T& tags, int size)
+    {
+        foreach (i, size) {
+            if (i % 5) tags.insertslot(i, i + 1);
+        }
+    }
+
+    /* AVX2 and SSE matching must agree, including on odd chunk counts */
+    TEST(Logic, AssocTagsAVX2)
+    {
+        if (!x86_host_avx2) return;
+
+        FullyAssociativeTags8bit<72, 72> tags8;
+        FullyAssociativeTags16bit<120, 120> tags16;
+        FullyAssociativeTagsNbitOneHot<40, 40> tlb;
+        fill_tags(tags8, 72);
+        fill_tags(tags16, 120);
+        fill_tags(tlb, 40);
+
+        foreach (tag, 256) {
+            x86_host_avx2 = false;
+            bitvec<72> m8 = tags8.match(tag);
+            bitvec<120> m16 = tags16.match(tag);
+            int slot = tlb.match(tag);
+
+            x86_host_avx2 = true;
+            ASSERT_EQ(m8, tags8.match(tag)) << "tag " << tag;
+            ASSERT_EQ(m16, tags16.match(tag)) << "tag " << tag;
+            ASSERT_EQ(slot, tlb.match(tag)) << "tag " << tag;
+        }
+    }
+
+    /*
+     * Microbenchmark: host cycles per issue queue broadcast over all operand
+     * tags, per uop id search and per TLB probe, at the sizes in ooo-const.h.
+     */
+    template <int size>
+    void issueq_benchmark(W64 ops, int paths)
+    {
+        using namespace OOO_CORE_MODEL;
+        typedef FullyAssociativeTags16bit<size, size> assoc_t;
+
+        assoc_t* uopids = new assoc_t();
+        assoc_t* tags = new assoc_t[MAX_OPERANDS];
+        fill_tags(*uopids, size);
+
+        foreach (avx2, paths) {
+            x86_host_avx2 = avx2;
+            CycleTimer broadcast("broadcast");
+            CycleTimer search("search");
+            W64 found = 0;
+
+            broadcast.start();
+            foreach (i, ops) {
+                if ((i % size) == 0) {
+                    foreach (j, MAX_OPERANDS) fill_tags(tags[j], size);
+                }
+                typename assoc_t::vec_t tagvec = assoc_t::prep(i % size + 1);
+                foreach (j, MAX_OPERANDS) tags[j].invalidate(tagvec);
+            }
+            broadcast.stop();
+
+            search.start();
+            foreach (i, ops) {
+                found += (uopids->search(i % size + 1) >= 0);
+            }
+            search.stop();
+
+            cout << "IssueQueue<" << size << "> benchmark (" <<
+                (avx2 ? "avx2" : "sse") << "): broadcast " <<
+                (double)broadcast.cycles() / ops << " cycles, search " <<
+                (double)search.cycles() / ops << " cycles (" << found << ")" << endl;
+        }
+
+        delete uopids;
+        delete[] tags;
+    }
+
+    /*
+     * Run with -run-benchmarks. Both paths are timed by switching
+     * x86_host_avx2, which is restored before returning.
+     */
+    TEST(Benchmark, AssocTags)
+    {
+        using namespace OOO_CORE_MODEL;
+        const W64 ops = 1000000;
+        bool avx2 = x86_host_avx2;
+        int paths = 1 + avx2;
+
+        issueq_benchmark<ISSUE_QUEUE_SIZE>(ops, paths);
+        issueq_benchmark<ROB_SIZE>(ops, paths);
+
+        FullyAssociativeTagsNbitOneHot<DTLB_SIZE, 40> tlb;
+        fill_tags(tlb, DTLB_SIZE);
+
+        foreach (use_avx2, paths) {
+            x86_host_avx2 = use_avx2;
+            CycleTimer probe("probe");
+            W64 hits = 0;
+
+            probe.start();
+            foreach (i, ops) {
+                hits += (tlb.probe(i % (DTLB_SIZE * 2)) >= 0);
+            }
+            probe.stop();
+
+            cout << "TLB<" << DTLB_SIZE << "> benchmark (" <<
+                (use_avx2 ? "avx2" : "sse") << "): probe " <<
+                (double)probe.cycles() / ops << " cycles (" << hits << ")" << endl;
+        }
+
+        x86_host_avx2 = avx2;
+    }
+
     /* Test simulation freq related functions */
     TEST(Sim, SimFreq)
     {
@@ -56,6 +175,45 @@ namespace {
 #undef TEST_NS_TO_CYCLE
     }
 
+    struct TestLine {
+        W64 tag;
+        W8 state;
+        void reset() { tag = -1; state = 0; }
+        void print(ostream& os, W64 tag) const { }
+    };
+
+    /* Warm state checkpoints restore arrays of same size only */
+    TEST(Sim, WarmStateBlock)
+    {
+        typedef AssociativeArray<W64, TestLine, 64, 4, 64> Array;
+        Array *saved = new Array();
+        Array *restored = new Array();
+        std::stringstream ss;
+
+        foreach (i, 1000) {
+            saved->select(i * 64 * 7)->state = i & 3;
+        }
+
+        save_warm_block(ss, *saved);
+        ASSERT_TRUE(restore_warm_block(ss, *restored));
+
+        foreach (i, 1000) {
+            TestLine* line = saved->probe(i * 64 * 7);
+            TestLine* restored_line = restored->probe(i * 64 * 7);
+            ASSERT_EQ(line == NULL, restored_line == NULL);
+            if (line) {
+                ASSERT_EQ(line->state, restored_line->state);
+            }
+        }
+
+        std::stringstream set_ss;
+        save_warm_block(set_ss, saved->sets[0]);
+        ASSERT_FALSE(restore_warm_block(set_ss, *restored));
+
+        delete saved;
+        delete restored;
+    }
+
     TEST(Sim, InvalidTag)
     {
         W64 invalid = InvalidTag<W64>::INVALID;
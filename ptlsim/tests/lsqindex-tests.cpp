@@ -0,0 +1,365 @@
+#include <gtest/gtest.h>
+
+#define DISABLE_ASSERT
+#define OOO_CORE_NAME "OOO_Test"
+#define OOO_CORE_MODEL OOO_Test
+#include <ptlsim.h>
+#include <ooo-core/ooo.h>
+
+using namespace OOO_CORE_MODEL;
+
+namespace {
+
+    /*
+     * LSQ with the entries of the queue between head and tail, and the
+     * issued bit of their ROB entries
+     */
+    struct TestLSQ {
+        LoadStoreQueueEntry entries[LSQ_SIZE];
+        bool issued[LSQ_SIZE];
+        LSQIndex index;
+        int head, tail, count;
+
+        TestLSQ()
+        {
+            head = tail = count = 0;
+            foreach (i, LSQ_SIZE) {
+                entries[i].init(i);
+                entries[i].addrvalid = 0;
+                entries[i].datavalid = 0;
+                entries[i].physaddr = 0;
+                issued[i] = 0;
+            }
+        }
+
+        LoadStoreQueueEntry& operator [](int i) { return entries[i]; }
+    };
+
+    /* Block addresses close together, across the 32-bit key wrap, or anywhere */
+    W64 random_physaddr()
+    {
+        switch (rand() % 4) {
+            case 0:
+                return (W64(rand()) << 24 ^ rand()) & bitmask(45);
+            case 1:
+                return (0xffffffffULL + (rand() % 4) - 2 +
+                        (W64(rand() % 3) << 32)) & bitmask(45);
+            default:
+                return 1000 + rand() % 12;
+        }
+    }
+
+    void dispatch(TestLSQ& q)
+    {
+        LoadStoreQueueEntry& lsq = q[q.tail];
+        lsq.reset();
+
+        int fence = rand() % 8;
+        lsq.store = rand() % 2;
+        lsq.lfence = lsq.store & ((fence == 0) | (fence == 2));
+        lsq.sfence = lsq.store & ((fence == 1) | (fence == 2));
+        lsq.addrvalid = 0;
+        lsq.datavalid = rand() % 2;
+        if (rand() % 2) lsq.physaddr = random_physaddr();
+        q.issued[q.tail] = 0;
+
+        q.index.add(lsq);
+        q.tail = add_index_modulo(q.tail, +1, LSQ_SIZE);
+        q.count++;
+    }
+
+    /* Entry changes, each followed by the index update the core does */
+    void change(TestLSQ& q)
+    {
+        int slot = add_index_modulo(q.head, rand() % q.count, LSQ_SIZE);
+        LoadStoreQueueEntry& lsq = q[slot];
+
+        switch (rand() % 3) {
+            case 0:
+                lsq.physaddr = random_physaddr();
+                break;
+            case 1:
+                lsq.addrvalid = !lsq.addrvalid;
+                break;
+            default:
+                lsq.datavalid = rand() % 2;
+                q.issued[slot] = rand() % 2;
+                break;
+        }
+
+        q.index.update(lsq);
+    }
+
+    /* Store a load forwards from or waits on, as issueload walked the LSQ */
+    LoadStoreQueueEntry* load_walk(TestLSQ& q, int slot, bool mmio, bool alias)
+    {
+        LoadStoreQueueEntry& state = q[slot];
+        LoadStoreQueueEntry* sfra = NULL;
+
+        for (int i = slot; i != q.head;) {
+            i = add_index_modulo(i, -1, LSQ_SIZE);
+            LoadStoreQueueEntry& stbuf = q[i];
+
+            if (!stbuf.store) continue;
+
+            if (stbuf.addrvalid) {
+                if (stbuf.lfence | stbuf.sfence) continue;
+
+                int x = (stbuf.physaddr - state.physaddr);
+                if (-1 <= x && x <= 1) {
+                    if (sfra == NULL) sfra = &stbuf;
+                    continue;
+                }
+            } else {
+                if (sfra != NULL) continue;
+                if (mmio | stbuf.lfence) return &stbuf;
+                if (stbuf.sfence) continue;
+                if (alias) return &stbuf;
+            }
+        }
+
+        return sfra;
+    }
+
+    /* The same with the index, as issueload does it */
+    LoadStoreQueueEntry* load_search(TestLSQ& q, int slot, bool mmio, bool alias)
+    {
+        LoadStoreQueueEntry& state = q[slot];
+        LSQIndex& lsqindex = q.index;
+
+        int nearest_match = -1;
+        LSQIndex::slotvec_t matches = LSQIndex::window(
+                lsqindex.near(state.physaddr) & lsqindex.stores, q.head, slot);
+        for (int i = matches.lsb(-1); i >= 0; i = matches.nextlsb(i, -1)) {
+            LoadStoreQueueEntry& stbuf = q[LSQIndex::slot_of(q.head, i)];
+
+            if ((!stbuf.addrvalid) | stbuf.lfence | stbuf.sfence) continue;
+
+            int x = (stbuf.physaddr - state.physaddr);
+            if (-1 <= x && x <= 1) nearest_match = i;
+        }
+
+        LSQIndex::slotvec_t blocking = (mmio) ? lsqindex.stores :
+            (alias) ? (lsqindex.lfences | ~lsqindex.sfences) : lsqindex.lfences;
+        int nearest_unknown = LSQIndex::window(lsqindex.unresolved & blocking,
+                q.head, slot).msb(-1);
+
+        if (nearest_unknown > nearest_match)
+            return &q[LSQIndex::slot_of(q.head, nearest_unknown)];
+        if (nearest_match >= 0)
+            return &q[LSQIndex::slot_of(q.head, nearest_match)];
+        return NULL;
+    }
+
+    /* Unresolved store a store waits on, as issuestore walked the LSQ */
+    LoadStoreQueueEntry* store_walk(TestLSQ& q, int slot)
+    {
+        LoadStoreQueueEntry& state = q[slot];
+
+        for (int i = slot; i != q.head;) {
+            i = add_index_modulo(i, -1, LSQ_SIZE);
+            LoadStoreQueueEntry& stbuf = q[i];
+
+            if (!stbuf.store) continue;
+
+            if (stbuf.addrvalid) {
+                if (stbuf.lfence | stbuf.sfence) continue;
+
+                int x = (stbuf.physaddr - state.physaddr);
+                if (-1 <= x && x <= 1) return NULL;
+            } else {
+                if (stbuf.lfence & !stbuf.sfence) continue;
+                return &stbuf;
+            }
+        }
+
+        return NULL;
+    }
+
+    LoadStoreQueueEntry* store_search(TestLSQ& q, int slot)
+    {
+        LoadStoreQueueEntry& state = q[slot];
+        LSQIndex& lsqindex = q.index;
+
+        int nearest_match = -1;
+        LSQIndex::slotvec_t matches = LSQIndex::window(
+                lsqindex.near(state.physaddr) & lsqindex.stores, q.head, slot);
+        for (int i = matches.lsb(-1); i >= 0; i = matches.nextlsb(i, -1)) {
+            LoadStoreQueueEntry& stbuf = q[LSQIndex::slot_of(q.head, i)];
+
+            if ((!stbuf.addrvalid) | stbuf.lfence | stbuf.sfence) continue;
+
+            int x = (stbuf.physaddr - state.physaddr);
+            if (-1 <= x && x <= 1) nearest_match = i;
+        }
+
+        int nearest_unknown = LSQIndex::window(lsqindex.unresolved &
+                ~(lsqindex.lfences & ~lsqindex.sfences), q.head, slot).msb(-1);
+
+        if (nearest_unknown > nearest_match)
+            return &q[LSQIndex::slot_of(q.head, nearest_unknown)];
+        return NULL;
+    }
+
+    /* Nearest unresolved fence, as find_nearest_memory_fence walked the LSQ */
+    LoadStoreQueueEntry* fence_walk(TestLSQ& q, int slot, bool ld)
+    {
+        for (int i = slot; i != q.head;) {
+            i = add_index_modulo(i, -1, LSQ_SIZE);
+            LoadStoreQueueEntry& stbuf = q[i];
+
+            if (!(stbuf.lfence | stbuf.sfence) || stbuf.addrvalid) continue;
+            if ((ld) ? stbuf.lfence : stbuf.sfence) return &stbuf;
+        }
+
+        return NULL;
+    }
+
+    LoadStoreQueueEntry* fence_search(TestLSQ& q, int slot, bool ld)
+    {
+        LSQIndex& lsqindex = q.index;
+        int nearest = LSQIndex::window(lsqindex.unresolved &
+                ((ld) ? lsqindex.lfences : lsqindex.sfences), q.head, slot).msb(-1);
+
+        return (nearest >= 0) ? &q[LSQIndex::slot_of(q.head, nearest)] : NULL;
+    }
+
+    /* First later issued load that aliases a store, as issuestore walked the LSQ */
+    LoadStoreQueueEntry* alias_walk(TestLSQ& q, int slot)
+    {
+        LoadStoreQueueEntry& state = q[slot];
+
+        for (int i = add_index_modulo(slot, +1, LSQ_SIZE); i != q.tail;
+                i = add_index_modulo(i, +1, LSQ_SIZE)) {
+            LoadStoreQueueEntry& ldbuf = q[i];
+
+            int x = (ldbuf.physaddr - state.physaddr);
+            if ((!ldbuf.store) & ldbuf.addrvalid & q.issued[i] &
+                    (-1 <= x && x <= 1))
+                return &ldbuf;
+        }
+
+        return NULL;
+    }
+
+    LoadStoreQueueEntry* alias_search(TestLSQ& q, int slot)
+    {
+        LoadStoreQueueEntry& state = q[slot];
+        LSQIndex& lsqindex = q.index;
+
+        int after = add_index_modulo(slot, +1, LSQ_SIZE);
+        LSQIndex::slotvec_t later_loads = LSQIndex::window(
+                lsqindex.near(state.physaddr) & ~lsqindex.stores, after, q.tail);
+
+        for (int j = later_loads.lsb(-1); j >= 0; j = later_loads.nextlsb(j, -1)) {
+            int i = LSQIndex::slot_of(after, j);
+            LoadStoreQueueEntry& ldbuf = q[i];
+
+            int x = (ldbuf.physaddr - state.physaddr);
+            if ((!ldbuf.store) & ldbuf.addrvalid & q.issued[i] &
+                    (-1 <= x && x <= 1))
+                return &ldbuf;
+        }
+
+        return NULL;
+    }
+
+    /*
+     * Random dispatch, commit, annul and issue of LSQ entries, comparing
+     * every index search with the LSQ walk it replaced
+     */
+    TEST(LSQIndex, SameAsWalk)
+    {
+        TestLSQ *q = new TestLSQ();
+
+        srand(1);
+        foreach (n, 500000) {
+            int op = rand() % 10;
+
+            if (op < 3 && q->count < LSQ_SIZE - 1) {
+                dispatch(*q);
+            } else if (op == 3 && q->count) {
+                /* Commit */
+                q->index.remove(q->head);
+                q->head = add_index_modulo(q->head, +1, LSQ_SIZE);
+                q->count--;
+            } else if (op == 4 && q->count) {
+                /* Annul */
+                q->tail = add_index_modulo(q->tail, -1, LSQ_SIZE);
+                q->index.remove(q->tail);
+                q->count--;
+            } else if (op < 8 && q->count) {
+                change(*q);
+            } else if (q->count) {
+                int slot = add_index_modulo(q->head, rand() % q->count, LSQ_SIZE);
+                bool mmio = (rand() % 4 == 0);
+                bool alias = rand() % 2;
+
+                ASSERT_EQ(load_walk(*q, slot, mmio, alias),
+                        load_search(*q, slot, mmio, alias));
+                ASSERT_EQ(store_walk(*q, slot), store_search(*q, slot));
+                ASSERT_EQ(fence_walk(*q, slot, true), fence_search(*q, slot, true));
+                ASSERT_EQ(fence_walk(*q, slot, false), fence_search(*q, slot, false));
+                ASSERT_EQ(alias_walk(*q, slot), alias_search(*q, slot));
+            }
+        }
+
+        delete q;
+    }
+
+    /* Window selects slots in queue order, also when the queue wraps */
+    TEST(LSQIndex, Window)
+    {
+        LSQIndex::slotvec_t set;
+        set[0] = 1;
+        set[3] = 1;
+        set[LSQ_SIZE - 1] = 1;
+
+        LSQIndex::slotvec_t w = LSQIndex::window(set, LSQ_SIZE - 1, 4);
+        ASSERT_EQ(w.popcount(), 3);
+        ASSERT_TRUE(w[0]);
+        ASSERT_TRUE(w[1]);
+        ASSERT_TRUE(w[4]);
+        ASSERT_EQ(LSQIndex::slot_of(LSQ_SIZE - 1, 4), 3);
+
+        /* Slot 'to' is not included */
+        w = LSQIndex::window(set, 0, 3);
+        ASSERT_EQ(w.popcount(), 1);
+        ASSERT_TRUE(w[0]);
+
+        ASSERT_EQ(LSQIndex::window(set, 1, 1).popcount(), 0);
+    }
+
+    /* Near finds entries one block apart across the 32-bit key wrap */
+    TEST(LSQIndex, Near)
+    {
+        TestLSQ *q = new TestLSQ();
+
+        dispatch(*q);
+        dispatch(*q);
+        (*q)[0].physaddr = 0xffffffffULL;
+        (*q)[1].physaddr = 0x100000000ULL;
+        q->index.update((*q)[0]);
+        q->index.update((*q)[1]);
+
+        LSQIndex::slotvec_t slots = q->index.near(0x100000000ULL);
+        ASSERT_TRUE(slots[0]);
+        ASSERT_TRUE(slots[1]);
+
+        slots = q->index.near(0x100000001ULL);
+        ASSERT_FALSE(slots[0]);
+        ASSERT_TRUE(slots[1]);
+
+        /* Entries are found at their new address once updated */
+        (*q)[1].physaddr = 5000;
+        q->index.update((*q)[1]);
+        ASSERT_FALSE(q->index.near(0x100000001ULL)[1]);
+        ASSERT_TRUE(q->index.near(5001)[1]);
+
+        q->index.remove(1);
+        ASSERT_FALSE(q->index.near(5001)[1]);
+
+        delete q;
+    }
+
+};
@@ -10,7 +10,7 @@ void read_simpoint_file();
 int get_simpoint(int id);
 int get_simpoint_label(int id);
 void add_simpoint(int point, int label);
-void set_next_simpoint(CPUX86State* ctx);
+void set_next_simpoint(void);
 void clear_simpoints(void);
 
 namespace {
@@ -43,10 +43,20 @@ namespace {
         ASSERT_EQ(10000000, config.simpoint_interval);
     }
 
-    TEST(Simpoint, SetNextSimpoint)
+    /* Simpoint counters are split between all CPU Contexts */
+    W64 simpoint_counters()
     {
-        Context& ctx = contextof(0);
+        W64 insns = 0;
+
+        foreach (i, NUM_SIM_CORES) {
+            insns += contextof(i).simpoint_decr;
+        }
 
+        return insns;
+    }
+
+    TEST(Simpoint, SetNextSimpoint)
+    {
         clear_simpoints();
         ofstream of("/tmp/test_simpoint");
         of << "320 0\n";
@@ -64,34 +74,33 @@ namespace {
         ASSERT_EQ(320, get_simpoint(2));
         ASSERT_EQ(3220, get_simpoint(3));
 
-        set_next_simpoint(&ctx);
-        ASSERT_EQ(10 * config.simpoint_interval, ctx.simpoint_decr);
+        set_next_simpoint();
+        ASSERT_EQ(10 * config.simpoint_interval, simpoint_counters());
 
-        set_next_simpoint(&ctx);
-        ASSERT_EQ(10 * config.simpoint_interval, ctx.simpoint_decr);
+        set_next_simpoint();
+        ASSERT_EQ(10 * config.simpoint_interval, simpoint_counters());
 
-        set_next_simpoint(&ctx);
-        ASSERT_EQ(300 * config.simpoint_interval, ctx.simpoint_decr);
+        set_next_simpoint();
+        ASSERT_EQ(300 * config.simpoint_interval, simpoint_counters());
 
-        set_next_simpoint(&ctx);
-        ASSERT_EQ(2900 * config.simpoint_interval, ctx.simpoint_decr);
+        set_next_simpoint();
+        ASSERT_EQ(2900 * config.simpoint_interval, simpoint_counters());
     }
 
     TEST(Simpoint, ChkName)
     {
         stringbuf* name;
-        Context& ctx = contextof(0);
 
         clear_simpoints();
         add_simpoint(10, 0);
         add_simpoint(20, 1);
 
-        set_next_simpoint(&ctx);
+        set_next_simpoint();
         name = get_simpoint_chk_name();
         EXPECT_STREQ("simpoint_sp_0", name->buf);
         delete name;
 
-        set_next_simpoint(&ctx);
+        set_next_simpoint();
         name = get_simpoint_chk_name();
         EXPECT_STREQ("simpoint_sp_1", name->buf);
         delete name;
@@ -101,12 +110,12 @@ namespace {
         add_simpoint(20, 0);
         config.simpoint_chk_name = "test";
 
-        set_next_simpoint(&ctx);
+        set_next_simpoint();
         name = get_simpoint_chk_name();
         EXPECT_STREQ("test_sp_1", name->buf);
         delete name;
 
-        set_next_simpoint(&ctx);
+        set_next_simpoint();
         name = get_simpoint_chk_name();
         EXPECT_STREQ("test_sp_0", name->buf);
         delete name;
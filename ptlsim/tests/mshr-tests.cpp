@@ -0,0 +1,73 @@
+#include <gtest/gtest.h>
+
+#define DISABLE_ASSERT
+#include <ptlsim.h>
+#include <mshr.h>
+
+using namespace Memory;
+
+namespace {
+
+    struct TestEntry : public FixStateListObject {
+        void init() { }
+    };
+
+    typedef MSHRQueue<TestEntry, 8> TestQueue;
+
+    TEST(MSHR, MergeAndOrder)
+    {
+        TestQueue queue;
+        TestEntry *e[5];
+
+        foreach (i, 5) e[i] = queue.alloc();
+
+        ASSERT_FALSE(queue.track(e[0], 0x100));
+        ASSERT_FALSE(queue.track(e[1], 0x200));
+        ASSERT_TRUE(queue.track(e[2], 0x100));
+        ASSERT_TRUE(queue.track(e[3], 0x100));
+        ASSERT_FALSE(queue.track(e[4], 0x100 + 2 * TestQueue::BUCKETS));
+        ASSERT_EQ(3, queue.mshr_count());
+        ASSERT_EQ(3, queue.line_count(0x100));
+
+        /* Entries of a line are in allocation order */
+        ASSERT_EQ(e[0], queue.first(0x100));
+        ASSERT_EQ(e[2], queue.next(e[0]));
+        ASSERT_EQ(e[3], queue.next(e[2]));
+        ASSERT_TRUE(queue.next(e[3]) == NULL);
+        ASSERT_EQ(e[4], queue.first(0x100 + 2 * TestQueue::BUCKETS));
+        ASSERT_TRUE(queue.first(0x300) == NULL);
+
+        /* Freeing the last entry of a line releases its MSHR */
+        queue.free(e[2]);
+        ASSERT_EQ(e[3], queue.next(e[0]));
+        queue.free(e[1]);
+        ASSERT_TRUE(queue.first(0x200) == NULL);
+        ASSERT_EQ(2, queue.mshr_count());
+
+        queue.free(e[0]);
+        queue.free(e[3]);
+        queue.free(e[4]);
+        ASSERT_EQ(0, queue.mshr_count());
+        ASSERT_EQ(0, queue.count());
+    }
+
+    TEST(MSHR, Full)
+    {
+        TestQueue queue;
+
+        /* Every entry can have its own MSHR */
+        foreach (i, 8) {
+            ASSERT_FALSE(queue.track(queue.alloc(), i * 64));
+        }
+        ASSERT_TRUE(queue.isFull());
+        ASSERT_EQ(8, queue.mshr_count());
+
+        foreach (i, 8) {
+            TestEntry *entry = queue.first(i * 64);
+            ASSERT_TRUE(entry != NULL);
+            queue.free(entry);
+        }
+        ASSERT_EQ(0, queue.mshr_count());
+    }
+
+};
@@ -0,0 +1,220 @@
+#include <gtest/gtest.h>
+
+#define DISABLE_ASSERT
+#include <ptlsim.h>
+#include <noc.h>
+#include <bus.h>
+#include <memoryHierarchy.h>
+#include <machine.h>
+
+using namespace Memory;
+using namespace Memory::NetworkOnChip;
+
+namespace {
+
+    /* Follow dimension order routing from src and count the hops */
+    int walk(const Topology& topo, int src, int dest)
+    {
+        int node = src;
+        int hops = 0;
+
+        while (node != dest && hops <= topo.nodes) {
+            node = topo.neighbor(node, topo.route_port(node, dest));
+            hops++;
+        }
+
+        return (node == dest) ? hops : -1;
+    }
+
+    TEST(NoC, MeshRouting)
+    {
+        Topology topo;
+        topo.setup_mesh(4, 4);
+
+        /* X first, then Y */
+        ASSERT_EQ(PORT_EAST, topo.route_port(0, 15));
+        ASSERT_EQ(PORT_SOUTH, topo.route_port(3, 15));
+        ASSERT_EQ(PORT_NORTH, topo.route_port(13, 1));
+        ASSERT_EQ(PORT_LOCAL, topo.route_port(5, 5));
+
+        ASSERT_EQ(-1, topo.neighbor(3, PORT_EAST));
+        ASSERT_EQ(-1, topo.neighbor(0, PORT_NORTH));
+        ASSERT_EQ(4, topo.neighbor(0, PORT_SOUTH));
+
+        foreach (src, 16) {
+            foreach (dest, 16) {
+                ASSERT_EQ(topo.hops(src, dest), walk(topo, src, dest));
+            }
+        }
+
+        int ports[2];
+        ASSERT_EQ(2, topo.productive_ports(0, 15, ports));
+        ASSERT_EQ(PORT_EAST, ports[0]);
+        ASSERT_EQ(PORT_SOUTH, ports[1]);
+        ASSERT_EQ(1, topo.productive_ports(0, 12, ports));
+        ASSERT_EQ(PORT_SOUTH, ports[0]);
+    }
+
+    TEST(NoC, RingRouting)
+    {
+        Topology topo;
+        topo.setup_ring(8);
+
+        /* Shorter direction, clockwise on a tie */
+        ASSERT_EQ(PORT_EAST, topo.route_port(1, 3));
+        ASSERT_EQ(PORT_WEST, topo.route_port(1, 7));
+        ASSERT_EQ(PORT_EAST, topo.route_port(0, 4));
+        ASSERT_EQ(2, topo.hops(1, 7));
+
+        foreach (src, 8) {
+            foreach (dest, 8) {
+                ASSERT_EQ(topo.hops(src, dest), walk(topo, src, dest));
+            }
+        }
+
+        ASSERT_TRUE(topo.crosses_dateline(7, PORT_EAST));
+        ASSERT_TRUE(topo.crosses_dateline(0, PORT_WEST));
+        ASSERT_FALSE(topo.crosses_dateline(3, PORT_EAST));
+    }
+
+    /* Controller that accepts every message and counts it in 'received' */
+    class SinkController : public Controller
+    {
+        public:
+            W64& received;
+
+            SinkController(const char *name, MemoryHierarchy *mem,
+                    W64& received_)
+                : Controller(0, name, mem)
+                , received(received_)
+            { }
+
+            bool handle_interconnect_cb(void *arg) {
+                received++;
+                return true;
+            }
+
+            void register_interconnect(Interconnect *interconnect,
+                    int conn_type) { }
+            void print_map(ostream& os) { }
+            void print(ostream& os) const { }
+            bool is_full(bool fromInterconnect = false) const { return false; }
+            void annul_request(MemoryRequest *request) { }
+            void dump_configuration(YAML::Emitter &out) const { }
+    };
+
+    /*
+     * Send uniform random traffic between the nodes of an interconnect, one
+     * new message per cycle and every other one with data, until all are
+     * delivered. The bus delivers each message to every other node. Returns
+     * host cycles spent, sets the simulated cycles and delivered copies.
+     */
+    W64 time_traffic(const char *type, const char *name, int nodes,
+            int messages, W64& sim_cycles, W64& received)
+    {
+        BaseMachine *machine = (BaseMachine*)PTLsimMachine::getmachine("base");
+        MemoryHierarchy *saved = machine->memoryHierarchyPtr;
+        MemoryHierarchy *mem = new MemoryHierarchy(*machine);
+        machine->memoryHierarchyPtr = mem;
+
+        Interconnect *interconnect;
+        if (strequal(type, "bus"))
+            interconnect = new BusInterconnect(name, mem);
+        else
+            interconnect = new NoC(name, mem, strequal(type, "ring") ?
+                    NOC_RING : NOC_MESH);
+
+        W64 copies = strequal(type, "bus") ? nodes - 1 : 1;
+        received = 0;
+
+        dynarray<SinkController*> sinks;
+        foreach (i, nodes) {
+            stringbuf node_name;
+            node_name << name << "_node_" << i;
+            sinks.push(new SinkController(node_name, mem, received));
+            interconnect->register_controller(sinks[i]);
+        }
+
+        /* The bus keeps arbitrating when idle, so wait for the copies */
+        W64 start_cycle = sim_cycle;
+        W64 limit = (W64)messages * copies * 100;
+        CycleTimer timer(name);
+        int sent = 0;
+        int src = -1;
+        int dest = 0;
+        MemoryRequest *request = NULL;
+
+        srand(1);
+        timer.start();
+        while (received < messages * copies &&
+                sim_cycle - start_cycle < limit) {
+            if (sent < messages) {
+                if (src < 0) {
+                    src = rand() % nodes;
+                    dest = (src + 1 + rand() % (nodes - 1)) % nodes;
+
+                    /* The interconnect holds the request until delivery */
+                    request = mem->get_free_request(0);
+                    request->init(0, 0, 0x1000 + sent * 64, 0, sim_cycle,
+                            false, 0, 0, MEMORY_OP_READ);
+                }
+
+                Message message;
+                message.init();
+                message.sender  = sinks[src];
+                message.origin  = sinks[src];
+                message.dest    = sinks[dest];
+                message.request = request;
+                message.hasData = sent & 1;
+
+                if (interconnect->get_controller_request_signal()->
+                        emit(&message)) {
+                    sent++;
+                    src = -1;
+                }
+            }
+
+            mem->clock();
+            sim_cycle++;
+        }
+        timer.stop();
+
+        sim_cycles = sim_cycle - start_cycle;
+        sim_cycle = start_cycle;
+        machine->memoryHierarchyPtr = saved;
+
+        foreach (i, nodes) {
+            delete sinks[i];
+        }
+        delete interconnect;
+
+        return timer.cycles();
+    }
+
+    /*
+     * Benchmark: host time of the same uniform random traffic on the bus and
+     * on 64 node networks. Run with -run-benchmarks.
+     */
+    TEST(Benchmark, NocVsBus)
+    {
+        const char *types[] = {"bus", "bus", "mesh", "ring"};
+        const char *names[] = {"bench_bus8", "bench_bus64", "bench_mesh64",
+            "bench_ring64"};
+        const int nodes[] = {8, 64, 64, 64};
+        const int messages = 20000;
+
+        foreach (i, 4) {
+            W64 sim_cycles, received;
+            W64 host_cycles = time_traffic(types[i], names[i], nodes[i],
+                    messages, sim_cycles, received);
+
+            /* The bus delivers each message to every other node */
+            W64 copies = strequal(types[i], "bus") ? nodes[i] - 1 : 1;
+            ASSERT_EQ(messages * copies, received);
+
+            cout << "NoC benchmark: " << nodes[i] << " node " << types[i] <<
+                ": " << (double)host_cycles / messages <<
+                " host cycles/message, " << sim_cycles << " cycles" << endl;
+        }
+    }
+};
@@ -0,0 +1,299 @@
+#include <gtest/gtest.h>
+
+#define DISABLE_ASSERT
+#define OOO_CORE_NAME "ooo"
+#define OOO_CORE_MODEL ooo
+#include <ptlsim.h>
+#include <machine.h>
+#include <ooo-core/ooo.h>
+
+namespace {
+
+    using namespace Core;
+    using namespace OOO_CORE_MODEL;
+
+    class OooCoreTest : public ::testing::Test {
+        public:
+            BaseMachine *base_machine;
+
+            OooCoreTest()
+            {
+                base_machine = (BaseMachine*)PTLsimMachine::getmachine(
+                        "base");
+
+                /* Machines of the default configuration with 'ooo' cores */
+                const char *machine_name = (NUM_SIM_CORES == 1) ?
+                    "single_core" : "shared_l2";
+
+                if(strcmp(config.machine_config, machine_name)) {
+                    config.machine_config = machine_name;
+
+                    base_machine->reset();
+                }
+
+                base_machine->init(config);
+            }
+
+            void TearDown()
+            {
+                base_machine->reset();
+                sim_cycle = 0;
+
+                foreach(i, NUM_SIM_CORES) {
+                    bbcache[i].flush(i);
+                }
+            }
+    };
+
+    /*
+     * Skipping idle cycles of a core waiting for an icache fill gives the
+     * same stats as simulating them
+     */
+    TEST_F(OooCoreTest, SkipCyclesSameAsRun)
+    {
+        const int cycles = 1000;
+        StatsBuilder& builder = StatsBuilder::get();
+
+        OooCore* core = (OooCore*)base_machine->cores[0];
+        ThreadContext* thread = core->threads[0];
+
+        thread->ctx.running = 1;
+        thread->waiting_for_icache_fill = 1;
+        thread->last_commit_at_cycle = sim_cycle;
+
+        /* One simulated cycle sets the default stats of the core */
+        core->runcycle(NULL);
+        sim_cycle++;
+
+        ASSERT_TRUE(thread->is_waiting_for_icache());
+        ASSERT_NE(core->get_idle_until(), sim_cycle);
+
+        Stats *user_start = builder.get_new_stats();
+        Stats *kernel_start = builder.get_new_stats();
+        *user_start = *user_stats;
+        *kernel_start = *kernel_stats;
+        int round_robin_tid = core->round_robin_tid;
+
+        foreach(i, cycles) {
+            core->runcycle(NULL);
+            sim_cycle++;
+        }
+
+        ASSERT_TRUE(thread->is_waiting_for_icache());
+
+        Stats *user_run = builder.get_new_stats();
+        Stats *kernel_run = builder.get_new_stats();
+        *user_run = *user_stats;
+        *kernel_run = *kernel_stats;
+        int run_round_robin_tid = core->round_robin_tid;
+
+        *user_stats = *user_start;
+        *kernel_stats = *kernel_start;
+        core->round_robin_tid = round_robin_tid;
+
+        core->skip_cycles(cycles);
+
+        ASSERT_EQ(core->round_robin_tid, run_round_robin_tid);
+        ASSERT_EQ(memcmp((void*)user_run->base(), (void*)user_stats->base(),
+                    STATS_SIZE), 0);
+        ASSERT_EQ(memcmp((void*)kernel_run->base(), (void*)kernel_stats->base(),
+                    STATS_SIZE), 0);
+    }
+
+    /*
+     * Skipping cycles of a core with a load miss at the ROB head and a uop
+     * waiting for full issue queues gives the same stats and dispatch
+     * deadlock countdown as simulating them
+     */
+    TEST_F(OooCoreTest, SkipDataMissSameAsRun)
+    {
+        const int cycles = 1000;
+        StatsBuilder& builder = StatsBuilder::get();
+
+        OooCore& core = *(OooCore*)base_machine->cores[0];
+        ThreadContext* thread = core.threads[0];
+
+        thread->ctx.running = 1;
+        thread->stall_frontend = 1;
+        thread->last_commit_at_cycle = sim_cycle;
+        thread->dispatch_deadlock_countdown = DISPATCH_DEADLOCK_COUNTDOWN_CYCLES;
+
+        /* A load that missed, the rest of its x86 insn and the next insn */
+        StateList* lists[3] = {&thread->rob_cache_miss_list,
+            &thread->rob_dispatched_list[0],
+            &thread->rob_ready_to_dispatch_list};
+
+        foreach(i, 3) {
+            ReorderBufferEntry& rob = *thread->ROB.alloc();
+            rob.reset();
+            setzero(rob.uop);
+            rob.uop.opcode = (i == 0) ? OP_ld : OP_add;
+            rob.uop.som = (i != 1);
+            rob.uop.eom = (i != 0);
+            rob.entry_valid = 1;
+            rob.executable_on_cluster_mask = 1;
+            foreach(j, MAX_OPERANDS) {
+                rob.operands[j] = &core.physregfiles[0][PHYS_REG_NULL];
+            }
+            rob.changestate(*lists[i]);
+        }
+
+        for_each_cluster(cluster) {
+            issueq_operation_on_cluster(core, cluster, count = ISSUE_QUEUE_SIZE);
+        }
+
+        /* One simulated cycle sets the default stats of the core */
+        core.runcycle(NULL);
+        sim_cycle++;
+
+        ASSERT_TRUE(thread->is_waiting_for_dcache());
+        ASSERT_EQ(core.get_idle_until(), sim_cycle +
+                thread->dispatch_deadlock_countdown - 1);
+
+        Stats *user_start = builder.get_new_stats();
+        Stats *kernel_start = builder.get_new_stats();
+        *user_start = *user_stats;
+        *kernel_start = *kernel_stats;
+        int countdown = thread->dispatch_deadlock_countdown;
+
+        foreach(i, cycles) {
+            core.runcycle(NULL);
+            sim_cycle++;
+        }
+
+        ASSERT_TRUE(thread->is_waiting_for_dcache());
+
+        Stats *user_run = builder.get_new_stats();
+        Stats *kernel_run = builder.get_new_stats();
+        *user_run = *user_stats;
+        *kernel_run = *kernel_stats;
+        int run_countdown = thread->dispatch_deadlock_countdown;
+
+        *user_stats = *user_start;
+        *kernel_stats = *kernel_start;
+        thread->dispatch_deadlock_countdown = countdown;
+
+        core.skip_cycles(cycles);
+
+        ASSERT_EQ(thread->dispatch_deadlock_countdown, run_countdown);
+        ASSERT_EQ(memcmp((void*)user_run->base(), (void*)user_stats->base(),
+                    STATS_SIZE), 0);
+        ASSERT_EQ(memcmp((void*)kernel_run->base(), (void*)kernel_stats->base(),
+                    STATS_SIZE), 0);
+
+        /* A free issue queue slot lets the waiting uop dispatch */
+        for_each_cluster(cluster) {
+            issueq_operation_on_cluster(core, cluster, count = 0);
+        }
+        ASSERT_FALSE(thread->is_waiting_for_dcache());
+        ASSERT_EQ(core.get_idle_until(), sim_cycle);
+    }
+
+    /* Fetch stage benchmarks, run with -run-benchmarks */
+    class OooCoreBenchmark : public OooCoreTest {
+    };
+
+    /* bbcache key of a block at rip, on the physical page of the same number */
+    RIPVirtPhys loop_rvp(W64 rip)
+    {
+        RIPVirtPhys rvp;
+        setzero(rvp);
+        rvp.rip = rip;
+        rvp.mfnlo = rvp.mfnhi = rip >> 12;
+        rvp.use64 = 1;
+        return rvp;
+    }
+
+    /* Cache a one uop block of core 0 at rip with the given successors */
+    void cache_loop_bb(W64 rip, W64 taken, W64 not_taken)
+    {
+        RIPVirtPhys rvp = loop_rvp(rip);
+
+        BasicBlock* bb = (BasicBlock*)malloc(sizeof(BasicBlock));
+        bb->reset(rvp);
+        bb->count = 1;
+        bb->bytes = 3;
+        bb->transops[0].init(OP_add, REG_rax, REG_rax, REG_imm, REG_zero, 3, 1);
+
+        BasicBlock* clone = bb->clone();
+        ::free(bb);
+
+        clone->rip_taken = taken;
+        clone->rip_not_taken = not_taken;
+        bbcache[0].add(clone);
+        bbcache[0].add_page(clone);
+    }
+
+    /*
+     * Host cycles per fetch_or_translate_basic_block call along a loop nest
+     * shaped like the hot loops of SPEC CPU integer codes: an outer body of
+     * 8 blocks around an inner loop of the given number of blocks, taken 16
+     * times. Between two fetches a 256 KB buffer is read for the work of the
+     * other stages. Hashed fetches drop the previous block first, so the
+     * lookup cannot follow its chain.
+     */
+    TEST_F(OooCoreBenchmark, FetchLoops)
+    {
+        const int inner_blocks[] = {4, 16, 64};
+        const int outer_blocks = 8;
+        const int inner_iterations = 16;
+        const int fetches = 1 << 15;
+        const int footprint = 256 << 10;
+
+        ThreadContext* thread = ((OooCore*)base_machine->cores[0])->threads[0];
+        byte* buf = (byte*)malloc(footprint);
+        memset(buf, 1, footprint);
+        W64 sum = 0;
+
+        foreach (n, lengthof(inner_blocks)) {
+            W64 base = 0x10000000 + n * 0x100000;
+            W64 inner = base + outer_blocks * 0x40;
+            dynarray<W64> path;
+
+            foreach (b, outer_blocks) {
+                cache_loop_bb(base + b * 0x40, 0, base + (b + 1) * 0x40);
+            }
+            foreach (b, inner_blocks[n]) {
+                W64 rip = inner + b * 0x40;
+                bool last = (b == inner_blocks[n] - 1);
+                cache_loop_bb(rip, (last) ? inner : 0, (last) ? base : rip + 0x40);
+            }
+
+            foreach (b, outer_blocks) path.push(base + b * 0x40);
+            foreach (i, inner_iterations) {
+                foreach (b, inner_blocks[n]) path.push(inner + b * 0x40);
+            }
+
+            CycleTimer timers[2];
+
+            foreach (hashed, 2) {
+                foreach (i, fetches) {
+                    for (int b = 0; b < footprint; b += 64) sum += buf[b];
+
+                    RIPVirtPhys rvp = loop_rvp(path[i % path.count()]);
+                    timers[hashed].start();
+                    if (hashed && thread->current_basic_block) {
+                        thread->current_basic_block->release();
+                        thread->current_basic_block = NULL;
+                    }
+                    BasicBlock* bb = thread->fetch_or_translate_basic_block(rvp);
+                    timers[hashed].stop();
+
+                    ASSERT_EQ(rvp.rip, bb->rip.rip);
+                }
+            }
+
+            cout << "Fetch benchmark: inner loop of " << inner_blocks[n] <<
+                " blocks: chained " << timers[0].cycles() / fetches <<
+                ", hashed " << timers[1].cycles() / fetches << " cycles" << endl;
+
+            thread->current_basic_block->release();
+            thread->current_basic_block = NULL;
+            bbcache[0].flush(0);
+        }
+
+        ASSERT_NE(0, sum);
+        ::free(buf);
+    }
+
+};
@@ -0,0 +1,195 @@
+#include <gtest/gtest.h>
+
+#define DISABLE_ASSERT
+#include <ptlsim.h>
+#include <parallel.h>
+
+namespace {
+
+    /*
+     * Synthetic core: does some private work every cycle and then appends
+     * to a log that is shared by all cores, like a core accessing the memory
+     * hierarchy at the end of its pipeline.
+     */
+    struct TestCore {
+        int id;
+        W64 state;
+        int private_work;
+        dynarray<W64>* log;
+        Signal signal;
+
+        TestCore(int id, int private_work, dynarray<W64>* log)
+            : id(id), state(id + 1), private_work(private_work), log(log)
+            , signal("test-core")
+        {
+            signal.connect(signal_mem_ptr(*this, &TestCore::runcycle));
+        }
+
+        bool runcycle(void* arg) {
+            foreach (i, private_work) {
+                state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+            }
+
+            /* Only some cycles access shared state */
+            if (state & 1) {
+                ParallelSharedAccess shared_access;
+                log->push((W64(id) << 32) | (state >> 48));
+            }
+
+            return false;
+        }
+    };
+
+    void run_cores(int num_cores, int num_threads, int cycles,
+            int private_work, dynarray<W64>& log)
+    {
+        dynarray<TestCore*> cores;
+        dynarray<Signal*> signals;
+
+        foreach (i, num_cores) {
+            cores.push(new TestCore(i, private_work, &log));
+            signals.push(&cores[i]->signal);
+        }
+
+        if (num_threads > 1) {
+            ParallelCycleRunner runner(num_threads);
+            runner.start();
+            foreach (c, cycles) {
+                runner.run(signals);
+            }
+            runner.stop();
+        } else {
+            foreach (c, cycles) {
+                foreach (i, signals.size()) {
+                    signals[i]->emit(NULL);
+                }
+            }
+        }
+
+        foreach (i, num_cores) {
+            delete cores[i];
+        }
+    }
+
+    TEST(Parallel, SameOrderAsSerial)
+    {
+        dynarray<W64> serial;
+        run_cores(7, 1, 500, 20, serial);
+
+        for (int threads = 2; threads <= 8; threads *= 2) {
+            dynarray<W64> threaded;
+            run_cores(7, threads, 500, 20, threaded);
+
+            ASSERT_EQ(serial.count(), threaded.count());
+            foreach (i, serial.count()) {
+                ASSERT_EQ(serial[i], threaded[i]) << "Mismatch at " << i <<
+                    " with " << threads << " threads";
+            }
+        }
+    }
+
+    /* Runner can be stopped and started again, like across QEMU switches */
+    TEST(Parallel, Restart)
+    {
+        dynarray<TestCore*> cores;
+        dynarray<Signal*> signals;
+        dynarray<W64> log;
+
+        foreach (i, 4) {
+            cores.push(new TestCore(i, 0, &log));
+            signals.push(&cores[i]->signal);
+        }
+
+        ParallelCycleRunner runner(3);
+        foreach (r, 50) {
+            runner.start();
+            foreach (c, 10) {
+                runner.run(signals);
+            }
+            runner.stop();
+        }
+
+        ASSERT_GT(log.count(), 0);
+
+        foreach (i, 4) {
+            delete cores[i];
+        }
+    }
+
+    /* Quantum mode runs every signal for each cycle without a barrier */
+    TEST(Parallel, Quantum)
+    {
+        dynarray<TestCore*> cores;
+        dynarray<Signal*> signals;
+        dynarray<W64> log;
+
+        foreach (i, 5) {
+            cores.push(new TestCore(i, 10, &log));
+            signals.push(&cores[i]->signal);
+        }
+
+        dynarray<W64> serial;
+        run_cores(5, 1, 300, 10, serial);
+
+        for (int threads = 1; threads <= 4; threads *= 2) {
+            foreach (i, 5) {
+                cores[i]->state = i + 1;
+            }
+            log.clear();
+
+            ParallelCycleRunner runner(threads);
+            runner.start();
+            foreach (q, 3) {
+                ASSERT_FALSE(runner.run_quantum(signals, 100, NULL));
+                ASSERT_EQ(100, runner.get_quantum_cycles());
+            }
+            runner.stop();
+
+            /* Same accesses, only the interleaving between cores differs */
+            ASSERT_EQ(serial.count(), log.count());
+            W64 serial_sum = 0, quantum_sum = 0;
+            foreach (i, log.count()) {
+                serial_sum += serial[i];
+                quantum_sum += log[i];
+            }
+            ASSERT_EQ(serial_sum, quantum_sum);
+        }
+
+        foreach (i, 5) {
+            delete cores[i];
+        }
+    }
+
+    /*
+     * Benchmark: wall clock time of simulating synthetic cores serially and
+     * with one host thread per core, up to the number of host CPUs. Run with
+     * -run-benchmarks, util/parallel_speedup.py measures a real checkpoint.
+     */
+    TEST(Benchmark, Parallel)
+    {
+        const int num_cores[] = {1, 2, 4, 8, 16};
+        const int cycles = 2000;
+        int host_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+        foreach (n, 5) {
+            int threads = min(num_cores[n], host_cpus);
+            dynarray<W64> log;
+            CycleTimer serial_timer("serial");
+            CycleTimer parallel_timer("parallel");
+
+            serial_timer.start();
+            run_cores(num_cores[n], 1, cycles, 2000, log);
+            serial_timer.stop();
+
+            log.clear();
+            parallel_timer.start();
+            run_cores(num_cores[n], threads, cycles, 2000, log);
+            parallel_timer.stop();
+
+            cout << "Parallel benchmark: " << num_cores[n] << " cores on " <<
+                threads << " threads: speedup " <<
+                (double)serial_timer.cycles() / parallel_timer.cycles() <<
+                endl;
+        }
+    }
+};
@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+
+#define DISABLE_ASSERT
+#include <ptlsim.h>
+#include <prefetcher.h>
+
+using namespace Memory;
+
+namespace {
+
+    PrefetchAccess make_access(W64 line, W64 pc, bool miss)
+    {
+        PrefetchAccess access;
+        access.line = line;
+        access.pc = pc;
+        access.miss = miss;
+        access.prefetchHit = false;
+        access.isWrite = false;
+        return access;
+    }
+
+    TEST(Prefetcher, Builders)
+    {
+        PrefetcherConfig pconf;
+        const char* names[] = {"next_line", "stride", "stream", "region"};
+
+        foreach (i, 4) {
+            Prefetcher* pf = PrefetcherBuilder::create(names[i], pconf);
+            ASSERT_TRUE(pf != NULL);
+            ASSERT_STREQ(names[i], pf->get_name());
+            delete pf;
+        }
+
+        ASSERT_TRUE(PrefetcherBuilder::create("unknown", pconf) == NULL);
+    }
+
+    TEST(Prefetcher, Stride)
+    {
+        PrefetcherConfig pconf;
+        pconf.degree = 2;
+        pconf.distance = 4;
+        StridePrefetcher pf(pconf);
+        dynarray<W64> lines;
+
+        /* Two accesses with same stride are needed to gain confidence */
+        foreach (i, 3) {
+            pf.access(make_access(100 + 3 * i, 0x400, true), lines);
+            ASSERT_EQ(0, lines.count());
+        }
+
+        pf.access(make_access(109, 0x400, false), lines);
+        ASSERT_EQ(2, lines.count());
+        ASSERT_EQ(109 + 3 * 4, lines[0]);
+        ASSERT_EQ(109 + 3 * 5, lines[1]);
+
+        /* Other instructions don't disturb the pattern, strides may be
+         * negative */
+        lines.clear();
+        foreach (i, 4) {
+            pf.access(make_access(500 - 2 * i, 0x401, true), lines);
+        }
+        ASSERT_EQ(2, lines.count());
+        ASSERT_EQ(494 - 2 * 4, lines[0]);
+        ASSERT_EQ(494 - 2 * 5, lines[1]);
+    }
+
+    TEST(Prefetcher, StreamAndRegion)
+    {
+        PrefetcherConfig pconf;
+        pconf.degree = 2;
+        pconf.distance = 4;
+        dynarray<W64> lines;
+
+        StreamPrefetcher stream(pconf);
+        stream.access(make_access(1000, 1, true), lines);
+        ASSERT_EQ(0, lines.count());
+
+        /* Descending misses start a stream */
+        stream.access(make_access(999, 2, true), lines);
+        ASSERT_EQ(2, lines.count());
+        ASSERT_EQ(998, lines[0]);
+        ASSERT_EQ(997, lines[1]);
+
+        /* Hit on a prefetched line keeps stream 'distance' lines ahead */
+        lines.clear();
+        PrefetchAccess hit = make_access(998, 3, false);
+        hit.prefetchHit = true;
+        stream.access(hit, lines);
+        ASSERT_EQ(2, lines.count());
+        ASSERT_EQ(996, lines[0]);
+        ASSERT_EQ(995, lines[1]);
+
+        pconf.table_size = 1;
+        pconf.region_lines = 16;
+        RegionPrefetcher region(pconf);
+
+        /* Learn the pattern of region 0, then trigger it in region 4 */
+        lines.clear();
+        region.access(make_access(2, 0x10, true), lines);
+        region.access(make_access(5, 0x20, true), lines);
+        region.access(make_access(3, 0x30, true), lines);
+        region.access(make_access(15, 0x40, true), lines);
+        region.access(make_access(16 + 7, 0x50, true), lines);
+        ASSERT_EQ(0, lines.count());
+
+        region.access(make_access(64 + 2, 0x10, true), lines);
+        ASSERT_EQ(2, lines.count());
+        ASSERT_EQ(64 + 3, lines[0]);
+        ASSERT_EQ(64 + 5, lines[1]);
+    }
+
+};
@@ -0,0 +1,144 @@
+#include <gtest/gtest.h>
+
+#define DISABLE_ASSERT
+#include <ptlsim.h>
+#include <logic.h>
+#include <replacement.h>
+
+namespace {
+
+    struct TestLine {
+        W64 tag;
+        void reset() { tag = -1; }
+        void print(ostream& os, W64 tag) const { }
+    };
+
+    template <typename repl>
+    struct TestArray : public AssociativeArray<W64, TestLine, 64, 4, 64,
+        NullAssociativeArrayStatisticsCollector<W64, TestLine>, repl> { };
+
+    /* Address of 'line' in set 0 */
+    W64 addr(int line)
+    {
+        return W64(line) * 64 * 64;
+    }
+
+    TEST(Replacement, LRU)
+    {
+        TestArray<LRUReplacement> *array = new TestArray<LRUReplacement>();
+        W64 oldaddr = -1;
+
+        foreach (i, 4) array->select(addr(i));
+
+        /* Touch lines 0 and 1, line 2 is now least recently used */
+        array->probe(addr(0));
+        array->probe(addr(1));
+        array->select(addr(4), oldaddr);
+        ASSERT_EQ(addr(2), oldaddr);
+
+        /* Invalidated ways are filled first */
+        array->invalidate(addr(0));
+        oldaddr = -1;
+        array->select(addr(5), oldaddr);
+        ASSERT_EQ(W64(-1), oldaddr);
+        ASSERT_TRUE(array->probe(addr(1)) != NULL);
+        ASSERT_TRUE(array->probe(addr(3)) != NULL);
+
+        delete array;
+    }
+
+    /* A scan of new lines doesn't evict lines that were reused */
+    template <typename repl>
+    int scan_survivors()
+    {
+        TestArray<repl> *array = new TestArray<repl>();
+
+        foreach (i, 2) {
+            array->select(addr(i));
+            array->probe(addr(i));
+        }
+
+        foreach (i, 6) array->select(addr(100 + i));
+
+        int survivors = 0;
+        foreach (i, 2) survivors += (array->match(addr(i)) != NULL);
+
+        delete array;
+        return survivors;
+    }
+
+    TEST(Replacement, ScanResistance)
+    {
+        ASSERT_EQ(0, scan_survivors<LRUReplacement>());
+        ASSERT_EQ(2, scan_survivors<SRRIPReplacement>());
+        ASSERT_EQ(2, scan_survivors<BRRIPReplacement>());
+        ASSERT_EQ(2, scan_survivors<DRRIPReplacement>());
+        ASSERT_EQ(2, scan_survivors<SHiPReplacement>());
+    }
+
+    TEST(Replacement, SetDueling)
+    {
+        TestArray<DRRIPReplacement> *array =
+            new TestArray<DRRIPReplacement>();
+        W16 psel = array->psel;
+
+        /* Set 0 is an SRRIP leader, set 31 a BRRIP leader */
+        ASSERT_EQ(1, DRRIPShared::leader(0));
+        ASSERT_EQ(-1, DRRIPShared::leader(31));
+        ASSERT_EQ(0, DRRIPShared::leader(5));
+
+        foreach (i, 10) array->select(addr(i));
+        ASSERT_EQ(psel + 10, array->psel);
+        ASSERT_TRUE(array->use_brrip(5));
+
+        foreach (i, 20) array->select(addr(i) + 31 * 64);
+        ASSERT_EQ(psel - 10, array->psel);
+        ASSERT_FALSE(array->use_brrip(5));
+
+        delete array;
+    }
+
+    /*
+     * Microbenchmark: accesses to a single set with a working set slightly
+     * larger than the associativity, reports host cycles per access of each
+     * policy. The default pseudo-LRU must not be slower than before.
+     */
+    template <typename repl>
+    double set_benchmark(W64 accesses)
+    {
+        typedef AssociativeArray<W64, TestLine, 1, 16, 64,
+                NullAssociativeArrayStatisticsCollector<W64, TestLine>,
+                repl> Array;
+        Array *array = new Array();
+        CycleTimer timer(repl::name());
+        W64 sum = 0;
+
+        srand(1);
+        timer.start();
+        foreach (i, accesses) {
+            W64 a = W64(rand() % 20) * 64;
+            TestLine *line = array->probe(a);
+            if (!line) line = array->select(a);
+            sum += line->tag;
+        }
+        timer.stop();
+
+        delete array;
+        return (sum) ? double(timer.cycles()) / accesses : 0;
+    }
+
+    /* Run with -run-benchmarks */
+    TEST(Benchmark, Replacement)
+    {
+        const W64 accesses = 1000000;
+
+        cout << "Replacement benchmark (cycles/access, 16 ways):" <<
+            " plru " << set_benchmark<PseudoLRUReplacement>(accesses) <<
+            " lru " << set_benchmark<LRUReplacement>(accesses) <<
+            " srrip " << set_benchmark<SRRIPReplacement>(accesses) <<
+            " brrip " << set_benchmark<BRRIPReplacement>(accesses) <<
+            " drrip " << set_benchmark<DRRIPReplacement>(accesses) <<
+            " ship " << set_benchmark<SHiPReplacement>(accesses) << endl;
+    }
+
+};
@@ -0,0 +1,132 @@
+#include <gtest/gtest.h>
+
+#define DISABLE_ASSERT
+#include <ptlsim.h>
+#include <memoryHierarchy.h>
+#include <memoryRequest.h>
+
+using namespace Memory;
+
+namespace {
+
+    MemoryRequest* new_request(RequestPool *pool, W64 addr)
+    {
+        MemoryRequest *request = pool->get_free_request();
+        request->init(0, 0, addr, 0, 0, false, 0, 0, MEMORY_OP_READ);
+        return request;
+    }
+
+    TEST(RequestPool, ReleaseOnLastReference)
+    {
+        RequestPool *pool = new RequestPool();
+        int size = pool->size();
+
+        MemoryRequest *request = new_request(pool, 0x1000);
+        ASSERT_EQ(size, pool->free_count());
+
+        request->incRefCounter();
+        request->incRefCounter();
+        ASSERT_EQ(size - 1, pool->free_count());
+        ASSERT_EQ(1, pool->used_list().count);
+
+        request->decRefCounter();
+        ASSERT_EQ(size - 1, pool->free_count());
+
+        /* Last reference returns the request to the pool */
+        request->decRefCounter();
+        ASSERT_EQ(size, pool->free_count());
+        ASSERT_EQ(0, pool->used_list().count);
+
+        /* Extra release of an annulled request is ignored */
+        request->decRefCounter();
+        ASSERT_EQ(0, request->get_ref_counter());
+        ASSERT_EQ(size, pool->free_count());
+
+        delete pool;
+    }
+
+    TEST(RequestPool, Grow)
+    {
+        RequestPool *pool = new RequestPool();
+        int count = REQUEST_POOL_SIZE * 3;
+        MemoryRequest **requests = new MemoryRequest*[count];
+
+        foreach (i, count) {
+            requests[i] = new_request(pool, i * 64);
+            requests[i]->incRefCounter();
+        }
+
+        ASSERT_GE(pool->size(), count);
+        ASSERT_EQ(count, pool->used_list().count);
+
+        /* Requests are not moved when the pool grows */
+        foreach (i, count) {
+            ASSERT_EQ(W64(i * 64), requests[i]->get_physical_address());
+            requests[i]->decRefCounter();
+        }
+        ASSERT_EQ(pool->size(), pool->free_count());
+
+        delete[] requests;
+        delete pool;
+    }
+
+    /* A request that was never referenced is reused last */
+    TEST(RequestPool, ReuseOrder)
+    {
+        RequestPool *pool = new RequestPool();
+        MemoryRequest *request = new_request(pool, 0x1000);
+
+        foreach (i, pool->size() - 1) {
+            ASSERT_NE(request, pool->get_free_request());
+        }
+        ASSERT_EQ(request, pool->get_free_request());
+
+        delete pool;
+    }
+
+    /*
+     * Heap allocations per simulated access: each access takes a request,
+     * queues it in two controllers and releases it. Without history there
+     * are none in steady state, with history only the first use of a
+     * request allocates it.
+     */
+    double pool_allocations(bool history, W64 accesses)
+    {
+        RequestPool *pool = new RequestPool();
+        W64 base = pool->allocations();
+
+        foreach (i, accesses) {
+            MemoryRequest *request = new_request(pool, i * 64);
+
+            request->incRefCounter();
+            request->incRefCounter();
+            if (history) request->get_history() << "{+L1} {+L2} ";
+            request->decRefCounter();
+            request->decRefCounter();
+        }
+
+        double per_access = double(pool->allocations() - base) / accesses;
+        delete pool;
+        return per_access;
+    }
+
+    TEST(RequestPool, Allocations)
+    {
+        const W64 accesses = 4 * REQUEST_POOL_SIZE;
+
+        ASSERT_EQ(0, pool_allocations(false, accesses));
+        ASSERT_LE(pool_allocations(true, accesses) * accesses, REQUEST_POOL_SIZE);
+    }
+
+    /* Run with -run-benchmarks */
+    TEST(Benchmark, RequestPool)
+    {
+        const W64 accesses = 1000000;
+        double without_history = pool_allocations(false, accesses);
+        double with_history = pool_allocations(true, accesses);
+
+        cout << "Request pool allocations per access: without history " <<
+            without_history << " with history " << with_history << endl;
+    }
+
+};
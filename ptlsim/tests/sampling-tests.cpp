@@ -0,0 +1,45 @@
+#include <gtest/gtest.h>
+
+#define DISABLE_ASSERT
+#include <ptlsim.h>
+#include <sampling.h>
+
+namespace {
+
+    TEST(Sampling, ConfidenceToZ)
+    {
+        ASSERT_NEAR(1.645, confidence_to_z(0.90), 0.001);
+        ASSERT_NEAR(1.960, confidence_to_z(0.95), 0.001);
+        ASSERT_NEAR(2.968, confidence_to_z(0.997), 0.001);
+    }
+
+    TEST(Sampling, Estimator)
+    {
+        SampleEstimator est;
+
+        est.add(1.0);
+        ASSERT_EQ(1, est.count);
+        ASSERT_EQ(HUGE_VAL, est.rel_error(1.96));
+
+        est.add(2.0);
+        est.add(3.0);
+        est.add(4.0);
+        est.add(5.0);
+
+        ASSERT_DOUBLE_EQ(3.0, est.mean());
+        ASSERT_NEAR(1.5811, est.stddev(), 0.0001);
+        ASSERT_NEAR(1.96 * 1.5811 / sqrt(5.0), est.half_width(1.96), 0.0001);
+        ASSERT_NEAR(est.half_width(1.96) / 3.0, est.rel_error(1.96), 0.0001);
+
+        /* Error bound shrinks as more windows with same spread are added */
+        double err = est.rel_error(1.96);
+        foreach (i, 5) {
+            est.add(1.0 + i);
+        }
+        ASSERT_LT(est.rel_error(1.96), err);
+
+        est.reset();
+        ASSERT_EQ(0, est.count);
+        ASSERT_EQ(0, est.mean());
+    }
+};
@@ -35,7 +35,7 @@ void MemoryHierarchy::dcache_wakeup_wrapper(int coreid, int threadid,
 
 Config config;
 
-W64 sim_cycle;
+SIM_CYCLE_TLS W64 sim_cycle;
 
 ostream ptl_logfile;
 
@@ -147,10 +147,20 @@ machine_core_option_add = '''
 '''
 
 cache_typedef_cacheline = '''
-typedef CacheLines<%s, %s, %s, %s> %sCacheLines;
+typedef CacheLines<%s, %s, %s, %s, %s> %sCacheLines;
 
 '''
 
+# Cache 'REPLACEMENT' param values and their policy classes
+cache_replacement_policies = {
+        'plru'  : 'PseudoLRUReplacement',
+        'lru'   : 'LRUReplacement',
+        'srrip' : 'SRRIPReplacement',
+        'brrip' : 'BRRIPReplacement',
+        'drrip' : 'DRRIPReplacement',
+        'ship'  : 'SHiPReplacement',
+        }
+
 cache_case_stmt = '''
         case %s:
             return new %s(%s_READ_PORTS, %s_WRITE_PORTS);
@@ -684,8 +694,14 @@ def generate_cache_logic(config, options):
         for cache, cfg in config["cache"].items():
             # First write all params
             for param,val in cfg["params"].items():
+                if param == "REPLACEMENT":
+                    continue
                 of.write("#define %s_%s %s\n" % (cache.upper(), param,
                     str(val)))
+            # Replacement policy, pseudo-LRU if not specified
+            repl = str(cfg["params"].get("REPLACEMENT", "plru")).lower()
+            assert repl in cache_replacement_policies, \
+                    "Unknown replacement policy %s of cache %s" % (repl, cache)
             # Find the number of sets
             size = get_cache_size(cfg["params"]["SIZE"])
             assoc = cfg["params"]["ASSOC"]
@@ -703,6 +719,7 @@ def generate_cache_logic(config, options):
                 c_pfx + "ASSOC",
                 c_pfx + "LINE_SIZE",
                 c_pfx + "LATENCY",
+                cache_replacement_policies[repl],
                 c_pfx))
 
             typedefs[cache] = c_pfx + "CacheLines"
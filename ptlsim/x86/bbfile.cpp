@@ -0,0 +1,326 @@
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * This code is released under GPL.
+ *
+ */
+
+#include <bbfile.h>
+#include <decode.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+BasicBlockFile bbfile;
+
+static const char BB_FILE_MAGIC[8] = {'M', 'A', 'R', 'S', 'S', 'B', 'B', '2'};
+static const int BB_FILE_BUCKETS = 65536;
+
+struct BasicBlockFile::Header {
+    char magic[8];
+    /* Decoded uops are only valid for the same uop and assist encoding */
+    W32 base_size;
+    W32 transop_size;
+    W16 opcodes;
+    W16 assists;
+    W16 light_assists;
+    W16 pad;
+    W32 buckets;
+    W32 pad2;
+    W64 size;
+    W64 used;
+};
+
+struct BasicBlockFile::Record {
+    W64 next;
+    W64 codehash;
+    W64 rip;
+    W32 mode;
+    W16 ripbits;
+    W16 count;
+    /* Followed by BasicBlockBase, count TransOps and the x86 bytes */
+    BasicBlockBase bb;
+
+    TransOp* transops() { return (TransOp*)(this + 1); }
+    byte* code() { return (byte*)(transops() + count); }
+
+    static W64 size_of(int count, int bytes) {
+        return ceil(W64(sizeof(Record) + count * sizeof(TransOp) + bytes), 8);
+    }
+};
+
+static inline W16 ripbits_of(const RIPVirtPhysBase& rvp)
+{
+    return rvp.use64 | (rvp.kernel << 1) | (rvp.df << 2);
+}
+
+BasicBlockFile::BasicBlockFile()
+    : fd_(-1)
+    , base_(NULL)
+    , size_(0)
+{
+}
+
+W64* BasicBlockFile::buckets() const
+{
+    return (W64*)(base_ + sizeof(Header));
+}
+
+W64 BasicBlockFile::first_record() const
+{
+    return sizeof(Header) + header()->buckets * sizeof(W64);
+}
+
+W64 BasicBlockFile::bucket_of(W64 rip, W32 mode, W64 codehash) const
+{
+    W64 h = codehash ^ (rip * 0x9e3779b97f4a7c15ULL) ^ mode;
+    return (h ^ (h >> 32)) % header()->buckets;
+}
+
+W64 BasicBlockFile::get_used() const
+{
+    return base_ ? header()->used : 0;
+}
+
+/**
+ * @brief Hash the first BB_FILE_KEY_BYTES x86 bytes fetched at a rip
+ *
+ * Short blocks hash some of the code after them too. That code changing
+ * only makes their lookup miss, as load compares the bytes of the block.
+ */
+static W64 hash_code(const byte* code)
+{
+    W64 h = 0xcbf29ce484222325ULL;
+
+    foreach (i, BB_FILE_KEY_BYTES) {
+        h = (h ^ code[i]) * 0x100000001b3ULL;
+    }
+
+    return h;
+}
+
+/**
+ * @brief Map a basic block file, creating it if it does not exist
+ *
+ * @param filename File to open
+ * @param size Size of a new file in bytes, an existing file keeps its size
+ *
+ * @return false if the file could not be used, the simulation then decodes
+ * every block as usual
+ */
+bool BasicBlockFile::open(const char* filename, W64 size)
+{
+    close();
+
+    int fd = ::open(filename, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        cerr << "Warning: unable to open basic block file " << filename << endl;
+        return false;
+    }
+
+    Header signature;
+    memset(&signature, 0, sizeof(signature));
+    memcpy(signature.magic, BB_FILE_MAGIC, sizeof(BB_FILE_MAGIC));
+    signature.base_size = sizeof(BasicBlockBase);
+    signature.transop_size = sizeof(TransOp);
+    signature.opcodes = OP_MAX_OPCODE;
+    signature.assists = ASSIST_COUNT;
+    signature.light_assists = L_ASSIST_COUNT;
+    signature.buckets = BB_FILE_BUCKETS;
+
+    flock(fd, LOCK_EX);
+
+    struct stat st;
+    fstat(fd, &st);
+    bool create = (st.st_size == 0);
+
+    W64 start = sizeof(Header) + signature.buckets * sizeof(W64);
+    if (create) {
+        size = max(size, start + PAGE_SIZE);
+        if (ftruncate(fd, size) < 0) {
+            cerr << "Warning: unable to resize basic block file " << filename << endl;
+            flock(fd, LOCK_UN);
+            ::close(fd);
+            return false;
+        }
+    } else {
+        size = st.st_size;
+    }
+
+    void* base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        cerr << "Warning: unable to map basic block file " << filename << endl;
+        flock(fd, LOCK_UN);
+        ::close(fd);
+        return false;
+    }
+
+    fd_ = fd;
+    base_ = (byte*)base;
+    size_ = size;
+
+    if (create) {
+        /* A new sparse file reads as zeros, so all buckets are empty */
+        *header() = signature;
+        header()->size = size;
+        header()->used = start;
+    }
+
+    Header found = *header();
+    found.size = 0;
+    found.used = 0;
+    bool valid = (memcmp(&found, &signature, sizeof(Header)) == 0) &&
+        (header()->size == size_) && (header()->used >= start) &&
+        (header()->used <= size_);
+
+    flock(fd, LOCK_UN);
+
+    if (!valid) {
+        cerr << "Warning: basic block file " << filename <<
+            " was written by another simulator build, delete it to rebuild it" << endl;
+        close();
+        return false;
+    }
+
+    ptl_logfile << "Basic block file " << filename << ": " <<
+        header()->used << " of " << size_ << " bytes used" << endl;
+    return true;
+}
+
+void BasicBlockFile::close()
+{
+    if (base_) munmap(base_, size_);
+    if (fd_ >= 0) ::close(fd_);
+
+    fd_ = -1;
+    base_ = NULL;
+    size_ = 0;
+}
+
+/**
+ * @brief Find a decoded block
+ *
+ * @param rvp Block to translate
+ * @param mode Decoder mode, see SharedBasicBlockCache::mode_of
+ * @param code x86 bytes fetched at rvp
+ * @param valid_bytes Number of valid bytes in code
+ *
+ * @return A new block that can be freed with BasicBlock::free, or NULL
+ */
+BasicBlock* BasicBlockFile::load(const RIPVirtPhys& rvp, W32 mode,
+        const byte* code, int valid_bytes)
+{
+    if unlikely (valid_bytes < BB_FILE_KEY_BYTES)
+        return NULL;
+
+    W64 codehash = hash_code(code);
+    W64 offset = ((volatile W64*)buckets())[bucket_of(rvp.rip, mode, codehash)];
+    W64 start = first_record();
+    W16 ripbits = ripbits_of(rvp);
+
+    while (offset) {
+        if unlikely ((offset < start) || (offset + sizeof(Record) > size_))
+            return NULL;
+
+        Record* rec = (Record*)(base_ + offset);
+        W64 end = offset;
+
+        /* Records are appended, so a valid chain only goes backwards */
+        offset = rec->next;
+        if unlikely (offset >= end)
+            return NULL;
+
+        if ((rec->codehash != codehash) | (rec->rip != rvp.rip) |
+                (rec->mode != mode) | (rec->ripbits != ripbits))
+            continue;
+
+        if unlikely ((rec->count != rec->bb.count) ||
+                (rec->count > MAX_BB_UOPS*2) ||
+                (rec->bb.bytes > MAX_BB_BYTES) ||
+                (end + Record::size_of(rec->count, rec->bb.bytes) > size_))
+            return NULL;
+
+        if ((rec->bb.bytes > valid_bytes) ||
+                memcmp(rec->code(), code, rec->bb.bytes))
+            continue;
+
+        BasicBlock* bb = (BasicBlock*)malloc(sizeof(BasicBlockBase) +
+                (rec->count * sizeof(TransOp)));
+
+        memcpy((void*)bb, (void*)&rec->bb, sizeof(BasicBlockBase));
+        memcpy(bb->transops, rec->transops(), rec->count * sizeof(TransOp));
+
+        /* Host pointers and per run state are not valid in the file */
+        bb->rip = rvp;
+        bb->hashlink.reset();
+        bb->mfnlo_loc.reset();
+        bb->mfnhi_loc.reset();
+        bb->synthops = NULL;
+        bb->uops = bb->transops;
+        bb->shared = NULL;
+        bb->unchain();
+        bb->refcount = 0;
+        bb->hitcount = 0;
+        bb->predcount = 0;
+        bb->context_id = 0;
+        bb->use(0);
+        return bb;
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Append a decoded block
+ *
+ * @param bb Block decoded from code
+ * @param mode Decoder mode the block was decoded in
+ * @param code x86 bytes fetched at bb.rip
+ * @param valid_bytes Number of valid bytes in code
+ *
+ * @return false if the file is full or fewer than BB_FILE_KEY_BYTES bytes
+ * are valid
+ */
+bool BasicBlockFile::store(const BasicBlock& bb, W32 mode, const byte* code,
+        int valid_bytes)
+{
+    if unlikely (valid_bytes < BB_FILE_KEY_BYTES)
+        return false;
+
+    W64 codehash = hash_code(code);
+    W64 size = Record::size_of(bb.count, bb.bytes);
+
+    flock(fd_, LOCK_EX);
+
+    Header* h = header();
+    W64 offset = h->used;
+
+    if unlikely (offset + size > size_) {
+        flock(fd_, LOCK_UN);
+        return false;
+    }
+
+    Record* rec = (Record*)(base_ + offset);
+    W64 bucket = bucket_of(bb.rip.rip, mode, codehash);
+
+    rec->codehash = codehash;
+    rec->rip = bb.rip.rip;
+    rec->mode = mode;
+    rec->ripbits = ripbits_of(bb.rip);
+    rec->count = bb.count;
+    memcpy((void*)&rec->bb, (void*)&bb, sizeof(BasicBlockBase));
+    memcpy(rec->transops(), bb.uops, bb.count * sizeof(TransOp));
+    memcpy(rec->code(), code, bb.bytes);
+    rec->next = buckets()[bucket];
+
+    /* Readers may walk the bucket without the lock */
+    barrier();
+    ((volatile W64*)buckets())[bucket] = offset;
+    h->used = offset + size;
+
+    flock(fd_, LOCK_UN);
+    return true;
+}
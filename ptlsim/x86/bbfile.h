@@ -0,0 +1,71 @@
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * This code is released under GPL.
+ *
+ */
+
+#ifndef BBFILE_H
+#define BBFILE_H
+
+#include <globals.h>
+#include <ptlsim.h>
+
+/**
+ * @brief Persistent file of decoded basic blocks
+ *
+ * Runs from the same checkpoint decode the same guest code again and again.
+ * This file keeps decoded blocks across runs: it is memory mapped and
+ * blocks are looked up when a core translates a block no core has decoded
+ * yet, so nothing is read up front.
+ *
+ * A block is keyed by a hash of the first BB_FILE_KEY_BYTES x86 bytes
+ * fetched at its rip, its RIPVirtPhys context bits (rip, use64, kernel, df)
+ * and the decoder mode. The x86 bytes of the block are stored with it and
+ * compared with the bytes just fetched, so a block is never reused for code
+ * that was modified, even if it crosses into a second page.
+ *
+ * The file starts with a header and a table of hash buckets, followed by
+ * records that are only ever appended. Appends take an exclusive lock on
+ * the file and publish a record by linking it into its bucket last, so
+ * several simulations can share one file. When the file is full, new
+ * blocks are not stored. Records are checked against the mapped size
+ * before they are read, so a damaged file only loses blocks.
+ */
+/* Number of x86 bytes fetched at the rip of a block that are hashed */
+static const int BB_FILE_KEY_BYTES = 16;
+
+class BasicBlockFile {
+    public:
+        BasicBlockFile();
+        ~BasicBlockFile() { close(); }
+
+        bool open(const char* filename, W64 size);
+        void close();
+        bool is_open() const { return base_ != NULL; }
+
+        BasicBlock* load(const RIPVirtPhys& rvp, W32 mode, const byte* code,
+                int valid_bytes);
+        bool store(const BasicBlock& bb, W32 mode, const byte* code,
+                int valid_bytes);
+
+        W64 get_size() const { return size_; }
+        W64 get_used() const;
+
+    private:
+        int fd_;
+        byte* base_;
+        W64 size_;
+
+        struct Header;
+        struct Record;
+
+        Header* header() const { return (Header*)base_; }
+        W64* buckets() const;
+        W64 first_record() const;
+        W64 bucket_of(W64 rip, W32 mode, W64 codehash) const;
+};
+
+extern BasicBlockFile bbfile;
+
+#endif // BBFILE_H
@@ -8,11 +8,13 @@
 #include <globals.h>
 #include <ptlsim.h>
 #include <decode.h>
+#include <bbfile.h>
 
 #include <setjmp.h>
 
 BasicBlockCache bbcache[NUM_SIM_CORES];
 W8 BasicBlockCache::cpuid_counter = 0;
+SharedBasicBlockCache shared_bbcache;
 
 struct BasicBlockChunkListHashtableLinkManager {
     static inline BasicBlockChunkList* objof(selflistlink* link) {
@@ -1684,9 +1686,120 @@ bool assist_invalid_opcode(Context& ctx) {
     return true;
 }
 
+//
+// Shared decoded basic blocks
+//
+W32 SharedBasicBlockCache::mode_of(Context& ctx) {
+    W32 mode = ctx.hflags & (HF_PE_MASK | HF_SS32_MASK | HF_CS32_MASK | HF_CS64_MASK |
+            HF_LMA_MASK | HF_SVME_MASK | HF_SVMI_MASK);
+    mode |= (ctx.use32 & 1) << 30;
+    mode |= ((ctx.eflags >> VM_SHIFT) & 1) << 31;
+    return mode;
+}
+
+//
+// Key of the shared copy of the block at rvp. The physical page is
+// INVALID if rip is not mapped, such a block is never decoded.
+//
+SharedBasicBlockKey SharedBasicBlockCache::key_of(Context& ctx, const RIPVirtPhys& rvp) {
+    SharedBasicBlockKey key;
+    key.rip = rvp;
+    key.mode = mode_of(ctx);
+
+    int exception = 0;
+    int mmio = 0;
+    PageFaultErrorCode pfec;
+
+    Waddr paddr = ctx.check_and_translate(rvp.rip, 0, false, false, exception, mmio, pfec, true);
+    key.physpage = (exception | mmio) ? RIPVirtPhys::INVALID : (paddr >> log2(PAGE_SIZE));
+    return key;
+}
+
+static inline W64 shared_bb_bytes(const BasicBlock* bb) {
+    return sizeof(SharedBasicBlock) + sizeof(BasicBlockBase) + bb->bytes +
+        bb->count * (sizeof(TransOp) + sizeof(uopimpl_func_t));
+}
+
+SharedBasicBlock* SharedBasicBlockCache::lookup(const SharedBasicBlockKey& key) {
+    return get(key);
+}
+
+//
+// Check that code, the x86 bytes now at the rip of a shared copy,
+// are still the bytes it was decoded from
+//
+bool SharedBasicBlockCache::matches(const SharedBasicBlock* shared, const byte* code, int valid_bytes) const {
+    return (shared->bb->bytes <= valid_bytes) &&
+        (memcmp(shared->code, code, shared->bb->bytes) == 0);
+}
+
+//
+// Take ownership of a newly decoded block. Its uops are synthesized
+// here once, so handles never need their own synthops.
+//
+SharedBasicBlock* SharedBasicBlockCache::insert(BasicBlock* bb, const SharedBasicBlockKey& key, const byte* code) {
+    SharedBasicBlock* shared = new SharedBasicBlock();
+    shared->key = key;
+    shared->hashlink.reset();
+    shared->handles = 0;
+    shared->bb = bb;
+    shared->code = (byte*)malloc(bb->bytes);
+    memcpy(shared->code, code, bb->bytes);
+
+    if (!bb->synthops) synth_uops_for_bb(*bb);
+
+    add(shared);
+    bytes += shared_bb_bytes(bb);
+    return shared;
+}
+
+BasicBlock* SharedBasicBlockCache::handle(SharedBasicBlock* shared) {
+    BasicBlock* bb = (BasicBlock*)malloc(sizeof(BasicBlockBase));
+
+    memcpy((void*)bb, (void*)shared->bb, sizeof(BasicBlockBase));
+
+    // hashlink, mfnlo_loc, mfnhi_loc are updated when the handle is cached
+    bb->hashlink.reset();
+    bb->refcount = 0;
+    bb->use(0);
+    bb->uops = shared->bb->transops;
+    bb->synthops = shared->bb->synthops;
+    bb->shared = shared;
+    bb->unchain();
+
+    shared->handles++;
+    return bb;
+}
+
+//
+// Drop the reference of a handle that is being freed. A stale
+// copy is no longer found by lookups, but stays alive until
+// the handles of other cores are invalidated too.
+//
+void SharedBasicBlockCache::release(BasicBlock* bb, bool stale) {
+    SharedBasicBlock* shared = bb->shared;
+
+    bb->shared = NULL;
+    bb->synthops = NULL;
+    bb->uops = NULL;
+
+    if (stale) remove(shared);
+
+    assert(shared->handles > 0);
+    if (--shared->handles) return;
+
+    remove(shared);
+    bytes -= shared_bb_bytes(shared->bb);
+    shared->bb->free();
+    ::free(shared->code);
+    delete shared;
+}
+
 static const bool log_code_page_ops = 0;
 
 bool BasicBlockCache::invalidate(BasicBlock* bb, int reason) {
+    ParallelSharedAccess shared_access;
+
     BasicBlockChunkList* pagelist;
     if unlikely (bb->refcount) {
         if(logable(8))
@@ -1714,10 +1827,14 @@ bool BasicBlockCache::invalidate(BasicBlock* bb, int reason) {
     }
 
     remove(bb);
-    W64 ct = bbcache[cpuid].count;
+    epoch++;
+    W64 ct = count;
     DECODERSTAT->bbcache.count = ct;
     DECODERSTAT->bbcache.invalidates[reason]++;
 
+    // Code that changed must not be handed to other cores either
+    if (bb->shared) shared_bbcache.release(bb, reason != INVALIDATE_REASON_RECLAIM);
+
     bb->free();
     return true;
 }
@@ -1760,6 +1877,8 @@ void BasicBlockCache::add_page(BasicBlock* bb)
 // when we run out of memory (it may will allocate any memory).
 //
 bool BasicBlockCache::invalidate_page(Waddr mfn, int reason) {
+    ParallelSharedAccess shared_access;
+
     //
     // We may try to invalidate the special invalid mfn if SMC
     // occurs on a page where the high virtual page is invalid.
@@ -1781,7 +1900,8 @@ bool BasicBlockCache::invalidate_page(Waddr mfn, int reason) {
     while ((entry = iter.next())) {
         BasicBlock* bb = *entry;
         if (logable(3) | log_code_page_ops) ptl_logfile << "  Invalidate bb " << bb << " (" << bb->rip << ", " << bb->bytes << " bytes)" << endl;
-        if unlikely (!bbcache[cpuid].invalidate(bb, reason)) {
+        // Page lists are shared, so this may be the handle of another core's cache
+        if unlikely (!bbcache[bb->context_id].invalidate(bb, reason)) {
             if (logable(3) | log_code_page_ops) ptl_logfile << "  Could not invalidate bb " << bb << " (" << bb->rip << ", " << bb->bytes <<
                  " bytes): still has refcount " << bb->refcount << endl;
             return false;
@@ -1925,6 +2045,7 @@ int BasicBlockCache::reclaim(size_t bytesreq, int urgency) {
 // references are allowed.
 //
 void BasicBlockCache::flush(int8_t context_id) {
+    ParallelSharedAccess shared_access;
 
     if (logable(1))
         ptl_logfile << "Flushing basic block cache at " << sim_cycle << " cycles, " << total_insns_committed << " commits:" << endl;
@@ -1941,6 +2062,13 @@ void BasicBlockCache::flush(int8_t context_id) {
         }
     }
 
+    //
+    // A flush follows a TLB flush, so shared copies of blocks that are
+    // still in some pipeline may belong to another address space now:
+    // they stay alive for their handles but are not reused.
+    //
+    shared_bbcache.clear();
+
     //
     // Reclaim per-page chunklist heads
     //
@@ -2332,6 +2460,68 @@ ostream& printflags(ostream& os, W64 flags) {
     return os;
 }
 
+//
+// Decode the basic block at rvp into a new clone. Returns NULL
+// if the first instruction could not be fetched or the block
+// raised an exec fault while decoding.
+//
+static BasicBlock* decode_basic_block(Context& ctx, const RIPVirtPhys& rvp, W32 mode, byte* insnbuf) {
+    DecoderStats* stats = decoder_stats[ctx.cpu_index];
+
+    TraceDecoder trans(rvp);
+    if(trans.fillbuf(ctx, insnbuf, MAX_BB_BYTES) <= 0) {
+        return NULL;
+    }
+
+    if (logable(10) | log_code_page_ops) {
+        ptl_logfile << "Translating " << rvp << " (" << trans.valid_byte_count << " bytes valid) at " << sim_cycle << 
+          " cycles, " << total_insns_committed << " commits" << endl;
+        ptl_logfile << "Instruction Buffer: 64[" << trans.use64 << "] \n";
+        foreach(i, MAX_BB_BYTES) {
+            ptl_logfile << hexstring(insnbuf[i], 8) << " ";
+        }
+        ptl_logfile << endl << superstl::flush;
+    }
+
+    if (rvp.mfnlo == RIPVirtPhys::INVALID) {
+        assert(trans.valid_byte_count == 0);
+    }
+
+    //
+    // Only blocks fetched with a full buffer of valid bytes go to the
+    // basic block file, so a block cut short by an unmapped page is not
+    // reused once that page is mapped. Without a file nothing is hashed.
+    //
+    bool persistent = bbfile.is_open() && (trans.valid_byte_count == MAX_BB_BYTES);
+
+    if (persistent) {
+        BasicBlock* bb = bbfile.load(rvp, mode, insnbuf, trans.valid_byte_count);
+        if (bb) {
+            stats->file.hits++;
+            return bb;
+        }
+        stats->file.misses++;
+    }
+
+    for (;;) {
+        if (!trans.translate()) break;
+    }
+
+    if(trans.handle_exec_fault) {
+        return NULL;
+    }
+
+    stats->throughput.basic_blocks++;
+
+    if (persistent && !bbfile.store(trans.bb, mode, insnbuf, trans.valid_byte_count)) {
+        stats->file.full++;
+    }
+
+    trans.bb.hitcount = 0;
+    trans.bb.predcount = 0;
+    return trans.bb.clone();
+}
+
 //
 // Translate one basic block. This function always returns
 // a BasicBlock, except in the very rare case where one or
@@ -2340,6 +2530,8 @@ ostream& printflags(ostream& os, W64 flags) {
 // references to some of the basic blocks.
 //
 BasicBlock* BasicBlockCache::translate(Context& ctx, const RIPVirtPhys& rvp) {
+    ParallelSharedAccess shared_access;
+
     if unlikely ((rvp.rip == config.start_log_at_rip) && (rvp.rip != 0xffffffffffffffffULL)) {
         config.start_log_at_iteration = 0;
         logenable = 1;
@@ -2358,7 +2550,7 @@ BasicBlock* BasicBlockCache::translate(Context& ctx, const RIPVirtPhys& rvp) {
        */
 
     BasicBlock* bb = get(rvp);
-    if likely (bb && bb->context_id == ctx.cpu_index) {
+    if likely (bb && bb->context_id == cpuid) {
         return bb;
     }
 
@@ -2366,38 +2558,39 @@ BasicBlock* BasicBlockCache::translate(Context& ctx, const RIPVirtPhys& rvp) {
 
     translate_timer.start();
 
-    byte insnbuf[MAX_BB_BYTES];
+    SharedBasicBlockKey key = SharedBasicBlockCache::key_of(ctx, rvp);
+    SharedBasicBlock* shared = shared_bbcache.lookup(key);
 
-    TraceDecoder trans(rvp);
-    if(trans.fillbuf(ctx, insnbuf, sizeof(insnbuf)) <= 0) {
-        return NULL;
-    }
-
-    if (logable(10) | log_code_page_ops) {
-        ptl_logfile << "Translating " << rvp << " (" << trans.valid_byte_count << " bytes valid) at " << sim_cycle << 
-          " cycles, " << total_insns_committed << " commits" << endl;
-        ptl_logfile << "Instruction Buffer: 64[" << trans.use64 << "] \n";
-        foreach(i, (int)sizeof(insnbuf)) {
-            ptl_logfile << hexstring(insnbuf[i], 8) << " ";
+    if likely (shared) {
+        //
+        // A block crossing into a second page may have other code
+        // there, so check all of its bytes before reusing it
+        //
+        byte code[MAX_BB_BYTES];
+        PageFaultErrorCode pfec;
+        W64 faultaddr = 0;
+        int n = ctx.copy_from_vm(code, rvp.rip, shared->bb->bytes, pfec, faultaddr, true);
+
+        if unlikely (!shared_bbcache.matches(shared, code, n)) {
+            // Handles of other cores keep the old copy until they are invalidated
+            shared_bbcache.remove(shared);
+            shared = NULL;
+            DECODERSTAT->shared.mismatches++;
         }
-        ptl_logfile << endl << superstl::flush;
     }
 
-    if (rvp.mfnlo == RIPVirtPhys::INVALID) {
-        assert(trans.valid_byte_count == 0);
-    }
+    if likely (shared) {
+        DECODERSTAT->shared.hits++;
+    } else {
+        byte insnbuf[MAX_BB_BYTES];
+        BasicBlock* decoded = decode_basic_block(ctx, rvp, key.mode, insnbuf);
+        if unlikely (!decoded) return NULL;
 
-    for (;;) {
-        if (!trans.translate()) break;
+        shared = shared_bbcache.insert(decoded, key, insnbuf);
+        DECODERSTAT->shared.misses++;
     }
 
-    if(trans.handle_exec_fault) {
-        return NULL;
-    }
-
-    trans.bb.hitcount = 0;
-    trans.bb.predcount = 0;
-    bb = trans.bb.clone();
+    bb = shared_bbcache.handle(shared);
     //
     // Acquire a reference to the new basic block right away,
     // since we make allocations below that might reclaim it
@@ -2409,7 +2602,6 @@ BasicBlock* BasicBlockCache::translate(Context& ctx, const RIPVirtPhys& rvp) {
     W64 ct = this->count;
     DECODERSTAT->bbcache.count = ct;
     DECODERSTAT->bbcache.inserts++;
-    DECODERSTAT->throughput.basic_blocks++;
 
     BasicBlockChunkList* pagelist;
 
@@ -2460,11 +2652,11 @@ BasicBlock* BasicBlockCache::translate(Context& ctx, const RIPVirtPhys& rvp) {
     if (logable(10)) {
         ptl_logfile << "=====================================================================" << endl;
         ptl_logfile << *bb << endl;
-        ptl_logfile << "End of basic block: rip " << trans.bb.rip << " -> taken rip 0x" << (void*)(Waddr)trans.bb.rip_taken << 
-          ", not taken rip 0x" << (void*)(Waddr)trans.bb.rip_not_taken << endl;
+        ptl_logfile << "End of basic block: rip " << bb->rip << " -> taken rip 0x" << (void*)(Waddr)bb->rip_taken << 
+          ", not taken rip 0x" << (void*)(Waddr)bb->rip_not_taken << endl;
     }
 
-    bb->context_id = ctx.cpu_index;
+    bb->context_id = cpuid;
 
     translate_timer.stop();
 
@@ -2482,6 +2674,8 @@ BasicBlock* BasicBlockCache::translate(Context& ctx, const RIPVirtPhys& rvp) {
 // This function does not allocate any memory.
 //
 void BasicBlockCache::translate_in_place(BasicBlock& targetbb, Context& ctx, Waddr rip) {
+    ParallelSharedAccess shared_access;
+
     if unlikely ((rip == config.start_log_at_rip) && (rip != 0xffffffffffffffffULL)) {
         config.start_log_at_iteration = 0;
         logenable = 1;
@@ -2509,6 +2703,7 @@ void BasicBlockCache::translate_in_place(BasicBlock& targetbb, Context& ctx, Wad
 
     memcpy(&targetbb, &trans.bb, sizeof(BasicBlockBase));
     memcpy(&targetbb.transops, &trans.bb.transops, trans.bb.count * sizeof(TransOp));
+    targetbb.uops = targetbb.transops;
 
     if (logable(5)) {
         ptl_logfile << "=====================================================================" << endl;
@@ -2519,6 +2714,8 @@ void BasicBlockCache::translate_in_place(BasicBlock& targetbb, Context& ctx, Wad
 }
 
 BasicBlock* BasicBlockCache::translate_and_clone(Context& ctx, Waddr rip) {
+    ParallelSharedAccess shared_access;
+
     if unlikely ((rip == config.start_log_at_rip) && (rip != 0xffffffffffffffffULL)) {
         config.start_log_at_iteration = 0;
         logenable = 1;
@@ -2582,6 +2779,7 @@ void shutdown_decode() {
         bbcache[i].flush(0);
     }
     if (bbcache_dump_file) bbcache_dump_file.close();
+    bbfile.close();
 }
 
 void dump_bbcache_to_logfile() {
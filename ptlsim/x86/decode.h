@@ -630,6 +630,47 @@ enum {
 struct BasicBlockCache: public SelfHashtable<RIPVirtPhys, BasicBlock, BB_CACHE_SIZE, BasicBlockHashtableLinkManager> {
   BasicBlockCache(): SelfHashtable<RIPVirtPhys, BasicBlock, BB_CACHE_SIZE, BasicBlockHashtableLinkManager>() {
       cpuid = cpuid_counter++;
+      epoch = 1;
+  }
+
+  BasicBlock* add(BasicBlock* bb) {
+    // The block it replaces may still be chained
+    if unlikely (get(bb->rip)) epoch++;
+    return SelfHashtable<RIPVirtPhys, BasicBlock, BB_CACHE_SIZE, BasicBlockHashtableLinkManager>::add(bb);
+  }
+
+  //
+  // Fetch stages link each block to the blocks fetched after it, so
+  // a hot path follows these pointers instead of hashing its rip.
+  // Removing any block from the cache bumps the epoch, which drops
+  // all chains at once.
+  //
+  BasicBlock* chained(BasicBlock* bb, const RIPVirtPhys& rvp) {
+    int slot = (rvp.rip == bb->rip_not_taken);
+    BasicBlock* next = bb->chain[slot];
+    if likely (next && (bb->chainepoch == epoch) && (next->rip.rip == rvp.rip)) return next;
+    return NULL;
+  }
+
+  void chain(BasicBlock* bb, BasicBlock* next) {
+    if unlikely (bb->chainepoch != epoch) {
+      bb->unchain();
+      bb->chainepoch = epoch;
+    }
+    bb->chain[next->rip.rip == bb->rip_not_taken] = next;
+  }
+
+  //
+  // Block at rvp, following the chain of the block fetched before it
+  // if there is one.
+  //
+  BasicBlock* lookup(BasicBlock* prev, const RIPVirtPhys& rvp) {
+    BasicBlock* bb = (prev) ? chained(prev, rvp) : NULL;
+    if likely (bb) return bb;
+
+    bb = get(rvp);
+    if (prev && bb) chain(prev, bb);
+    return bb;
   }
 
   BasicBlock* translate(Context& ctx, const RIPVirtPhys& rvp);
@@ -644,12 +685,99 @@ struct BasicBlockCache: public SelfHashtable<RIPVirtPhys, BasicBlock, BB_CACHE_S
   void flush(int8_t context_id);
   W8 cpuid;
   static W8 cpuid_counter;
+  W64 epoch;
 
   ostream& print(ostream& os);
 };
 
 extern BasicBlockCache bbcache[NUM_SIM_CORES];
 
+//
+// Decoded basic blocks shared by all cores
+//
+// Cores running the same code in the same mode decode it only once. The
+// first core to translate a block adds its decoded copy here; each core's
+// BasicBlockCache then holds a small handle (a BasicBlockBase) whose uops
+// and synthops point into that copy, and which keeps its own refcount,
+// prediction info and page list locators. The copy is freed when its
+// last handle is invalidated.
+//
+// Besides the RIPVirtPhys bits, the key has the decoder mode taken from
+// the context (operand and stack size, protected and vm86 mode, SVM) and
+// the guest physical page of the rip. RIPVirtPhys has no physical frames
+// in MARSS, so without it two processes running different code at the same
+// virtual address would share blocks. The x86 bytes of each copy are kept
+// too and compared on every hit, which also covers the second page of a
+// block that crosses a page boundary.
+//
+struct SharedBasicBlockKey {
+  RIPVirtPhysBase rip;
+  W64 physpage;
+  W32 mode;
+};
+
+struct SharedBasicBlock {
+  SharedBasicBlockKey key;
+  selflistlink hashlink;
+  int handles;
+  BasicBlock* bb;
+  byte* code;   // bb->bytes x86 bytes the copy was decoded from
+};
+
+namespace superstl {
+  template <int setcount>
+  struct HashtableKeyManager<SharedBasicBlockKey, setcount> {
+    static inline int hash(const SharedBasicBlockKey& key) {
+      W64 slot = foldbits<log2(setcount)>(key.rip.rip);
+      slot ^= key.physpage ^ key.mode;
+      return slot;
+    }
+
+    static inline bool equal(const SharedBasicBlockKey& a, const SharedBasicBlockKey& b) {
+      return (a.rip.rip == b.rip.rip) & (a.rip.mfnlo == b.rip.mfnlo) & (a.rip.mfnhi == b.rip.mfnhi) &
+        (a.rip.use64 == b.rip.use64) & (a.rip.kernel == b.rip.kernel) & (a.rip.df == b.rip.df) &
+        (a.physpage == b.physpage) & (a.mode == b.mode);
+    }
+
+    static inline SharedBasicBlockKey dup(const SharedBasicBlockKey& key) { return key; }
+    static inline void free(SharedBasicBlockKey& key) { }
+  };
+};
+
+struct SharedBasicBlockHashtableLinkManager {
+  static inline SharedBasicBlock* objof(selflistlink* link) {
+    return baseof(SharedBasicBlock, hashlink, link);
+  }
+
+  static inline SharedBasicBlockKey& keyof(SharedBasicBlock* obj) {
+    return obj->key;
+  }
+
+  static inline selflistlink* linkof(SharedBasicBlock* obj) {
+    return &obj->hashlink;
+  }
+};
+
+// The shared table holds the blocks of every core, so give it more sets
+static const int SHARED_BB_CACHE_SIZE = BB_CACHE_SIZE * 4;
+
+struct SharedBasicBlockCache: public SelfHashtable<SharedBasicBlockKey, SharedBasicBlock, SHARED_BB_CACHE_SIZE, SharedBasicBlockHashtableLinkManager> {
+  SharedBasicBlockCache() { bytes = 0; }
+
+  static W32 mode_of(Context& ctx);
+  static SharedBasicBlockKey key_of(Context& ctx, const RIPVirtPhys& rvp);
+  SharedBasicBlock* lookup(const SharedBasicBlockKey& key);
+  bool matches(const SharedBasicBlock* shared, const byte* code, int valid_bytes) const;
+  SharedBasicBlock* insert(BasicBlock* bb, const SharedBasicBlockKey& key, const byte* code);
+  BasicBlock* handle(SharedBasicBlock* shared);
+  void release(BasicBlock* bb, bool stale);
+
+  // Bytes held by decoded copies and their synthops
+  W64 bytes;
+};
+
+extern SharedBasicBlockCache shared_bbcache;
+
 extern ofstream bbcache_dump_file;
 
 static const char* decode_type_names[DECODE_TYPE_COUNT] = {
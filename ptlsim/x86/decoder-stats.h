@@ -65,6 +65,39 @@ struct DecoderStats : public Statable
     cache bbcache;
     cache pagecache;
 
+    /*
+     * Translations that reused (hits) or made (misses) a shared decoded copy,
+     * mismatches counts copies dropped because the x86 bytes differed
+     */
+    struct shared : public Statable
+    {
+        StatObj<W64> hits;
+        StatObj<W64> misses;
+        StatObj<W64> mismatches;
+
+        shared(Statable *parent)
+            : Statable("shared", parent)
+              , hits("hits", this)
+              , misses("misses", this)
+              , mismatches("mismatches", this)
+        { }
+    } shared;
+
+    /* Lookups in the persistent basic block file, full counts blocks not stored */
+    struct file : public Statable
+    {
+        StatObj<W64> hits;
+        StatObj<W64> misses;
+        StatObj<W64> full;
+
+        file(Statable *parent)
+            : Statable("file", parent)
+              , hits("hits", this)
+              , misses("misses", this)
+              , full("full", this)
+        { }
+    } file;
+
     StatObj<W64> reclaim_rounds;
 
     DecoderStats(Statable *parent)
@@ -75,6 +108,8 @@ struct DecoderStats : public Statable
           , page_crossings(this)
           , bbcache("bbcache", this)
           , pagecache("pagecache", this)
+          , shared(this)
+          , file(this)
           , reclaim_rounds("reclaim_rounds", this)
     { }
 };
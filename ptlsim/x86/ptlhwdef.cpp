@@ -475,6 +475,7 @@ void BasicBlock::reset() {
   mfnlo_loc.reset();
   mfnhi_loc.reset();
   type = BB_TYPE_COND;
+  uops = transops;
   context_id = 0;
 }
 
@@ -507,11 +508,14 @@ BasicBlock* BasicBlock::clone() {
   memcpy(bb, this, sizeof(BasicBlockBase));
 
   bb->synthops = NULL;
+  bb->uops = bb->transops;
+  bb->shared = NULL;
+  bb->unchain();
   // hashlink, mfnlo_loc, mfnhi_loc are always updated after cloning
   bb->hashlink.reset();
   bb->use(0);
 
-  foreach (i, count) bb->transops[i] = this->transops[i];
+  foreach (i, count) bb->transops[i] = this->uops[i];
   return bb;
 }
 
@@ -526,7 +530,7 @@ ostream& operator <<(ostream& os, const BasicBlock& bb) {
   int bytes_in_insn = 0;
 
   foreach (i, bb.count) {
-    const TransOp& transop = bb.transops[i];
+    const TransOp& transop = bb.uops[i];
     os << "  " << (void*)rip << ": " << transop;
 
     os << endl;
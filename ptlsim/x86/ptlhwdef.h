@@ -194,9 +194,10 @@ using std::map;
 //
 
 #include <globals.h>
-extern "C" W64 sim_cycle;
+extern "C" SIM_CYCLE_TLS W64 sim_cycle;
 #include <logic.h>
 #include <config.h>
+#include <parallel.h>
 
 //
 // Exceptions:
@@ -831,6 +832,11 @@ struct Context: public CPUX86State {
   W64 exec_fault_addr;
   map<Waddr, Waddr> hvirt_gphys_map;
 
+  // check_events() sampled at start of each cycle in parallel mode so all
+  // cores see the same pending events within a cycle
+  bool events_pending;
+  bool events_sampled;
+
 
   void change_runstate(int new_state) { running = new_state; }
 
@@ -845,6 +851,7 @@ struct Context: public CPUX86State {
   }
 
   void setup_qemu_switch() {
+	  ParallelSharedAccess shared_access;
 	  old_eip = eip;
 	  set_eip_qemu();
 	  set_cpu_env((CPUX86State*)this);
@@ -861,6 +868,7 @@ struct Context: public CPUX86State {
   }
 
   void setup_ptlsim_switch() {
+	  ParallelSharedAccess shared_access;
 
 	  set_cpu_env((CPUX86State*)this);
 	  // W64 flags = compute_eflags();
@@ -937,6 +945,7 @@ struct Context: public CPUX86State {
 
   // SMC code support
   bool smc_isdirty(Waddr virtaddr) {
+	  ParallelSharedAccess shared_access;
 
 	  CPUTLBEntry *tlb_entry = get_tlb_entry(virtaddr);;
 	  W64 tlb_addr = tlb_entry->addr_code;
@@ -961,6 +970,7 @@ struct Context: public CPUX86State {
   }
 
   void smc_setdirty(Waddr virtaddr) {
+	  ParallelSharedAccess shared_access;
 
 	  CPUTLBEntry *tlb_entry = get_tlb_entry(virtaddr);;
 	  W64 tlb_addr = tlb_entry->addr_code;
@@ -987,12 +997,18 @@ struct Context: public CPUX86State {
 
   void init();
 
-  Context() : invalid_reg(-1), reg_zero(0), reg_ctx((Waddr)this) { }
+  Context() : invalid_reg(-1), reg_zero(0), reg_ctx((Waddr)this),
+    events_sampled(false) { }
 
   W64 virt_to_pte_phys_addr(Waddr virtaddr, byte& level);
 
   void update_mode_count();
   bool check_events() const;
+  void sample_events() { events_pending = check_events(); events_sampled = true; }
+  void unsample_events() { events_sampled = false; }
+  bool pending_events() const {
+    return events_sampled ? events_pending : check_events();
+  }
   bool is_int_pending() const;
   bool event_upcall();
 
@@ -1682,6 +1698,8 @@ enum {
 extern const char* branch_type_names[8];
 
 
+struct SharedBasicBlock;
+
 struct BasicBlockBase {
   RIPVirtPhys rip;
   selflistlink hashlink;
@@ -1699,13 +1717,17 @@ struct BasicBlockBase {
   byte marked:1, mfence:1, x87:1, sse:1, nondeterministic:1, brtype:3;
   W64 usedregs;
   uopimpl_func_t* synthops;
+  TransOp* uops;             // transops of this block or of its shared decoded copy
+  SharedBasicBlock* shared;  // shared decoded copy if this block is a handle to it
+  BasicBlock* chain[2];      // blocks fetched after this one, taken/not taken
+  W64 chainepoch;            // BasicBlockCache epoch the chain is valid in
   int refcount;
   W32 hitcount;
   W32 predcount;
   W32 confidence;
   W64 lastused;
   W64 lasttarget;
-  W16 context_id;
+  W16 context_id;           // index of the bbcache holding this block
 
   void acquire() {
     refcount++;
@@ -1716,6 +1738,12 @@ struct BasicBlockBase {
     assert(refcount >= 0);
     return (!refcount);
   }
+
+  void unchain() {
+    chain[0] = NULL;
+    chain[1] = NULL;
+    chainepoch = 0;
+  }
 };
 
 struct BasicBlock: public BasicBlockBase {
@@ -1792,7 +1792,7 @@ uopimpl_func_t get_synthcode_for_uop(int op, int size, bool setflags, int cond,
 void synth_uops_for_bb(BasicBlock& bb) {
   bb.synthops = new uopimpl_func_t[bb.count];
   foreach (i, bb.count) {
-    const TransOp& transop = bb.transops[i];
+    const TransOp& transop = bb.uops[i];
     uopimpl_func_t func = get_synthcode_for_uop(transop.opcode, transop.size, transop.setflags, transop.cond, transop.extshift, 0, transop.internal);
     bb.synthops[i] = func;
   }
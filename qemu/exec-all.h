@@ -158,6 +158,9 @@ struct TranslationBlock {
     struct TranslationBlock *jmp_next[2];
     struct TranslationBlock *jmp_first;
     uint32_t icount;
+#ifdef MARSS_QEMU
+    int bbv_id; /* basic block vector id when profiling */
+#endif
 };
 
 static inline unsigned int tb_jmp_cache_hash_page(target_ulong pc)
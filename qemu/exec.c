@@ -982,6 +982,10 @@ TranslationBlock *tb_gen_code(CPUState *env,
         phys_page2 = get_page_addr_code(env, virt_page2);
     }
     tb_link_page(tb, phys_pc, phys_page2);
+#ifdef MARSS_QEMU
+    if (ptl_bbv_enabled)
+        tb->bbv_id = ptl_bbv_block_id(phys_pc, tb->icount);
+#endif
     return tb;
 }
 
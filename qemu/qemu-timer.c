@@ -764,6 +764,24 @@ int64_t qemu_next_deadline(void)
     return delta;
 }
 
+#ifdef MARSS_QEMU
+int64_t qemu_next_sim_timer_deadline(void)
+{
+    int64_t delta;
+
+    if (!active_timers[QEMU_CLOCK_VIRTUAL])
+        return INT64_MAX;
+
+    delta = active_timers[QEMU_CLOCK_VIRTUAL]->expire_time -
+        cpu_get_sim_clock();
+
+    if (delta < 0)
+        delta = 0;
+
+    return delta;
+}
+#endif
+
 static int64_t qemu_next_alarm_deadline(void)
 {
     int64_t delta;
@@ -54,6 +54,9 @@ void qemu_system_powerdown_request(void);
 int qemu_shutdown_requested(void);
 int qemu_reset_requested(void);
 int qemu_powerdown_requested(void);
+#ifdef MARSS_QEMU
+int qemu_system_request_pending(void);
+#endif
 extern qemu_irq qemu_system_powerdown;
 void qemu_system_reset(void);
 
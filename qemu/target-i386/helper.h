@@ -98,6 +98,10 @@ DEF_HELPER_1(inl, tl, i32)
 #ifdef MARSS_QEMU
 DEF_HELPER_0(switch_to_sim, void)
 DEF_HELPER_0(simpoint, void)
+DEF_HELPER_1(warm_fetch, void, tl)
+DEF_HELPER_2(warm_mem, void, tl, i32)
+DEF_HELPER_3(warm_branch, void, tl, tl, i32)
+DEF_HELPER_1(bbv_count, void, ptr)
 #endif
 
 DEF_HELPER_2(svm_check_intercept_param, void, i32, i64)
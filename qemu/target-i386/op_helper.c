@@ -614,6 +614,34 @@ void helper_simpoint(void)
      * to handle this 'simpoint'. */
     ptl_simpoint_reached(env->cpu_index);
 }
+
+/* Functional warming during fast-forward, branch addresses are EIP values */
+void helper_warm_fetch(target_ulong pc)
+{
+    ptl_warm_fetch(env->cpu_index, pc);
+}
+
+void helper_warm_mem(target_ulong addr, uint32_t is_write)
+{
+    ptl_warm_mem(env->cpu_index, addr, is_write);
+}
+
+void helper_warm_branch(target_ulong next_eip, target_ulong target_eip,
+        uint32_t type)
+{
+    target_ulong cs_base = env->segs[R_CS].base;
+
+    ptl_warm_branch(env->cpu_index, cs_base + next_eip, cs_base + target_eip,
+            type);
+}
+
+/* Basic block vector profiling, called at start of each executed block */
+void helper_bbv_count(void *tb_ptr)
+{
+    TranslationBlock *tb = tb_ptr;
+
+    ptl_bbv_count(env->cpu_index, tb->bbv_id, tb->icount);
+}
 #endif
 
 static inline unsigned int get_sp_mask(unsigned int e2)
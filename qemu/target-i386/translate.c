@@ -496,9 +496,57 @@ static inline void gen_op_addq_A0_reg_sN(int shift, int reg)
 }
 #endif
 
+#ifdef MARSS_QEMU
+/* Functional warming hooks, only generated while fast-forward warms the
+ * simulated machine */
+static inline void gen_warm_mem(TCGv a0, int is_write)
+{
+    TCGv_i32 t_write;
+
+    if (!ptl_fast_fwd_warming)
+        return;
+
+    t_write = tcg_const_i32(is_write);
+    gen_helper_warm_mem(a0, t_write);
+    tcg_temp_free_i32(t_write);
+}
+
+static inline void gen_warm_branch(target_ulong next_eip, TCGv target,
+                                   int type)
+{
+    TCGv t_next;
+    TCGv_i32 t_type;
+
+    if (!ptl_fast_fwd_warming)
+        return;
+
+    t_next = tcg_const_tl(next_eip);
+    t_type = tcg_const_i32(type);
+    gen_helper_warm_branch(t_next, target, t_type);
+    tcg_temp_free(t_next);
+    tcg_temp_free_i32(t_type);
+}
+
+static inline void gen_warm_branch_im(target_ulong next_eip,
+                                      target_ulong target, int type)
+{
+    TCGv t_target;
+
+    if (!ptl_fast_fwd_warming)
+        return;
+
+    t_target = tcg_const_tl(target);
+    gen_warm_branch(next_eip, t_target, type);
+    tcg_temp_free(t_target);
+}
+#endif
+
 static inline void gen_op_lds_T0_A0(int idx)
 {
     int mem_index = (idx >> 2) - 1;
+#ifdef MARSS_QEMU
+    gen_warm_mem(cpu_A0, 0);
+#endif
     switch(idx & 3) {
     case 0:
         tcg_gen_qemu_ld8s(cpu_T[0], cpu_A0, mem_index);
@@ -516,6 +564,9 @@ static inline void gen_op_lds_T0_A0(int idx)
 static inline void gen_op_ld_v(int idx, TCGv t0, TCGv a0)
 {
     int mem_index = (idx >> 2) - 1;
+#ifdef MARSS_QEMU
+    gen_warm_mem(a0, 0);
+#endif
     switch(idx & 3) {
     case 0:
         tcg_gen_qemu_ld8u(t0, a0, mem_index);
@@ -555,6 +606,9 @@ static inline void gen_op_ld_T1_A0(int idx)
 static inline void gen_op_st_v(int idx, TCGv t0, TCGv a0)
 {
     int mem_index = (idx >> 2) - 1;
+#ifdef MARSS_QEMU
+    gen_warm_mem(a0, 1);
+#endif
     switch(idx & 3) {
     case 0:
         tcg_gen_qemu_st8(t0, a0, mem_index);
@@ -2297,9 +2351,15 @@ static inline void gen_jcc(DisasContext *s, int b,
         l1 = gen_new_label();
         gen_jcc1(s, cc_op, b, l1);
         
+#ifdef MARSS_QEMU
+        gen_warm_branch_im(next_eip, next_eip, PTL_WARM_BRANCH_COND);
+#endif
         gen_goto_tb(s, 0, next_eip);
 
         gen_set_label(l1);
+#ifdef MARSS_QEMU
+        gen_warm_branch_im(next_eip, val, PTL_WARM_BRANCH_COND);
+#endif
         gen_goto_tb(s, 1, val);
         s->is_jmp = DISAS_TB_JUMP;
     } else {
@@ -2308,10 +2368,16 @@ static inline void gen_jcc(DisasContext *s, int b,
         l2 = gen_new_label();
         gen_jcc1(s, cc_op, b, l1);
 
+#ifdef MARSS_QEMU
+        gen_warm_branch_im(next_eip, next_eip, PTL_WARM_BRANCH_COND);
+#endif
         gen_jmp_im(next_eip);
         tcg_gen_br(l2);
 
         gen_set_label(l1);
+#ifdef MARSS_QEMU
+        gen_warm_branch_im(next_eip, val, PTL_WARM_BRANCH_COND);
+#endif
         gen_jmp_im(val);
         gen_set_label(l2);
         gen_eob(s);
@@ -4626,6 +4692,10 @@ static target_ulong disas_insn(DisasContext *s, target_ulong pc_start)
             next_eip = s->pc - s->cs_base;
             gen_movtl_T1_im(next_eip);
             gen_push_T1(s);
+#ifdef MARSS_QEMU
+            gen_warm_branch(next_eip, cpu_T[0],
+                            PTL_WARM_BRANCH_INDIRECT | PTL_WARM_BRANCH_CALL);
+#endif
             gen_op_jmp_T0();
             gen_eob(s);
             break;
@@ -4653,6 +4723,10 @@ static target_ulong disas_insn(DisasContext *s, target_ulong pc_start)
         case 4: /* jmp Ev */
             if (s->dflag == 0)
                 gen_op_andl_T0_ffff();
+#ifdef MARSS_QEMU
+            gen_warm_branch(s->pc - s->cs_base, cpu_T[0],
+                            PTL_WARM_BRANCH_INDIRECT);
+#endif
             gen_op_jmp_T0();
             gen_eob(s);
             break;
@@ -6180,6 +6254,10 @@ static target_ulong disas_insn(DisasContext *s, target_ulong pc_start)
         gen_stack_update(s, val + (2 << s->dflag));
         if (s->dflag == 0)
             gen_op_andl_T0_ffff();
+#ifdef MARSS_QEMU
+        gen_warm_branch(s->pc - s->cs_base, cpu_T[0],
+                        PTL_WARM_BRANCH_INDIRECT | PTL_WARM_BRANCH_RET);
+#endif
         gen_op_jmp_T0();
         gen_eob(s);
         break;
@@ -6188,6 +6266,10 @@ static target_ulong disas_insn(DisasContext *s, target_ulong pc_start)
         gen_pop_update(s);
         if (s->dflag == 0)
             gen_op_andl_T0_ffff();
+#ifdef MARSS_QEMU
+        gen_warm_branch(s->pc - s->cs_base, cpu_T[0],
+                        PTL_WARM_BRANCH_INDIRECT | PTL_WARM_BRANCH_RET);
+#endif
         gen_op_jmp_T0();
         gen_eob(s);
         break;
@@ -6259,6 +6341,9 @@ static target_ulong disas_insn(DisasContext *s, target_ulong pc_start)
                 tval &= 0xffffffff;
             gen_movtl_T0_im(next_eip);
             gen_push_T0(s);
+#ifdef MARSS_QEMU
+            gen_warm_branch_im(next_eip, tval, PTL_WARM_BRANCH_CALL);
+#endif
             gen_jmp(s, tval);
         }
         break;
@@ -6286,6 +6371,9 @@ static target_ulong disas_insn(DisasContext *s, target_ulong pc_start)
             tval &= 0xffff;
         else if(!CODE64(s))
             tval &= 0xffffffff;
+#ifdef MARSS_QEMU
+        gen_warm_branch_im(s->pc - s->cs_base, tval, PTL_WARM_BRANCH_UNCOND);
+#endif
         gen_jmp(s, tval);
         break;
     case 0xea: /* ljmp im */
@@ -6307,6 +6395,9 @@ static target_ulong disas_insn(DisasContext *s, target_ulong pc_start)
         tval += s->pc - s->cs_base;
         if (s->dflag == 0)
             tval &= 0xffff;
+#ifdef MARSS_QEMU
+        gen_warm_branch_im(s->pc - s->cs_base, tval, PTL_WARM_BRANCH_UNCOND);
+#endif
         gen_jmp(s, tval);
         break;
     case 0x70 ... 0x7f: /* jcc Jb */
@@ -7741,6 +7832,15 @@ static void gen_simpoint_check_start(CPUState *env, DisasContext *dc)
     }
 }
 
+static void gen_bbv_count(TranslationBlock *tb)
+{
+    if (ptl_bbv_enabled) {
+        TCGv_ptr tb_ptr = tcg_const_ptr((tcg_target_long)tb);
+        gen_helper_bbv_count(tb_ptr);
+        tcg_temp_free_ptr(tb_ptr);
+    }
+}
+
 static void gen_simpoint_check_end(CPUState* env, DisasContext *dc, int num_insns)
 {
     if (env->simpoint_decr) {
@@ -7764,6 +7864,9 @@ static inline void gen_intermediate_code_internal(CPUState *env,
 {
     DisasContext dc1, *dc = &dc1;
     target_ulong pc_ptr;
+#ifdef MARSS_QEMU
+    target_ulong last_pc = 0;
+#endif
     uint16_t *gen_opc_end;
     CPUBreakpoint *bp;
     int j, lj;
@@ -7848,6 +7951,7 @@ static inline void gen_intermediate_code_internal(CPUState *env,
     gen_icount_start();
 #ifdef MARSS_QEMU
     gen_simpoint_check_start(env, dc);
+    gen_bbv_count(tb);
 #endif
     for(;;) {
         if (unlikely(!QTAILQ_EMPTY(&env->breakpoints))) {
@@ -7874,6 +7978,17 @@ static inline void gen_intermediate_code_internal(CPUState *env,
         if (num_insns + 1 == max_insns && (tb->cflags & CF_LAST_IO))
             gen_io_start();
 
+#ifdef MARSS_QEMU
+        /* Warm instruction cache once for each line of the block */
+        if (ptl_fast_fwd_warming &&
+                (pc_ptr == pc_start || (pc_ptr >> 6) != (last_pc >> 6))) {
+            TCGv t_pc = tcg_const_tl(pc_ptr);
+            gen_helper_warm_fetch(t_pc);
+            tcg_temp_free(t_pc);
+        }
+        last_pc = pc_ptr;
+#endif
+
         pc_ptr = disas_insn(dc, pc_ptr);
         num_insns++;
         /* stop translation if indicated */
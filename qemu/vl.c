@@ -1265,6 +1265,16 @@ static int qemu_vmstop_requested(void)
     return r;
 }
 
+#ifdef MARSS_QEMU
+/* Non-zero while a reset, shutdown, powerdown, debug or stop request waits
+ * for the main loop, without clearing it */
+int qemu_system_request_pending(void)
+{
+    return reset_requested || shutdown_requested || powerdown_requested ||
+        debug_requested || vmstop_requested;
+}
+#endif
+
 void qemu_register_reset(QEMUResetHandler *func, void *opaque)
 {
     QEMUResetEntry *re = qemu_mallocz(sizeof(QEMUResetEntry));
@@ -0,0 +1,77 @@
+# Error Compare Plugin
+#
+# Compare stats of runs that started from the same checkpoint, for example a
+# lockstep run against a parallel quantum run, and print relative error of
+# each stat against the first stats file.
+#
+# A quantum run on one host thread is deterministic, so its error is a fixed
+# property of the quantum length. With more than one host thread (only in
+# quantum=1 builds) cores take the shared access lock in host timing order,
+# so the stats and the error change from run to run: compare a few runs.
+# util/parallel_speedup.py with '-Q' runs a checkpoint in both modes and
+# prints this error along with the speedup of quantum mode over lockstep.
+
+import sys
+mstats = sys.modules['__main__']
+
+class ErrorCompareWriter(mstats.Writers):
+    '''Print relative error of all stats against first stats file'''
+
+    def set_options(self, parser):
+        parser.add_option("--compare-error", action="store_true",
+                default=False,
+                help="Print relative error of stats against first file")
+        parser.add_option("--compare-error-min", type="float", default=0.0,
+                dest="compare_error_min",
+                help="Only print stats with error above this percentage")
+
+    def flatten(self, node, pfx, out):
+        if type(node) == dict:
+            for key,val in node.items():
+                if str(key).startswith('_'):
+                    continue
+                name = "%s::%s" % (pfx, key) if pfx else str(key)
+                self.flatten(val, name, out)
+        elif type(node) == list:
+            for idx in range(len(node)):
+                self.flatten(node[idx], "%s[%d]" % (pfx, idx), out)
+        elif type(node) in (int, long, float):
+            out[pfx] = node
+
+    def write(self, stats, options):
+        if not options.compare_error:
+            return
+
+        if len(stats) < 2:
+            mstats.error("--compare-error needs at least two stats files")
+
+        ref = {}
+        self.flatten(stats[0], None, ref)
+
+        for stat in stats[1:]:
+            cur = {}
+            self.flatten(stat, None, cur)
+
+            print("%s vs %s:" % (stat.get('_name', '?'),
+                stats[0].get('_name', '?')))
+
+            total = 0.0
+            count = 0
+            for key in sorted(ref.keys()):
+                if key not in cur:
+                    continue
+
+                if ref[key] == 0:
+                    err = 0.0 if cur[key] == 0 else 100.0
+                else:
+                    err = abs(float(cur[key] - ref[key])) / abs(ref[key]) * 100
+
+                total += err
+                count += 1
+
+                if err > options.compare_error_min:
+                    print("  %s: %s %s %.4f%%" % (key, ref[key], cur[key], err))
+
+            if count:
+                print("  Mean error of %d stats: %.4f%%" % (count,
+                    total / count))
@@ -0,0 +1,147 @@
+#!/usr/bin/env python
+#
+# Measure speedup of parallel core simulation on a checkpoint
+#
+# Runs the same checkpoint once for each number of host threads given with
+# '-t' (default 1, 2, 4, 8 and 16) using '-parallel-threads', and prints the
+# wall clock time of each run and its speedup over the serial run. Stats of
+# each run are written to '<out dir>/threads-<n>.yml'.
+#
+# With '-Q <cycles>' each thread count is also run in parallel quantum mode
+# with that quantum. The script prints the speedup of each quantum run over
+# the lockstep run with the same number of threads, and the relative error
+# of its stats against the lockstep stats using mstats '--compare-error'.
+# More than one host thread in quantum mode needs a 'quantum=1' build.
+#
+# Parallel mode is only used with more than one simulated core, so use a
+# machine with at least as many cores as the largest thread count, and a
+# host with that many CPUs: threads are limited to the number of host CPUs.
+#
+# Example:
+#   parallel_speedup.py -q qemu/qemu-system-x86_64 -i disk.qcow2 \
+#       -c parsec_canneal -m shared_l2 -n 100000000 -o speedup
+#   parallel_speedup.py ... -t 4 -Q 100 -Q 1000 -o quantum
+#
+
+import os
+import sys
+import time
+import subprocess
+from optparse import OptionParser
+
+
+def write_simconfig(options, name, extra):
+    '''Write simconfig file of one run, returns (simconfig file, stats file)'''
+    stats_file = os.path.join(options.out_dir, "%s.yml" % name)
+    log_file = os.path.join(options.out_dir, "%s.log" % name)
+    simcfg_file = os.path.join(options.out_dir, "%s.simcfg" % name)
+
+    with open(simcfg_file, 'w') as f:
+        f.write("-run -kill-after-run -quiet\n")
+        f.write("-machine %s\n" % options.machine)
+        f.write("-logfile %s\n" % log_file)
+        f.write("-yamlstats %s\n" % stats_file)
+        if options.insns:
+            f.write("-stopinsns %d\n" % options.insns)
+        if options.simconfig:
+            f.write("%s\n" % options.simconfig)
+        f.write("%s\n" % extra)
+
+    return simcfg_file, stats_file
+
+
+def run_checkpoint(options, name, extra):
+    '''Run checkpoint with given simconfig options, returns wall clock time'''
+    simcfg_file, stats_file = write_simconfig(options, name, extra)
+
+    cmd = [options.qemu, '-m', str(options.memory), '-nographic',
+            '-snapshot', '-drive', 'cache=unsafe,file=%s' % options.image,
+            '-simconfig', simcfg_file, '-loadvm', options.checkpoint]
+    if options.qemu_args:
+        cmd.extend(options.qemu_args.split())
+
+    with open(os.path.join(options.out_dir, "%s.out" % name), 'w') as out:
+        start = time.time()
+        ret = subprocess.call(cmd, stdout=out, stderr=subprocess.STDOUT,
+                stdin=open(os.devnull))
+        elapsed = time.time() - start
+
+    if ret != 0:
+        print("Run %s failed with exit code %d, see %s.out" % (name, ret,
+            name))
+        sys.exit(1)
+
+    return elapsed
+
+
+def compare_quantum(options, threads, times):
+    '''Run each thread count in quantum mode and compare with lockstep'''
+    mstats = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+            "mstats.py")
+
+    for n in threads:
+        stats = [os.path.join(options.out_dir, "threads-%d.yml" % n)]
+
+        for q in options.quantum:
+            name = "threads-%d-quantum-%d" % (n, q)
+            elapsed = run_checkpoint(options, name,
+                    "-parallel-threads %d -parallel-quantum %d" % (n, q))
+            print("%d threads, quantum %d: %.2f seconds, speedup over "
+                    "lockstep %.2f" % (n, q, elapsed, times[n] / elapsed))
+            stats.append(os.path.join(options.out_dir, "%s.yml" % name))
+
+        subprocess.call([sys.executable, mstats, "-y", "--compare-error",
+            "--compare-error-min", str(options.error_min)] + stats)
+
+
+def main():
+    parser = OptionParser(usage="%prog [options]")
+    parser.add_option("-q", "--qemu", help="MARSS qemu binary")
+    parser.add_option("-i", "--image", help="Disk image with the checkpoint")
+    parser.add_option("-c", "--checkpoint", help="Checkpoint name")
+    parser.add_option("-m", "--machine", help="Machine configuration name")
+    parser.add_option("-n", "--insns", type="int", default=0,
+            help="Stop after this many instructions")
+    parser.add_option("-t", "--threads", type="int", action="append",
+            help="Number of host threads, can be given multiple times")
+    parser.add_option("-Q", "--quantum", type="int", action="append",
+            help="Parallel quantum in cycles, can be given multiple times")
+    parser.add_option("-o", "--out-dir", dest="out_dir", default=".",
+            help="Directory for simconfig, log and stats files")
+    parser.add_option("-s", "--simconfig", default="",
+            help="Additional simconfig options for all runs")
+    parser.add_option("--error-min", dest="error_min", type="float",
+            default=1.0, help="Only print stats with error above this "
+            "percentage")
+    parser.add_option("--memory", default="1024", help="VM memory size")
+    parser.add_option("--qemu-args", dest="qemu_args", default="",
+            help="Additional qemu arguments")
+
+    (options, args) = parser.parse_args()
+    for opt in ['qemu', 'image', 'checkpoint', 'machine']:
+        if not getattr(options, opt):
+            parser.error("Option --%s is required" % opt)
+
+    threads = options.threads or [1, 2, 4, 8, 16]
+    if 1 not in threads:
+        threads.insert(0, 1)
+
+    if not os.path.exists(options.out_dir):
+        os.makedirs(options.out_dir)
+
+    times = {}
+    for n in threads:
+        times[n] = run_checkpoint(options, "threads-%d" % n,
+                "-parallel-threads %d" % n)
+        print("%d threads: %.2f seconds" % (n, times[n]))
+
+    print("Speedup over serial run:")
+    for n in threads:
+        print("  %2d threads: %.2f" % (n, times[1] / times[n]))
+
+    if options.quantum:
+        compare_quantum(options, threads, times)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,206 @@
+#!/usr/bin/env python
+#
+# Pick simulation points from basic block vectors
+#
+# Reads the basic block vector file written by MARSS with '-bbv-file', one
+# line per '-simpoint-interval' instructions, clusters the intervals with
+# k-means and writes the simpoint and weight files in SimPoint's format:
+#
+#   simpoints file: <interval> <cluster>
+#   weights file:   <weight> <cluster>
+#
+# The simpoints file can be given to MARSS with '-simpoint' to create a
+# checkpoint at the start of each simulation point, using the same
+# '-simpoint-interval'. Clustering follows SimPoint: vectors are normalized,
+# randomly projected to a few dimensions and the smallest number of
+# clusters whose BIC score is within a threshold of the best is used.
+#
+# Needs numpy, on ubuntu it is in package: python-numpy
+
+import sys
+import math
+from optparse import OptionParser
+
+import numpy
+
+
+def read_bbv(filename):
+    '''Read basic block vectors, returns list of {block id: count}'''
+    vectors = []
+    with open(filename) as f:
+        for line in f:
+            line = line.strip()
+            if not line.startswith('T'):
+                continue
+
+            vec = {}
+            for entry in line[1:].split():
+                _, bbid, count = entry.split(':')
+                vec[int(bbid)] = vec.get(int(bbid), 0) + int(count)
+            vectors.append(vec)
+    return vectors
+
+
+def project(vectors, dim, rand):
+    '''Normalize vectors and randomly project them to dim dimensions'''
+    max_id = max([max(v.keys()) for v in vectors if v] or [0])
+    proj = rand.uniform(-1.0, 1.0, (max_id + 1, dim))
+
+    data = numpy.zeros((len(vectors), dim))
+    for i, vec in enumerate(vectors):
+        total = float(sum(vec.values()))
+        if total == 0:
+            continue
+        for bbid, count in vec.items():
+            data[i] += proj[bbid] * (count / total)
+    return data
+
+
+def distances(data, centers):
+    '''Squared distance of every point to every center'''
+    diff = data[:, numpy.newaxis, :] - centers[numpy.newaxis, :, :]
+    return (diff * diff).sum(axis=2)
+
+
+def kmeans(data, k, rand, iterations):
+    '''Cluster data into k clusters, returns (labels, centers, distortion)'''
+    n = len(data)
+
+    # Furthest-first initialization from a random point
+    centers = [data[rand.randint(n)]]
+    dist = ((data - centers[0]) ** 2).sum(axis=1)
+    for i in range(1, k):
+        centers.append(data[dist.argmax()])
+        dist = numpy.minimum(dist, ((data - centers[-1]) ** 2).sum(axis=1))
+    centers = numpy.array(centers)
+
+    labels = None
+    for it in range(iterations):
+        new_labels = distances(data, centers).argmin(axis=1)
+        if labels is not None and (new_labels == labels).all():
+            break
+        labels = new_labels
+
+        for c in range(k):
+            members = data[labels == c]
+            if len(members):
+                centers[c] = members.mean(axis=0)
+
+    dist = distances(data, centers)
+    distortion = dist[numpy.arange(n), labels].sum()
+    return labels, centers, distortion
+
+
+def bic(data, labels, k, distortion):
+    '''Bayesian Information Criterion of a clustering, as in X-means'''
+    n, dim = data.shape
+    if n <= k:
+        return float('-inf')
+
+    variance = distortion / float(n - k)
+    if variance <= 0:
+        variance = 1e-300
+
+    loglike = 0.0
+    for c in range(k):
+        size = float((labels == c).sum())
+        if size == 0:
+            continue
+        loglike += (-size / 2.0 * math.log(2 * math.pi) -
+                size * dim / 2.0 * math.log(variance) -
+                (size - k) / 2.0 + size * math.log(size) -
+                size * math.log(n))
+
+    params = (k - 1) + dim * k + 1
+    return loglike - params / 2.0 * math.log(n)
+
+
+def pick_simpoints(data, options):
+    '''Returns list of (interval, cluster, weight)'''
+    rand = numpy.random.RandomState(options.seed)
+    n = len(data)
+    runs = []
+
+    # A single interval represents the whole run
+    if n < 2:
+        return [(0, 0, 1.0)] if n else []
+
+    for k in range(1, min(options.max_k, n) + 1):
+        best = None
+        for r in range(options.restarts):
+            labels, centers, distortion = kmeans(data, k, rand,
+                    options.iterations)
+            if best is None or distortion < best[2]:
+                best = (labels, centers, distortion)
+        score = bic(data, best[0], k, best[2])
+        runs.append((k, score, best[0], best[1]))
+
+    scores = [r[1] for r in runs if r[1] != float('-inf')]
+    if scores:
+        low, high = min(scores), max(scores)
+        limit = low + options.bic_threshold * (high - low)
+        k, score, labels, centers = [r for r in runs if r[1] >= limit][0]
+    else:
+        # No clustering could be scored, keep all intervals in one
+        k, score, labels, centers = runs[0]
+
+    points = []
+    dist = distances(data, centers)
+    for c in range(k):
+        members = numpy.nonzero(labels == c)[0]
+        if len(members) == 0:
+            continue
+        closest = members[dist[members, c].argmin()]
+        points.append((int(closest), c, len(members) / float(n)))
+
+    points.sort()
+    return points
+
+
+def main():
+    parser = OptionParser(usage="%prog [options] -b <bbv file>")
+    parser.add_option("-b", "--bbv", dest="bbv",
+            help="Basic block vector file written by -bbv-file")
+    parser.add_option("-s", "--simpoints", dest="simpoints",
+            default="simpoints", help="Output simpoints file")
+    parser.add_option("-w", "--weights", dest="weights",
+            default="weights", help="Output weights file")
+    parser.add_option("-k", "--max-k", dest="max_k", type="int", default=10,
+            help="Maximum number of clusters")
+    parser.add_option("--dim", type="int", default=15,
+            help="Dimensions of randomly projected vectors")
+    parser.add_option("--iterations", type="int", default=100,
+            help="Maximum k-means iterations")
+    parser.add_option("--restarts", type="int", default=5,
+            help="Number of k-means runs with different seeds for each k")
+    parser.add_option("--bic-threshold", dest="bic_threshold", type="float",
+            default=0.9, help="Use smallest k with BIC above this fraction")
+    parser.add_option("--seed", type="int", default=493575226,
+            help="Random seed")
+
+    (options, args) = parser.parse_args()
+    if not options.bbv:
+        parser.error("Basic block vector file is required")
+
+    vectors = read_bbv(options.bbv)
+    if not vectors:
+        print("No intervals found in %s" % options.bbv)
+        sys.exit(1)
+
+    data = project(vectors, options.dim,
+            numpy.random.RandomState(options.seed))
+    points = pick_simpoints(data, options)
+
+    with open(options.simpoints, 'w') as f:
+        for interval, cluster, weight in points:
+            f.write("%d %d\n" % (interval, cluster))
+
+    with open(options.weights, 'w') as f:
+        for interval, cluster, weight in points:
+            f.write("%f %d\n" % (weight, cluster))
+
+    print("%d intervals, %d simulation points" % (len(vectors), len(points)))
+
+
+if __name__ == "__main__":
+    main()